@@ -59,6 +59,7 @@
 #define DEFAULT_QUEUE_BASE	(0)
 
 #define QDMA_MAX_BURST_SIZE (128)
+#define QDMA_TX_FREE_BULK_SIZE (64)
 #define QDMA_MIN_RXBUFF_SIZE	(256)
 
 /* Descriptor Rings aligned to 4KB boundaries - only supported value */
@@ -403,6 +404,7 @@ struct rte_memzone *qdma_zone_reserve(struct rte_eth_dev *dev,
 bool is_qdma_supported(struct rte_eth_dev *dev);
 bool is_vf_device_supported(struct rte_eth_dev *dev);
 bool is_pf_device_supported(struct rte_eth_dev *dev);
+bool is_qdma_sim_device(struct rte_eth_dev *dev);
 
 void qdma_check_errors(void *arg);
 #endif /* ifndef __QDMA_H__ */
@@ -903,12 +903,13 @@ is_pf_device_supported(struct rte_eth_dev *dev)
 
 bool is_qdma_supported(struct rte_eth_dev *dev)
 {
-	bool is_pf, is_vf;
+	bool is_pf, is_vf, is_sim;
 
 	is_pf = is_pf_device_supported(dev);
 	is_vf = is_vf_device_supported(dev);
+	is_sim = is_qdma_sim_device(dev);
 
-	if (!is_pf && !is_vf)
+	if (!is_pf && !is_vf && !is_sim)
 		return false;
 
 	return true;
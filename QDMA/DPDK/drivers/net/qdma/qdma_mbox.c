@@ -36,6 +36,9 @@
 #include <rte_malloc.h>
 #include <rte_spinlock.h>
 #include <rte_alarm.h>
+#include <rte_cycles.h>
+#include <time.h>
+#include <errno.h>
 
 /*
  * Get index from VF info array of PF device for a given VF funcion id.
@@ -212,12 +215,32 @@ static void qdma_mbox_process_msg_from_pf(void *arg)
 	}
 }
 
+/*
+ * Unlink a message from the tx/rx list it is queued on. The node links are
+ * cleared so that the message can be unlinked again safely by a waiter that
+ * gave up on it.
+ */
+static void qdma_mbox_list_del(struct qdma_list_head *entry)
+{
+	qdma_list_del(entry);
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+static void qdma_mbox_wake_waiters(struct qdma_pci_dev *qdma_dev)
+{
+	pthread_mutex_lock(&qdma_dev->mbox.rsp_lock);
+	pthread_cond_broadcast(&qdma_dev->mbox.rsp_cond);
+	pthread_mutex_unlock(&qdma_dev->mbox.rsp_lock);
+}
+
 static void qdma_mbox_process_rsp_from_pf(void *arg)
 {
 	struct rte_eth_dev *dev = (struct rte_eth_dev *)arg;
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
 	struct qdma_list_head *entry = NULL;
 	struct qdma_list_head *tmp = NULL;
+	int found = 0;
 
 	if (!qdma_dev)
 		return;
@@ -240,21 +263,32 @@ static void qdma_mbox_process_rsp_from_pf(void *arg)
 			memcpy(msg->raw_data, qdma_dev->mbox.rx_data,
 			       MBOX_MSG_REG_MAX * sizeof(uint32_t));
 			msg->rsp_rcvd = 1;
-			qdma_list_del(entry);
+			qdma_mbox_list_del(entry);
+			found = 1;
 			break;
 		}
 	}
 	rte_spinlock_unlock(&qdma_dev->mbox.list_lock);
+
+	if (found)
+		qdma_mbox_wake_waiters(qdma_dev);
 }
 
-static void qdma_mbox_rcv_task(void *arg)
+/*
+ * Drain all messages present in the incoming mailbox.
+ * Returns the number of messages processed. When @try_lock is set, the
+ * function returns immediately if another context is already receiving.
+ */
+static int qdma_mbox_rcv_poll(struct rte_eth_dev *dev, int try_lock)
 {
-	struct rte_eth_dev *dev = (struct rte_eth_dev *)arg;
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
-	int rv;
+	int rv, cnt = 0;
 
-	if (!qdma_dev)
-		return;
+	if (try_lock) {
+		if (!rte_spinlock_trylock(&qdma_dev->mbox.rx_lock))
+			return 0;
+	} else
+		rte_spinlock_lock(&qdma_dev->mbox.rx_lock);
 
 	do {
 		memset(qdma_dev->mbox.rx_data, 0,
@@ -264,39 +298,76 @@ static void qdma_mbox_rcv_task(void *arg)
 		if (rv < 0)
 			break;
 		if (qdma_dev->is_vf) {
-			qdma_mbox_process_msg_from_pf(arg);
-			qdma_mbox_process_rsp_from_pf(arg);
+			qdma_mbox_process_msg_from_pf(dev);
+			qdma_mbox_process_rsp_from_pf(dev);
 		} else
-			qdma_mbox_process_msg_from_vf(arg);
-
+			qdma_mbox_process_msg_from_vf(dev);
+		cnt++;
 	} while (1);
 
-	if (!qdma_dev->dev_cap.mailbox_intr)
-		rte_eal_alarm_set(MBOX_POLL_FRQ, qdma_mbox_rcv_task, arg);
+	rte_spinlock_unlock(&qdma_dev->mbox.rx_lock);
+
+	return cnt;
 }
 
-static void qdma_mbox_send_task(void *arg)
+static void qdma_mbox_rcv_task(void *arg)
 {
 	struct rte_eth_dev *dev = (struct rte_eth_dev *)arg;
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	int cnt;
+
+	if (!qdma_dev)
+		return;
+
+	cnt = qdma_mbox_rcv_poll(dev, 0);
+	if (qdma_dev->dev_cap.mailbox_intr)
+		return;
+
+	/* Without mailbox interrupts, keep polling at a short interval
+	 * while the peer is active, since control path operations come
+	 * in bursts (e.g. queue setup for all the queues of a port).
+	 */
+	if (cnt)
+		qdma_dev->mbox.fast_poll_cnt = MBOX_POLL_FAST_CNT;
+	if (qdma_dev->mbox.fast_poll_cnt) {
+		qdma_dev->mbox.fast_poll_cnt--;
+		rte_eal_alarm_set(MBOX_POLL_FAST_FRQ, qdma_mbox_rcv_task, arg);
+	} else
+		rte_eal_alarm_set(MBOX_POLL_FRQ, qdma_mbox_rcv_task, arg);
+}
+
+static void qdma_mbox_send_task(void *arg);
+
+/*
+ * Push all queued messages to the hardware mailbox in one pass.
+ * Must be called with list_lock held. Messages which could not be sent
+ * because the outgoing mailbox is still occupied are retried from an
+ * alarm after MBOX_TX_RETRY_FRQ.
+ */
+static int qdma_mbox_tx_flush(struct rte_eth_dev *dev)
+{
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
 	struct qdma_list_head *entry = NULL;
 	struct qdma_list_head *tmp = NULL;
-	int rv;
+	uint64_t now = rte_get_timer_cycles();
+	int rv, wake = 0;
 
-	rte_spinlock_lock(&qdma_dev->mbox.list_lock);
 	qdma_list_for_each_safe(entry, tmp, &qdma_dev->mbox.tx_todo_list) {
 		struct qdma_mbox_msg *msg = QDMA_LIST_GET_DATA(entry);
 
 		rv = qdma_mbox_send(dev, qdma_dev->is_vf, msg->raw_data);
 		if (rv < 0) {
-			msg->retry_cnt--;
-			if (!msg->retry_cnt) {
-				qdma_list_del(entry);
+			if (now >= msg->expire_tsc) {
+				qdma_mbox_list_del(entry);
 				if (msg->rsp_wait == QDMA_MBOX_RSP_NO_WAIT)
 					qdma_mbox_msg_free(msg);
+				else {
+					msg->tx_err = 1;
+					wake = 1;
+				}
 			}
 		} else {
-			qdma_list_del(entry);
+			qdma_mbox_list_del(entry);
 			if (msg->rsp_wait == QDMA_MBOX_RSP_WAIT)
 				qdma_list_add_tail(entry,
 					   &qdma_dev->mbox.rx_pend_list);
@@ -304,37 +375,118 @@ static void qdma_mbox_send_task(void *arg)
 				qdma_mbox_msg_free(msg);
 		}
 	}
-	if (!qdma_list_is_empty(&qdma_dev->mbox.tx_todo_list))
-		rte_eal_alarm_set(MBOX_POLL_FRQ, qdma_mbox_send_task, arg);
+
+	if (!qdma_list_is_empty(&qdma_dev->mbox.tx_todo_list) &&
+			!qdma_dev->mbox.tx_retry_armed) {
+		qdma_dev->mbox.tx_retry_armed = 1;
+		rte_eal_alarm_set(MBOX_TX_RETRY_FRQ, qdma_mbox_send_task, dev);
+	}
+
+	return wake;
+}
+
+static void qdma_mbox_send_task(void *arg)
+{
+	struct rte_eth_dev *dev = (struct rte_eth_dev *)arg;
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	int wake;
+
+	rte_spinlock_lock(&qdma_dev->mbox.list_lock);
+	qdma_dev->mbox.tx_retry_armed = 0;
+	wake = qdma_mbox_tx_flush(dev);
 	rte_spinlock_unlock(&qdma_dev->mbox.list_lock);
+
+	if (wake)
+		qdma_mbox_wake_waiters(qdma_dev);
+}
+
+static void qdma_mbox_wait_rsp(struct rte_eth_dev *dev,
+			       struct qdma_mbox_msg *msg)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	struct timespec ts;
+	uint64_t now, slice_us;
+
+	pthread_mutex_lock(&qdma_dev->mbox.rsp_lock);
+	while (!msg->rsp_rcvd && !msg->tx_err) {
+		now = rte_get_timer_cycles();
+		if (now >= msg->expire_tsc)
+			break;
+
+		if (!qdma_dev->dev_cap.mailbox_intr) {
+			/* No interrupt to wake us up, receive inline */
+			pthread_mutex_unlock(&qdma_dev->mbox.rsp_lock);
+			if (!qdma_mbox_rcv_poll(dev, 1))
+				rte_delay_us(MBOX_RSP_POLL_FRQ);
+			pthread_mutex_lock(&qdma_dev->mbox.rsp_lock);
+			continue;
+		}
+
+		/* Response is delivered from the mailbox interrupt. Sleep
+		 * in slices of MBOX_POLL_FRQ and look at the mailbox on
+		 * every slice expiry, so that a lost interrupt only costs
+		 * one slice.
+		 */
+		slice_us = ((msg->expire_tsc - now) * US_PER_S) /
+				rte_get_timer_hz();
+		if (slice_us > MBOX_POLL_FRQ)
+			slice_us = MBOX_POLL_FRQ;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_nsec += (slice_us + 1) * 1000;
+		ts.tv_sec += ts.tv_nsec / NS_PER_S;
+		ts.tv_nsec %= NS_PER_S;
+		if (pthread_cond_timedwait(&qdma_dev->mbox.rsp_cond,
+				&qdma_dev->mbox.rsp_lock, &ts) == ETIMEDOUT) {
+			pthread_mutex_unlock(&qdma_dev->mbox.rsp_lock);
+			qdma_mbox_rcv_poll(dev, 1);
+			pthread_mutex_lock(&qdma_dev->mbox.rsp_lock);
+		}
+	}
+	pthread_mutex_unlock(&qdma_dev->mbox.rsp_lock);
 }
 
 int qdma_mbox_msg_send(struct rte_eth_dev *dev, struct qdma_mbox_msg *msg,
-		       unsigned int timeout_ms)
+		       unsigned int timeout_us)
 {
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	int wake;
 
 	if (!msg)
 		return -EINVAL;
 
-	msg->retry_cnt = timeout_ms ? ((timeout_ms / MBOX_POLL_FRQ) + 1) :
-			MBOX_SEND_RETRY_COUNT;
+	msg->rsp_rcvd = 0;
+	msg->tx_err = 0;
+	msg->expire_tsc = rte_get_timer_cycles() +
+		((uint64_t)(timeout_us ? timeout_us : MBOX_OP_RSP_TIMEOUT) *
+		 rte_get_timer_hz()) / US_PER_S;
+	msg->rsp_wait = (!timeout_us) ? QDMA_MBOX_RSP_NO_WAIT :
+			QDMA_MBOX_RSP_WAIT;
 	QDMA_LIST_SET_DATA(&msg->node, msg);
 
+	/* Send right away together with anything else that is queued,
+	 * rather than deferring to an alarm
+	 */
 	rte_spinlock_lock(&qdma_dev->mbox.list_lock);
 	qdma_list_add_tail(&msg->node, &qdma_dev->mbox.tx_todo_list);
+	wake = qdma_mbox_tx_flush(dev);
 	rte_spinlock_unlock(&qdma_dev->mbox.list_lock);
 
-	msg->rsp_wait = (!timeout_ms) ? QDMA_MBOX_RSP_NO_WAIT :
-			QDMA_MBOX_RSP_WAIT;
-	rte_eal_alarm_set(MBOX_POLL_FRQ, qdma_mbox_send_task, dev);
+	if (wake)
+		qdma_mbox_wake_waiters(qdma_dev);
 
-	if (!timeout_ms)
+	if (!timeout_us)
 		return 0;
 
 	/* if code reached here, caller should free the buffer */
-	while (msg->retry_cnt && !msg->rsp_rcvd)
-		rte_delay_ms(1);
+	qdma_mbox_wait_rsp(dev, msg);
+
+	/* On failure make sure the message is no longer referenced by
+	 * the tx or rx lists before handing it back to the caller
+	 */
+	rte_spinlock_lock(&qdma_dev->mbox.list_lock);
+	if (msg->node.next)
+		qdma_mbox_list_del(&msg->node);
+	rte_spinlock_unlock(&qdma_dev->mbox.list_lock);
 
 	if (!msg->rsp_rcvd)
 		return  -EPIPE;
@@ -358,6 +510,7 @@ int qdma_mbox_init(struct rte_eth_dev *dev)
 	struct rte_pci_device *pci_dev = RTE_ETH_DEV_TO_PCI(dev);
 	uint32_t raw_data[MBOX_MSG_REG_MAX] = {0};
 	struct rte_intr_handle *intr_handle = &pci_dev->intr_handle;
+	pthread_condattr_t cattr;
 
 	if (!qdma_dev->is_vf) {
 		int i;
@@ -371,6 +524,15 @@ int qdma_mbox_init(struct rte_eth_dev *dev)
 	qdma_list_init_head(&qdma_dev->mbox.tx_todo_list);
 	qdma_list_init_head(&qdma_dev->mbox.rx_pend_list);
 	rte_spinlock_init(&qdma_dev->mbox.list_lock);
+	rte_spinlock_init(&qdma_dev->mbox.rx_lock);
+	qdma_dev->mbox.tx_retry_armed = 0;
+	qdma_dev->mbox.fast_poll_cnt = 0;
+
+	pthread_condattr_init(&cattr);
+	pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&qdma_dev->mbox.rsp_cond, &cattr);
+	pthread_condattr_destroy(&cattr);
+	pthread_mutex_init(&qdma_dev->mbox.rsp_lock, NULL);
 
 	if (qdma_dev->dev_cap.mailbox_intr) {
 		/* Register interrupt call back handler */
@@ -420,5 +582,8 @@ void qdma_mbox_uninit(struct rte_eth_dev *dev)
 	} else {
 		rte_eal_alarm_cancel(qdma_mbox_rcv_task, (void *)dev);
 	}
+
+	pthread_cond_destroy(&qdma_dev->mbox.rsp_cond);
+	pthread_mutex_destroy(&qdma_dev->mbox.rsp_lock);
 }
 
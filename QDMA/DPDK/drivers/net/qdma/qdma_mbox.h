@@ -32,13 +32,23 @@
 #ifndef QDMA_DPDK_MBOX_H_
 #define QDMA_DPDK_MBOX_H_
 
+#include <pthread.h>
 #include "qdma_list.h"
 #include "qdma_mbox_protocol.h"
 #include <rte_ethdev.h>
 
+/* All intervals and timeouts below are in micro seconds */
 #define MBOX_POLL_FRQ 1000
 #define MBOX_OP_RSP_TIMEOUT (10000 * MBOX_POLL_FRQ) /* 10 sec */
-#define MBOX_SEND_RETRY_COUNT (MBOX_OP_RSP_TIMEOUT/MBOX_POLL_FRQ)
+/* Retry interval when the outgoing mailbox is still occupied */
+#define MBOX_TX_RETRY_FRQ 20
+/* Receive poll interval used right after mailbox activity when
+ * mailbox interrupts are not available
+ */
+#define MBOX_POLL_FAST_FRQ 20
+#define MBOX_POLL_FAST_CNT 2500 /* ~50 ms of fast polling */
+/* Inline receive poll interval of a waiter in poll mode */
+#define MBOX_RSP_POLL_FRQ 5
 
 enum qdma_mbox_rsp_state {
 	QDMA_MBOX_RSP_NO_WAIT,
@@ -49,12 +59,20 @@ struct qdma_dev_mbox {
 	struct qdma_list_head tx_todo_list;
 	struct qdma_list_head rx_pend_list;
 	rte_spinlock_t list_lock;
+	/* serializes mailbox reads and protects rx_data */
+	rte_spinlock_t rx_lock;
+	/* waiters of a response sleep on rsp_cond */
+	pthread_mutex_t rsp_lock;
+	pthread_cond_t rsp_cond;
+	uint8_t tx_retry_armed;
+	uint32_t fast_poll_cnt;
 	uint32_t rx_data[MBOX_MSG_REG_MAX];
 };
 
 struct qdma_mbox_msg {
-	uint8_t rsp_rcvd;
-	uint32_t retry_cnt;
+	volatile uint8_t rsp_rcvd;
+	volatile uint8_t tx_err;
+	uint64_t expire_tsc;
 	enum qdma_mbox_rsp_state rsp_wait;
 	uint32_t raw_data[MBOX_MSG_REG_MAX];
 	struct qdma_list_head node;
@@ -65,7 +83,7 @@ void qdma_mbox_uninit(struct rte_eth_dev *dev);
 void *qdma_mbox_msg_alloc(void);
 void qdma_mbox_msg_free(void *buffer);
 int qdma_mbox_msg_send(struct rte_eth_dev *dev, struct qdma_mbox_msg *msg,
-		       unsigned int timeout_ms);
+		       unsigned int timeout_us);
 int qdma_dev_notify_qadd(struct rte_eth_dev *dev, uint32_t qidx_hw,
 						enum qdma_dev_q_type q_type);
 int qdma_dev_notify_qdel(struct rte_eth_dev *dev, uint32_t qidx_hw,
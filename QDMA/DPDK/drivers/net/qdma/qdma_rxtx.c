@@ -146,6 +146,38 @@ static int qdma_ul_update_st_h2c_desc_v(void *qhndl, uint64_t q_offloads,
 
 	return 0;
 }
+
+/* Vector implementation to update H2C descriptors for two single segment
+ * packets in one go. Caller makes sure both descriptors fit before the
+ * end of the ring.
+ */
+static void qdma_ul_update_st_h2c_desc_x2_v(void *qhndl,
+				struct rte_mbuf *mb0, struct rte_mbuf *mb1)
+{
+	uint64_t flags = S_H2C_DESC_F_SOP | S_H2C_DESC_F_EOP;
+	uint64_t len0 = mb0->data_len;
+	uint64_t len1 = mb1->data_len;
+	uint16_t id;
+	struct qdma_ul_st_h2c_desc *tx_ring_st;
+	struct qdma_tx_queue *txq = (struct qdma_tx_queue *)qhndl;
+	__m128i desc0, desc1;
+
+	tx_ring_st = (struct qdma_ul_st_h2c_desc *)txq->tx_ring;
+	id = txq->q_pidx_info.pidx;
+
+	desc0 = _mm_set_epi64x(mb0->buf_iova + mb0->data_off,
+			len0 << 16 | len0 << 32 | flags << 48);
+	desc1 = _mm_set_epi64x(mb1->buf_iova + mb1->data_off,
+			len1 << 16 | len1 << 32 | flags << 48);
+	_mm_store_si128((__m128i *)&tx_ring_st[id], desc0);
+	_mm_store_si128((__m128i *)&tx_ring_st[id + 1], desc1);
+
+	id += 2;
+	if (unlikely(id >= (txq->nb_tx_desc - 1)))
+		id -= (txq->nb_tx_desc - 1);
+
+	txq->q_pidx_info.pidx = id;
+}
 #endif //QDMA_TX_VEC_X86_64
 
 /******** User logic dependent functions end **********/
@@ -227,40 +259,91 @@ static int dma_wb_monitor(void *xq, uint8_t dir, uint16_t expected_count)
 	return -1;
 }
 
+/* Return a batch of transmitted mbufs to their mempool */
+static inline void tx_free_bulk(struct rte_mbuf **free, uint16_t nb_free)
+{
+	if (nb_free)
+		rte_mempool_put_bulk(free[0]->pool, (void **)free, nb_free);
+}
+
+/* Free mbufs held by [id, id + cnt) of the TX SW ring. Caller makes sure
+ * the range does not wrap around the ring.
+ *
+ * Mbufs are grouped per mempool and returned with rte_mempool_put_bulk().
+ * With DEV_TX_OFFLOAD_MBUF_FAST_FREE the application guarantees that all
+ * mbufs come from one mempool with refcnt 1, so single segment mbufs skip
+ * the reference count handling altogether.
+ */
+static uint16_t reclaim_tx_ring_range(struct qdma_tx_queue *txq,
+			uint16_t id, uint16_t cnt)
+{
+	struct rte_mbuf *free[QDMA_TX_FREE_BULK_SIZE];
+	struct rte_mbuf *mb, *next;
+	uint16_t nb_free = 0;
+	uint16_t count;
+	int fast_free = !!(txq->offloads & DEV_TX_OFFLOAD_MBUF_FAST_FREE);
+
+	for (count = 0; count < cnt; count++, id++) {
+		mb = txq->sw_ring[id];
+		if (mb == NULL)
+			continue;
+		txq->sw_ring[id] = NULL;
+
+		if (likely(fast_free && mb->nb_segs == 1)) {
+			if (unlikely(nb_free == QDMA_TX_FREE_BULK_SIZE ||
+				(nb_free && mb->pool != free[0]->pool))) {
+				tx_free_bulk(free, nb_free);
+				nb_free = 0;
+			}
+			free[nb_free++] = mb;
+			continue;
+		}
+
+		do {
+			next = mb->next;
+			mb = rte_pktmbuf_prefree_seg(mb);
+			if (mb != NULL) {
+				if (unlikely(nb_free ==
+						QDMA_TX_FREE_BULK_SIZE ||
+					(nb_free &&
+					 mb->pool != free[0]->pool))) {
+					tx_free_bulk(free, nb_free);
+					nb_free = 0;
+				}
+				free[nb_free++] = mb;
+			}
+			mb = next;
+		} while (mb != NULL);
+	}
+
+	tx_free_bulk(free, nb_free);
+
+	return id;
+}
+
 static int reclaim_tx_mbuf(struct qdma_tx_queue *txq,
 			uint16_t cidx, uint16_t free_cnt)
 {
 	int fl_desc = 0;
-	uint16_t count;
+	uint16_t ring_sz = txq->nb_tx_desc - 1;
+	uint16_t first;
 	int id;
 
 	id = txq->tx_fl_tail;
 	fl_desc = (int)cidx - id;
 	if (fl_desc < 0)
-		fl_desc += (txq->nb_tx_desc - 1);
+		fl_desc += ring_sz;
 
 	if (free_cnt && (fl_desc > free_cnt))
 		fl_desc = free_cnt;
 
-	if ((id + fl_desc) < (txq->nb_tx_desc - 1)) {
-		for (count = 0; count < ((uint16_t)fl_desc & 0xFFFF);
-				count++) {
-			rte_pktmbuf_free(txq->sw_ring[id]);
-			txq->sw_ring[id++] = NULL;
-		}
+	if ((id + fl_desc) < ring_sz) {
+		id = reclaim_tx_ring_range(txq, id, (uint16_t)fl_desc);
 	} else {
-		fl_desc -= (txq->nb_tx_desc - 1 - id);
-		for (; id < (txq->nb_tx_desc - 1); id++) {
-			rte_pktmbuf_free(txq->sw_ring[id]);
-			txq->sw_ring[id] = NULL;
-		}
-
-		id -= (txq->nb_tx_desc - 1);
-		for (count = 0; count < ((uint16_t)fl_desc & 0xFFFF);
-				count++) {
-			rte_pktmbuf_free(txq->sw_ring[id]);
-			txq->sw_ring[id++] = NULL;
-		}
+		first = ring_sz - id;
+		reclaim_tx_ring_range(txq, id, first);
+		id = reclaim_tx_ring_range(txq, 0,
+				(uint16_t)fl_desc - first);
 	}
 	txq->tx_fl_tail = id;
 
@@ -839,6 +922,95 @@ struct rte_mbuf *prepare_single_packet(struct qdma_rx_queue *rxq,
 }
 
 #ifdef QDMA_RX_VEC_X86_64
+/* Vector implementation to chain mbufs for a packet spread across
+ * multiple C2H buffers. The segment count and the last segment length
+ * are derived once from the completion length, and every segment gets
+ * its rearm data and descriptor fields written with 128-bit stores.
+ */
+static struct rte_mbuf *prepare_segmented_packet_v(struct qdma_rx_queue *rxq,
+		uint16_t pkt_length, uint16_t *tail, __m128i mbuf_init)
+{
+	struct rte_mbuf **sw_ring = rxq->sw_ring;
+	struct rte_mbuf *first_seg, *mb;
+	uint16_t rx_buff_size = rxq->rx_buff_size;
+	uint16_t ring_sz = rxq->nb_rx_desc - 1;
+	uint16_t id = *tail;
+	uint16_t nb_segs, last_len, seg;
+	__m128i zero_data = _mm_setzero_si128();
+	__m128i seg_fields, last_fields;
+
+	if (unlikely(!pkt_length))
+		return NULL;
+
+	nb_segs = (pkt_length + rx_buff_size - 1) / rx_buff_size;
+	last_len = pkt_length - ((nb_segs - 1) * rx_buff_size);
+
+	/* rx_descriptor_fields1 layout:
+	 * packet_type(32) | pkt_len(32) | data_len(16), vlan_tci(16) | rss(32)
+	 */
+	seg_fields = _mm_set_epi32(0, rx_buff_size, rx_buff_size, 0);
+	last_fields = _mm_set_epi32(0, last_len, last_len, 0);
+
+	first_seg = sw_ring[id];
+
+	if (likely((id + nb_segs) < ring_sz)) {
+		/* Segments are contiguous in SW ring, chain them in place */
+		for (seg = 0; seg < (nb_segs - 1); seg++) {
+			mb = sw_ring[id + seg];
+			rte_prefetch0(sw_ring[id + seg + 1]);
+			_mm_store_si128((__m128i *)&mb->rearm_data, mbuf_init);
+			_mm_storeu_si128((void *)&mb->rx_descriptor_fields1,
+					seg_fields);
+			mb->next = sw_ring[id + seg + 1];
+		}
+		mb = sw_ring[id + seg];
+		_mm_store_si128((__m128i *)&mb->rearm_data, mbuf_init);
+		_mm_storeu_si128((void *)&mb->rx_descriptor_fields1,
+				last_fields);
+		mb->next = NULL;
+
+		/* Release SW ring entries, two at a time */
+		for (seg = 0; (seg + 1) < nb_segs;
+				seg += RTE_QDMA_DESCS_PER_LOOP)
+			_mm_storeu_si128((__m128i *)&sw_ring[id + seg],
+					zero_data);
+		if (nb_segs & 1)
+			sw_ring[id + nb_segs - 1] = NULL;
+
+		id += nb_segs;
+	} else {
+		/* Packet wraps around the end of the ring */
+		for (seg = 0; seg < nb_segs; seg++) {
+			mb = sw_ring[id];
+			sw_ring[id++] = NULL;
+			if (unlikely(id >= ring_sz))
+				id -= ring_sz;
+
+			_mm_store_si128((__m128i *)&mb->rearm_data, mbuf_init);
+			if (seg == (nb_segs - 1)) {
+				_mm_storeu_si128(
+					(void *)&mb->rx_descriptor_fields1,
+					last_fields);
+				mb->next = NULL;
+			} else {
+				_mm_storeu_si128(
+					(void *)&mb->rx_descriptor_fields1,
+					seg_fields);
+				mb->next = sw_ring[id];
+			}
+		}
+	}
+
+	if (unlikely(id >= ring_sz))
+		id -= ring_sz;
+
+	first_seg->nb_segs = nb_segs;
+	first_seg->pkt_len = pkt_length;
+
+	*tail = id;
+	return first_seg;
+}
+
 /* Vector implementation to prepare mbufs for packets.
  * Update this API if HW provides more information to be populated in mbuf.
  */
@@ -932,32 +1104,39 @@ static uint16_t prepare_packets_v(struct qdma_rx_queue *rxq,
 			 * or ring wrap
 			 */
 			if (pktlen1) {
-				mb = prepare_segmented_packet(rxq,
-					pktlen1, &id);
+				mb = prepare_segmented_packet_v(rxq,
+					pktlen1, &id, mbuf_init);
 				rx_pkts[count_pkts++] = mb;
 				pktlen = _mm_add_epi32(pktlen, pkt_len[0]);
 			}
 
 			if (pktlen2) {
-				mb = prepare_segmented_packet(rxq,
-					pktlen2, &id);
+				mb = prepare_segmented_packet_v(rxq,
+					pktlen2, &id, mbuf_init);
 				rx_pkts[count_pkts++] = mb;
 				pktlen = _mm_add_epi32(pktlen, pkt_len[1]);
 			}
 		}
 	}
 
-	rxq->stats.pkts += count_pkts;
-	rxq->stats.bytes += _mm_extract_epi64(pktlen, 0);
-	rxq->rx_tail = id;
-
 	/* Handle single packet, if any pending */
 	if (nb_pkts & 1) {
-		mb = prepare_single_packet(rxq, count);
-		if (mb)
+		uint16_t pktlen1 = qdma_ul_get_cmpt_pkt_len(
+					&rxq->cmpt_data[count]);
+
+		if (pktlen1) {
+			mb = prepare_segmented_packet_v(rxq, pktlen1, &id,
+					mbuf_init);
 			rx_pkts[count_pkts++] = mb;
+			pktlen = _mm_add_epi32(pktlen,
+					_mm_set_epi64x(0, pktlen1));
+		}
 	}
 
+	rxq->stats.pkts += count_pkts;
+	rxq->stats.bytes += _mm_extract_epi64(pktlen, 0);
+	rxq->rx_tail = id;
+
 	return count_pkts;
 }
 #endif //QDMA_RX_VEC_X86_64
@@ -991,55 +1170,32 @@ static uint16_t prepare_packets(struct qdma_rx_queue *rxq,
 	return count_pkts;
 }
 
-/* Populate C2H ring with new buffers */
-static int rearm_c2h_ring(struct qdma_rx_queue *rxq, uint16_t num_desc)
+#ifdef QDMA_RX_VEC_X86_64
+/* Vector implementation to write C2H descriptors for freshly allocated
+ * mbufs, two descriptors per iteration. Caller makes sure that
+ * [id, id + num_desc) does not wrap around the ring.
+ */
+static uint16_t rearm_c2h_ring_v(struct qdma_rx_queue *rxq, uint16_t id,
+		uint16_t num_desc)
 {
-	struct qdma_pci_dev *qdma_dev = rxq->dev->data->dev_private;
-	struct rte_mbuf *mb;
 	struct qdma_ul_st_c2h_desc *rx_ring_st =
 			(struct qdma_ul_st_c2h_desc *)rxq->rx_ring;
-	uint16_t mbuf_index = 0;
-	uint16_t id;
-	int rearm_descs;
-
-	id = rxq->q_pidx_info.pidx;
-
-	/* Split the C2H ring updation in two parts.
-	 * First handle till end of ring and then
-	 * handle from beginning of ring, if ring wraps
-	 */
-	if ((id + num_desc) < (rxq->nb_rx_desc - 1))
-		rearm_descs = num_desc;
-	else
-		rearm_descs = (rxq->nb_rx_desc - 1) - id;
-
-	/* allocate new buffer */
-	if (rte_mempool_get_bulk(rxq->mb_pool, (void *)&rxq->sw_ring[id],
-					rearm_descs) != 0){
-		PMD_DRV_LOG(ERR, "%s(): %d: No MBUFS, queue id = %d,"
-		"mbuf_avail_count = %d,"
-		" mbuf_in_use_count = %d, num_desc_req = %d\n",
-		__func__, __LINE__, rxq->queue_id,
-		rte_mempool_avail_count(rxq->mb_pool),
-		rte_mempool_in_use_count(rxq->mb_pool), rearm_descs);
-		return -1;
-	}
-
-#ifdef QDMA_RX_VEC_X86_64
-	int rearm_cnt = rearm_descs & -2;
+	struct rte_mbuf *mb;
+	uint16_t mbuf_index;
+	uint16_t rearm_cnt = num_desc & -2;
 	__m128i head_room = _mm_set_epi64x(RTE_PKTMBUF_HEADROOM,
 			RTE_PKTMBUF_HEADROOM);
 
-	for (mbuf_index = 0; mbuf_index < ((uint16_t)rearm_cnt  & 0xFFFF);
+	/* load buf_addr(lo 64bit) and buf_iova(hi 64bit) */
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, buf_iova) !=
+			offsetof(struct rte_mbuf, buf_addr) + 8);
+
+	for (mbuf_index = 0; mbuf_index < rearm_cnt;
 			mbuf_index += RTE_QDMA_DESCS_PER_LOOP,
 			id += RTE_QDMA_DESCS_PER_LOOP) {
 		__m128i vaddr0, vaddr1;
 		__m128i dma_addr;
 
-		/* load buf_addr(lo 64bit) and buf_iova(hi 64bit) */
-		RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, buf_iova) !=
-				offsetof(struct rte_mbuf, buf_addr) + 8);
-
 		/* Load two mbufs data addresses */
 		vaddr0 = _mm_loadu_si128(
 				(__m128i *)&(rxq->sw_ring[id]->buf_addr));
@@ -1056,7 +1212,7 @@ static int rearm_c2h_ring(struct qdma_rx_queue *rxq, uint16_t num_desc)
 		_mm_storeu_si128((__m128i *)&rx_ring_st[id], dma_addr);
 	}
 
-	if (rearm_descs & 1) {
+	if (num_desc & 1) {
 		mb = rxq->sw_ring[id];
 
 		/* rearm descriptor */
@@ -1065,6 +1221,49 @@ static int rearm_c2h_ring(struct qdma_rx_queue *rxq, uint16_t num_desc)
 					RTE_PKTMBUF_HEADROOM;
 		id++;
 	}
+
+	return id;
+}
+#endif //QDMA_RX_VEC_X86_64
+
+/* Populate C2H ring with new buffers */
+static int rearm_c2h_ring(struct qdma_rx_queue *rxq, uint16_t num_desc)
+{
+	struct qdma_pci_dev *qdma_dev = rxq->dev->data->dev_private;
+#ifndef QDMA_RX_VEC_X86_64
+	struct rte_mbuf *mb;
+	struct qdma_ul_st_c2h_desc *rx_ring_st =
+			(struct qdma_ul_st_c2h_desc *)rxq->rx_ring;
+	uint16_t mbuf_index = 0;
+#endif //QDMA_RX_VEC_X86_64
+	uint16_t id;
+	int rearm_descs;
+
+	id = rxq->q_pidx_info.pidx;
+
+	/* Split the C2H ring updation in two parts.
+	 * First handle till end of ring and then
+	 * handle from beginning of ring, if ring wraps
+	 */
+	if ((id + num_desc) < (rxq->nb_rx_desc - 1))
+		rearm_descs = num_desc;
+	else
+		rearm_descs = (rxq->nb_rx_desc - 1) - id;
+
+	/* allocate new buffer */
+	if (rte_mempool_get_bulk(rxq->mb_pool, (void *)&rxq->sw_ring[id],
+					rearm_descs) != 0){
+		PMD_DRV_LOG(ERR, "%s(): %d: No MBUFS, queue id = %d,"
+		"mbuf_avail_count = %d,"
+		" mbuf_in_use_count = %d, num_desc_req = %d\n",
+		__func__, __LINE__, rxq->queue_id,
+		rte_mempool_avail_count(rxq->mb_pool),
+		rte_mempool_in_use_count(rxq->mb_pool), rearm_descs);
+		return -1;
+	}
+
+#ifdef QDMA_RX_VEC_X86_64
+	id = rearm_c2h_ring_v(rxq, id, rearm_descs);
 #else //QDMA_RX_VEC_X86_64
 	for (mbuf_index = 0; mbuf_index < rearm_descs;
 			mbuf_index++, id++) {
@@ -1102,6 +1301,9 @@ static int rearm_c2h_ring(struct qdma_rx_queue *rxq, uint16_t num_desc)
 			return -1;
 		}
 
+#ifdef QDMA_RX_VEC_X86_64
+		id = rearm_c2h_ring_v(rxq, id, rearm_descs);
+#else //QDMA_RX_VEC_X86_64
 		for (mbuf_index = 0;
 				mbuf_index < ((uint16_t)rearm_descs & 0xFFFF);
 				mbuf_index++, id++) {
@@ -1113,6 +1315,7 @@ static int rearm_c2h_ring(struct qdma_rx_queue *rxq, uint16_t num_desc)
 					(uint64_t)mb->buf_iova +
 						RTE_PKTMBUF_HEADROOM;
 		}
+#endif //QDMA_RX_VEC_X86_64
 	}
 
 	PMD_DRV_LOG(DEBUG, "%s(): %d: PIDX Update: queue id = %d, "
@@ -1480,6 +1683,26 @@ uint16_t qdma_xmit_pkts_st(struct qdma_tx_queue *txq, struct rte_mbuf **tx_pkts,
 	for (count = 0; count < nb_pkts; count++) {
 		mb = tx_pkts[count];
 		nsegs = mb->nb_segs;
+#ifdef QDMA_TX_VEC_X86_64
+		/* Two single segment packets without ring wrap,
+		 * write both descriptors in one iteration
+		 */
+		id = txq->q_pidx_info.pidx;
+		if (likely(((count + 1) < nb_pkts) && (avail >= 2) &&
+				(nsegs == 1) &&
+				(tx_pkts[count + 1]->nb_segs == 1) &&
+				((id + 2) < (txq->nb_tx_desc - 1)))) {
+			txq->sw_ring[id] = mb;
+			txq->sw_ring[id + 1] = tx_pkts[count + 1];
+			pkt_len += rte_pktmbuf_pkt_len(mb) +
+				rte_pktmbuf_pkt_len(tx_pkts[count + 1]);
+			qdma_ul_update_st_h2c_desc_x2_v(txq, mb,
+					tx_pkts[count + 1]);
+			avail -= 2;
+			count++;
+			continue;
+		}
+#endif //QDMA_TX_VEC_X86_64
 		if (nsegs > avail) {
 			/* Number of segments in current mbuf are greater
 			 * than number of descriptors available,
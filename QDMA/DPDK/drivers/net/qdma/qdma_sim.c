@@ -0,0 +1,1528 @@
+/*-
+ * BSD LICENSE
+ *
+ * Copyright(c) 2017-2021 Xilinx, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Virtual QDMA device (net_qdma_sim).
+ *
+ * Exposes an ethdev port that runs the regular QDMA datapath
+ * (qdma_rxtx.c) and control path (qdma_devops.c) without any hardware.
+ * All register and context accesses go through a software qdma_hw_access
+ * table, and a software DMA engine services the descriptor rings that
+ * the driver programs into the queue contexts:
+ *
+ *  - ST H2C packets are looped back into the C2H ring of the same queue,
+ *    with completion entries and completion status writes honouring the
+ *    trigger mode, counter and timer programmed through the CMPT CIDX.
+ *  - MM H2C/C2H descriptors copy to/from a DMA_BRAM_SIZE card memory.
+ *
+ * Usage:
+ *   --vdev=net_qdma_sim0,num_queues=64,engine=thread,mm_queues=8
+ *
+ * Device arguments:
+ *   num_queues - number of queues exposed by the device (default 64)
+ *   engine     - "thread" runs the engine in a control thread (default),
+ *                "service" registers it as a service component, which
+ *                must then be mapped to a service lcore by the
+ *                application.
+ *   mm_queues  - the first mm_queues queues are configured in memory
+ *                mapped mode, the others in streaming mode (default 0).
+ *                rte_pmd_qdma_set_queue_mode() can change a queue's mode
+ *                after rte_eth_dev_configure().
+ *   desc_prefetch, cmpt_desc_len and trigger_mode are accepted as for
+ *   the PCI device; bypass modes are not supported.
+ *
+ * The rte_pmd_qdma.h APIs accept the device, the BAR indexes it reports are
+ * BAR_ID_INVALID as there are no BARs behind it and the bypass
+ * configuration is rejected.
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <rte_malloc.h>
+#include <rte_memory.h>
+#include <rte_eal.h>
+#include <rte_ether.h>
+#include <rte_ethdev.h>
+#include <rte_ethdev_driver.h>
+#include <rte_ethdev_vdev.h>
+#include <rte_bus_vdev.h>
+#include <rte_kvargs.h>
+#include <rte_cycles.h>
+#include <rte_lcore.h>
+#include <rte_service.h>
+#include <rte_service_component.h>
+
+#include "qdma.h"
+#include "qdma_access_common.h"
+#include "qdma_access_export.h"
+#include "qdma_devops.h"
+
+#define QDMA_SIM_NUM_QUEUES_ARG		"num_queues"
+#define QDMA_SIM_ENGINE_ARG		"engine"
+#define QDMA_SIM_MM_QUEUES_ARG		"mm_queues"
+
+#define QDMA_SIM_DEFAULT_NUM_QUEUES	(64)
+#define QDMA_SIM_MAX_NUM_QUEUES		(2048)
+
+/* Synthetic bus numbers used to register the virtual devices with the
+ * resource manager, kept clear of the 8 bit PCI bus number space.
+ */
+#define QDMA_SIM_BUS_BASE		(0x100)
+
+/* Max descriptors serviced per queue and direction in one engine pass */
+#define QDMA_SIM_BURST			(64)
+
+/* Idle engine passes before the control thread backs off */
+#define QDMA_SIM_IDLE_SPINS		(1024)
+#define QDMA_SIM_IDLE_SLEEP_US		(10)
+
+enum qdma_sim_engine_type {
+	QDMA_SIM_ENGINE_THREAD,
+	QDMA_SIM_ENGINE_SERVICE
+};
+
+/*
+ * Descriptor ring as seen by the engine, built from the SW context.
+ */
+struct qdma_sim_ring {
+	uint8_t			*base; /* descriptor ring virtual address */
+	struct wb_status	*wb_status;
+	uint16_t		nb_desc; /* usable descriptors */
+	uint16_t		desc_sz;
+	uint16_t		cidx;
+	uint16_t		pidx; /* doorbell, written by the datapath */
+	uint8_t			en:1;
+	uint8_t			is_mm:1;
+	uint8_t			wbk_en:1;
+};
+
+/*
+ * Completion ring state, built from the CMPT context and the CMPT CIDX
+ * register updates.
+ */
+struct qdma_sim_cmpt {
+	uint8_t			*base;
+	struct wb_status	*wb_status;
+	uint16_t		nb_desc;
+	uint16_t		desc_sz;
+	uint16_t		pidx;
+	uint16_t		cidx;
+	uint16_t		reported; /* pidx last written to status */
+	uint8_t			color;
+	uint8_t			trig_mode;
+	uint8_t			counter_idx;
+	uint8_t			timer_idx;
+	uint8_t			en:1;
+	uint8_t			stat_en:1;
+	uint8_t			armed:1;
+	uint64_t		pend_tsc; /* first unreported entry */
+
+	/* CMPT CIDX register, packed as written by the datapath */
+	uint64_t		cidx_reg;
+	uint16_t		cidx_seq; /* owned by the register writer */
+	uint16_t		last_seq; /* owned by the engine */
+};
+
+struct qdma_sim_queue_stats {
+	uint64_t h2c_pkts;
+	uint64_t h2c_bytes;
+	uint64_t c2h_pkts;
+	uint64_t c2h_bytes;
+	uint64_t drops;
+	uint64_t cmpt_entries;
+	uint64_t mm_h2c_bytes;
+	uint64_t mm_c2h_bytes;
+};
+
+struct qdma_sim_queue {
+	rte_spinlock_t			lock;
+	struct qdma_sim_ring		h2c;
+	struct qdma_sim_ring		c2h;
+	struct qdma_sim_cmpt		cmpt;
+	uint32_t			c2h_buf_sz;
+	struct qdma_sim_queue_stats	stats;
+} __rte_cache_aligned;
+
+struct qdma_sim_dev {
+	/* must be first, shared code casts dev_private to qdma_pci_dev */
+	struct qdma_pci_dev	qdma_dev;
+
+	struct rte_eth_dev	*dev;
+	struct qdma_sim_queue	*queues;
+	uint16_t		num_queues;
+	uint16_t		mm_queues; /* the first mm_queues are MM */
+	uint8_t			*card_mem; /* MM endpoint memory */
+
+	uint32_t		ring_sz[QDMA_NUM_RING_SIZES];
+	uint32_t		c2h_timer_cnt[QDMA_NUM_C2H_TIMERS];
+	uint32_t		c2h_cnt_th[QDMA_NUM_C2H_COUNTERS];
+	uint32_t		c2h_buf_sz[QDMA_NUM_C2H_BUFFER_SIZES];
+
+	enum qdma_sim_engine_type engine;
+	volatile int		run;
+	pthread_t		thread;
+	uint32_t		service_id;
+	uint8_t			engine_started:1;
+};
+
+static const uint32_t qdma_sim_ring_sz[QDMA_NUM_RING_SIZES] = {2049, 65,
+	129, 193, 257, 385, 513, 769, 1025, 1537, 3073, 4097, 6145, 8193,
+	12289, 16385};
+static const uint32_t qdma_sim_tmr_cnt[QDMA_NUM_C2H_TIMERS] = {1, 2, 4, 5,
+	8, 10, 15, 20, 25, 30, 50, 75, 100, 125, 150, 200};
+static const uint32_t qdma_sim_cnt_th[QDMA_NUM_C2H_COUNTERS] = {2, 4, 8, 16,
+	24, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192};
+static const uint32_t qdma_sim_buf_sz[QDMA_NUM_C2H_BUFFER_SIZES] = {4096,
+	256, 512, 1024, 2048, 3968, 4096, 4096, 4096, 4096, 4096, 4096, 4096,
+	8192, 9018, 16384};
+
+static uint32_t qdma_sim_instances;
+
+static const char * const qdma_sim_valid_args[] = {
+	QDMA_SIM_NUM_QUEUES_ARG,
+	QDMA_SIM_ENGINE_ARG,
+	QDMA_SIM_MM_QUEUES_ARG,
+	"desc_prefetch",
+	"cmpt_desc_len",
+	"trigger_mode",
+	NULL
+};
+
+static inline struct qdma_sim_dev *qdma_sim_get_dev(void *dev_hndl)
+{
+	return ((struct rte_eth_dev *)dev_hndl)->data->dev_private;
+}
+
+static inline struct qdma_sim_queue *qdma_sim_get_queue(void *dev_hndl,
+					uint16_t qid)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+
+	if (qid >= sdev->num_queues)
+		return NULL;
+	return &sdev->queues[qid];
+}
+
+static inline struct qdma_sim_queue *qdma_sim_get_hw_queue(void *dev_hndl,
+					uint16_t hw_qid)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+
+	if (hw_qid < sdev->qdma_dev.queue_base)
+		return NULL;
+	return qdma_sim_get_queue(dev_hndl,
+			hw_qid - sdev->qdma_dev.queue_base);
+}
+
+/*
+ * Translate a bus address programmed into a descriptor or context
+ * into a virtual address. In VA mode the IOVA is the virtual address,
+ * otherwise fall back to a lookup in the EAL memory map.
+ */
+static inline void *qdma_sim_iova2virt(uint64_t iova)
+{
+	if (rte_eal_iova_mode() == RTE_IOVA_VA)
+		return (void *)(uintptr_t)iova;
+	return rte_mem_iova2virt((rte_iova_t)iova);
+}
+
+static inline uint16_t qdma_sim_ring_used(uint16_t pidx, uint16_t cidx,
+					uint16_t nb_desc)
+{
+	return (pidx >= cidx) ? (pidx - cidx) : (nb_desc - cidx + pidx);
+}
+
+/******************************************************************************
+ * Software register and context access
+ *****************************************************************************/
+
+static int qdma_sim_set_default_global_csr(void *dev_hndl)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+
+	memcpy(sdev->ring_sz, qdma_sim_ring_sz, sizeof(sdev->ring_sz));
+	memcpy(sdev->c2h_timer_cnt, qdma_sim_tmr_cnt,
+			sizeof(sdev->c2h_timer_cnt));
+	memcpy(sdev->c2h_cnt_th, qdma_sim_cnt_th, sizeof(sdev->c2h_cnt_th));
+	memcpy(sdev->c2h_buf_sz, qdma_sim_buf_sz, sizeof(sdev->c2h_buf_sz));
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_global_csr_conf(void *dev_hndl, uint8_t index,
+				uint8_t count, uint32_t *csr_val,
+				enum qdma_global_csr_type csr_type,
+				enum qdma_hw_access_type access_type)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+	uint32_t *csr;
+	uint32_t max;
+
+	switch (csr_type) {
+	case QDMA_CSR_RING_SZ:
+		csr = sdev->ring_sz;
+		max = QDMA_NUM_RING_SIZES;
+		break;
+	case QDMA_CSR_TIMER_CNT:
+		csr = sdev->c2h_timer_cnt;
+		max = QDMA_NUM_C2H_TIMERS;
+		break;
+	case QDMA_CSR_CNT_TH:
+		csr = sdev->c2h_cnt_th;
+		max = QDMA_NUM_C2H_COUNTERS;
+		break;
+	case QDMA_CSR_BUF_SZ:
+		csr = sdev->c2h_buf_sz;
+		max = QDMA_NUM_C2H_BUFFER_SIZES;
+		break;
+	default:
+		return -QDMA_ERR_INV_PARAM;
+	}
+
+	if (!csr_val || (index + count) > max)
+		return -QDMA_ERR_INV_PARAM;
+
+	switch (access_type) {
+	case QDMA_HW_ACCESS_READ:
+		memcpy(csr_val, &csr[index], count * sizeof(uint32_t));
+		break;
+	case QDMA_HW_ACCESS_WRITE:
+		memcpy(&csr[index], csr_val, count * sizeof(uint32_t));
+		break;
+	default:
+		return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+	}
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_init_ctxt_memory(void *dev_hndl)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+	uint16_t qid;
+
+	for (qid = 0; qid < sdev->num_queues; qid++) {
+		rte_spinlock_lock(&sdev->queues[qid].lock);
+		memset(&sdev->queues[qid].h2c, 0, sizeof(struct qdma_sim_ring));
+		memset(&sdev->queues[qid].c2h, 0, sizeof(struct qdma_sim_ring));
+		memset(&sdev->queues[qid].cmpt, 0,
+				sizeof(struct qdma_sim_cmpt));
+		rte_spinlock_unlock(&sdev->queues[qid].lock);
+	}
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_fmap_conf(void *dev_hndl, uint16_t func_id,
+				struct qdma_fmap_cfg *config,
+				enum qdma_hw_access_type access_type)
+{
+	(void)dev_hndl;
+	(void)func_id;
+	(void)config;
+
+	if (access_type == QDMA_HW_ACCESS_READ)
+		return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_sw_ctx_conf(void *dev_hndl, uint8_t c2h, uint16_t hw_qid,
+				struct qdma_descq_sw_ctxt *ctxt,
+				enum qdma_hw_access_type access_type)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+	struct qdma_sim_queue *q = qdma_sim_get_hw_queue(dev_hndl, hw_qid);
+	struct qdma_sim_ring *ring;
+	uint32_t ring_sz;
+
+	if (!q)
+		return -QDMA_ERR_INV_PARAM;
+	ring = c2h ? &q->c2h : &q->h2c;
+
+	switch (access_type) {
+	case QDMA_HW_ACCESS_WRITE:
+		if (!ctxt || ctxt->rngsz_idx >= QDMA_NUM_RING_SIZES)
+			return -QDMA_ERR_INV_PARAM;
+		if (ctxt->bypass)
+			return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+
+		ring_sz = sdev->ring_sz[ctxt->rngsz_idx];
+		rte_spinlock_lock(&q->lock);
+		ring->base = qdma_sim_iova2virt(ctxt->ring_bs_addr);
+		ring->is_mm = ctxt->is_mm ? 1 : 0;
+		if (ring->is_mm)
+			ring->desc_sz = sizeof(struct qdma_ul_mm_desc);
+		else if (c2h)
+			ring->desc_sz = sizeof(struct qdma_ul_st_c2h_desc);
+		else
+			ring->desc_sz = sizeof(struct qdma_ul_st_h2c_desc);
+		ring->nb_desc = ring_sz - 1;
+		ring->wb_status = (struct wb_status *)(ring->base +
+				((uint32_t)ring->nb_desc * ring->desc_sz));
+		ring->wbk_en = ctxt->wbk_en ? 1 : 0;
+		ring->cidx = 0;
+		ring->pidx = 0;
+		ring->en = (ring->base && ctxt->qen) ? 1 : 0;
+		rte_spinlock_unlock(&q->lock);
+		break;
+	case QDMA_HW_ACCESS_CLEAR:
+	case QDMA_HW_ACCESS_INVALIDATE:
+		rte_spinlock_lock(&q->lock);
+		memset(ring, 0, sizeof(struct qdma_sim_ring));
+		rte_spinlock_unlock(&q->lock);
+		break;
+	default:
+		return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+	}
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_pfetch_ctx_conf(void *dev_hndl, uint16_t hw_qid,
+				struct qdma_descq_prefetch_ctxt *ctxt,
+				enum qdma_hw_access_type access_type)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+	struct qdma_sim_queue *q = qdma_sim_get_hw_queue(dev_hndl, hw_qid);
+
+	if (!q)
+		return -QDMA_ERR_INV_PARAM;
+
+	switch (access_type) {
+	case QDMA_HW_ACCESS_WRITE:
+		if (!ctxt || ctxt->bufsz_idx >= QDMA_NUM_C2H_BUFFER_SIZES)
+			return -QDMA_ERR_INV_PARAM;
+		if (ctxt->bypass)
+			return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+		rte_spinlock_lock(&q->lock);
+		q->c2h_buf_sz = sdev->c2h_buf_sz[ctxt->bufsz_idx];
+		rte_spinlock_unlock(&q->lock);
+		break;
+	case QDMA_HW_ACCESS_CLEAR:
+	case QDMA_HW_ACCESS_INVALIDATE:
+		rte_spinlock_lock(&q->lock);
+		q->c2h_buf_sz = 0;
+		rte_spinlock_unlock(&q->lock);
+		break;
+	default:
+		return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+	}
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_cmpt_ctx_conf(void *dev_hndl, uint16_t hw_qid,
+				struct qdma_descq_cmpt_ctxt *ctxt,
+				enum qdma_hw_access_type access_type)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+	struct qdma_sim_queue *q = qdma_sim_get_hw_queue(dev_hndl, hw_qid);
+	struct qdma_sim_cmpt *cmpt;
+	uint32_t ring_sz;
+
+	if (!q)
+		return -QDMA_ERR_INV_PARAM;
+	cmpt = &q->cmpt;
+
+	switch (access_type) {
+	case QDMA_HW_ACCESS_WRITE:
+		if (!ctxt || ctxt->ringsz_idx >= QDMA_NUM_RING_SIZES ||
+				ctxt->desc_sz > CMPT_CNTXT_DESC_SIZE_64B)
+			return -QDMA_ERR_INV_PARAM;
+
+		ring_sz = sdev->ring_sz[ctxt->ringsz_idx];
+		rte_spinlock_lock(&q->lock);
+		cmpt->base = qdma_sim_iova2virt(ctxt->bs_addr);
+		cmpt->desc_sz = 8 << ctxt->desc_sz;
+		cmpt->nb_desc = ring_sz - 1;
+		cmpt->wb_status = (struct wb_status *)(cmpt->base +
+				((uint32_t)cmpt->nb_desc * cmpt->desc_sz));
+		cmpt->pidx = 0;
+		cmpt->cidx = 0;
+		cmpt->reported = 0;
+		cmpt->color = ctxt->color;
+		cmpt->trig_mode = ctxt->trig_mode;
+		cmpt->counter_idx = ctxt->counter_idx;
+		cmpt->timer_idx = ctxt->timer_idx;
+		cmpt->stat_en = ctxt->en_stat_desc ? 1 : 0;
+		cmpt->armed = 0;
+		cmpt->pend_tsc = 0;
+		/* Only doorbells rung after the context write count */
+		cmpt->last_seq = cmpt->cidx_seq;
+		cmpt->en = (cmpt->base && ctxt->valid) ? 1 : 0;
+		rte_spinlock_unlock(&q->lock);
+		break;
+	case QDMA_HW_ACCESS_CLEAR:
+	case QDMA_HW_ACCESS_INVALIDATE:
+		rte_spinlock_lock(&q->lock);
+		cmpt->en = 0;
+		cmpt->base = NULL;
+		cmpt->wb_status = NULL;
+		cmpt->armed = 0;
+		rte_spinlock_unlock(&q->lock);
+		break;
+	default:
+		return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+	}
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_hw_ctx_conf(void *dev_hndl, uint8_t c2h, uint16_t hw_qid,
+				struct qdma_descq_hw_ctxt *ctxt,
+				enum qdma_hw_access_type access_type)
+{
+	(void)dev_hndl;
+	(void)c2h;
+	(void)hw_qid;
+	(void)ctxt;
+
+	if (access_type == QDMA_HW_ACCESS_READ ||
+			access_type == QDMA_HW_ACCESS_WRITE)
+		return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_credit_ctx_conf(void *dev_hndl, uint8_t c2h,
+				uint16_t hw_qid,
+				struct qdma_descq_credit_ctxt *ctxt,
+				enum qdma_hw_access_type access_type)
+{
+	(void)dev_hndl;
+	(void)c2h;
+	(void)hw_qid;
+	(void)ctxt;
+
+	if (access_type == QDMA_HW_ACCESS_READ ||
+			access_type == QDMA_HW_ACCESS_WRITE)
+		return -QDMA_ERR_HWACC_FEATURE_NOT_SUPPORTED;
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_queue_pidx_update(void *dev_hndl, uint8_t is_vf,
+				uint16_t qid, uint8_t is_c2h,
+				const struct qdma_q_pidx_reg_info *reg_info)
+{
+	struct qdma_sim_queue *q = qdma_sim_get_queue(dev_hndl, qid);
+
+	(void)is_vf;
+	if (!q || !reg_info)
+		return -QDMA_ERR_INV_PARAM;
+
+	/* Descriptor writes must be visible before the doorbell */
+	if (is_c2h)
+		__atomic_store_n(&q->c2h.pidx, reg_info->pidx,
+				__ATOMIC_RELEASE);
+	else
+		__atomic_store_n(&q->h2c.pidx, reg_info->pidx,
+				__ATOMIC_RELEASE);
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_queue_cmpt_cidx_update(void *dev_hndl, uint8_t is_vf,
+			uint16_t qid,
+			const struct qdma_q_cmpt_cidx_reg_info *reg_info)
+{
+	struct qdma_sim_queue *q = qdma_sim_get_queue(dev_hndl, qid);
+	uint64_t reg;
+
+	(void)is_vf;
+	if (!q || !reg_info)
+		return -QDMA_ERR_INV_PARAM;
+
+	/* The sequence number lets the engine tell a fresh write of
+	 * an unchanged CIDX apart from no write at all, as every write
+	 * re-arms the status trigger.
+	 */
+	q->cmpt.cidx_seq++;
+	reg = (uint64_t)reg_info->wrb_cidx |
+		((uint64_t)reg_info->counter_idx << 16) |
+		((uint64_t)reg_info->timer_idx << 24) |
+		((uint64_t)reg_info->trig_mode << 32) |
+		((uint64_t)(reg_info->wrb_en ? 1 : 0) << 40) |
+		((uint64_t)q->cmpt.cidx_seq << 48);
+	__atomic_store_n(&q->cmpt.cidx_reg, reg, __ATOMIC_RELEASE);
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_queue_cmpt_cidx_read(void *dev_hndl, uint8_t is_vf,
+			uint16_t qid, struct qdma_q_cmpt_cidx_reg_info *reg_info)
+{
+	struct qdma_sim_queue *q = qdma_sim_get_queue(dev_hndl, qid);
+	uint64_t reg;
+
+	(void)is_vf;
+	if (!q || !reg_info)
+		return -QDMA_ERR_INV_PARAM;
+
+	reg = __atomic_load_n(&q->cmpt.cidx_reg, __ATOMIC_ACQUIRE);
+	reg_info->wrb_cidx = reg & 0xFFFF;
+	reg_info->counter_idx = (reg >> 16) & 0xFF;
+	reg_info->timer_idx = (reg >> 24) & 0xFF;
+	reg_info->trig_mode = (reg >> 32) & 0xFF;
+	reg_info->wrb_en = (reg >> 40) & 0x1;
+	reg_info->irq_en = 0;
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_mm_channel_conf(void *dev_hndl, uint8_t channel,
+				uint8_t is_c2h, uint8_t enable)
+{
+	(void)dev_hndl;
+	(void)channel;
+	(void)is_c2h;
+	(void)enable;
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_get_function_number(void *dev_hndl, uint8_t *func_id)
+{
+	(void)dev_hndl;
+
+	if (!func_id)
+		return -QDMA_ERR_INV_PARAM;
+	*func_id = 0;
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_get_device_attributes(void *dev_hndl,
+				struct qdma_dev_attributes *dev_info)
+{
+	struct qdma_sim_dev *sdev = qdma_sim_get_dev(dev_hndl);
+
+	if (!dev_info)
+		return -QDMA_ERR_INV_PARAM;
+
+	memset(dev_info, 0, sizeof(struct qdma_dev_attributes));
+	dev_info->num_pfs = 1;
+	dev_info->num_qs = sdev->num_queues;
+	dev_info->st_en = 1;
+	dev_info->mm_en = 1;
+	dev_info->desc_eng_mode = QDMA_DESC_ENG_INTERNAL_ONLY;
+	dev_info->mm_channel_max = 1;
+	dev_info->cmpt_ovf_chk_dis = 1;
+	dev_info->cmpt_desc_64b = 1;
+	dev_info->cmpt_trig_count_timer = 1;
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_hw_error_enable(void *dev_hndl, uint32_t err_idx)
+{
+	(void)dev_hndl;
+	(void)err_idx;
+
+	return QDMA_SUCCESS;
+}
+
+static int qdma_sim_hw_error_process(void *dev_hndl)
+{
+	(void)dev_hndl;
+
+	return QDMA_SUCCESS;
+}
+
+static void qdma_sim_hw_access_init(struct qdma_hw_access *hw_access)
+{
+	hw_access->qdma_set_default_global_csr =
+					&qdma_sim_set_default_global_csr;
+	hw_access->qdma_global_csr_conf = &qdma_sim_global_csr_conf;
+	hw_access->qdma_init_ctxt_memory = &qdma_sim_init_ctxt_memory;
+	hw_access->qdma_fmap_conf = &qdma_sim_fmap_conf;
+	hw_access->qdma_sw_ctx_conf = &qdma_sim_sw_ctx_conf;
+	hw_access->qdma_pfetch_ctx_conf = &qdma_sim_pfetch_ctx_conf;
+	hw_access->qdma_cmpt_ctx_conf = &qdma_sim_cmpt_ctx_conf;
+	hw_access->qdma_hw_ctx_conf = &qdma_sim_hw_ctx_conf;
+	hw_access->qdma_credit_ctx_conf = &qdma_sim_credit_ctx_conf;
+	hw_access->qdma_queue_pidx_update = &qdma_sim_queue_pidx_update;
+	hw_access->qdma_queue_cmpt_cidx_read = &qdma_sim_queue_cmpt_cidx_read;
+	hw_access->qdma_queue_cmpt_cidx_update =
+					&qdma_sim_queue_cmpt_cidx_update;
+	hw_access->qdma_mm_channel_conf = &qdma_sim_mm_channel_conf;
+	hw_access->qdma_get_function_number = &qdma_sim_get_function_number;
+	hw_access->qdma_get_device_attributes =
+					&qdma_sim_get_device_attributes;
+	hw_access->qdma_hw_error_enable = &qdma_sim_hw_error_enable;
+	hw_access->qdma_hw_error_process = &qdma_sim_hw_error_process;
+	hw_access->qdma_get_error_code = &qdma_get_error_code;
+}
+
+/******************************************************************************
+ * Software DMA engine
+ *****************************************************************************/
+
+/*
+ * Copy between host memory and the MM card memory, wrapping at the end
+ * of the card memory the same way the driver wraps its endpoint address.
+ */
+static void qdma_sim_card_copy(struct qdma_sim_dev *sdev, uint64_t card_addr,
+				void *host, uint32_t len, uint8_t to_card)
+{
+	uint32_t off = card_addr % DMA_BRAM_SIZE;
+	uint8_t *buf = host;
+	uint32_t chunk;
+
+	while (len) {
+		chunk = RTE_MIN(len, (uint32_t)DMA_BRAM_SIZE - off);
+		if (to_card)
+			rte_memcpy(sdev->card_mem + off, buf, chunk);
+		else
+			rte_memcpy(buf, sdev->card_mem + off, chunk);
+		buf += chunk;
+		len -= chunk;
+		off = 0;
+	}
+}
+
+static uint16_t qdma_sim_service_mm(struct qdma_sim_dev *sdev,
+				struct qdma_sim_queue *q,
+				struct qdma_sim_ring *ring, uint8_t is_c2h)
+{
+	struct qdma_ul_mm_desc *desc;
+	uint16_t pidx, n = 0;
+	uint32_t len;
+	void *host;
+
+	pidx = __atomic_load_n(&ring->pidx, __ATOMIC_ACQUIRE);
+	if (pidx >= ring->nb_desc)
+		return 0;
+
+	while (ring->cidx != pidx && n < QDMA_SIM_BURST) {
+		desc = (struct qdma_ul_mm_desc *)(ring->base +
+				(uint32_t)ring->cidx * ring->desc_sz);
+		len = desc->len;
+		if (is_c2h) {
+			host = qdma_sim_iova2virt(desc->dst_addr);
+			if (host)
+				qdma_sim_card_copy(sdev, desc->src_addr, host,
+						len, 0);
+			q->stats.mm_c2h_bytes += len;
+		} else {
+			host = qdma_sim_iova2virt(desc->src_addr);
+			if (host)
+				qdma_sim_card_copy(sdev, desc->dst_addr, host,
+						len, 1);
+			q->stats.mm_h2c_bytes += len;
+		}
+
+		ring->cidx++;
+		if (ring->cidx >= ring->nb_desc)
+			ring->cidx = 0;
+		n++;
+	}
+
+	if (n && ring->wbk_en) {
+		rte_smp_wmb();
+		ring->wb_status->cidx = ring->cidx;
+	}
+
+	return n;
+}
+
+/*
+ * Post the completion status (CMPT PIDX) according to the trigger mode
+ * armed by the last CMPT CIDX update.
+ */
+static void qdma_sim_cmpt_status(struct qdma_sim_dev *sdev,
+				struct qdma_sim_queue *q)
+{
+	struct qdma_sim_cmpt *cmpt = &q->cmpt;
+	uint16_t pending;
+	uint64_t reg, timeout;
+	uint16_t seq;
+	int fire = 0;
+
+	reg = __atomic_load_n(&cmpt->cidx_reg, __ATOMIC_ACQUIRE);
+	seq = reg >> 48;
+	if (seq != cmpt->last_seq) {
+		cmpt->last_seq = seq;
+		cmpt->cidx = reg & 0xFFFF;
+		if (cmpt->cidx >= cmpt->nb_desc)
+			cmpt->cidx = 0;
+		cmpt->counter_idx = ((reg >> 16) & 0xFF) %
+					QDMA_NUM_C2H_COUNTERS;
+		cmpt->timer_idx = ((reg >> 24) & 0xFF) % QDMA_NUM_C2H_TIMERS;
+		cmpt->trig_mode = (reg >> 32) & 0xFF;
+		cmpt->stat_en = (reg >> 40) & 0x1;
+		cmpt->armed = 1;
+	}
+
+	if (!cmpt->stat_en || cmpt->reported == cmpt->pidx)
+		return;
+
+	pending = qdma_sim_ring_used(cmpt->pidx, cmpt->reported,
+				cmpt->nb_desc);
+	timeout = (uint64_t)sdev->c2h_timer_cnt[cmpt->timer_idx] *
+			rte_get_timer_hz() / US_PER_S;
+
+	switch (cmpt->trig_mode) {
+	case RTE_PMD_QDMA_TRIG_MODE_EVERY:
+		fire = 1;
+		break;
+	case RTE_PMD_QDMA_TRIG_MODE_USER_COUNT:
+		fire = cmpt->armed &&
+			pending >= sdev->c2h_cnt_th[cmpt->counter_idx];
+		break;
+	case RTE_PMD_QDMA_TRIG_MODE_USER:
+		fire = cmpt->armed;
+		break;
+	case RTE_PMD_QDMA_TRIG_MODE_USER_TIMER:
+		fire = cmpt->armed &&
+			(rte_get_timer_cycles() - cmpt->pend_tsc) >= timeout;
+		break;
+	case RTE_PMD_QDMA_TRIG_MODE_USER_TIMER_COUNT:
+		fire = cmpt->armed &&
+			((pending >= sdev->c2h_cnt_th[cmpt->counter_idx]) ||
+			 ((rte_get_timer_cycles() - cmpt->pend_tsc) >=
+			  timeout));
+		break;
+	default:
+		break;
+	}
+
+	if (!fire)
+		return;
+
+	/* Completion entries must land before the status update */
+	rte_smp_wmb();
+	cmpt->wb_status->pidx = cmpt->pidx;
+	cmpt->reported = cmpt->pidx;
+	if (cmpt->trig_mode != RTE_PMD_QDMA_TRIG_MODE_EVERY)
+		cmpt->armed = 0;
+}
+
+static void qdma_sim_cmpt_post(struct qdma_sim_queue *q, uint32_t len)
+{
+	struct qdma_sim_cmpt *cmpt = &q->cmpt;
+	union qdma_ul_st_cmpt_ring *entry;
+	union qdma_ul_st_cmpt_ring data;
+
+	entry = (union qdma_ul_st_cmpt_ring *)(cmpt->base +
+			(uint32_t)cmpt->pidx * cmpt->desc_sz);
+	if (cmpt->desc_sz > sizeof(data.data))
+		memset((uint8_t *)entry + sizeof(data.data), 0,
+				cmpt->desc_sz - sizeof(data.data));
+
+	data.data = 0;
+	data.color = cmpt->color;
+	data.desc_used = 1;
+	data.length = len;
+	entry->data = data.data;
+
+	if (cmpt->reported == cmpt->pidx)
+		cmpt->pend_tsc = rte_get_timer_cycles();
+
+	cmpt->pidx++;
+	if (cmpt->pidx >= cmpt->nb_desc) {
+		cmpt->pidx = 0;
+		cmpt->color ^= 1;
+	}
+	q->stats.cmpt_entries++;
+}
+
+/*
+ * Find the end of the packet starting at the H2C CIDX.
+ * Returns the number of descriptors in the packet and its length,
+ * or 0 when the EOP descriptor has not been posted yet.
+ */
+static uint16_t qdma_sim_h2c_pkt(struct qdma_sim_ring *ring, uint16_t pidx,
+				uint32_t *pkt_len)
+{
+	struct qdma_ul_st_h2c_desc *desc;
+	uint16_t id = ring->cidx;
+	uint16_t nb = 0;
+	uint32_t len = 0;
+
+	while (id != pidx) {
+		desc = (struct qdma_ul_st_h2c_desc *)(ring->base +
+				(uint32_t)id * ring->desc_sz);
+		len += desc->len;
+		nb++;
+		if (desc->flags & S_H2C_DESC_F_EOP) {
+			*pkt_len = len;
+			return nb;
+		}
+		id++;
+		if (id >= ring->nb_desc)
+			id = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Loop H2C packets back into the C2H ring of the same queue. A packet
+ * is moved only once it is complete and the C2H ring has enough
+ * buffers and the CMPT ring a free entry, otherwise H2C backpressures.
+ */
+static uint16_t qdma_sim_service_st(struct qdma_sim_queue *q)
+{
+	struct qdma_sim_ring *h2c = &q->h2c;
+	struct qdma_sim_ring *c2h = &q->c2h;
+	struct qdma_sim_cmpt *cmpt = &q->cmpt;
+	struct qdma_ul_st_h2c_desc *hdesc;
+	struct qdma_ul_st_c2h_desc *cdesc;
+	uint16_t h2c_pidx, c2h_pidx;
+	uint16_t nb_desc, nb_buf = 0, used, i, n = 0;
+	uint32_t pkt_len, seg_len, seg_off, buf_off = 0;
+	uint8_t *src, *dst = NULL;
+	int loop;
+
+	h2c_pidx = __atomic_load_n(&h2c->pidx, __ATOMIC_ACQUIRE);
+	if (h2c_pidx >= h2c->nb_desc)
+		return 0;
+
+	loop = c2h->en && !c2h->is_mm && cmpt->en && q->c2h_buf_sz;
+	c2h_pidx = loop ? __atomic_load_n(&c2h->pidx, __ATOMIC_ACQUIRE) : 0;
+	if (loop && c2h_pidx >= c2h->nb_desc)
+		return 0;
+
+	while (h2c->cidx != h2c_pidx && n < QDMA_SIM_BURST) {
+		nb_desc = qdma_sim_h2c_pkt(h2c, h2c_pidx, &pkt_len);
+		if (!nb_desc)
+			break;
+
+		if (loop) {
+			nb_buf = RTE_MAX(1, (pkt_len + q->c2h_buf_sz - 1) /
+					q->c2h_buf_sz);
+			if (qdma_sim_ring_used(c2h_pidx, c2h->cidx,
+					c2h->nb_desc) < nb_buf)
+				break;
+			if (qdma_sim_ring_used(cmpt->pidx, cmpt->cidx,
+					cmpt->nb_desc) >= cmpt->nb_desc - 1)
+				break;
+		}
+
+		buf_off = q->c2h_buf_sz;
+		used = 0;
+		for (i = 0; i < nb_desc; i++) {
+			hdesc = (struct qdma_ul_st_h2c_desc *)(h2c->base +
+					(uint32_t)h2c->cidx * h2c->desc_sz);
+			seg_len = hdesc->len;
+			seg_off = 0;
+			src = qdma_sim_iova2virt(hdesc->src_addr);
+
+			while (loop && src && seg_off < seg_len) {
+				uint32_t chunk;
+
+				if (buf_off == q->c2h_buf_sz) {
+					cdesc = (struct qdma_ul_st_c2h_desc *)
+						(c2h->base + (uint32_t)c2h->cidx *
+						 c2h->desc_sz);
+					dst = qdma_sim_iova2virt(
+							cdesc->dst_addr);
+					used++;
+					c2h->cidx++;
+					if (c2h->cidx >= c2h->nb_desc)
+						c2h->cidx = 0;
+					buf_off = 0;
+				}
+				chunk = RTE_MIN(seg_len - seg_off,
+						q->c2h_buf_sz - buf_off);
+				if (dst)
+					rte_memcpy(dst + buf_off,
+						src + seg_off, chunk);
+				seg_off += chunk;
+				buf_off += chunk;
+			}
+
+			h2c->cidx++;
+			if (h2c->cidx >= h2c->nb_desc)
+				h2c->cidx = 0;
+		}
+
+		q->stats.h2c_pkts++;
+		q->stats.h2c_bytes += pkt_len;
+		if (loop) {
+			/* The driver frees as many buffers as the length
+			 * spans and at least one, zero length packets
+			 * included.
+			 */
+			for (; used < nb_buf; used++) {
+				c2h->cidx++;
+				if (c2h->cidx >= c2h->nb_desc)
+					c2h->cidx = 0;
+			}
+			qdma_sim_cmpt_post(q, pkt_len);
+			q->stats.c2h_pkts++;
+			q->stats.c2h_bytes += pkt_len;
+		} else {
+			q->stats.drops++;
+		}
+		n++;
+	}
+
+	if (n && h2c->wbk_en) {
+		rte_smp_wmb();
+		h2c->wb_status->cidx = h2c->cidx;
+	}
+
+	return n;
+}
+
+/*
+ * One pass of the engine over all queues.
+ * Returns the number of descriptors processed.
+ */
+static uint32_t qdma_sim_engine_poll(struct qdma_sim_dev *sdev)
+{
+	struct qdma_sim_queue *q;
+	uint32_t work = 0;
+	uint16_t qid;
+
+	for (qid = 0; qid < sdev->num_queues; qid++) {
+		q = &sdev->queues[qid];
+		if (!q->h2c.en && !q->c2h.en && !q->cmpt.en)
+			continue;
+		/* Contexts are being (re)programmed, retry next pass */
+		if (!rte_spinlock_trylock(&q->lock))
+			continue;
+
+		if (q->h2c.en) {
+			if (q->h2c.is_mm)
+				work += qdma_sim_service_mm(sdev, q, &q->h2c,
+						0);
+			else
+				work += qdma_sim_service_st(q);
+		}
+		if (q->c2h.en && q->c2h.is_mm)
+			work += qdma_sim_service_mm(sdev, q, &q->c2h, 1);
+		if (q->cmpt.en)
+			qdma_sim_cmpt_status(sdev, q);
+
+		rte_spinlock_unlock(&q->lock);
+	}
+
+	return work;
+}
+
+static void *qdma_sim_engine_thread(void *arg)
+{
+	struct qdma_sim_dev *sdev = arg;
+	uint32_t idle = 0;
+
+	while (sdev->run) {
+		if (qdma_sim_engine_poll(sdev)) {
+			idle = 0;
+		} else if (++idle >= QDMA_SIM_IDLE_SPINS) {
+			/* Timer triggers still need polling while idle */
+			usleep(QDMA_SIM_IDLE_SLEEP_US);
+			idle = 0;
+		} else {
+			rte_pause();
+		}
+	}
+
+	return NULL;
+}
+
+static int32_t qdma_sim_engine_service(void *arg)
+{
+	qdma_sim_engine_poll(arg);
+	return 0;
+}
+
+static int qdma_sim_engine_start(struct qdma_sim_dev *sdev)
+{
+	struct rte_service_spec spec;
+	char name[RTE_SERVICE_NAME_MAX];
+	int ret;
+
+	snprintf(name, sizeof(name), "qdma_sim_%u",
+			sdev->dev->data->port_id);
+
+	sdev->run = 1;
+	if (sdev->engine == QDMA_SIM_ENGINE_THREAD) {
+		ret = rte_ctrl_thread_create(&sdev->thread, name, NULL,
+				qdma_sim_engine_thread, sdev);
+		if (ret != 0) {
+			PMD_DRV_LOG(ERR, "%s: engine thread create failed: %d",
+					name, ret);
+			sdev->run = 0;
+			return -ret;
+		}
+	} else {
+		memset(&spec, 0, sizeof(spec));
+		snprintf(spec.name, sizeof(spec.name), "%s", name);
+		spec.callback = qdma_sim_engine_service;
+		spec.callback_userdata = sdev;
+		spec.socket_id = rte_socket_id();
+
+		ret = rte_service_component_register(&spec,
+				&sdev->service_id);
+		if (ret != 0) {
+			PMD_DRV_LOG(ERR, "%s: engine service register "
+					"failed: %d", name, ret);
+			sdev->run = 0;
+			return ret;
+		}
+		rte_service_component_runstate_set(sdev->service_id, 1);
+		rte_service_runstate_set(sdev->service_id, 1);
+		if (rte_service_lcore_count() == 0)
+			PMD_DRV_LOG(WARNING, "%s: no service lcore, map one "
+					"to service %u to run the engine",
+					name, sdev->service_id);
+	}
+
+	sdev->engine_started = 1;
+	PMD_DRV_LOG(INFO, "%s: engine started (%s)", name,
+		(sdev->engine == QDMA_SIM_ENGINE_THREAD) ? "thread" : "service");
+
+	return 0;
+}
+
+static void qdma_sim_engine_stop(struct qdma_sim_dev *sdev)
+{
+	if (!sdev->engine_started)
+		return;
+
+	sdev->run = 0;
+	if (sdev->engine == QDMA_SIM_ENGINE_THREAD) {
+		pthread_join(sdev->thread, NULL);
+	} else {
+		rte_service_runstate_set(sdev->service_id, 0);
+		rte_service_component_runstate_set(sdev->service_id, 0);
+		while (rte_service_may_be_active(sdev->service_id) == 1)
+			rte_pause();
+		rte_service_component_unregister(sdev->service_id);
+	}
+	sdev->engine_started = 0;
+}
+
+/******************************************************************************
+ * ethdev
+ *****************************************************************************/
+
+static void qdma_sim_dump_stats(struct qdma_sim_dev *sdev)
+{
+	struct qdma_sim_queue_stats *s;
+	uint16_t qid;
+
+	for (qid = 0; qid < sdev->num_queues; qid++) {
+		s = &sdev->queues[qid].stats;
+		if (!s->h2c_pkts && !s->mm_h2c_bytes && !s->mm_c2h_bytes)
+			continue;
+		PMD_DRV_LOG(INFO, "sim q%u: h2c %"PRIu64" pkts/%"PRIu64
+			" bytes, c2h %"PRIu64" pkts/%"PRIu64" bytes, drops %"
+			PRIu64", cmpt %"PRIu64", mm h2c %"PRIu64" bytes, "
+			"mm c2h %"PRIu64" bytes", qid,
+			s->h2c_pkts, s->h2c_bytes, s->c2h_pkts, s->c2h_bytes,
+			s->drops, s->cmpt_entries, s->mm_h2c_bytes,
+			s->mm_c2h_bytes);
+	}
+}
+
+static void qdma_sim_dev_free(struct qdma_sim_dev *sdev)
+{
+	struct qdma_pci_dev *qdma_dev = &sdev->qdma_dev;
+
+	qdma_dev_entry_destroy(qdma_dev->dma_device_index,
+			qdma_dev->func_id);
+	qdma_master_resource_destroy(qdma_dev->dma_device_index);
+
+	rte_free(qdma_dev->hw_access);
+	qdma_dev->hw_access = NULL;
+	rte_free(sdev->queues);
+	sdev->queues = NULL;
+	rte_free(sdev->card_mem);
+	sdev->card_mem = NULL;
+}
+
+/**
+ * DPDK callback to close the virtual device.
+ *
+ * Queues are torn down by the regular close path while the engine is
+ * still running, so that pending descriptors drain as on hardware.
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ */
+static int qdma_sim_dev_close(struct rte_eth_dev *dev)
+{
+	struct qdma_sim_dev *sdev = dev->data->dev_private;
+	struct qdma_pci_dev *qdma_dev = &sdev->qdma_dev;
+
+	if (rte_eal_process_type() != RTE_PROC_PRIMARY)
+		return 0;
+	if (qdma_dev->hw_access == NULL)
+		return 0;
+
+	qdma_dev_close(dev);
+	if (qdma_dev->cmpt_queues != NULL) {
+		rte_free(qdma_dev->cmpt_queues);
+		qdma_dev->cmpt_queues = NULL;
+	}
+
+	qdma_sim_engine_stop(sdev);
+	qdma_sim_dump_stats(sdev);
+	qdma_sim_dev_free(sdev);
+
+	return 0;
+}
+
+static int qdma_sim_dev_configure(struct rte_eth_dev *dev)
+{
+	struct qdma_sim_dev *sdev = dev->data->dev_private;
+	struct qdma_pci_dev *qdma_dev = &sdev->qdma_dev;
+	uint32_t qid;
+	int ret;
+
+	ret = qdma_dev_configure(dev);
+	if (ret < 0)
+		return ret;
+
+	/* qdma_dev_configure() starts all the queues in streaming mode */
+	for (qid = 0; qid < sdev->mm_queues && qid < qdma_dev->qsets_en; qid++)
+		qdma_dev->q_info[qid].queue_mode =
+				RTE_PMD_QDMA_MEMORY_MAPPED_MODE;
+
+	return 0;
+}
+
+static struct eth_dev_ops qdma_sim_dev_ops = {
+	.dev_configure            = qdma_sim_dev_configure,
+	.dev_infos_get            = qdma_dev_infos_get,
+	.dev_start                = qdma_dev_start,
+	.dev_stop                 = qdma_dev_stop,
+	.dev_close                = qdma_sim_dev_close,
+	.link_update              = qdma_dev_link_update,
+	.rx_queue_setup           = qdma_dev_rx_queue_setup,
+	.tx_queue_setup           = qdma_dev_tx_queue_setup,
+	.rx_queue_release         = qdma_dev_rx_queue_release,
+	.tx_queue_release         = qdma_dev_tx_queue_release,
+	.rx_queue_start           = qdma_dev_rx_queue_start,
+	.rx_queue_stop            = qdma_dev_rx_queue_stop,
+	.tx_queue_start           = qdma_dev_tx_queue_start,
+	.tx_queue_stop            = qdma_dev_tx_queue_stop,
+	.tx_done_cleanup          = qdma_dev_tx_done_cleanup,
+	.queue_stats_mapping_set  = qdma_dev_queue_stats_mapping,
+	.stats_get                = qdma_dev_stats_get,
+	.stats_reset              = qdma_dev_stats_reset,
+	.rxq_info_get             = qdma_dev_rxq_info_get,
+	.txq_info_get             = qdma_dev_txq_info_get,
+};
+
+static void qdma_sim_dev_ops_init(struct rte_eth_dev *dev)
+{
+	dev->dev_ops = &qdma_sim_dev_ops;
+	dev->rx_pkt_burst = &qdma_recv_pkts;
+	dev->tx_pkt_burst = &qdma_xmit_pkts;
+	dev->rx_queue_count = &qdma_dev_rx_queue_count;
+	dev->rx_descriptor_status = &qdma_dev_rx_descriptor_status;
+	dev->tx_descriptor_status = &qdma_dev_tx_descriptor_status;
+}
+
+static int qdma_sim_num_queues_handler(__rte_unused const char *key,
+					const char *value, void *opaque)
+{
+	struct qdma_sim_dev *sdev = opaque;
+	char *end = NULL;
+	unsigned long num;
+
+	num = strtoul(value, &end, 0);
+	if (end == value || *end != '\0' || num == 0 ||
+			num > QDMA_SIM_MAX_NUM_QUEUES) {
+		PMD_DRV_LOG(ERR, "Invalid %s: %s, range [1, %d]\n",
+				QDMA_SIM_NUM_QUEUES_ARG, value,
+				QDMA_SIM_MAX_NUM_QUEUES);
+		return -1;
+	}
+	sdev->num_queues = (uint16_t)num;
+	return 0;
+}
+
+static int qdma_sim_mm_queues_handler(__rte_unused const char *key,
+					const char *value, void *opaque)
+{
+	struct qdma_sim_dev *sdev = opaque;
+	char *end = NULL;
+	unsigned long num;
+
+	num = strtoul(value, &end, 0);
+	if (end == value || *end != '\0' || num > QDMA_SIM_MAX_NUM_QUEUES) {
+		PMD_DRV_LOG(ERR, "Invalid %s: %s, range [0, %d]\n",
+				QDMA_SIM_MM_QUEUES_ARG, value,
+				QDMA_SIM_MAX_NUM_QUEUES);
+		return -1;
+	}
+	sdev->mm_queues = (uint16_t)num;
+	return 0;
+}
+
+static int qdma_sim_engine_handler(__rte_unused const char *key,
+					const char *value, void *opaque)
+{
+	struct qdma_sim_dev *sdev = opaque;
+
+	if (!strcmp(value, "thread")) {
+		sdev->engine = QDMA_SIM_ENGINE_THREAD;
+	} else if (!strcmp(value, "service")) {
+		sdev->engine = QDMA_SIM_ENGINE_SERVICE;
+	} else {
+		PMD_DRV_LOG(ERR, "Invalid %s: %s, expected thread or "
+				"service\n", QDMA_SIM_ENGINE_ARG, value);
+		return -1;
+	}
+	return 0;
+}
+
+static int qdma_sim_parse_args(struct rte_vdev_device *vdev,
+				struct qdma_sim_dev *sdev)
+{
+	const char *params = rte_vdev_device_args(vdev);
+	struct rte_kvargs *kvlist;
+	int ret = 0;
+
+	sdev->num_queues = QDMA_SIM_DEFAULT_NUM_QUEUES;
+	sdev->mm_queues = 0;
+	sdev->engine = QDMA_SIM_ENGINE_THREAD;
+
+	if (params == NULL || params[0] == '\0')
+		return 0;
+
+	kvlist = rte_kvargs_parse(params, qdma_sim_valid_args);
+	if (kvlist == NULL) {
+		PMD_DRV_LOG(ERR, "Invalid devargs: %s\n", params);
+		return -EINVAL;
+	}
+
+	if (rte_kvargs_process(kvlist, QDMA_SIM_NUM_QUEUES_ARG,
+			qdma_sim_num_queues_handler, sdev) < 0 ||
+		rte_kvargs_process(kvlist, QDMA_SIM_ENGINE_ARG,
+			qdma_sim_engine_handler, sdev) < 0 ||
+		rte_kvargs_process(kvlist, QDMA_SIM_MM_QUEUES_ARG,
+			qdma_sim_mm_queues_handler, sdev) < 0) {
+		ret = -EINVAL;
+	} else if (sdev->mm_queues > sdev->num_queues) {
+		PMD_DRV_LOG(ERR, "Invalid %s: %u, more than %s %u\n",
+				QDMA_SIM_MM_QUEUES_ARG, sdev->mm_queues,
+				QDMA_SIM_NUM_QUEUES_ARG, sdev->num_queues);
+		ret = -EINVAL;
+	}
+
+	rte_kvargs_free(kvlist);
+	return ret;
+}
+
+static int qdma_sim_dev_init(struct rte_vdev_device *vdev,
+				struct rte_eth_dev *dev)
+{
+	struct qdma_sim_dev *sdev = dev->data->dev_private;
+	struct qdma_pci_dev *dma_priv = &sdev->qdma_dev;
+	uint32_t bus;
+	int i, ret;
+
+	sdev->dev = dev;
+	ret = qdma_sim_parse_args(vdev, sdev);
+	if (ret < 0)
+		return ret;
+
+	/* allocate space for a single Ethernet MAC address */
+	dev->data->mac_addrs = rte_zmalloc("qdma_sim", RTE_ETHER_ADDR_LEN, 0);
+	if (dev->data->mac_addrs == NULL)
+		return -ENOMEM;
+	for (i = 0; i < RTE_ETHER_ADDR_LEN; ++i)
+		dev->data->mac_addrs[0].addr_bytes[i] = 0x15 + i;
+	/* locally administered, distinct per instance */
+	dev->data->mac_addrs[0].addr_bytes[0] = 0x02;
+	dev->data->mac_addrs[0].addr_bytes[5] = dev->data->port_id;
+
+	sdev->queues = rte_zmalloc("qdma_sim_queues",
+			sizeof(struct qdma_sim_queue) * sdev->num_queues,
+			RTE_CACHE_LINE_SIZE);
+	sdev->card_mem = rte_zmalloc("qdma_sim_card", DMA_BRAM_SIZE,
+			RTE_CACHE_LINE_SIZE);
+	dma_priv->hw_access = rte_zmalloc("hwaccess",
+			sizeof(struct qdma_hw_access), 0);
+	if (!sdev->queues || !sdev->card_mem || !dma_priv->hw_access) {
+		ret = -ENOMEM;
+		goto init_err;
+	}
+	for (i = 0; i < sdev->num_queues; i++)
+		rte_spinlock_init(&sdev->queues[i].lock);
+	qdma_sim_hw_access_init(dma_priv->hw_access);
+
+	/* Init system & device, defaults as for the PCI PF */
+	dma_priv->is_vf = 0;
+	dma_priv->is_master = 0;
+	dma_priv->vf_online_count = 0;
+	dma_priv->timer_count = DEFAULT_TIMER_CNT_TRIG_MODE_TIMER;
+	dma_priv->en_desc_prefetch = 0;
+	dma_priv->cmpt_desc_len = DEFAULT_QDMA_CMPT_DESC_LEN;
+	dma_priv->c2h_bypass_mode = RTE_PMD_QDMA_RX_BYPASS_NONE;
+	dma_priv->h2c_bypass_mode = 0;
+	dma_priv->config_bar_idx = BAR_ID_INVALID;
+	dma_priv->bypass_bar_idx = BAR_ID_INVALID;
+	dma_priv->user_bar_idx = BAR_ID_INVALID;
+	dma_priv->ip_type = QDMA_SOFT_IP;
+	dma_priv->device_type = QDMA_DEVICE_SOFT;
+
+	dma_priv->hw_access->qdma_get_device_attributes(dev,
+			&dma_priv->dev_cap);
+	dma_priv->trigger_mode = RTE_PMD_QDMA_TRIG_MODE_USER_TIMER_COUNT;
+	dma_priv->timer_count = DEFAULT_TIMER_CNT_TRIG_MODE_COUNT_TIMER;
+
+	if (qdma_check_kvargs(dev->device->devargs, dma_priv)) {
+		PMD_DRV_LOG(INFO, "devargs failed\n");
+		ret = -EINVAL;
+		goto init_err;
+	}
+	/* No descriptor bypass logic behind the virtual device */
+	dma_priv->c2h_bypass_mode = RTE_PMD_QDMA_RX_BYPASS_NONE;
+	dma_priv->h2c_bypass_mode = 0;
+
+	/* Each instance is a board of its own for the resource manager */
+	bus = QDMA_SIM_BUS_BASE + qdma_sim_instances++;
+	ret = qdma_master_resource_create(bus, bus, DEFAULT_QUEUE_BASE,
+			dma_priv->dev_cap.num_qs, &dma_priv->dma_device_index);
+	if (ret != QDMA_SUCCESS) {
+		ret = (ret == -QDMA_ERR_NO_MEM) ? -ENOMEM : -EINVAL;
+		goto init_err;
+	}
+
+	dma_priv->hw_access->qdma_get_function_number(dev,
+			&dma_priv->func_id);
+	dma_priv->hw_access->qdma_set_default_global_csr(dev);
+	dma_priv->hw_access->qdma_init_ctxt_memory(dev);
+
+	ret = qdma_dev_entry_create(dma_priv->dma_device_index,
+			dma_priv->func_id);
+	if (ret != QDMA_SUCCESS) {
+		PMD_DRV_LOG(ERR, "qdma_dev_entry_create failed: %d\n", ret);
+		qdma_master_resource_destroy(dma_priv->dma_device_index);
+		ret = -ENOMEM;
+		goto init_err;
+	}
+
+	qdma_sim_dev_ops_init(dev);
+
+	ret = qdma_sim_engine_start(sdev);
+	if (ret < 0) {
+		qdma_dev_entry_destroy(dma_priv->dma_device_index,
+				dma_priv->func_id);
+		qdma_master_resource_destroy(dma_priv->dma_device_index);
+		goto init_err;
+	}
+
+	PMD_DRV_LOG(INFO, "%s: virtual QDMA device with %u queues, %u MM",
+			rte_vdev_device_name(vdev), sdev->num_queues,
+			sdev->mm_queues);
+	return 0;
+
+init_err:
+	rte_free(dma_priv->hw_access);
+	dma_priv->hw_access = NULL;
+	rte_free(sdev->card_mem);
+	sdev->card_mem = NULL;
+	rte_free(sdev->queues);
+	sdev->queues = NULL;
+	return ret;
+}
+
+static int qdma_sim_probe(struct rte_vdev_device *vdev)
+{
+	const char *name = rte_vdev_device_name(vdev);
+	struct rte_eth_dev *dev;
+	int ret;
+
+	PMD_DRV_LOG(INFO, "Initializing %s", name);
+
+	if (rte_eal_process_type() == RTE_PROC_SECONDARY) {
+		dev = rte_eth_dev_attach_secondary(name);
+		if (dev == NULL) {
+			PMD_DRV_LOG(ERR, "Failed to probe %s", name);
+			return -1;
+		}
+		qdma_sim_dev_ops_init(dev);
+		dev->device = &vdev->device;
+		rte_eth_dev_probing_finish(dev);
+		return 0;
+	}
+
+	dev = rte_eth_vdev_allocate(vdev, sizeof(struct qdma_sim_dev));
+	if (dev == NULL)
+		return -ENOMEM;
+
+	ret = qdma_sim_dev_init(vdev, dev);
+	if (ret < 0) {
+		rte_eth_dev_release_port(dev);
+		return ret;
+	}
+
+	rte_eth_dev_probing_finish(dev);
+	return 0;
+}
+
+static int qdma_sim_remove(struct rte_vdev_device *vdev)
+{
+	struct rte_eth_dev *dev;
+
+	dev = rte_eth_dev_allocated(rte_vdev_device_name(vdev));
+	if (dev == NULL)
+		return 0;
+
+	qdma_sim_dev_close(dev);
+	rte_eth_dev_release_port(dev);
+
+	return 0;
+}
+
+static struct rte_vdev_driver qdma_sim_pmd = {
+	.probe = qdma_sim_probe,
+	.remove = qdma_sim_remove,
+};
+
+bool
+is_qdma_sim_device(struct rte_eth_dev *dev)
+{
+	if (strcmp(dev->device->driver->name, qdma_sim_pmd.driver.name))
+		return false;
+
+	return true;
+}
+
+RTE_PMD_REGISTER_VDEV(net_qdma_sim, qdma_sim_pmd);
+RTE_PMD_REGISTER_PARAM_STRING(net_qdma_sim,
+	QDMA_SIM_NUM_QUEUES_ARG "=<int> "
+	QDMA_SIM_ENGINE_ARG "=thread|service "
+	QDMA_SIM_MM_QUEUES_ARG "=<int> "
+	"desc_prefetch=<0|1> "
+	"cmpt_desc_len=<8|16|32|64> "
+	"trigger_mode=<int>");
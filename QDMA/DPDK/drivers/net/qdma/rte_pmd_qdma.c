@@ -979,6 +979,11 @@ int rte_pmd_qdma_configure_tx_bypass(int port_id, uint32_t qid,
 	}
 	dev = &rte_eth_devices[port_id];
 	qdma_dev = dev->data->dev_private;
+	if (is_qdma_sim_device(dev)) {
+		PMD_DRV_LOG(ERR, "Bypass mode not supported by the virtual "
+				"device\n");
+		return -ENOTSUP;
+	}
 	if (qid < dev->data->nb_tx_queues) {
 		if (bypass_mode >= RTE_PMD_QDMA_TX_BYPASS_MAX) {
 			PMD_DRV_LOG(ERR, "Invalid Tx Bypass mode : %d\n",
@@ -1060,6 +1065,11 @@ int rte_pmd_qdma_configure_rx_bypass(int port_id, uint32_t qid,
 	}
 	dev = &rte_eth_devices[port_id];
 	qdma_dev = dev->data->dev_private;
+	if (is_qdma_sim_device(dev)) {
+		PMD_DRV_LOG(ERR, "Bypass mode not supported by the virtual "
+				"device\n");
+		return -ENOTSUP;
+	}
 	if (qid < dev->data->nb_rx_queues) {
 		if (bypass_mode >= RTE_PMD_QDMA_RX_BYPASS_MAX) {
 			PMD_DRV_LOG(ERR, "Invalid Rx Bypass mode : %d\n",
@@ -163,6 +163,10 @@ static void cmd_help_parsed(__attribute__((unused)) void *parsed_result,
 						"<output-filename> "
 			"<src_addr> <size> <iterations>  "
 			":To Receive\n"
+			"\tdma_bench            <port-id> <num-queues> "
+						"<num-lcores> <h2c|c2h|bidir> "
+			"<pkt-size> <burst> <duration-sec>  "
+			":Multi-lcore ST throughput/latency benchmark\n"
 			"\treg_dump             <port-id>  "
 			":To dump all the valid registers\n"
 			"\treg_info_read        <port-id> <reg-addr> <num-regs> "
@@ -1044,6 +1048,107 @@ cmdline_parse_inst_t cmd_obj_dma_from_device = {
 
 };
 
+/* Command dma-bench */
+struct cmd_obj_dma_bench_result {
+	cmdline_fixed_string_t action;
+	cmdline_fixed_string_t port_id;
+	cmdline_fixed_string_t queues;
+	cmdline_fixed_string_t lcores;
+	cmdline_fixed_string_t mode;
+	cmdline_fixed_string_t pkt_size;
+	cmdline_fixed_string_t burst;
+	cmdline_fixed_string_t duration;
+};
+
+static void cmd_obj_dma_bench_parsed(void *parsed_result,
+			       struct cmdline *cl,
+			       __attribute__((unused)) void *data)
+{
+	struct cmd_obj_dma_bench_result *res = parsed_result;
+	enum bench_mode mode;
+	int port_id, num_queues, num_lcores, pkt_size, burst, duration;
+
+	port_id = atoi(res->port_id);
+	if (port_id >= num_ports) {
+		cmdline_printf(cl, "Error: port-id:%d not supported\n "
+					"Please enter valid port-id\n",
+					port_id);
+		return;
+	}
+
+	if (!strcmp(res->mode, "h2c"))
+		mode = BENCH_MODE_H2C;
+	else if (!strcmp(res->mode, "c2h"))
+		mode = BENCH_MODE_C2H;
+	else if (!strcmp(res->mode, "bidir"))
+		mode = BENCH_MODE_BIDIR;
+	else {
+		cmdline_printf(cl, "Error: invalid mode %s, "
+				"expected h2c, c2h or bidir\n", res->mode);
+		return;
+	}
+
+	num_queues = atoi(res->queues);
+	num_lcores = atoi(res->lcores);
+	pkt_size = atoi(res->pkt_size);
+	burst = atoi(res->burst);
+	duration = atoi(res->duration);
+
+	cmdline_printf(cl, "bench on Port:%d, num-queues:%d, lcores:%d, "
+			"mode:%s, pkt-size:%d, burst:%d, duration:%ds\n\n",
+			port_id, num_queues, num_lcores, res->mode,
+			pkt_size, burst, duration);
+
+	if (do_bench(port_id, num_queues, num_lcores, mode, pkt_size,
+			burst, duration) < 0)
+		cmdline_printf(cl, "Error: dma_bench failed on port %d\n",
+				port_id);
+}
+
+cmdline_parse_token_string_t cmd_obj_action_dma_bench =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, action,
+							"dma_bench");
+cmdline_parse_token_string_t cmd_obj_dma_bench_port_id =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, port_id,
+								NULL);
+cmdline_parse_token_string_t cmd_obj_dma_bench_queues =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, queues,
+								NULL);
+cmdline_parse_token_string_t cmd_obj_dma_bench_lcores =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, lcores,
+								NULL);
+cmdline_parse_token_string_t cmd_obj_dma_bench_mode =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, mode,
+							"h2c#c2h#bidir");
+cmdline_parse_token_string_t cmd_obj_dma_bench_pkt_size =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, pkt_size,
+								NULL);
+cmdline_parse_token_string_t cmd_obj_dma_bench_burst =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, burst,
+								NULL);
+cmdline_parse_token_string_t cmd_obj_dma_bench_duration =
+	TOKEN_STRING_INITIALIZER(struct cmd_obj_dma_bench_result, duration,
+								NULL);
+
+cmdline_parse_inst_t cmd_obj_dma_bench = {
+	.f = cmd_obj_dma_bench_parsed,  /* function to call */
+	.data = NULL,      /* 2nd arg of func */
+	.help_str = "dma_bench port-id num-queues num-lcores h2c|c2h|bidir "
+			"pkt-size burst duration-sec",
+	.tokens = {        /* token list, NULL terminated */
+		(void *)&cmd_obj_action_dma_bench,
+		(void *)&cmd_obj_dma_bench_port_id,
+		(void *)&cmd_obj_dma_bench_queues,
+		(void *)&cmd_obj_dma_bench_lcores,
+		(void *)&cmd_obj_dma_bench_mode,
+		(void *)&cmd_obj_dma_bench_pkt_size,
+		(void *)&cmd_obj_dma_bench_burst,
+		(void *)&cmd_obj_dma_bench_duration,
+		NULL,
+	},
+
+};
+
 struct cmd_obj_reg_dump_result {
 	cmdline_fixed_string_t action;
 	cmdline_fixed_string_t port_id;
@@ -1362,6 +1467,7 @@ cmdline_parse_ctx_t main_ctx[] = {
 	(cmdline_parse_inst_t *)&cmd_obj_reg_write,
 	(cmdline_parse_inst_t *)&cmd_obj_dma_to_device,
 	(cmdline_parse_inst_t *)&cmd_obj_dma_from_device,
+	(cmdline_parse_inst_t *)&cmd_obj_dma_bench,
 	(cmdline_parse_inst_t *)&cmd_obj_reg_dump,
 	(cmdline_parse_inst_t *)&cmd_obj_reg_info_read,
 	(cmdline_parse_inst_t *)&cmd_obj_queue_dump,
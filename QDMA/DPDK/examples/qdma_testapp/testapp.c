@@ -42,6 +42,8 @@
 #include <rte_memcpy.h>
 #include <rte_malloc.h>
 #include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
 #include <rte_log.h>
 #include <rte_string_fns.h>
 #include <rte_spinlock.h>
@@ -626,6 +628,417 @@ int do_xmit(int port_id, int fd, int queueid, int ld_size, int tot_num_desc,
 	return 0;
 }
 
+/* Header stamped at the start of every dma_bench H2C packet. In ST
+ * loopback mode the design returns it on the C2H side of the same queue,
+ * which gives the round trip latency of each packet.
+ */
+struct bench_hdr {
+	uint64_t magic;
+	uint64_t tsc;
+	uint32_t qid;
+	uint32_t seq;
+};
+
+struct bench_queue_stats {
+	uint16_t qid;
+	unsigned int lcore_id;
+	uint32_t seq;
+	uint64_t tx_pkts;
+	uint64_t tx_bytes;
+	uint64_t tx_alloc_fail;
+	uint64_t rx_pkts;
+	uint64_t rx_bytes;
+	uint64_t lat_cnt;
+	uint64_t lat_min;
+	uint64_t lat_max;
+	uint64_t lat_sum;
+	uint64_t lat_hist[BENCH_HIST_BUCKETS];
+} __rte_cache_aligned;
+
+struct bench_lcore_ctx {
+	int port_id;
+	enum bench_mode mode;
+	int pkt_size;
+	int burst;
+	uint64_t end_tsc;
+	struct rte_mempool *mp;
+	struct bench_queue_stats *qstats;
+	int qfirst;
+	int qstride;
+	int num_queues;
+};
+
+static struct bench_lcore_ctx bench_ctx[RTE_MAX_LCORE];
+static volatile int bench_stop;
+
+/* Log-linear latency histogram: values below 2 * BENCH_HIST_SUB_CNT ns
+ * are counted exactly, larger values use BENCH_HIST_SUB_CNT sub-buckets
+ * per power of two (~3% resolution).
+ */
+static inline uint32_t bench_hist_bucket(uint64_t val)
+{
+	uint32_t msb;
+
+	if (val < 2 * BENCH_HIST_SUB_CNT)
+		return (uint32_t)val;
+
+	msb = 63 - __builtin_clzll(val);
+	return 2 * BENCH_HIST_SUB_CNT +
+		(msb - BENCH_HIST_SUB_BITS - 1) * BENCH_HIST_SUB_CNT +
+		((val >> (msb - BENCH_HIST_SUB_BITS)) &
+		 (BENCH_HIST_SUB_CNT - 1));
+}
+
+static uint64_t bench_hist_value(uint32_t bucket)
+{
+	uint32_t msb, sub;
+	uint64_t width;
+
+	if (bucket < 2 * BENCH_HIST_SUB_CNT)
+		return bucket;
+
+	bucket -= 2 * BENCH_HIST_SUB_CNT;
+	msb = bucket / BENCH_HIST_SUB_CNT + BENCH_HIST_SUB_BITS + 1;
+	sub = bucket % BENCH_HIST_SUB_CNT;
+	width = 1ULL << (msb - BENCH_HIST_SUB_BITS);
+
+	/* report the middle of the bucket */
+	return (1ULL << msb) + sub * width + width / 2;
+}
+
+static uint64_t bench_hist_percentile(const uint64_t *hist, uint64_t cnt,
+		double pct)
+{
+	uint64_t target, seen = 0;
+	uint32_t i;
+
+	if (cnt == 0)
+		return 0;
+
+	target = (uint64_t)((double)cnt * pct / 100.0);
+	if (target >= cnt)
+		target = cnt - 1;
+
+	for (i = 0; i < BENCH_HIST_BUCKETS; i++) {
+		seen += hist[i];
+		if (seen > target)
+			return bench_hist_value(i);
+	}
+
+	return bench_hist_value(BENCH_HIST_BUCKETS - 1);
+}
+
+static void bench_tx(struct bench_lcore_ctx *ctx,
+		struct bench_queue_stats *qs, struct rte_mbuf **pkts)
+{
+	struct bench_hdr *hdr;
+	uint64_t tsc;
+	int i, nb_tx;
+
+	if (rte_pktmbuf_alloc_bulk(ctx->mp, pkts, ctx->burst) != 0) {
+		qs->tx_alloc_fail++;
+		return;
+	}
+
+	for (i = 0; i < ctx->burst; i++) {
+		rte_pktmbuf_data_len(pkts[i]) = (uint16_t)ctx->pkt_size;
+		rte_pktmbuf_pkt_len(pkts[i]) = (uint16_t)ctx->pkt_size;
+		hdr = rte_pktmbuf_mtod(pkts[i], struct bench_hdr *);
+		hdr->magic = BENCH_HDR_MAGIC;
+		hdr->qid = qs->qid;
+		hdr->seq = qs->seq++;
+	}
+
+	/* stamp the whole burst right before handing it to the PMD */
+	tsc = rte_rdtsc();
+	for (i = 0; i < ctx->burst; i++) {
+		hdr = rte_pktmbuf_mtod(pkts[i], struct bench_hdr *);
+		hdr->tsc = tsc;
+	}
+
+	nb_tx = rte_eth_tx_burst(ctx->port_id, qs->qid, pkts, ctx->burst);
+	qs->tx_pkts += nb_tx;
+	qs->tx_bytes += (uint64_t)nb_tx * ctx->pkt_size;
+
+	for (i = nb_tx; i < ctx->burst; i++)
+		rte_pktmbuf_free(pkts[i]);
+}
+
+static void bench_rx(struct bench_lcore_ctx *ctx,
+		struct bench_queue_stats *qs, struct rte_mbuf **pkts,
+		double ns_per_cycle)
+{
+	struct bench_hdr *hdr;
+	uint64_t now, lat;
+	int i, nb_rx;
+
+	nb_rx = rte_eth_rx_burst(ctx->port_id, qs->qid, pkts, ctx->burst);
+	if (nb_rx == 0)
+		return;
+
+	now = rte_rdtsc();
+	for (i = 0; i < nb_rx; i++) {
+		qs->rx_bytes += rte_pktmbuf_pkt_len(pkts[i]);
+		if (rte_pktmbuf_data_len(pkts[i]) >= sizeof(*hdr)) {
+			hdr = rte_pktmbuf_mtod(pkts[i], struct bench_hdr *);
+			if ((hdr->magic == BENCH_HDR_MAGIC) &&
+					(hdr->qid == qs->qid) &&
+					(now > hdr->tsc)) {
+				lat = (uint64_t)((now - hdr->tsc) *
+						ns_per_cycle);
+				if (qs->lat_cnt == 0 || lat < qs->lat_min)
+					qs->lat_min = lat;
+				if (lat > qs->lat_max)
+					qs->lat_max = lat;
+				qs->lat_sum += lat;
+				qs->lat_cnt++;
+				qs->lat_hist[bench_hist_bucket(lat)]++;
+			}
+		}
+		rte_pktmbuf_free(pkts[i]);
+	}
+	qs->rx_pkts += nb_rx;
+}
+
+static int bench_lcore_main(void *arg)
+{
+	struct bench_lcore_ctx *ctx = arg;
+	struct rte_mbuf *pkts[BENCH_MAX_BURST];
+	struct bench_queue_stats *qs;
+	double ns_per_cycle = 1E9 / (double)rte_get_tsc_hz();
+	int do_tx = (ctx->mode != BENCH_MODE_C2H);
+	int do_rx = (ctx->mode != BENCH_MODE_H2C);
+	uint64_t drain_end;
+	int q;
+
+	while (!bench_stop && (rte_rdtsc() < ctx->end_tsc)) {
+		for (q = ctx->qfirst; q < ctx->num_queues;
+				q += ctx->qstride) {
+			qs = &ctx->qstats[q];
+			if (do_tx)
+				bench_tx(ctx, qs, pkts);
+			if (do_rx)
+				bench_rx(ctx, qs, pkts, ns_per_cycle);
+		}
+	}
+
+	if (!do_rx)
+		return 0;
+
+	/* collect packets still in flight on the loopback path */
+	drain_end = rte_rdtsc() +
+		(rte_get_tsc_hz() * BENCH_DRAIN_US) / US_PER_S;
+	while (rte_rdtsc() < drain_end) {
+		for (q = ctx->qfirst; q < ctx->num_queues;
+				q += ctx->qstride)
+			bench_rx(ctx, &ctx->qstats[q], pkts, ns_per_cycle);
+	}
+
+	return 0;
+}
+
+static void bench_print_stats(struct bench_queue_stats *qstats,
+		int num_queues, int duration)
+{
+	uint64_t *hist;
+	uint64_t tx_pkts = 0, tx_bytes = 0, rx_pkts = 0, rx_bytes = 0;
+	uint64_t lat_cnt = 0, lat_min = UINT64_MAX, lat_max = 0;
+	uint64_t alloc_fail = 0;
+	struct bench_queue_stats *qs;
+	int q;
+	uint32_t i;
+
+	hist = rte_zmalloc("bench_hist", BENCH_HIST_BUCKETS * sizeof(*hist),
+			0);
+	if (hist == NULL)
+		printf("Could not allocate aggregate histogram, "
+				"skipping aggregate percentiles\n");
+
+	printf("%6s%7s%12s%12s%12s%12s%12s%12s\n",
+			"Queue", "Lcore", "TX Mpps", "TX Gbps",
+			"RX Mpps", "RX Gbps", "p50(us)", "p99(us)");
+	for (q = 0; q < num_queues; q++) {
+		qs = &qstats[q];
+		printf("%6u%7u%12.3lf%12.3lf%12.3lf%12.3lf%12.2lf%12.2lf\n",
+			qs->qid, qs->lcore_id,
+			(double)qs->tx_pkts / duration / 1E6,
+			(double)qs->tx_bytes * 8 / duration / 1E9,
+			(double)qs->rx_pkts / duration / 1E6,
+			(double)qs->rx_bytes * 8 / duration / 1E9,
+			bench_hist_percentile(qs->lat_hist, qs->lat_cnt,
+				50.0) / 1E3,
+			bench_hist_percentile(qs->lat_hist, qs->lat_cnt,
+				99.0) / 1E3);
+
+		tx_pkts += qs->tx_pkts;
+		tx_bytes += qs->tx_bytes;
+		rx_pkts += qs->rx_pkts;
+		rx_bytes += qs->rx_bytes;
+		alloc_fail += qs->tx_alloc_fail;
+		if (qs->lat_cnt) {
+			lat_cnt += qs->lat_cnt;
+			if (qs->lat_min < lat_min)
+				lat_min = qs->lat_min;
+			if (qs->lat_max > lat_max)
+				lat_max = qs->lat_max;
+		}
+		if (hist != NULL)
+			for (i = 0; i < BENCH_HIST_BUCKETS; i++)
+				hist[i] += qs->lat_hist[i];
+	}
+
+	printf("\nAggregate: TX %.3lf Mpps %.3lf Gbps, "
+			"RX %.3lf Mpps %.3lf Gbps, mbuf alloc failures %"
+			PRIu64 "\n",
+			(double)tx_pkts / duration / 1E6,
+			(double)tx_bytes * 8 / duration / 1E9,
+			(double)rx_pkts / duration / 1E6,
+			(double)rx_bytes * 8 / duration / 1E9,
+			alloc_fail);
+
+	if (lat_cnt == 0) {
+		printf("Latency: no timestamped packets received\n");
+	} else if (hist != NULL) {
+		printf("Latency(us) over %" PRIu64 " pkts: min %.2lf "
+			"p50 %.2lf p90 %.2lf p99 %.2lf p99.9 %.2lf "
+			"max %.2lf\n", lat_cnt, lat_min / 1E3,
+			bench_hist_percentile(hist, lat_cnt, 50.0) / 1E3,
+			bench_hist_percentile(hist, lat_cnt, 90.0) / 1E3,
+			bench_hist_percentile(hist, lat_cnt, 99.0) / 1E3,
+			bench_hist_percentile(hist, lat_cnt, 99.9) / 1E3,
+			lat_max / 1E3);
+	}
+
+	rte_free(hist);
+}
+
+int do_bench(int port_id, int num_queues, int num_lcores,
+		enum bench_mode mode, int pkt_size, int burst, int duration)
+{
+	struct bench_queue_stats *qstats;
+	struct rte_mempool *mp;
+	struct rte_device *dev;
+	unsigned int lcore_id;
+	unsigned int lcores[RTE_MAX_LCORE];
+	uint64_t end_tsc;
+	int nb_lcores = 0, launched = 0, q, i, ret = 0;
+
+	if ((num_queues <= 0) ||
+			((unsigned int)num_queues > pinfo[port_id].st_queues)) {
+		printf("Error: num-queues %d must be between 1 and the "
+				"configured ST queues %u\n",
+				num_queues, pinfo[port_id].st_queues);
+		return -1;
+	}
+
+	if ((num_lcores <= 0) ||
+			((unsigned int)num_lcores >= rte_lcore_count())) {
+		printf("Error: num-lcores %d must be between 1 and the "
+				"available worker lcores %u\n",
+				num_lcores, rte_lcore_count() - 1);
+		return -1;
+	}
+
+	if ((pkt_size < (int)sizeof(struct bench_hdr)) ||
+			((unsigned int)pkt_size > pinfo[port_id].buff_size)) {
+		printf("Error: pkt-size %d must be between %d and the "
+				"port buffer size %u\n", pkt_size,
+				(int)sizeof(struct bench_hdr),
+				pinfo[port_id].buff_size);
+		return -1;
+	}
+
+	if ((burst <= 0) || (burst > BENCH_MAX_BURST) || (duration <= 0)) {
+		printf("Error: burst must be between 1 and %d and duration "
+				"must be non-zero\n", BENCH_MAX_BURST);
+		return -1;
+	}
+
+	rte_spinlock_lock(&pinfo[port_id].port_update_lock);
+
+	dev = rte_eth_devices[port_id].device;
+	if (dev == NULL) {
+		printf("Port id %d already removed. "
+			"Relaunch application to use the port again\n",
+			port_id);
+		rte_spinlock_unlock(&pinfo[port_id].port_update_lock);
+		return -1;
+	}
+
+	mp = rte_mempool_lookup(pinfo[port_id].mem_pool);
+	if (mp == NULL) {
+		printf("Could not find mempool with name %s\n",
+				pinfo[port_id].mem_pool);
+		rte_spinlock_unlock(&pinfo[port_id].port_update_lock);
+		return -1;
+	}
+
+	qstats = rte_zmalloc("bench_qstats", num_queues * sizeof(*qstats),
+			RTE_CACHE_LINE_SIZE);
+	if (qstats == NULL) {
+		printf("Could not allocate benchmark stats for %d queues\n",
+				num_queues);
+		rte_spinlock_unlock(&pinfo[port_id].port_update_lock);
+		return -1;
+	}
+
+	RTE_LCORE_FOREACH_WORKER(lcore_id) {
+		if (nb_lcores == num_lcores)
+			break;
+		lcores[nb_lcores++] = lcore_id;
+	}
+	/* more lcores than queues leaves the extra lcores idle */
+	if (nb_lcores > num_queues)
+		nb_lcores = num_queues;
+
+	for (q = 0; q < num_queues; q++) {
+		qstats[q].qid = q;
+		qstats[q].lcore_id = lcores[q % nb_lcores];
+	}
+
+	bench_stop = 0;
+	end_tsc = rte_rdtsc() + rte_get_tsc_hz() * (uint64_t)duration;
+	for (i = 0; i < nb_lcores; i++) {
+		bench_ctx[i].port_id = port_id;
+		bench_ctx[i].mode = mode;
+		bench_ctx[i].pkt_size = pkt_size;
+		bench_ctx[i].burst = burst;
+		bench_ctx[i].end_tsc = end_tsc;
+		bench_ctx[i].mp = mp;
+		bench_ctx[i].qstats = qstats;
+		bench_ctx[i].qfirst = i;
+		bench_ctx[i].qstride = nb_lcores;
+		bench_ctx[i].num_queues = num_queues;
+
+		ret = rte_eal_remote_launch(bench_lcore_main, &bench_ctx[i],
+				lcores[i]);
+		if (ret < 0) {
+			printf("Error: could not launch benchmark on "
+					"lcore %u, err %d\n", lcores[i], ret);
+			bench_stop = 1;
+			break;
+		}
+		launched++;
+	}
+
+	for (i = 0; i < launched; i++)
+		rte_eal_wait_lcore(lcores[i]);
+
+	if (ret == 0) {
+		printf("\ndma_bench: port %d, %d queues on %d lcores, "
+				"%s, pkt-size %d, burst %d, %d sec\n\n",
+				port_id, num_queues, nb_lcores,
+				(mode == BENCH_MODE_H2C) ? "h2c" :
+				(mode == BENCH_MODE_C2H) ? "c2h" : "bidir",
+				pkt_size, burst, duration);
+		bench_print_stats(qstats, num_queues, duration);
+	}
+
+	rte_free(qstats);
+	rte_spinlock_unlock(&pinfo[port_id].port_update_lock);
+	return ret;
+}
+
 static int dev_reset_callback(uint16_t port_id,
 				enum rte_eth_event_type type,
 				void *param __rte_unused, void *ret_param)
@@ -45,6 +45,16 @@
 #define RX_TX_MAX_RETRY			1500
 #define DEFAULT_RX_WRITEBACK_THRESH	(64)
 
+/* dma_bench command */
+#define BENCH_MAX_BURST			512
+#define BENCH_DRAIN_US			(10000)
+#define BENCH_HIST_SUB_BITS		5
+#define BENCH_HIST_SUB_CNT		(1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BUCKETS		(2 * BENCH_HIST_SUB_CNT + \
+					 (64 - BENCH_HIST_SUB_BITS - 1) * \
+					 BENCH_HIST_SUB_CNT)
+#define BENCH_HDR_MAGIC			0x51444d4142454e43ULL
+
 #define MP_CACHE_SZ     512
 #define MBUF_POOL_NAME_PORT   "mbuf_pool_%d"
 
@@ -65,6 +75,12 @@
 
 extern int num_ports;
 
+enum bench_mode {
+	BENCH_MODE_H2C,
+	BENCH_MODE_C2H,
+	BENCH_MODE_BIDIR
+};
+
 struct port_info {
 	int config_bar_idx;
 	int user_bar_idx;
@@ -86,6 +102,8 @@ int do_recv_mm(int port_id, int fd, int queueid,
 		int ld_size, int tot_num_desc);
 int do_xmit(int port_id, int fd, int queueid,
 		int ld_size, int tot_num_desc, int zbyte);
+int do_bench(int port_id, int num_queues, int num_lcores,
+		enum bench_mode mode, int pkt_size, int burst, int duration);
 void load_file_cmds(struct cmdline *cl);
 void port_close(int port_id);
 int port_reset(int port_id, int num_queues, int st_queues,
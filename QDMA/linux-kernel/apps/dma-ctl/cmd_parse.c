@@ -75,6 +75,14 @@ static const char *progname;
 #define Q_CMPT_READ_FLAG_IGNORE_MASK  ~(XNL_F_QMODE_ST | \
 					XNL_F_QMODE_MM | \
 					XNL_F_QDIR_BOTH | XNL_F_Q_CMPL)
+#define Q_RATE_LIMIT_ATTR_IGNORE_MASK ~((1 << QPARM_IDX) | \
+				(1 << QPARM_MODE) | \
+				(1 << QPARM_DIR) | \
+				(1 << QPARM_RL_RATE) | \
+				(1 << QPARM_RL_BURST))
+#define Q_RATE_LIMIT_FLAG_IGNORE_MASK ~(XNL_F_QMODE_ST | \
+					XNL_F_QMODE_MM | \
+					XNL_F_QDIR_BOTH | XNL_F_RL_BORROW)
 
 #ifdef ERR_DEBUG
 char *qdma_err_str[qdma_errs] = {
@@ -204,6 +212,8 @@ static void __attribute__((noreturn)) usage(FILE *fp)
 		"\t\tcap....                 lists the Hardware and Software version and capabilities\n"
 		"\t\tstat                    statistics of qdma[N] device\n"
 		"\t\tstat clear              clear all statistics data of qdma[N} device\n"
+		"\t\tstat bin [idx <N>] [num <N>] per queue counters and completion latency histogram of qdma[N] device\n"
+		"\t\tratelimit rate <Mbit/s> [burst <bytes>] - limit the bandwidth of all the queues of qdma[N], rate 0 removes the limit\n"
 		"\t\tglobal_csr              dump the Global CSR of qdma[N} device\n"
 		"\t\tq list                  list all queues\n"
 		"\t\tq add idx <N> [mode <mm|st>] [dir <h2c|c2h|bi|cmpt>] - add a queue\n"
@@ -214,12 +224,15 @@ static void __attribute__((noreturn)) usage(FILE *fp)
 		   "                                    [idx_cntr <0:15>] [trigmode <every|usr_cnt|usr|usr_tmr|dis>] [cmptsz <0|1|2|3>] [sw_desc_sz <3>]\n"
 	        "                                    [mm_chn <0|1>] [desc_bypass_en] [pfetch_en] [pfetch_bypass_en] [dis_cmpl_status]\n"
 	        "                                    [dis_cmpl_status_acc] [dis_cmpl_status_pend_chk] [c2h_udd_en]\n"
-			"                                    [cmpl_ovf_dis] [fetch_credit  <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]- start a single queue\n"
+			"                                    [cmpl_ovf_dis] [fetch_credit  <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]\n"
+			"                                    [rate <Mbit/s>] [burst <bytes>] [rate_borrow] [prio_high] - start a single queue\n"
 	        "\t\tq start list <start_idx> <num_Qs> [dir <h2c|c2h|bi|cmpt>] [idx_bufsz <0:15>] [idx_tmr <0:15>]\n"
 			"                                    [idx_cntr <0:15>] [trigmode <every|usr_cnt|usr|usr_tmr|dis>] [cmptsz <0|1|2|3>] [sw_desc_sz <3>]\n"
 	        "                                    [mm_chn <0|1>] [desc_bypass_en] [pfetch_en] [pfetch_bypass_en] [dis_cmpl_status]\n"
 	        "                                    [dis_cmpl_status_acc] [dis_cmpl_status_pend_chk] [cmpl_ovf_dis]\n"
-			"                                    [fetch_credit <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]- start multiple queues at once\n"
+			"                                    [fetch_credit <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]\n"
+			"                                    [rate <Mbit/s>] [burst <bytes>] [rate_borrow] [prio_high] - start multiple queues at once\n"
+			"                                    prio_high services the queue completions ahead of the other queues, in small slices\n"
 	        "\t\tq stop idx <N> dir [<h2c|c2h|bi|cmpt>] - stop a single queue\n"
 	        "\t\tq stop list <start_idx> <num_Qs> dir [<h2c|c2h|bi|cmpt>] - stop list of queues at once\n"
 	        "\t\tq del idx <N> dir [<h2c|c2h|bi|cmpt>] - delete a queue\n"
@@ -231,6 +244,9 @@ static void __attribute__((noreturn)) usage(FILE *fp)
 		"\t\tq dump idx <N> dir [<h2c|c2h|bi|cmpt>] cmpt <x> <y> - dump cmpt ring entry x ~ y\n"
 		"\t\tq dump list <start_idx> <num_Qs> dir [<h2c|c2h|bi|cmpt>] cmpt <x> <y> - dump cmpt ring entry x ~ y\n"
 		"\t\tq cmpt_read idx <N> - read the completion data\n"
+		"\t\tq ratelimit idx <N> [mode <mm|st>] [dir <h2c|c2h|bi>] rate <Mbit/s> [burst <bytes>] [rate_borrow]\n"
+		"\t\t                        - limit the bandwidth of a queue, not for st c2h, rate 0 removes the limit;\n"
+		"\t\t                          rate_borrow lets it use what the other queues leave of the qdma[N] ratelimit\n"
 #ifdef ERR_DEBUG
 		"\t\tq err help - help to induce errors  \n"
 		"\t\tq err idx <N> [<err <[1|0]>>] dir <[h2c|c2h|bi]> - induce errors on q idx <N>  \n"
@@ -241,6 +257,10 @@ static void __attribute__((noreturn)) usage(FILE *fp)
 		"\t\t                                   specify dmap range to dump: Q=queue, N=num of queues\n"
 		"\t\treg read [bar <N>] <addr>        - read a register\n"
 		"\t\treg write [bar <N>] <addr> <val> - write a register\n"
+		"\t\treg batch [bar <N>] <file>       - read/write the registers listed in <file>, one per line:\n"
+		"\t\t                                   <addr> to read, <addr> <val> to write\n"
+		"\t\treg watch [bar <N>] <file> [interval <us>] [count <N>] - sample the registers listed in <file>\n"
+		"\t\t                                   every <us>, default 1000, <N> times, default until ^C\n"
 		"\t\treg info bar <N> <addr> [num_regs <M>] - dump detailed fields information of a register\n");
 	fprintf(fp,
 		"\t\tintring dump vector <N> <start_idx> <end_idx> - interrupt ring dump for vector number <N>  \n"
@@ -354,6 +374,8 @@ static int parse_reg_cmd(int argc, char *argv[], int i, struct xcmd_info *xcmd)
 	 * reg dump
 	 * reg read [bar <N>] <addr> 
 	 * reg write [bar <N>] <addr> <val> 
+	 * reg batch [bar <N>] <file>
+	 * reg watch [bar <N>] <file> [interval <us>] [count <N>]
 	 */
 
 	memset(regcmd, 0, sizeof(struct xcmd_reg));
@@ -412,6 +434,43 @@ static int parse_reg_cmd(int argc, char *argv[], int i, struct xcmd_info *xcmd)
 		regcmd->sflags |= XCMD_REG_F_VAL_SET;
 
 		i++;
+	} else if (!strcmp(argv[i], "batch") || !strcmp(argv[i], "watch")) {
+		xcmd->op = XNL_CMD_REG_RD;
+		if (!strcmp(argv[i], "batch")) {
+			regcmd->sflags |= XCMD_REG_F_BATCH;
+		} else {
+			regcmd->sflags |= XCMD_REG_F_WATCH;
+			regcmd->interval_us = 1000;
+		}
+
+		get_next_arg(argc, argv, &i);
+		if (!strcmp(argv[i], "bar")) {
+			rv = next_arg_read_int(argc, argv, &i, &regcmd->bar);
+			if (rv < 0)
+				return rv;
+			regcmd->sflags |= XCMD_REG_F_BAR_SET;
+			get_next_arg(argc, argv, &i);
+		}
+		regcmd->fname = argv[i];
+		i++;
+
+		while ((regcmd->sflags & XCMD_REG_F_WATCH) && i < argc) {
+			if (!strcmp(argv[i], "interval")) {
+				rv = next_arg_read_int(argc, argv, &i,
+						       &regcmd->interval_us);
+				if (rv < 0)
+					return rv;
+			} else if (!strcmp(argv[i], "count")) {
+				rv = next_arg_read_int(argc, argv, &i,
+						       &regcmd->count);
+				if (rv < 0)
+					return rv;
+			} else {
+				warnx("unknown reg watch option %s", argv[i]);
+				return -EINVAL;
+			}
+			i++;
+		}
 	} else if (!strcmp(argv[i], "info")) {
 		xcmd->op = XNL_CMD_REG_INFO_READ;
 		get_next_arg(argc, argv, &i);
@@ -481,6 +540,11 @@ static char *qparm_type_str[QPARM_MAX] = {
 	"idx_tmr",
 	"idx_cntr",
 	"trigmode",
+	"ping_pong_en",
+	"aperture_sz",
+	"mm_chn",
+	"rate",
+	"burst",
 #ifdef ERR_DEBUG
 	"err_no"
 #endif
@@ -495,7 +559,6 @@ static char *qflag_type_str[MAX_QFLAGS] = {
 	"pfetch_en",
 	"bypass",
 	"fetch_credit",
-	"fetch_credit",
 	"dis_cmpl_status_acc",
 	"dis_cmpl_status",
 	"dis_cmpl_status_pend_chk",
@@ -504,7 +567,9 @@ static char *qflag_type_str[MAX_QFLAGS] = {
 	"c2h_udd_en",
 	"pftch_bypass_en",
 	"cmpl_ovf_dis",
-	"en_mm_cmpl"
+	"en_mm_cmpl",
+	"rate_borrow",
+	"prio_high"
 };
 
 #define IS_SIZE_IDX_VALID(x) (x < 16)
@@ -637,6 +702,12 @@ static int validate_qcmd(enum xnl_op_t qcmd, struct xcmd_q_parm *qparm)
 			print_ignored_params(qparm->flags &
 					     Q_CMPT_READ_FLAG_IGNORE_MASK, 1, NULL);
 			break;
+		case XNL_CMD_RATE_LIMIT:
+			print_ignored_params(qparm->sflags &
+					     Q_RATE_LIMIT_ATTR_IGNORE_MASK, 0, NULL);
+			print_ignored_params(qparm->flags &
+					     Q_RATE_LIMIT_FLAG_IGNORE_MASK, 1, NULL);
+			break;
 #ifdef ERR_DEBUG
 		case XNL_CMD_Q_ERR_INDUCE:
 			break;
@@ -953,6 +1024,28 @@ static int read_qparm(int argc, char *argv[], int i, struct xcmd_q_parm *qparm,
 		} else if (!strcmp(argv[i], "c2h_udd_en")) {
 			qparm->flags |= XNL_F_CMPL_UDD_EN;
 			i++;
+		} else if (!strcmp(argv[i], "rate")) {
+			rv = next_arg_read_int(argc, argv, &i, &v1);
+			if (rv < 0)
+				return rv;
+
+			qparm->rl_rate_mbps = v1;
+			f_arg_set |= 1 << QPARM_RL_RATE;
+			i++;
+		} else if (!strcmp(argv[i], "burst")) {
+			rv = next_arg_read_int(argc, argv, &i, &v1);
+			if (rv < 0)
+				return rv;
+
+			qparm->rl_burst = v1;
+			f_arg_set |= 1 << QPARM_RL_BURST;
+			i++;
+		} else if (!strcmp(argv[i], "rate_borrow")) {
+			qparm->flags |= XNL_F_RL_BORROW;
+			i++;
+		} else if (!strcmp(argv[i], "prio_high")) {
+			qparm->flags |= XNL_F_Q_PRIO_HIGH;
+			i++;
 		} else {
 			warnx("unknown q parameter %s.\n", argv[i]);
 			return -EINVAL;
@@ -1066,6 +1159,14 @@ static int parse_q_cmd(int argc, char *argv[], int i, struct xcmd_info *xcmd)
 		xcmd->op = XNL_CMD_Q_RX_PKT;
 		get_next_arg(argc, argv, &i);
 		rv = read_qparm(argc, argv, i, qparm, (1 << QPARM_IDX));
+	} else if (!strcmp(argv[i], "ratelimit")) {
+		xcmd->op = XNL_CMD_RATE_LIMIT;
+		get_next_arg(argc, argv, &i);
+		rv = read_qparm(argc, argv, i, qparm, (1 << QPARM_IDX));
+		if (rv >= 0 && !(qparm->sflags & (1 << QPARM_RL_RATE))) {
+			warnx("missing q parameter rate.\n");
+			return -EINVAL;
+		}
 	} else if (!strcmp(argv[i], "cmpt_read")) {
 		xcmd->op = XNL_CMD_Q_CMPT_READ;
 		qparm->flags |= XNL_F_Q_CMPL;
@@ -1124,6 +1225,69 @@ static int parse_stat_cmd(int argc, char *argv[], int i, struct xcmd_info *xcmd)
 	if (!strcmp(argv[i], "clear")) {
 		xcmd->op = XNL_CMD_DEV_STAT_CLEAR;
 		i++;
+	} else if (!strcmp(argv[i], "bin")) {
+		struct xcmd_q_parm *qparm = &xcmd->req.qparm;
+		int rv;
+
+		/*
+		 * stat bin [idx <N>] [num <N>]
+		 */
+		xcmd->op = XNL_CMD_DEV_STAT_BIN;
+		qparm->idx = 0;
+		/* clamped to the device qmax by the driver */
+		qparm->num_q = XNL_QIDX_INVALID;
+		i++;
+		while (i < argc) {
+			if (!strcmp(argv[i], "idx")) {
+				rv = next_arg_read_int(argc, argv, &i,
+						       &qparm->idx);
+			} else if (!strcmp(argv[i], "num")) {
+				rv = next_arg_read_int(argc, argv, &i,
+						       &qparm->num_q);
+			} else {
+				warnx("unknown stat bin parameter \"%s\".\n",
+				      argv[i]);
+				return -EINVAL;
+			}
+			if (rv < 0)
+				return rv;
+			i++;
+		}
+	}
+	return i;
+}
+
+static int parse_ratelimit_cmd(int argc, char *argv[], int i,
+			       struct xcmd_info *xcmd)
+{
+	struct xcmd_q_parm *qparm = &xcmd->req.qparm;
+	int rv;
+
+	/*
+	 * ratelimit rate <Mbit/s> [burst <bytes>]
+	 */
+	xcmd->op = XNL_CMD_RATE_LIMIT;
+	while (i < argc) {
+		if (!strcmp(argv[i], "rate")) {
+			rv = next_arg_read_int(argc, argv, &i,
+					       &qparm->rl_rate_mbps);
+			qparm->sflags |= 1 << QPARM_RL_RATE;
+		} else if (!strcmp(argv[i], "burst")) {
+			rv = next_arg_read_int(argc, argv, &i,
+					       &qparm->rl_burst);
+			qparm->sflags |= 1 << QPARM_RL_BURST;
+		} else {
+			warnx("unknown ratelimit parameter \"%s\".\n",
+			      argv[i]);
+			return -EINVAL;
+		}
+		if (rv < 0)
+			return rv;
+		i++;
+	}
+	if (!(qparm->sflags & (1 << QPARM_RL_RATE))) {
+		warnx("missing ratelimit parameter rate.\n");
+		return -EINVAL;
 	}
 	return i;
 }
@@ -1213,6 +1377,8 @@ int parse_cmd(int argc, char *argv[], struct xcmd_info *xcmd)
 		rv = parse_q_cmd(argc, argv, i, xcmd);
 	} else if (!strcmp(argv[2], "intring")){
 		rv = parse_intr_cmd(argc, argv, i, xcmd);
+	} else if (!strcmp(argv[2], "ratelimit")) {
+		rv = parse_ratelimit_cmd(argc, argv, i, xcmd);
 	} else if (!strcmp(argv[2], "cap")) {
 		rv = 3;
 		xcmd->op = XNL_CMD_DEV_CAP;
@@ -10,6 +10,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <err.h>
 #include <errno.h>
@@ -43,7 +44,9 @@ static int (*xnl_proc_fn[XNL_CMD_MAX])(struct xcmd_info *xcmd) = {
 	NULL,                    /* XNL_CMD_Q_UDD */
 	qdma_dev_get_global_csr, /* XNL_CMD_GLOBAL_CSR */
 	qdma_dev_cap,            /* XNL_CMD_DEV_CAP */
-	NULL                     /* XNL_CMD_GET_Q_STATE */
+	NULL,                    /* XNL_CMD_GET_Q_STATE */
+	qdma_dev_stat_bin,       /* XNL_CMD_DEV_STAT_BIN */
+	qdma_rate_limit          /* XNL_CMD_RATE_LIMIT */
 };
 
 static const char *desc_engine_mode[] = {
@@ -115,6 +118,54 @@ static void dump_dev_stat(struct xcmd_info *xcmd)
 	printf("Avg Ping Pong Latency = %llu\n", avg_ping_pong_lat);
 }
 
+static void dump_dev_stat_bin(struct xcmd_info *xcmd)
+{
+	struct xnl_stat_bin *sb = &xcmd->resp.stat_bin;
+	static const char *q_type_str[] = { "H2C", "C2H", "CMPT" };
+	unsigned int i, b;
+
+	printf("qdma%s%05x:statistics (v%u, t=%llu ns)\n",
+	       xcmd->vf ? "vf" : "", xcmd->if_bdf, sb->dev.version,
+	       sb->dev.timestamp_ns);
+	printf("Total MM H2C packets processed = %llu\n", sb->dev.mm_h2c_pkts);
+	printf("Total MM C2H packets processed = %llu\n", sb->dev.mm_c2h_pkts);
+	printf("Total ST H2C packets processed = %llu\n", sb->dev.st_h2c_pkts);
+	printf("Total ST C2H packets processed = %llu\n", sb->dev.st_c2h_pkts);
+	if (sb->dev.rl_rate_mbps)
+		printf("Rate limit %u Mbit/s, burst %u bytes, queues throttled %llu\n",
+		       sb->dev.rl_rate_mbps, sb->dev.rl_burst,
+		       sb->dev.rl_fn_throttled);
+
+	for (i = 0; i < sb->q_cnt; i++) {
+		struct xnl_q_stat_bin *q = sb->q + i;
+
+		printf("q%u %s %s: pkts %llu bytes %llu descs %llu doorbells %llu irqs %llu errors %llu\n",
+		       q->qidx, q->st ? "ST" : "MM",
+		       q->q_type < 3 ? q_type_str[q->q_type] : "?",
+		       q->pkts, q->bytes, q->descs, q->doorbells, q->irqs,
+		       q->errors);
+		printf("\tlatency us:");
+		for (b = 0; b < XNL_STAT_BIN_LAT_BUCKETS; b++) {
+			if (!q->lat_bucket[b])
+				continue;
+			if (b == XNL_STAT_BIN_LAT_BUCKETS - 1)
+				printf(" >=%u:%llu", 1U << (b - 1),
+				       q->lat_bucket[b]);
+			else
+				printf(" <%u:%llu", 1U << b, q->lat_bucket[b]);
+		}
+		printf("\n");
+		if (q->rl_throttled || q->rl_borrowed)
+			printf("\trate limit: throttled %llu for %llu us, borrowed %llu bytes\n",
+			       q->rl_throttled, q->rl_throttle_ns / 1000,
+			       q->rl_borrowed);
+	}
+
+	free(sb->q);
+	sb->q = NULL;
+	sb->q_cnt = 0;
+}
+
 static void dump_dev_global_csr(struct xcmd_info *xcmd)
 {
 	printf("Global Ring Sizes:");
@@ -151,7 +202,14 @@ void xnl_dump_cmd_resp(struct xcmd_info *xcmd)
         case XNL_CMD_DEV_STAT:
         	dump_dev_stat(xcmd);
 		break;
+        case XNL_CMD_DEV_STAT_BIN:
+        	dump_dev_stat_bin(xcmd);
+		break;
         case XNL_CMD_REG_RD:
+		/* reg batch and reg watch print as they go */
+		if (xcmd->req.reg.sflags &
+		    (XCMD_REG_F_BATCH | XCMD_REG_F_WATCH))
+			break;
 		printf("qdma%s%05x, %02x:%02x.%02x, bar#%u, 0x%x = 0x%x.\n",
 				xcmd->vf ? "vf" :"",
 				xcmd->if_bdf, xcmd->resp.dev_info.pci_bus,
@@ -160,6 +218,9 @@ void xnl_dump_cmd_resp(struct xcmd_info *xcmd)
 				xcmd->req.reg.reg, xcmd->req.reg.val);
 		break;
         case XNL_CMD_REG_WRT:
+		if (xcmd->req.reg.sflags &
+		    (XCMD_REG_F_BATCH | XCMD_REG_F_WATCH))
+			break;
 		printf("qdma%s%05x, %02x:%02x.%02x, bar#%u, reg 0x%x, read back 0x%x.\n",
 			   xcmd->vf ? "vf" :"",
 			   xcmd->if_bdf, xcmd->resp.dev_info.pci_bus,
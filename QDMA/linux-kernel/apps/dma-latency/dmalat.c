@@ -11,6 +11,7 @@
 
 #include <time.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <stdint.h>
@@ -22,6 +23,7 @@
 #include <errno.h>
 #include <error.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include </usr/include/pthread.h>
 #include "dmautils.h"
 #include "qdma_nl.h"
@@ -101,6 +103,8 @@ static char * strip_comments(char *word)
 
 #define PCI_DUMP_CMD_LEN 100
 #define QDMA_GLBL_MAX_ENTRIES  (16)
+#define LAT_Q_MAX		8
+#define LAT_PKT_SZ_MAX		8
 
 enum q_mode {
 	Q_MODE_MM,
@@ -146,7 +150,7 @@ static unsigned int force_exit = 0;
 static unsigned int num_q = 0;
 static unsigned int pkt_sz = 0;
 static unsigned int tsecs = 0;
-struct io_info info[8];
+struct io_info info[LAT_Q_MAX];
 static char cfg_name[20];
 static unsigned int pci_bus = 0;
 static unsigned int pci_dev = 0;
@@ -171,6 +175,40 @@ unsigned int dump_en = 0;
 static struct timespec g_ts_start;
 int *child_pid_lst = NULL;
 unsigned int glbl_rng_sz[QDMA_GLBL_MAX_ENTRIES];
+/* target requests per second per queue, 0: back to back */
+static unsigned int rate = 0;
+static unsigned int pkt_sz_list[LAT_PKT_SZ_MAX];
+static unsigned int num_pkt_sz = 0;
+static unsigned int cpu_acct = 0;
+static unsigned int cpu_mhz = 0;
+
+/*
+ * HDR histogram of latencies in ns: 2048 linear sub-buckets per power of
+ * two, i.e. 3 significant digits, up to 2^36 ns.
+ */
+#define HDR_SUB_BITS		11
+#define HDR_SUB_CNT		(1U << HDR_SUB_BITS)
+#define HDR_SUB_HALF		(HDR_SUB_CNT >> 1)
+#define HDR_MAX_BITS		36
+#define HDR_COUNTS		((HDR_MAX_BITS - HDR_SUB_BITS + 2) * HDR_SUB_HALF)
+
+struct hdr_hist {
+	unsigned long long total;
+	unsigned long long min;
+	unsigned long long max;
+	unsigned long long sum;
+	unsigned long long counts[HDR_COUNTS];
+};
+
+/* per queue and message size, in memory shared with the io processes */
+struct lat_hists {
+	/* from the scheduled submit time, corrected for coordinated omission */
+	struct hdr_hist lat;
+	/* from the actual submit time */
+	struct hdr_hist svc;
+};
+
+static struct lat_hists *hists;
 
 static int setup_thrd_env(struct io_info *_info, unsigned char is_new_fd);
 
@@ -808,6 +846,16 @@ static void parse_config_file(const char *cfg_fname)
 			printf("Error: Invalid dump_en:%s\n", value);
 			goto prase_cleanup;
 		    }
+		} else if (!strncmp(config, "cpu_acct", 8)) {
+		    if (arg_read_int(value, &cpu_acct)) {
+			printf("Error: Invalid cpu_acct:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "cpu_mhz", 7)) {
+		    if (arg_read_int(value, &cpu_mhz)) {
+			printf("Error: Invalid cpu_mhz:%s\n", value);
+			goto prase_cleanup;
+		    }
 		} else if (!strncmp(config, "trig_mode", 9)) {
 		    copy_value(value, trigmode, 10);
 		} else if (!strncmp(config, "runtime", 9)) {
@@ -815,6 +863,20 @@ static void parse_config_file(const char *cfg_fname)
 				printf("Error: Invalid tsecs:%s\n", value);
 				goto prase_cleanup;
 			}
+		} else if (!strncmp(config, "pkt_sz_list", 11)) {
+			int cnt = arg_read_int_array(value, pkt_sz_list,
+						     LAT_PKT_SZ_MAX);
+
+			if (cnt <= 0) {
+				printf("Error: Invalid pkt_sz_list:%s\n", value);
+				goto prase_cleanup;
+			}
+			num_pkt_sz = cnt;
+		} else if (!strncmp(config, "rate", 4)) {
+			if (arg_read_int(value, &rate)) {
+				printf("Error: Invalid rate:%s\n", value);
+				goto prase_cleanup;
+			}
 		} else if (!strncmp(config, "pkt_sz", 6)) {
 			if (arg_read_int(value, &pkt_sz)) {
 				printf("Error: Invalid pkt_sz:%s\n", value);
@@ -859,6 +921,21 @@ static void parse_config_file(const char *cfg_fname)
 		exit(1);
 	}
 
+	if (num_q * num_pf > LAT_Q_MAX) {
+		printf("Error: %u queues, max %u\n", num_q * num_pf, LAT_Q_MAX);
+		exit(1);
+	}
+	if (!num_pkt_sz) {
+		pkt_sz_list[0] = pkt_sz;
+		num_pkt_sz = 1;
+	}
+	hists = mmap(NULL, LAT_Q_MAX * num_pkt_sz * sizeof(*hists),
+		     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (hists == MAP_FAILED) {
+		printf("Error: OOM latency histograms\n");
+		exit(1);
+	}
+
 	snprintf(rng_sz_path, 200,"dma-ctl %s%05x global_csr | grep Global| cut -d : -f 2 > glbl_rng_sz",
 			 dmactl_dev_prefix_str, (pci_bus << 12) | (pci_dev << 4) | pf_start);
 	printf("%s\n", rng_sz_path);
@@ -958,13 +1035,165 @@ static void io_proc_cleanup(struct io_info *_info)
 	_info->q_added = 0;
 }
 
+static unsigned int hdr_idx(unsigned long long v)
+{
+	unsigned int bucket;
+
+	if (v >> HDR_MAX_BITS)
+		v = (1ULL << HDR_MAX_BITS) - 1;
+	if (v < HDR_SUB_CNT)
+		return v;
+	bucket = 64 - __builtin_clzll(v) - HDR_SUB_BITS;
+
+	return (bucket * HDR_SUB_HALF) + (v >> bucket);
+}
+
+/* highest value that maps to the same index */
+static unsigned long long hdr_val(unsigned int idx)
+{
+	unsigned int bucket;
+
+	if (idx < HDR_SUB_CNT)
+		return idx;
+	bucket = idx / HDR_SUB_HALF - 1;
+
+	return ((unsigned long long)(idx - bucket * HDR_SUB_HALF + 1)
+			<< bucket) - 1;
+}
+
+static void hdr_record(struct hdr_hist *h, unsigned long long v)
+{
+	if (!h->total || v < h->min)
+		h->min = v;
+	if (v > h->max)
+		h->max = v;
+	h->total++;
+	h->sum += v;
+	h->counts[hdr_idx(v)]++;
+}
+
+static void hdr_merge(struct hdr_hist *dst, struct hdr_hist *src)
+{
+	unsigned int i;
+
+	if (!src->total)
+		return;
+	if (!dst->total || src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->total += src->total;
+	dst->sum += src->sum;
+	for (i = 0; i < HDR_COUNTS; i++)
+		dst->counts[i] += src->counts[i];
+}
+
+static unsigned long long hdr_percentile(struct hdr_hist *h, double pct)
+{
+	unsigned long long want = (unsigned long long)(h->total * pct / 100);
+	unsigned long long cnt = 0;
+	unsigned int i;
+
+	if (want < 1)
+		want = 1;
+	for (i = 0; i < HDR_COUNTS; i++) {
+		cnt += h->counts[i];
+		if (cnt >= want)
+			return hdr_val(i) < h->max ? hdr_val(i) : h->max;
+	}
+
+	return h->max;
+}
+
+static void hdr_dump(const char *prefix, struct hdr_hist *h)
+{
+	static const double pcts[] = { 50, 90, 99, 99.9 };
+	unsigned int i;
+
+	printf("%s min = %llu ns\n", prefix, h->min);
+	printf("%s avg = %llu ns\n", prefix, h->sum / h->total);
+	for (i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++)
+		printf("%s p%g = %llu ns\n", prefix, pcts[i],
+			hdr_percentile(h, pcts[i]));
+	printf("%s max = %llu ns\n", prefix, h->max);
+}
+
+static void dump_latency(unsigned long long *bytes, unsigned long long *reqs)
+{
+	struct lat_hists *tot;
+	struct lat_hists *sz_tot;
+	char prefix[64];
+	unsigned int q, k;
+
+	tot = calloc(1 + num_pkt_sz, sizeof(*tot));
+	if (!tot) {
+		printf("OOM\n");
+		return;
+	}
+	sz_tot = tot + 1;
+
+	for (q = 0; q < num_q * num_pf; q++) {
+		for (k = 0; k < num_pkt_sz; k++) {
+			struct lat_hists *h = &hists[q * num_pkt_sz + k];
+
+			hdr_merge(&sz_tot[k].lat, &h->lat);
+			hdr_merge(&sz_tot[k].svc, &h->svc);
+		}
+	}
+
+	for (k = 0; k < num_pkt_sz; k++) {
+		if (!sz_tot[k].lat.total)
+			continue;
+		printf("pkt_sz %u: %llu requests\n", pkt_sz_list[k],
+			sz_tot[k].lat.total);
+		snprintf(prefix, sizeof(prefix), "pkt_sz %u latency",
+			 pkt_sz_list[k]);
+		hdr_dump(prefix, &sz_tot[k].lat);
+		snprintf(prefix, sizeof(prefix), "pkt_sz %u service time",
+			 pkt_sz_list[k]);
+		hdr_dump(prefix, &sz_tot[k].svc);
+		hdr_merge(&tot->lat, &sz_tot[k].lat);
+		hdr_merge(&tot->svc, &sz_tot[k].svc);
+		/* a request is a write and a read of the packet */
+		*bytes += sz_tot[k].lat.total * pkt_sz_list[k] * 2;
+	}
+	*reqs = tot->lat.total;
+
+	if (tot->lat.total) {
+		printf("all: %llu requests, rate %u/s per queue\n",
+			tot->lat.total, rate);
+		hdr_dump("Service time", &tot->svc);
+		hdr_dump("Latency", &tot->lat);
+	}
+
+	free(tot);
+}
+
+static unsigned long long tv_us(struct timeval *tv)
+{
+	return (unsigned long long)tv->tv_sec * 1000000ULL + tv->tv_usec;
+}
+
+static unsigned long long timespec_ns(struct timespec *t)
+{
+	return (unsigned long long)t->tv_sec * 1000000000ULL + t->tv_nsec;
+}
+
 static void *io_thread(void *argp)
 {
 
 	struct io_info *_info = (struct io_info *)argp;
+	struct lat_hists *h = &hists[_info->thread_id * num_pkt_sz];
 	char *buffer = NULL;
+	unsigned int io_sz = 0;
+	unsigned long long interval = rate ? 1000000000ULL / rate : 0;
+	unsigned long long t_start, t_sched, t_sub, t_done;
+	unsigned long long n = 0;
+	unsigned int k;
 
-	unsigned int io_sz = _info->pkt_sz;
+	for (k = 0; k < num_pkt_sz; k++)
+		if (pkt_sz_list[k] > io_sz)
+			io_sz = pkt_sz_list[k];
 
 	posix_memalign((void **)&buffer, 4096 /*alignment */ , io_sz + 4096);
 	if (!buffer) {
@@ -972,6 +1201,7 @@ static void *io_thread(void *argp)
 		return NULL;
 	}
 
+	t_start = timespec_ns(&g_ts_start);
 	do {
 
 		struct timespec ts_cur;
@@ -984,9 +1214,35 @@ static void *io_thread(void *argp)
 				break;
 		}
 
-		write(_info->fd, buffer ,io_sz);
-		read(_info->fd, buffer ,io_sz);
+		/*
+		 * At a fixed rate the latency is taken from the time the
+		 * request was due, not when it could be sent, so stalls are
+		 * charged to every request they delay (coordinated omission)
+		 */
+		k = n % num_pkt_sz;
+		clock_gettime(CLOCK_MONOTONIC, &ts_cur);
+		t_sub = timespec_ns(&ts_cur);
+		t_sched = t_sub;
+		if (interval) {
+			t_sched = t_start + n * interval;
+			if (t_sched > t_sub) {
+				ts_cur.tv_sec = t_sched / 1000000000ULL;
+				ts_cur.tv_nsec = t_sched % 1000000000ULL;
+				clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+						&ts_cur, NULL);
+				clock_gettime(CLOCK_MONOTONIC, &ts_cur);
+				t_sub = timespec_ns(&ts_cur);
+			}
+		}
 
+		write(_info->fd, buffer, pkt_sz_list[k]);
+		read(_info->fd, buffer, pkt_sz_list[k]);
+
+		clock_gettime(CLOCK_MONOTONIC, &ts_cur);
+		t_done = timespec_ns(&ts_cur);
+		hdr_record(&h[k].lat, t_done - t_sched);
+		hdr_record(&h[k].svc, t_done - t_sub);
+		n++;
 
 	} while (tsecs && !force_exit);
 
@@ -1076,6 +1332,10 @@ int main(int argc, char *argv[])
 	char *cfg_fname = NULL;
 	unsigned int i = 0;
 	cpu_set_t set;
+	struct qdmautils_cpu_snap cpu_start, cpu_end;
+	char cpu_intr_name[20];
+	struct rusage ru;
+	unsigned long long bytes = 0, reqs = 0;
 	while ((cmd_opt = getopt_long(argc, argv, "vhxc:c:", long_opts,
 			    NULL)) != -1) {
 		switch (cmd_opt) {
@@ -1107,6 +1367,13 @@ int main(int argc, char *argv[])
         if (sched_setaffinity(getpid(), sizeof(set), &set) == -1)
         	printf("setaffinity for thrd%u failed\n", info[i].thread_id);
 
+	if (cpu_acct) {
+		/* the msix vectors are named after the device, qdma<bdf>-... */
+		snprintf(cpu_intr_name, sizeof(cpu_intr_name), "%s%02x%02x",
+			 pf_dmactl_prefix_str, pci_bus, pci_dev);
+		qdmautils_cpu_snapshot(&cpu_start, cpu_intr_name);
+	}
+
 	for (i = 0; i < num_q; i++) {
 		if (getpid() == base_pid)
 			child_pid_lst[i] = fork();
@@ -1117,10 +1384,22 @@ int main(int argc, char *argv[])
 	clock_gettime(CLOCK_MONOTONIC, &g_ts_start);
 	if (getpid() == base_pid) {
 		for(i = 0; i < num_q; i++) {
-			waitpid(child_pid_lst[i], NULL, 0);
+			wait4(child_pid_lst[i], NULL, 0, &ru);
+			if (cpu_acct)
+				printf("%s thrd %u cpu = %.3f s\n",
+				       info[i].q_name, info[i].thread_id,
+				       (tv_us(&ru.ru_utime) +
+					tv_us(&ru.ru_stime)) / 1e6);
 		}
 		free(child_pid_lst);
 	        child_pid_lst = NULL;
+		if (cpu_acct)
+			qdmautils_cpu_snapshot(&cpu_end, cpu_intr_name);
+
+		dump_latency(&bytes, &reqs);
+		if (cpu_acct)
+			qdmautils_cpu_report(&cpu_start, &cpu_end, bytes, reqs,
+					     cpu_mhz);
 
 		qdma_register_write(vf_perf, (pci_bus << 12) | (pci_dev << 4) | pf_start, 2, 0x08, 0);
 
@@ -15,6 +15,7 @@
 #include <sys/stat.h>
 #include <sys/shm.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #include <stdbool.h>
 #include <linux/types.h>
@@ -122,6 +123,7 @@ static char * strip_comments(char *word)
 #define CMPL_STATUS_ACC_CMD_LEN 200
 #define PCI_DUMP_CMD_LEN 100
 
+#define QDMA_UL_LOOPBACK               (1 << 0)
 #define QDMA_UL_SEND_MARKER_PACKET     (1 << 5)
 #define QDMA_UL_IMM_DUMP_C2H_DATA      (1 << 17)
 #define QDMA_UL_STOP_C2H_TRANSFER      (1 << 18)
@@ -184,6 +186,16 @@ struct io_info {
 	int keyhole_en;
 	unsigned int aperture_sz;
 	unsigned int offset;
+	/* integrity mode results of a C2H thread */
+	unsigned long long integ_blks;
+	unsigned long long integ_crc_err;
+	unsigned long long integ_seq_err;
+	unsigned long long integ_torn;
+	unsigned long long integ_skip;
+	/* arbitration weight, 0: the thread shares the queue's fd */
+	unsigned int weight;
+	/* counters of the thread's open file in its direction, ctx_stats */
+	struct qdma_cdev_ctx_dir_stats ctx_stats;
 #ifdef DEBUG
 	unsigned long long total_nodes;
 	unsigned long long freed_nodes;
@@ -208,6 +220,8 @@ struct list_head {
 static unsigned int *io_exit = 0;
 int io_exit_id;
 static unsigned int mm_chnl = 0;
+/* number of MM channels the queues are spread over, from mm_chnl up */
+static unsigned int mm_chnl_num = 1;
 static unsigned int force_exit = 0;
 static unsigned int num_q = 0;
 static unsigned int pkt_sz = 0;
@@ -248,6 +262,29 @@ char trigmode[10];
 char pci_dump[PCI_DUMP_CMD_LEN];
 unsigned int dump_en = 0;
 unsigned int marker_en = 1;
+static unsigned int cpu_acct = 0;
+static unsigned int cpu_mhz = 0;
+static struct qdmautils_cpu_snap cpu_start;
+static struct qdmautils_cpu_snap cpu_end;
+static unsigned int cpu_end_taken = 0;
+static char cpu_intr_name[20];
+static unsigned int integrity = 0;
+/* validation threads of every C2H io process */
+static unsigned int integ_thrds = 1;
+/* cpu time of every io process, from its rusage */
+static unsigned long long *thrd_cpu_us = NULL;
+/* ring budget of the queue arbitration in bytes, 0: arbitration off */
+static unsigned int arb_inflight = 0;
+/* arbitration weights of the threads of a queue, each opens its own fd */
+static unsigned int *cdev_weight_lst = NULL;
+/* read the counters of the open files at the end of the run */
+static unsigned int ctx_stats = 0;
+/* elements per vectored transfer, 0: aio */
+static unsigned int io_vec = 0;
+/* transfers prepared once and submitted over and over, 0: aio */
+static unsigned int xfer_prep = 0;
+/* fd the io process transfers on, the queue's or its own weighted one */
+static int io_fd = -1;
 static struct timespec g_ts_start;
 static unsigned char *q_lst_stop = NULL;
 int q_lst_stop_mid;
@@ -357,19 +394,21 @@ static void dump_thrd_info(struct io_info *_info) {
 #endif
 }
 
-struct dma_meminfo {
-	void *memptr;
-	unsigned int num_blks;
-};
-
-#define USE_MEMPOOL
+/* pools of at least this size are tried on 2MB hugepages first */
+#define MEMPOOL_HUGEPAGE_SIZE	(2 * 1024 * 1024)
 
 struct mempool_handle {
 	void *mempool;
-	unsigned int mempool_blkidx;
+	/* mmap()ed length if the pool is on hugepages, 0 otherwise */
+	size_t mempool_len;
 	unsigned int mempool_blksz;
 	unsigned int total_memblks;
-	struct dma_meminfo *mempool_info;
+	/* free stack links, per block */
+	unsigned int *next_free;
+	/* free stack of the allocating thread */
+	unsigned int local_free;
+	/* blocks freed, pushed by any thread */
+	unsigned int remote_free;
 #ifdef DEBUG
 	unsigned int id;
 	unsigned int loop;
@@ -380,85 +419,97 @@ static struct mempool_handle ctxhandle;
 static struct mempool_handle iocbhandle;
 static struct mempool_handle datahandle;
 
-static void mempool_create(struct mempool_handle *mpool, unsigned int entry_size, unsigned int max_entries)
+/*
+ * Fixed size block pool. Blocks are handed out from a free stack owned by
+ * the allocating (io) thread, blocks freed by any thread are pushed on a
+ * lock-free remote stack that the allocator takes over in one exchange
+ * when its own stack runs empty, so both sides are O(1). Stack entries
+ * are block index + 1, 0 terminates.
+ */
+static int mempool_create(struct mempool_handle *mpool, unsigned int entry_size,
+		unsigned int max_entries)
 {
-#ifdef USE_MEMPOOL
-	if (posix_memalign((void **)&mpool->mempool, DEFAULT_PAGE_SIZE,
-			   max_entries * (entry_size + sizeof(struct dma_meminfo)))) {
+	size_t len = (size_t)max_entries * entry_size;
+	unsigned int i;
+
+	mpool->mempool = MAP_FAILED;
+	mpool->mempool_len = 0;
+	if (len >= MEMPOOL_HUGEPAGE_SIZE) {
+		size_t hlen = (len + MEMPOOL_HUGEPAGE_SIZE - 1) &
+				~((size_t)MEMPOOL_HUGEPAGE_SIZE - 1);
+
+		/* falls back to normal pages if none are reserved */
+		mpool->mempool = mmap(NULL, hlen, PROT_READ | PROT_WRITE,
+				      MAP_PRIVATE | MAP_ANONYMOUS |
+				      MAP_HUGETLB | MAP_POPULATE, -1, 0);
+		if (mpool->mempool != MAP_FAILED)
+			mpool->mempool_len = hlen;
+	}
+	if (mpool->mempool == MAP_FAILED) {
+		if (posix_memalign((void **)&mpool->mempool,
+				   DEFAULT_PAGE_SIZE, len)) {
+			printf("OOM\n");
+			exit(1);
+		}
+		/* pre-fault, the first I/Os should not take page faults */
+		memset(mpool->mempool, 0, len);
+	}
+
+	mpool->next_free = malloc(max_entries * sizeof(unsigned int));
+	if (!mpool->next_free) {
+		if (mpool->mempool_len)
+			munmap(mpool->mempool, mpool->mempool_len);
+		else
+			free(mpool->mempool);
+		mpool->mempool = NULL;
 		printf("OOM\n");
 		exit(1);
 	}
-	mpool->mempool_info = (struct dma_meminfo *)(((char *)mpool->mempool) + (max_entries * entry_size));
-#endif
+	for (i = 0; i < max_entries; i++)
+		mpool->next_free[i] = (i + 1 < max_entries) ? i + 2 : 0;
+	mpool->local_free = max_entries ? 1 : 0;
+	mpool->remote_free = 0;
 	mpool->mempool_blksz = entry_size;
 	mpool->total_memblks = max_entries;
-	mpool->mempool_blkidx = 0;
+
+	return 0;
 }
 
 static void mempool_free(struct mempool_handle *mpool)
 {
-#ifdef USE_MEMPOOL
-	free(mpool->mempool);
+	if (mpool->mempool_len)
+		munmap(mpool->mempool, mpool->mempool_len);
+	else
+		free(mpool->mempool);
 	mpool->mempool = NULL;
-#endif
+	free(mpool->next_free);
+	mpool->next_free = NULL;
 }
 
-static void *dma_memalloc(struct mempool_handle *mpool, unsigned int num_blks)
+static void *dma_memalloc(struct mempool_handle *mpool)
 {
-	unsigned int _mempool_blkidx = mpool->mempool_blkidx;
-	unsigned int tmp_blkidx = _mempool_blkidx;
-	unsigned int max_blkcnt = tmp_blkidx + num_blks;
-	unsigned int i, avail = 0;
-	void *memptr = NULL;
-	char *mempool = mpool->mempool;
-	struct dma_meminfo *_mempool_info = mpool->mempool_info;
-	unsigned int _total_memblks = mpool->total_memblks;
-
-#ifdef USE_MEMPOOL
-	if (max_blkcnt > _total_memblks) {
-		tmp_blkidx = 0;
-		max_blkcnt = num_blks;
-	}
-	for (i = tmp_blkidx; (i < _total_memblks) && (i < max_blkcnt); i++) {
-		if (_mempool_info[i].memptr) { /* occupied blks ahead */
-			i += _mempool_info[i].num_blks;
-			max_blkcnt = i + num_blks;
-			avail = 0;
-			tmp_blkidx = i;
-		} else
-			avail++;
-		if (max_blkcnt > _total_memblks) { /* reached the end of mempool. circle through*/
-			if (num_blks > _mempool_blkidx) return NULL; /* Continuous num_blks not available */
-			i = 0;
-			avail = 0;
-			max_blkcnt = num_blks;
-			tmp_blkidx = 0;
-		}
-	}
-	if (avail < num_blks) { /* no required available blocks */
+	unsigned int idx;
+
+	if (!mpool->local_free)
+		mpool->local_free = __atomic_exchange_n(&mpool->remote_free, 0,
+							__ATOMIC_ACQUIRE);
+	if (!mpool->local_free)
 		return NULL;
-	}
 
-	memptr = &(mempool[tmp_blkidx * mpool->mempool_blksz]);
-	_mempool_info[tmp_blkidx].memptr = memptr;
-	_mempool_info[tmp_blkidx].num_blks = num_blks;
-	mpool->mempool_blkidx = tmp_blkidx + num_blks;
-#else
-	memptr = calloc(num_blks, mpool->mempool_blksz);
-#endif
+	idx = mpool->local_free - 1;
+	mpool->local_free = mpool->next_free[idx];
 
-	return memptr;
+	return (char *)mpool->mempool + ((size_t)idx * mpool->mempool_blksz);
 }
 
 static void dma_free(struct mempool_handle *mpool, void *memptr)
 {
-#ifdef USE_MEMPOOL
-	struct dma_meminfo *_meminfo = mpool->mempool_info;
 	unsigned int idx;
+	unsigned int head;
 
 	if (!memptr) return;
 
-	idx = (memptr - mpool->mempool)/mpool->mempool_blksz;
+	idx = ((char *)memptr - (char *)mpool->mempool)/mpool->mempool_blksz;
 #ifdef DEBUG
 	if (idx >= mpool->total_memblks) {
 		printf("Asserting: %u:Invalid memory index %u acquired\n", mpool->id, idx);
@@ -466,11 +517,309 @@ static void dma_free(struct mempool_handle *mpool, void *memptr)
 	}
 #endif
 
-	_meminfo[idx].num_blks = 0;
-	_meminfo[idx].memptr = NULL;
-#else
-	free(memptr);
-#endif
+	head = __atomic_load_n(&mpool->remote_free, __ATOMIC_RELAXED);
+	do {
+		mpool->next_free[idx] = head;
+	} while (!__atomic_compare_exchange_n(&mpool->remote_free, &head,
+					      idx + 1, 1, __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
+
+/*
+ * Integrity mode. Every pkt_sz block of an H2C buffer is
+ *
+ *	| magic | src | seq | crc | payload ... | seq |
+ *
+ * src is the H2C thread id and seq counts the blocks it sent. The payload
+ * is a fixed pattern of the offset in the block, written once when the
+ * buffer pool is created, so a submit only stamps the header and the
+ * trailer. crc is the CRC32C of the payload followed by magic, src and seq.
+ *
+ * ST queues run with the user logic looping H2C back to C2H, MM queues
+ * read back the card memory the H2C side of the queue writes to. The
+ * event thread hands the completed C2H requests to validation threads over
+ * a ring and never touches the data itself; a validated block gets its
+ * magic cleared so a buffer the DMA did not write is caught the next time
+ * round.
+ */
+#define INTEG_MAGIC		0x51444d41
+#define INTEG_HDR_SZ		16
+#define INTEG_TRL_SZ		4
+#define INTEG_MIN_PKT_SZ	64
+/* errors printed per io process, the rest are only counted */
+#define INTEG_MAX_REPORT	8
+
+struct integ_hdr {
+	uint32_t magic;
+	uint32_t src;
+	uint32_t seq;
+	uint32_t crc;
+};
+
+struct integ_req {
+	struct iocb *iocb;
+	/* all buffers of the request were filled */
+	unsigned int done;
+};
+
+/* single producer (event thread), multiple consumers (validation threads) */
+struct integ_ring {
+	struct integ_req *slot;
+	unsigned int mask;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int stop;
+};
+
+struct integ_stats {
+	unsigned long long blks;
+	unsigned long long crc_err;
+	unsigned long long seq_err;
+	unsigned long long torn;
+	unsigned long long skip;
+};
+
+static struct integ_ring integ_ring;
+static pthread_t *integ_tid;
+static unsigned int integ_reported;
+/* H2C: crc of the fixed payload and the next block sequence number */
+static uint32_t integ_payload_crc;
+static uint32_t integ_seq;
+/*
+ * ST C2H: last sequence number seen per H2C thread. Loopback keeps the
+ * order of a queue, the order is only known with a single H2C and C2H
+ * thread per queue and a single validation thread.
+ */
+static uint32_t *integ_last_seq;
+static unsigned char *integ_seq_valid;
+
+static void integ_fill(unsigned char *buf, unsigned int len)
+{
+	uint32_t *w = (uint32_t *)buf;
+	unsigned int off, k;
+
+	for (off = 0; off + pkt_sz <= len; off += pkt_sz) {
+		memset(buf + off, 0, INTEG_HDR_SZ);
+		for (k = INTEG_HDR_SZ / 4; k < (pkt_sz - INTEG_TRL_SZ) / 4; k++)
+			w[(off / 4) + k] = (k * 0x9E3779B1) ^ 0xA5A5A5A5;
+	}
+}
+
+static void integ_stamp(struct io_info *_info, unsigned char *buf,
+			unsigned int len)
+{
+	unsigned int off;
+
+	for (off = 0; off + pkt_sz <= len; off += pkt_sz) {
+		struct integ_hdr *hdr = (struct integ_hdr *)(buf + off);
+
+		hdr->magic = INTEG_MAGIC;
+		hdr->src = _info->thread_id;
+		hdr->seq = integ_seq++;
+		hdr->crc = qdmautils_crc32c(integ_payload_crc, hdr,
+					    offsetof(struct integ_hdr, crc));
+		memcpy(buf + off + pkt_sz - INTEG_TRL_SZ, &hdr->seq,
+		       INTEG_TRL_SZ);
+	}
+}
+
+static void integ_report(struct io_info *_info, const char *what,
+			 unsigned int off, struct integ_hdr *hdr, uint32_t trl)
+{
+	if (integ_reported >= INTEG_MAX_REPORT)
+		return;
+	integ_reported++;
+	printf("Integrity: %s thrd %u %s at blk off %u: magic 0x%08x src %u "
+	       "seq %u trl %u crc 0x%08x\n", _info->q_name, _info->thread_id,
+	       what, off, hdr->magic, hdr->src, hdr->seq, trl, hdr->crc);
+}
+
+static void integ_check(struct io_info *_info, unsigned char *buf,
+			unsigned int len, struct integ_stats *st)
+{
+	unsigned int off;
+
+	for (off = 0; off + pkt_sz <= len; off += pkt_sz) {
+		struct integ_hdr *hdr = (struct integ_hdr *)(buf + off);
+		uint32_t trl, crc;
+
+		memcpy(&trl, buf + off + pkt_sz - INTEG_TRL_SZ, INTEG_TRL_SZ);
+		st->blks++;
+		if (hdr->magic != INTEG_MAGIC) {
+			/* MM reads can run ahead of the first write */
+			if (_info->mode == Q_MODE_MM) {
+				st->skip++;
+			} else {
+				st->crc_err++;
+				integ_report(_info, "bad header", off, hdr, trl);
+			}
+			continue;
+		}
+		if (trl != hdr->seq) {
+			/* MM read overlapping a write of the same card memory */
+			if (_info->mode == Q_MODE_MM) {
+				st->torn++;
+			} else {
+				st->crc_err++;
+				integ_report(_info, "bad trailer", off, hdr, trl);
+			}
+			hdr->magic = 0;
+			continue;
+		}
+
+		crc = qdmautils_crc32c(0, buf + off + INTEG_HDR_SZ,
+				       pkt_sz - INTEG_HDR_SZ - INTEG_TRL_SZ);
+		crc = qdmautils_crc32c(crc, hdr, offsetof(struct integ_hdr, crc));
+		if (crc != hdr->crc) {
+			st->crc_err++;
+			integ_report(_info, "crc error", off, hdr, trl);
+		} else if (integ_last_seq) {
+			if (hdr->src >= num_thrds) {
+				st->seq_err++;
+				integ_report(_info, "bad source", off, hdr, trl);
+			} else {
+				if (integ_seq_valid[hdr->src] &&
+				    (hdr->seq != integ_last_seq[hdr->src] + 1)) {
+					st->seq_err++;
+					integ_report(_info, "out of sequence",
+						     off, hdr, trl);
+				}
+				integ_last_seq[hdr->src] = hdr->seq;
+				integ_seq_valid[hdr->src] = 1;
+			}
+		}
+		hdr->magic = 0;
+	}
+}
+
+static void integ_ring_push(struct integ_ring *r, struct iocb *iocb,
+			    unsigned int done)
+{
+	unsigned int tail = r->tail;
+
+	/* the ring holds every iocb of the pool, it cannot overflow */
+	r->slot[tail & r->mask].iocb = iocb;
+	r->slot[tail & r->mask].done = done;
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static int integ_ring_pop(struct integ_ring *r, struct integ_req *req)
+{
+	unsigned int head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+	do {
+		if (head == __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE))
+			return 0;
+		*req = r->slot[head & r->mask];
+	} while (!__atomic_compare_exchange_n(&r->head, &head, head + 1, 1,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	return 1;
+}
+
+static void *integ_thread(void *argp)
+{
+	struct io_info *_info = (struct io_info *)argp;
+	struct integ_stats st = {0};
+	struct integ_req req;
+	unsigned int bufcnt;
+
+	while (1) {
+		unsigned int stop = __atomic_load_n(&integ_ring.stop,
+						    __ATOMIC_ACQUIRE);
+		struct iovec *iov;
+
+		if (!integ_ring_pop(&integ_ring, &req)) {
+			if (stop)
+				break;
+			sched_yield();
+			continue;
+		}
+
+		iov = (struct iovec *)req.iocb->u.c.buf;
+		for (bufcnt = 0; bufcnt < req.iocb->u.c.nbytes; bufcnt++) {
+			if (req.done)
+				integ_check(_info, iov[bufcnt].iov_base,
+					    iov[bufcnt].iov_len, &st);
+			dma_free(&datahandle, iov[bufcnt].iov_base);
+		}
+		if (!req.done)
+			st.skip++;
+		dma_free(&iocbhandle, req.iocb);
+	}
+
+	__atomic_fetch_add(&_info->integ_blks, st.blks, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&_info->integ_crc_err, st.crc_err, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&_info->integ_seq_err, st.seq_err, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&_info->integ_torn, st.torn, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&_info->integ_skip, st.skip, __ATOMIC_RELAXED);
+
+	return NULL;
+}
+
+static void integ_start(struct io_info *_info)
+{
+	unsigned int sz = 1;
+	unsigned int i;
+
+	if (_info->dir == Q_DIR_H2C) {
+		unsigned char *blk = datahandle.mempool;
+
+		for (i = 0; i < datahandle.total_memblks; i++)
+			integ_fill(blk + ((size_t)i * datahandle.mempool_blksz),
+				   datahandle.mempool_blksz);
+		integ_payload_crc = qdmautils_crc32c(0, blk + INTEG_HDR_SZ,
+					pkt_sz - INTEG_HDR_SZ - INTEG_TRL_SZ);
+		return;
+	}
+
+	while (sz < iocbhandle.total_memblks)
+		sz <<= 1;
+	integ_ring.slot = calloc(sz, sizeof(struct integ_req));
+	integ_tid = calloc(integ_thrds, sizeof(pthread_t));
+	if (!integ_ring.slot || !integ_tid) {
+		printf("OOM\n");
+		exit(1);
+	}
+	integ_ring.mask = sz - 1;
+
+	if ((_info->mode == Q_MODE_ST) && (num_thrds_per_q == 1) &&
+	    (integ_thrds == 1)) {
+		integ_last_seq = calloc(num_thrds, sizeof(uint32_t));
+		integ_seq_valid = calloc(num_thrds, 1);
+		if (!integ_last_seq || !integ_seq_valid) {
+			printf("OOM\n");
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < integ_thrds; i++) {
+		if (pthread_create(&integ_tid[i], NULL, integ_thread, _info))
+			exit(1);
+	}
+}
+
+/* called once the event thread is gone, validates what is left */
+static void integ_stop(struct io_info *_info)
+{
+	unsigned int i;
+
+	if ((_info->dir == Q_DIR_H2C) || !integ_tid)
+		return;
+
+	__atomic_store_n(&integ_ring.stop, 1, __ATOMIC_RELEASE);
+	for (i = 0; i < integ_thrds; i++)
+		pthread_join(integ_tid[i], NULL);
+
+	free(integ_tid);
+	integ_tid = NULL;
+	free(integ_ring.slot);
+	integ_ring.slot = NULL;
+	free(integ_last_seq);
+	integ_last_seq = NULL;
+	free(integ_seq_valid);
+	integ_seq_valid = NULL;
 }
 
 static void xnl_dump_response(const char *resp)
@@ -623,8 +972,10 @@ static void create_thread_info(void)
 					_info[base].q_ctrl = q_ctrl;
 					_info[base].fd = last_fd;
 					_info[base].pkt_burst = num_pkts;
-					_info[base].mm_chnl = mm_chnl;
+					_info[base].mm_chnl = mm_chnl + (i % mm_chnl_num);
 					_info[base].pkt_sz = pkt_sz;
+					_info[base].weight = cdev_weight_lst ?
+							     cdev_weight_lst[j] : 0;
 					if ((_info[base].mode == Q_MODE_ST) &&
 							(stm_mode)) {
 						_info[base].stm_mode = stm_mode;
@@ -664,8 +1015,14 @@ static void create_thread_info(void)
 					_info[base].qid = q_start + i;
 					_info[base].q_ctrl = q_ctrl;
 					_info[base].pkt_burst = num_pkts;
-					_info[base].mm_chnl = mm_chnl;
+					_info[base].mm_chnl = mm_chnl + (i % mm_chnl_num);
 					_info[base].pkt_sz = pkt_sz;
+					_info[base].weight = cdev_weight_lst ?
+							     cdev_weight_lst[j] : 0;
+					if (_info[base].mode == Q_MODE_MM &&
+							keyhole_en) {
+						_info[base].aperture_sz = aperture_sz;
+					}
 #if THREADS_SET_CPU_AFFINITY
 					_info[base].cpu = c2h_cpu;
 #endif
@@ -701,7 +1058,13 @@ static void create_thread_info(void)
 		}
 	}
 	if ((mode == Q_MODE_ST) && (dir != Q_DIR_H2C)) {
-		if (!stm_mode) {
+		if (integrity) {
+			/* reset the traffic generator, C2H is the H2C looped back */
+			qdma_register_write(vf_perf, (pci_bus << 12) | (pci_dev << 4) | pf_start, 2, 0x08, 0);
+			qdma_register_write(vf_perf, (pci_bus << 12) | (pci_dev << 4) | pf_start, 2, 0x08,
+					QDMA_UL_LOOPBACK);
+			usleep(1000);
+		} else if (!stm_mode) {
 			qdma_register_write(vf_perf, (pci_bus << 12) | (pci_dev << 4) | pf_start, 2, 0x08,
 					QDMA_UL_IMM_DUMP_C2H_DATA | QDMA_UL_IMM_DUMP_CMPT_FIFO/* | QDMA_UL_DROP_ENABLE*/);
 			usleep(1000);
@@ -829,6 +1192,60 @@ static void parse_config_file(const char *cfg_fname)
 			printf("Error: Invalid dump_en:%s\n", value);
 			goto prase_cleanup;
 		    }
+		} else if (!strncmp(config, "cpu_acct", 8)) {
+		    if (arg_read_int(value, &cpu_acct)) {
+			printf("Error: Invalid cpu_acct:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "cpu_mhz", 7)) {
+		    if (arg_read_int(value, &cpu_mhz)) {
+			printf("Error: Invalid cpu_mhz:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "arb_inflight", 12)) {
+		    if (arg_read_int(value, &arb_inflight)) {
+			printf("Error: Invalid arb_inflight:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "cdev_weight_lst", 15)) {
+		    int arr_len = get_array_len(value);
+
+		    if ((arr_len <= 0) || (arr_len != (int)num_thrds_per_q)) {
+			printf("ERROR: Invalid number of entries in cdev_weight_lst - %s\n", value);
+			exit(1);
+		    }
+		    cdev_weight_lst = (unsigned int *)calloc(arr_len, sizeof(unsigned int));
+		    if (arg_read_int_array(value, cdev_weight_lst, arr_len) <= 0) {
+			printf("Error: Invalid cdev_weight_lst:%s\n", value);
+			exit(1);
+		    }
+		} else if (!strncmp(config, "ctx_stats", 9)) {
+		    if (arg_read_int(value, &ctx_stats)) {
+			printf("Error: Invalid ctx_stats:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "io_vec", 6)) {
+		    if (arg_read_int(value, &io_vec) ||
+			(io_vec > QDMA_CDEV_RW_VEC_MAX)) {
+			printf("Error: Invalid io_vec:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "xfer_prep", 9)) {
+		    if (arg_read_int(value, &xfer_prep) ||
+			(xfer_prep > QDMA_CDEV_XFER_MAX)) {
+			printf("Error: Invalid xfer_prep:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "integrity_thrds", 15)) {
+		    if (arg_read_int(value, &integ_thrds) || !integ_thrds) {
+			printf("Error: Invalid integrity_thrds:%s\n", value);
+			goto prase_cleanup;
+		    }
+		} else if (!strncmp(config, "integrity", 9)) {
+		    if (arg_read_int(value, &integrity)) {
+			printf("Error: Invalid integrity:%s\n", value);
+			goto prase_cleanup;
+		    }
 		} else if (!strncmp(config, "trig_mode", 9)) {
 		    copy_value(value, trigmode, 10);
 		} else if (!strncmp(config, "runtime", 9)) {
@@ -846,6 +1263,11 @@ static void parse_config_file(const char *cfg_fname)
 				printf("Error: Invalid pkt_sz:%s\n", value);
 				goto prase_cleanup;
 			}
+		} else if (!strncmp(config, "mm_chnl_num", 11)) {
+			if (arg_read_int(value, &mm_chnl_num) || !mm_chnl_num) {
+				printf("Error: Invalid mm_chnl_num:%s\n", value);
+				goto prase_cleanup;
+			}
 		} else if (!strncmp(config, "mm_chnl", 7)) {
 			if (arg_read_int(value, &mm_chnl)) {
 				printf("Error: Invalid mm_chnl:%s\n", value);
@@ -1001,6 +1423,25 @@ static void parse_config_file(const char *cfg_fname)
 		exit(1);
 	}
 
+	if (integrity && ((dir != Q_DIR_BI) || stm_mode)) {
+		printf("Error: integrity needs dir=bi and no stm_mode\n");
+		exit(1);
+	}
+	if (io_vec && ((mode != Q_MODE_MM) || integrity || !pkt_sz)) {
+		printf("Error: io_vec needs mode=mm, pkt_sz and no integrity\n");
+		exit(1);
+	}
+	if (xfer_prep && ((mode != Q_MODE_MM) || integrity || !pkt_sz ||
+			  io_vec)) {
+		printf("Error: xfer_prep needs mode=mm, pkt_sz, no integrity and no io_vec\n");
+		exit(1);
+	}
+	if (integrity && ((pkt_sz < INTEG_MIN_PKT_SZ) || (pkt_sz & 0x3))) {
+		printf("Error: integrity needs pkt_sz >= %u, multiple of 4\n",
+		       INTEG_MIN_PKT_SZ);
+		exit(1);
+	}
+
 	snprintf(rng_sz_path, 200,"dma-ctl %s%05x global_csr | grep \"Global Ring\"| cut -d \":\" -f 2 > glbl_rng_sz",
 			 dmactl_dev_prefix_str, (pci_bus << 12) | (pci_dev << 4) | pf_start);
 	system(rng_sz_path);
@@ -1030,6 +1471,8 @@ static void parse_config_file(const char *cfg_fname)
 		dir_factor = 2;
 	num_thrds = num_pf * num_q * dir_factor * num_thrds_per_q;
 	create_thread_info();
+	free(cdev_weight_lst);
+	cdev_weight_lst = NULL;
 	if (stm_mode) {
 		free(pipe_tdest_lst);
 		free(pipe_slr_id_lst);
@@ -1274,6 +1717,12 @@ static void *event_mon(void *argp)
 							rcv_data[k+6], rcv_data[k+7]);
 				}
 #endif
+				if (integrity && (_info->dir == Q_DIR_C2H)) {
+					integ_ring_push(&integ_ring, iocb,
+							!events[j].res2 &&
+							(events[j].res == iocb->u.c.nbytes));
+					continue;
+				}
 				for (bufcnt = 0; (bufcnt < iocb->u.c.nbytes) && iov; bufcnt++)
 					dma_free(&datahandle, iov[bufcnt].iov_base);
 				dma_free(&iocbhandle, iocb);
@@ -1651,6 +2100,153 @@ static int qdma_dump_queue(unsigned char is_vf, struct io_info *info)
 	return qdma_q_dump(&xcmd);
 }
 
+/* a weighted thread gets its own open file, arbitrated against the others */
+static int io_fd_open(struct io_info *_info)
+{
+	char node[25] = {'\0'};
+	int fd;
+	int s;
+
+	if (!_info->weight)
+		return _info->fd;
+
+	snprintf(node, 25, "/dev/%s", _info->q_name);
+	fd = open(node, O_RDWR);
+	if (fd < 0) {
+		printf("Error: Cannot find %s\n", node);
+		exit(1);
+	}
+	s = qdmautils_cdev_weight(fd, _info->weight);
+	if (s < 0) {
+		printf("Error: weight %u on %s failed %d\n", _info->weight,
+		       node, s);
+		exit(1);
+	}
+
+	return fd;
+}
+
+static void io_ctx_stats(struct io_info *_info)
+{
+	struct qdma_cdev_ctx_stats st;
+	int s;
+
+	s = qdmautils_cdev_stats(io_fd, &st);
+	if (s < 0) {
+		printf("Error: ctx stats on %s failed %d\n", _info->q_name, s);
+		return;
+	}
+	_info->ctx_stats = st.dir[(_info->dir == Q_DIR_H2C) ? 0 : 1];
+}
+
+/* synchronous vectored transfers of io_vec packets, MM only */
+static void io_vec_run(struct io_info *_info)
+{
+	struct qdmautils_io *iov;
+	unsigned char *bufs = NULL;
+	unsigned int i;
+	int ret;
+
+	iov = calloc(io_vec, sizeof(*iov));
+	if (!iov || posix_memalign((void **)&bufs, DEFAULT_PAGE_SIZE,
+				   (size_t)io_vec * _info->pkt_sz)) {
+		printf("OOM\n");
+		free(iov);
+		return;
+	}
+	for (i = 0; i < io_vec; i++) {
+		iov[i].buf = bufs + (size_t)i * _info->pkt_sz;
+		iov[i].len = _info->pkt_sz;
+		iov[i].dir = (_info->dir == Q_DIR_H2C) ? DMAXFER_IO_WRITE :
+							 DMAXFER_IO_READ;
+		iov[i].ep_addr = offset + (unsigned long long)i * _info->pkt_sz;
+	}
+
+	do {
+		struct timespec ts_cur;
+
+		if (tsecs) {
+			if (clock_gettime(CLOCK_MONOTONIC, &ts_cur) != 0)
+				break;
+			timespec_sub(&ts_cur, &g_ts_start);
+			if (ts_cur.tv_sec >= tsecs)
+				break;
+		}
+		ret = qdmautils_cdev_rw_vec(io_fd, iov, io_vec, 10 * 1000);
+		if (ret < 0) {
+			printf("Error: rw_vec error:%d on %s\n", ret,
+			       _info->q_name);
+			break;
+		}
+		_info->num_req_submitted += io_vec;
+		_info->num_req_completed += ret;
+	} while (tsecs && !force_exit);
+
+	free(bufs);
+	free(iov);
+}
+
+/* xfer_prep transfers mapped once, submitted round-robin, MM only */
+static void xfer_prep_run(struct io_info *_info)
+{
+	struct qdmautils_io io;
+	unsigned char *bufs = NULL;
+	unsigned int *ids;
+	unsigned int cnt;
+	unsigned int i;
+	int ret = 0;
+
+	ids = calloc(xfer_prep, sizeof(*ids));
+	if (!ids || posix_memalign((void **)&bufs, DEFAULT_PAGE_SIZE,
+				   (size_t)xfer_prep * _info->pkt_sz)) {
+		printf("OOM\n");
+		free(ids);
+		return;
+	}
+	for (cnt = 0; cnt < xfer_prep; cnt++) {
+		memset(&io, 0, sizeof(io));
+		io.buf = bufs + (size_t)cnt * _info->pkt_sz;
+		io.len = _info->pkt_sz;
+		io.dir = (_info->dir == Q_DIR_H2C) ? DMAXFER_IO_WRITE :
+						     DMAXFER_IO_READ;
+		io.ep_addr = offset + (unsigned long long)cnt * _info->pkt_sz;
+		ret = qdmautils_cdev_xfer_prep(io_fd, &io, &ids[cnt]);
+		if (ret < 0) {
+			printf("Error: xfer_prep error:%d on %s\n", ret,
+			       _info->q_name);
+			goto release;
+		}
+	}
+
+	i = 0;
+	do {
+		struct timespec ts_cur;
+
+		if (tsecs) {
+			if (clock_gettime(CLOCK_MONOTONIC, &ts_cur) != 0)
+				break;
+			timespec_sub(&ts_cur, &g_ts_start);
+			if (ts_cur.tv_sec >= tsecs)
+				break;
+		}
+		_info->num_req_submitted++;
+		ret = qdmautils_cdev_xfer_submit(io_fd, ids[i]);
+		if (ret < 0) {
+			printf("Error: xfer_submit error:%d on %s\n", ret,
+			       _info->q_name);
+			break;
+		}
+		_info->num_req_completed++;
+		i = (i + 1) % xfer_prep;
+	} while (tsecs && !force_exit);
+
+release:
+	for (i = 0; i < cnt; i++)
+		qdmautils_cdev_xfer_release(io_fd, ids[i]);
+	free(bufs);
+	free(ids);
+}
+
 static void io_proc_cleanup(struct io_info *_info)
 {
 	unsigned int i;
@@ -1662,6 +2258,12 @@ static void io_proc_cleanup(struct io_info *_info)
 
 	*io_exit = 1;
 	pthread_join(_info->evt_id, NULL);
+	if (integrity)
+		integ_stop(_info);
+	if (ctx_stats)
+		io_ctx_stats(_info);
+	if (io_fd != _info->fd)
+		close(io_fd);
 
 	q_offset = (_info->dir == Q_DIR_H2C) ? 0 : num_q;
 	if (dir != Q_DIR_BI)
@@ -1791,12 +2393,26 @@ static void *io_thread(void *argp)
 	datahandle.id = 0;
 	iocbhandle.id = 2;
 #endif
+	if (integrity)
+		integ_start(_info);
 	s = pthread_attr_init(&attr);
 	if (s != 0)
 		printf("pthread_attr_init failed\n");
 	if (pthread_create(&_info->evt_id, &attr, event_mon, _info))
 		exit(1);
 
+	io_fd = io_fd_open(_info);
+	if (io_vec) {
+		io_vec_run(_info);
+		io_proc_cleanup(_info);
+		return NULL;
+	}
+	if (xfer_prep) {
+		xfer_prep_run(_info);
+		io_proc_cleanup(_info);
+		return NULL;
+	}
+
 	do {
 		struct list_head *node = NULL;
 		struct timespec ts_cur;
@@ -1808,7 +2424,7 @@ static void *io_thread(void *argp)
 			if (ts_cur.tv_sec >= tsecs)
 				break;
 		}
-		node = dma_memalloc(&ctxhandle, 1);
+		node = dma_memalloc(&ctxhandle);
 		if (!node) {
 			continue;
 		}
@@ -1840,7 +2456,7 @@ static void *io_thread(void *argp)
 				continue;
 			}
 
-			io_list[0] = dma_memalloc(&iocbhandle, 1);
+			io_list[0] = dma_memalloc(&iocbhandle);
 			if (io_list[0] == NULL) {
 				if (cnt) {
 					node->max_events = cnt;
@@ -1853,7 +2469,7 @@ static void *io_thread(void *argp)
 			}
 			iov = (struct iovec *)(io_list[0] + 1);
 			for (iovcnt = 0; iovcnt < burst_cnt; iovcnt++) {
-				iov[iovcnt].iov_base = dma_memalloc(&datahandle, 1);
+				iov[iovcnt].iov_base = dma_memalloc(&datahandle);
 				if (iov[iovcnt].iov_base == NULL)
 					break;
 				iov[iovcnt].iov_len = io_sz;
@@ -1863,14 +2479,21 @@ static void *io_thread(void *argp)
 				continue;
 			}
 			if (_info->dir == Q_DIR_H2C) {
+				if (integrity) {
+					unsigned int k;
+
+					for (k = 0; k < iovcnt; k++)
+						integ_stamp(_info, iov[k].iov_base,
+							    iov[k].iov_len);
+				}
 				io_prep_pwritev(io_list[0],
-					       _info->fd,
+					       io_fd,
 					       iov,
 					       iovcnt,
 						  offset);
 			} else {
 				io_prep_preadv(io_list[0],
-					       _info->fd,
+					       io_fd,
 					       iov,
 					       iovcnt,
 						  offset);
@@ -1930,15 +2553,29 @@ static int setup_thrd_env(struct io_info *_info, unsigned char is_new_fd)
 		}
 	}
 
-	s = ioctl(_info->fd, 0, &no_memcpy);
+	s = ioctl(_info->fd, QDMA_CDEV_IOCTL_NO_MEMCPY, &no_memcpy);
 	if (s != 0) {
 		printf("failed to set non memcpy\n");
 		exit(1);
 	}
 
+	if (arb_inflight) {
+		s = qdmautils_cdev_arb_conf(_info->fd, arb_inflight);
+		if (s < 0) {
+			printf("Error: arb_inflight %u on %s failed %d\n",
+			       arb_inflight, _info->q_name, s);
+			exit(1);
+		}
+	}
+
 	return _info->fd;
 }
 
+static unsigned long long tv_us(struct timeval *tv)
+{
+	return (unsigned long long)tv->tv_sec * 1000000ULL + tv->tv_usec;
+}
+
 static void dump_result(unsigned long long total_io_sz)
 {
 	unsigned long long gig_div = ((unsigned long long)tsecs * 1000000000);
@@ -2055,6 +2692,44 @@ static void cleanup(void)
 			total_num_c2h_ios += info[i].num_req_completed;
 		}
 	}
+	if (integrity) {
+		struct integ_stats st = {0};
+
+		for (i = 0; i < num_thrds; i++) {
+			st.blks += info[i].integ_blks;
+			st.crc_err += info[i].integ_crc_err;
+			st.seq_err += info[i].integ_seq_err;
+			st.torn += info[i].integ_torn;
+			st.skip += info[i].integ_skip;
+		}
+		printf("INTEGRITY blocks = %llu, crc_err = %llu, seq_err = %llu, "
+		       "torn = %llu, skipped = %llu\n", st.blks, st.crc_err,
+		       st.seq_err, st.torn, st.skip);
+	}
+	if (ctx_stats) {
+		for (i = 0; i < num_thrds; i++) {
+			struct qdma_cdev_ctx_dir_stats *st = &info[i].ctx_stats;
+
+			printf("%s thrd %u %s weight %u: reqs = %llu, bytes = %llu, "
+			       "errors = %llu, avg wait = %llu ns, avg lat = %llu ns, "
+			       "max lat = %llu ns\n", info[i].q_name,
+			       info[i].thread_id,
+			       (info[i].dir == Q_DIR_H2C) ? "H2C" : "C2H",
+			       info[i].weight ? info[i].weight :
+			       QDMA_CDEV_WEIGHT_DEFAULT,
+			       (unsigned long long)st->reqs,
+			       (unsigned long long)st->bytes,
+			       (unsigned long long)st->errors,
+			       st->reqs ? (unsigned long long)(st->wait_ns / st->reqs) : 0,
+			       st->reqs ? (unsigned long long)(st->lat_ns / st->reqs) : 0,
+			       (unsigned long long)st->lat_max_ns);
+		}
+	}
+	if (cpu_acct && thrd_cpu_us) {
+		for (i = 0; i < num_thrds; i++)
+			printf("%s thrd %u cpu = %.3f s\n", info[i].q_name,
+			       info[i].thread_id, thrd_cpu_us[i] / 1e6);
+	}
 	if (shmdt(info) == -1){
 		perror("shmdt returned -1\n");
 		error(-1, errno, " ");
@@ -2086,6 +2761,17 @@ static void cleanup(void)
 	}
 	if ((0 == total_num_h2c_ios) && (0 == total_num_c2h_ios))
 		printf("No IOs happened\n");
+	if (cpu_acct) {
+		if (!cpu_end_taken)
+			qdmautils_cpu_snapshot(&cpu_end, cpu_intr_name);
+		qdmautils_cpu_report(&cpu_start, &cpu_end,
+				     (total_num_h2c_ios + total_num_c2h_ios) *
+				     pkt_sz,
+				     total_num_h2c_ios + total_num_c2h_ios,
+				     cpu_mhz);
+		free(thrd_cpu_us);
+		thrd_cpu_us = NULL;
+	}
 }
 
 int main(int argc, char *argv[])
@@ -2135,6 +2821,13 @@ int main(int argc, char *argv[])
 	printf("dmautils(%u) threads\n", num_thrds);
 	child_pid_lst = calloc(num_thrds, sizeof(int));
 	base_pid = getpid();
+	if (cpu_acct) {
+		/* the msix vectors are named after the device, qdma<bdf>-... */
+		snprintf(cpu_intr_name, sizeof(cpu_intr_name), "%s%02x%02x",
+			 pf_dmactl_prefix_str, pci_bus, pci_dev);
+		thrd_cpu_us = calloc(num_thrds, sizeof(*thrd_cpu_us));
+		qdmautils_cpu_snapshot(&cpu_start, cpu_intr_name);
+	}
 	child_pid_lst[0] = base_pid;
 	for (i = 1; i < num_thrds; i++) {
 		if (getpid() == base_pid)
@@ -2164,6 +2857,20 @@ int main(int argc, char *argv[])
 		if (sched_setaffinity(base_pid, sizeof(set), &set) == -1)
 			printf("setaffinity for thrd%u failed\n", info[i].thread_id);
 #endif
+		if (thrd_cpu_us) {
+			struct rusage ru;
+
+			getrusage(RUSAGE_SELF, &ru);
+			thrd_cpu_us[0] = tv_us(&ru.ru_utime) +
+					 tv_us(&ru.ru_stime);
+			for (i = 1; i < num_thrds; i++) {
+				wait4(child_pid_lst[i], NULL, 0, &ru);
+				thrd_cpu_us[i] = tv_us(&ru.ru_utime) +
+						 tv_us(&ru.ru_stime);
+			}
+			qdmautils_cpu_snapshot(&cpu_end, cpu_intr_name);
+			cpu_end_taken = 1;
+		}
 	        for(i = 1; i < num_thrds; i++) {
 	            waitpid(child_pid_lst[i], NULL, 0);
 	        }
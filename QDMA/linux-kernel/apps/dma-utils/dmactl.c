@@ -317,6 +317,12 @@ static int get_cmd_resp_buf_len(enum xnl_op_t op, struct xcmd_info *xcmd)
 		case XNL_CMD_DEV_STAT:
 			buf_len = XNL_RESP_BUFLEN_MAX;
 		break;
+		case XNL_CMD_DEV_STAT_BIN:
+			buf_len = XNL_RESP_BUFLEN_MAX +
+				XNL_STAT_BIN_Q_MAX * sizeof(struct xnl_q_stat_bin);
+			return buf_len;
+		case XNL_CMD_RATE_LIMIT:
+			return buf_len;
 		default:
         	buf_len = XNL_RESP_BUFLEN_MIN;
         	return buf_len;
@@ -379,6 +385,12 @@ static void xnl_msg_add_extra_config_attrs(struct xnl_hdr *hdr,
 		xnl_msg_add_int_attr(hdr,  XNL_ATTR_APERTURE_SZ,
 							 xcmd->req.qparm.aperture_sz);
 	}
+	if (xcmd->req.qparm.sflags & (1 << QPARM_RL_RATE))
+		xnl_msg_add_int_attr(hdr,  XNL_ATTR_RL_RATE,
+		                     xcmd->req.qparm.rl_rate_mbps);
+	if (xcmd->req.qparm.sflags & (1 << QPARM_RL_BURST))
+		xnl_msg_add_int_attr(hdr,  XNL_ATTR_RL_BURST,
+		                     xcmd->req.qparm.rl_burst);
 }
 
 static int xnl_parse_response(struct xnl_cb *cb, struct xnl_hdr *hdr,
@@ -497,6 +509,24 @@ static int xnl_send_cmd(struct xnl_cb *cb, struct xnl_hdr *hdr,
 		xnl_msg_add_int_attr(hdr, XNL_ATTR_CSR_COUNT,
 				QDMA_GLOBAL_CSR_ARRAY_SZ);
 		break;
+		case XNL_CMD_DEV_STAT_BIN:
+		xnl_msg_add_int_attr(hdr, XNL_ATTR_QIDX, xcmd->req.qparm.idx);
+		xnl_msg_add_int_attr(hdr, XNL_ATTR_NUM_Q, xcmd->req.qparm.num_q);
+		break;
+		case XNL_CMD_RATE_LIMIT:
+		/* no queue index: the function limit */
+		if (xcmd->req.qparm.sflags & (1 << QPARM_IDX)) {
+			xnl_msg_add_int_attr(hdr, XNL_ATTR_QIDX,
+					     xcmd->req.qparm.idx);
+			xnl_msg_add_int_attr(hdr, XNL_ATTR_QFLAG,
+					     xcmd->req.qparm.flags);
+		}
+		xnl_msg_add_int_attr(hdr, XNL_ATTR_RL_RATE,
+				     xcmd->req.qparm.rl_rate_mbps);
+		if (xcmd->req.qparm.sflags & (1 << QPARM_RL_BURST))
+			xnl_msg_add_int_attr(hdr, XNL_ATTR_RL_BURST,
+					     xcmd->req.qparm.rl_burst);
+		break;
 	default:
 		break;
 	}
@@ -622,6 +652,50 @@ static void xnl_parse_csr_attrs(struct xnl_hdr *hdr, uint32_t *attrs, struct xcm
 
 }
 
+static void xnl_parse_stat_bin_attrs(struct xnl_hdr *hdr,
+				     struct xcmd_info *xcmd)
+{
+	struct xnl_stat_bin *sb = &xcmd->resp.stat_bin;
+	unsigned char *p = (unsigned char *)(hdr + 1);
+	int maxlen = hdr->n.nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+	unsigned int q_size = 0;
+
+	memset(&sb->dev, 0, sizeof(sb->dev));
+	sb->dev.qidx_next = XNL_QIDX_INVALID;
+	while (maxlen > 0) {
+		struct nlattr *na = (struct nlattr *)p;
+		unsigned int dlen = na->nla_len - NLA_HDRLEN;
+		int len = NLA_ALIGN(na->nla_len);
+
+		if (na->nla_type == XNL_ATTR_DEV_STAT_BIN) {
+			memcpy(&sb->dev, na + 1,
+			       dlen < sizeof(sb->dev) ? dlen : sizeof(sb->dev));
+			q_size = sb->dev.q_stat_size;
+		} else if (na->nla_type == XNL_ATTR_Q_STAT_BIN && q_size) {
+			/* entries may be larger than ours with a newer kernel */
+			unsigned int n = dlen / q_size;
+			unsigned int cpsz = q_size < sizeof(*sb->q) ?
+						q_size : sizeof(*sb->q);
+			struct xnl_q_stat_bin *q;
+			unsigned int i;
+
+			q = realloc(sb->q, (sb->q_cnt + n) * sizeof(*sb->q));
+			if (!q)
+				return;
+			sb->q = q;
+			q += sb->q_cnt;
+			memset(q, 0, n * sizeof(*q));
+			for (i = 0; i < n; i++)
+				memcpy(q + i, (char *)(na + 1) + i * q_size,
+				       cpsz);
+			sb->q_cnt += n;
+		}
+
+		p += len;
+		maxlen -= len;
+	}
+}
+
 static void xnl_parse_cmd_attrs(struct xnl_hdr *hdr, struct xcmd_info *xcmd,
 				uint32_t *attrs)
 {
@@ -645,6 +719,9 @@ static void xnl_parse_cmd_attrs(struct xnl_hdr *hdr, struct xcmd_info *xcmd,
         case XNL_CMD_GLOBAL_CSR:
 		xnl_parse_csr_attrs(hdr, attrs, xcmd);
 		break;
+        case XNL_CMD_DEV_STAT_BIN:
+		xnl_parse_stat_bin_attrs(hdr, xcmd);
+		break;
 	default:
 		break;
 	}
@@ -731,6 +808,54 @@ int qdma_dev_stat_clear(struct xcmd_info *cmd)
 	return xnl_common_msg_send(cmd, attrs);
 }
 
+int qdma_dev_stat_bin(struct xcmd_info *cmd)
+{
+	struct xnl_stat_bin *sb = &cmd->resp.stat_bin;
+	struct xcmd_q_parm *qparm = &cmd->req.qparm;
+	unsigned int qidx = qparm->idx;
+	unsigned int qcnt = qparm->num_q;
+	unsigned int idx = qidx;
+	unsigned int num_q = qcnt;
+	int rv;
+
+	sb->q_cnt = 0;
+	sb->q = NULL;
+
+	/* one reply covers at most XNL_STAT_BIN_Q_MAX entries */
+	do {
+		uint32_t attrs[XNL_ATTR_MAX] = {0};
+
+		qparm->idx = idx;
+		qparm->num_q = num_q;
+		rv = xnl_common_msg_send(cmd, attrs);
+		if (rv < 0)
+			break;
+		if (sb->dev.qidx_next == XNL_QIDX_INVALID ||
+		    sb->dev.qidx_next <= idx ||
+		    sb->dev.qidx_next - idx >= num_q)
+			break;
+		num_q -= sb->dev.qidx_next - idx;
+		idx = sb->dev.qidx_next;
+	} while (1);
+
+	qparm->idx = qidx;
+	qparm->num_q = qcnt;
+	if (rv < 0) {
+		free(sb->q);
+		sb->q = NULL;
+		sb->q_cnt = 0;
+	}
+
+	return rv;
+}
+
+int qdma_rate_limit(struct xcmd_info *cmd)
+{
+	uint32_t attrs[XNL_ATTR_MAX] = {0};
+
+	return xnl_common_msg_send(cmd, attrs);
+}
+
 int qdma_dev_intr_ring_dump(struct xcmd_info *cmd)
 {
 	uint32_t attrs[XNL_ATTR_MAX] = {0};
@@ -15,8 +15,11 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "qdma_nl.h"
 #include "dmactl_internal.h"
 
@@ -374,6 +377,262 @@ static inline void print_seperator(struct xcmd_info *xcmd)
 		xcmd->log_msg_dump(buffer);
 }
 
+/*
+ * Register list file of reg batch and reg watch: one register per line,
+ * "<addr>" to read it or "<addr> <val>" to write it, '#' starts a comment.
+ */
+struct reg_list_ent {
+	unsigned int reg;
+	unsigned int val;
+	unsigned char write;
+};
+
+static int reg_list_load(const char *fname, struct reg_list_ent **listp)
+{
+	struct reg_list_ent *list = NULL;
+	unsigned int cnt = 0, max = 0, lineno = 0;
+	char line[256];
+	FILE *fp;
+
+	fp = fopen(fname, "r");
+	if (!fp) {
+		warn("%s", fname);
+		return -errno;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		char *p, *end;
+		unsigned long v;
+
+		lineno++;
+		p = strchr(line, '#');
+		if (p)
+			*p = '\0';
+		for (p = line; *p == ' ' || *p == '\t'; p++)
+			;
+		if (*p == '\0' || *p == '\n')
+			continue;
+
+		if (cnt == max) {
+			struct reg_list_ent *l;
+
+			max = max ? max * 2 : 64;
+			l = realloc(list, max * sizeof(*list));
+			if (!l) {
+				free(list);
+				fclose(fp);
+				return -ENOMEM;
+			}
+			list = l;
+		}
+
+		v = strtoul(p, &end, 0);
+		if (end == p || (v & 0x3)) {
+			warnx("%s:%u: bad register address", fname, lineno);
+			goto err_out;
+		}
+		list[cnt].reg = v;
+		list[cnt].write = 0;
+
+		for (p = end; *p == ' ' || *p == '\t'; p++)
+			;
+		if (*p && *p != '\n') {
+			v = strtoul(p, &end, 0);
+			if (end == p) {
+				warnx("%s:%u: bad register value", fname,
+				      lineno);
+				goto err_out;
+			}
+			list[cnt].val = v;
+			list[cnt].write = 1;
+		}
+		cnt++;
+	}
+	fclose(fp);
+
+	*listp = list;
+	return cnt;
+
+err_out:
+	free(list);
+	fclose(fp);
+	return -EINVAL;
+}
+
+/* fallback when the BAR cannot be mapped, a netlink message per access */
+static int reg_list_access_nl(struct xcmd_info *xcmd,
+			      struct reg_list_ent *ent)
+{
+	uint32_t attrs[XNL_ATTR_MAX] = {0};
+
+	xcmd->op = ent->write ? XNL_CMD_REG_WRT : XNL_CMD_REG_RD;
+	xcmd->req.reg.reg = ent->reg;
+	xcmd->req.reg.val = ent->val;
+	return xnl_common_msg_send(xcmd, attrs);
+}
+
+static int reg_batch(struct xcmd_info *xcmd, struct qdmautils_bar *bar,
+		     struct reg_list_ent *list, int cnt)
+{
+	char reg_dump[100];
+	int i;
+	int rv;
+
+	for (i = 0; i < cnt; i++) {
+		if (!bar)
+			rv = reg_list_access_nl(xcmd, &list[i]);
+		else if (list[i].write)
+			rv = qdmautils_bar_write(bar, &list[i].reg,
+						 &list[i].val, 1);
+		else
+			rv = qdmautils_bar_read(bar, &list[i].reg,
+						&list[i].val, 1);
+		if (rv < 0) {
+			warnx("reg 0x%x %s failed, %d", list[i].reg,
+			      list[i].write ? "write" : "read", rv);
+			return rv;
+		}
+		if (!bar && !list[i].write)
+			list[i].val = xcmd->req.reg.val;
+
+		snprintf(reg_dump, 100, "[%#7x] %s %#-10x %u\n", list[i].reg,
+			 list[i].write ? "<-" : "= ", list[i].val,
+			 list[i].val);
+		if (xcmd->log_msg_dump)
+			xcmd->log_msg_dump(reg_dump);
+	}
+
+	return 0;
+}
+
+static volatile sig_atomic_t reg_watch_stop;
+
+static void reg_watch_sigint(int sig)
+{
+	reg_watch_stop = 1;
+}
+
+static unsigned long long ts_ns(struct timespec *ts)
+{
+	return (unsigned long long)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+/*
+ * Sample the registers of the list every interval_us, each sample is one
+ * line: the time in us from the first sample and the register values in
+ * list order. The sampling is paced on absolute times so the rate does
+ * not drift with the cost of a sample.
+ */
+static int reg_watch(struct xcmd_info *xcmd, struct qdmautils_bar *bar,
+		     struct reg_list_ent *list, int cnt)
+{
+	struct xcmd_reg *regcmd = &xcmd->req.reg;
+	unsigned long long interval = regcmd->interval_us * 1000ULL;
+	unsigned long long t_start, t_next, n;
+	unsigned int *regs, *vals;
+	struct timespec ts;
+	size_t line_len = 24 + cnt * 12;
+	char *line;
+	int len;
+	int i;
+	int rv = 0;
+
+	regs = calloc(cnt, sizeof(*regs));
+	vals = calloc(cnt, sizeof(*vals));
+	line = malloc(line_len);
+	if (!regs || !vals || !line) {
+		rv = -ENOMEM;
+		goto out;
+	}
+
+	len = snprintf(line, line_len, "%-12s", "time_us");
+	for (i = 0; i < cnt; i++) {
+		if (list[i].write) {
+			warnx("reg watch: 0x%x, writes are not allowed",
+			      list[i].reg);
+			rv = -EINVAL;
+			goto out;
+		}
+		regs[i] = list[i].reg;
+		len += snprintf(line + len, line_len - len, " %#10x", regs[i]);
+	}
+	snprintf(line + len, line_len - len, "\n");
+	if (xcmd->log_msg_dump)
+		xcmd->log_msg_dump(line);
+
+	signal(SIGINT, reg_watch_sigint);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t_start = t_next = ts_ns(&ts);
+	for (n = 0; !reg_watch_stop && (!regcmd->count || n < regcmd->count);
+	     n++) {
+		if (bar) {
+			rv = qdmautils_bar_read(bar, regs, vals, cnt);
+		} else {
+			for (i = 0; i < cnt; i++) {
+				rv = reg_list_access_nl(xcmd, &list[i]);
+				if (rv < 0)
+					break;
+				vals[i] = xcmd->req.reg.val;
+			}
+		}
+		if (rv < 0)
+			break;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		len = snprintf(line, line_len, "%-12llu",
+			       (ts_ns(&ts) - t_start) / 1000);
+		for (i = 0; i < cnt; i++)
+			len += snprintf(line + len, line_len - len, " %#10x",
+					vals[i]);
+		snprintf(line + len, line_len - len, "\n");
+		if (xcmd->log_msg_dump)
+			xcmd->log_msg_dump(line);
+
+		/* a late sample moves the schedule instead of bursting */
+		t_next += interval;
+		if (t_next < ts_ns(&ts))
+			t_next = ts_ns(&ts);
+		ts.tv_sec = t_next / 1000000000ULL;
+		ts.tv_nsec = t_next % 1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+	signal(SIGINT, SIG_DFL);
+
+out:
+	free(line);
+	free(vals);
+	free(regs);
+	return rv;
+}
+
+static int reg_list_cmd(struct xcmd_info *xcmd, unsigned int barno)
+{
+	struct xnl_dev_info *dev_info = &xcmd->resp.dev_info;
+	struct reg_list_ent *list = NULL;
+	struct qdmautils_bar *bar = NULL;
+	int cnt;
+	int rv;
+
+	cnt = reg_list_load(xcmd->req.reg.fname, &list);
+	if (cnt <= 0)
+		return cnt;
+
+	rv = qdmautils_bar_open(dev_info->pci_bus, dev_info->pci_dev,
+				dev_info->dev_func, barno, &bar);
+	if (rv < 0)
+		bar = NULL;
+
+	if (xcmd->req.reg.sflags & XCMD_REG_F_WATCH)
+		rv = reg_watch(xcmd, bar, list, cnt);
+	else
+		rv = reg_batch(xcmd, bar, list, cnt);
+
+	qdmautils_bar_close(bar);
+	free(list);
+
+	return rv;
+}
+
 int proc_reg_cmd(struct xcmd_info *xcmd)
 {
 	struct xcmd_reg *regcmd;
@@ -406,6 +665,9 @@ int proc_reg_cmd(struct xcmd_info *xcmd)
 			 regcmd->bar : xcmd->resp.dev_info.config_bar;
 	regcmd->bar = barno;
 
+	if (regcmd->sflags & (XCMD_REG_F_BATCH | XCMD_REG_F_WATCH))
+		return reg_list_cmd(xcmd, barno);
+
 	switch (xcmd->op) {
 	case XNL_CMD_REG_RD:
 		rv = reg_read_mmap(&xcmd->resp.dev_info, barno, xcmd);
@@ -41,5 +41,29 @@ int qdmautils_sync_xfer(char *filename, enum qdmautils_io_dir dir, void *buf,
 int qdmautils_async_xfer(char *filename, enum qdmautils_io_dir dir, void *buf,
 			unsigned int xfer_len)
 {
-	return dmaxfer_iosubmit(filename, dir, DMAXFER_IO_ASYNC, buf, xfer_len);
+	struct qdmautils_io io = {
+		.buf = buf,
+		.len = xfer_len,
+		.dir = dir,
+	};
+	struct qdmautils_io *iop = &io;
+	struct qdmautils_q *q;
+	int ret;
+
+	ret = qdmautils_q_open(filename, 1, &q);
+	if (ret < 0)
+		return ret;
+
+	ret = qdmautils_q_submit(q, &iop, 1);
+	if (ret == 1) {
+		ret = qdmautils_q_reap(q, &iop, 1, 1, -1);
+		if (ret == 1)
+			ret = io.res;
+	} else if (!ret) {
+		ret = -EAGAIN;
+	}
+
+	qdmautils_q_close(q);
+
+	return ret;
 }
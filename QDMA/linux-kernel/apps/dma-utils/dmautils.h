@@ -11,6 +11,10 @@
 #ifndef QDMAUTILS_H
 #define QDMAUTILS_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "qdma_nl.h"
+#include "qdma_cdev_ioctl.h"
 
 /** @QDMA_GLOBAL_CSR_ARRAY_SZ: QDMA Global CSR array size */
 #define QDMA_GLOBAL_CSR_ARRAY_SZ        16
@@ -99,6 +103,10 @@ enum qdma_q_parm_type {
 	QPARM_KEYHOLE_EN,
 	/** @QPARM_MM_CHANNEL: q mm channel enable param */
 	QPARM_MM_CHANNEL,
+	/** @QPARM_RL_RATE: q/function rate limit param */
+	QPARM_RL_RATE,
+	/** @QPARM_RL_BURST: q/function rate limit bucket depth param */
+	QPARM_RL_BURST,
 	/** @QPARM_MAX: max q param */
 	QPARM_MAX,
 };
@@ -144,6 +152,10 @@ struct xcmd_q_parm {
 	unsigned char ping_pong_en;
 	/** @aperture_sz: aperture_size for keyhole transfers*/
 	unsigned int aperture_sz;
+	/** @rl_rate_mbps: rate limit in Mbit/s, 0: unlimited */
+	unsigned int rl_rate_mbps;
+	/** @rl_burst: rate limit bucket depth in bytes, 0: default */
+	unsigned int rl_burst;
 };
 
 /**
@@ -201,6 +213,10 @@ struct xcmd_reg {
 #define XCMD_REG_F_REG_SET	0x2
 	/** @XCMD_REG_F_VAL_SET: val param set */
 #define XCMD_REG_F_VAL_SET	0x4
+	/** @XCMD_REG_F_BATCH: access the registers of a list file */
+#define XCMD_REG_F_BATCH	0x8
+	/** @XCMD_REG_F_WATCH: sample the registers of a list file */
+#define XCMD_REG_F_WATCH	0x10
 	/** @bar: bar number */
 	unsigned int bar;
 	/** @reg: register offset */
@@ -211,6 +227,12 @@ struct xcmd_reg {
 	unsigned int range_start;
 	/** @range_end: range end */
 	unsigned int range_end;
+	/** @fname: register list file, batch and watch */
+	const char *fname;
+	/** @interval_us: sampling interval, watch */
+	unsigned int interval_us;
+	/** @count: number of samples, 0 until interrupted, watch */
+	unsigned int count;
 };
 
 /**
@@ -253,6 +275,19 @@ struct xnl_dev_stat {
 	unsigned long long ping_pong_lat_avg;
 };
 
+/**
+ * struct xnl_stat_bin - binary device and queue statistics
+ */
+struct xnl_stat_bin {
+	/** @dev: device statistics */
+	struct xnl_dev_stat_bin dev;
+	/** @q_cnt: number of entries in @q */
+	unsigned int q_cnt;
+	/** @q: queue statistics, allocated by qdma_dev_stat_bin(),
+	 *      to be released with free() */
+	struct xnl_q_stat_bin *q;
+};
+
 /**
  * struct xnl_q_info - q state information
  */
@@ -305,6 +340,8 @@ struct xcmd_info {
 		struct xcmd_dev_cap cap;
 		/** @dev_stat: device stat response */
 		struct xnl_dev_stat dev_stat;
+		/** @stat_bin: binary device and queue stat response */
+		struct xnl_stat_bin stat_bin;
 		/** @dev_info: device info response */
 		struct xnl_dev_info dev_info;
 		/** @q_info: queue info response */
@@ -394,6 +431,31 @@ int qdma_dev_stat(struct xcmd_info *cmd);
  *****************************************************************************/
 int qdma_dev_stat_clear(struct xcmd_info *cmd);
 
+/*****************************************************************************/
+/**
+ * qdma_dev_stat_bin() - get the binary device and per queue statistics
+ *			 provided by cmd->resp.stat_bin, for the queues
+ *			 cmd->req.qparm.idx .. idx + num_q - 1
+ *
+ * @cmd:	command information
+ *
+ * Return:	>=0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_dev_stat_bin(struct xcmd_info *cmd);
+
+/*****************************************************************************/
+/**
+ * qdma_rate_limit() - set the rate limit of the queue cmd->req.qparm.idx,
+ *		       or of the function if no queue index is given
+ *
+ * @cmd:	command information
+ *
+ * Return:	>=0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_rate_limit(struct xcmd_info *cmd);
+
 /*****************************************************************************/
 /**
  * qdma_dev_intr_ring_dump() - dump device interrupt ring
@@ -603,4 +665,370 @@ int qdmautils_sync_xfer(char *filename, enum qdmautils_io_dir dir, void *buf,
 int qdmautils_async_xfer(char *filename, enum qdmautils_io_dir dir, void *buf,
 		   unsigned int xfer_len);
 
+/**
+ * struct qdmautils_q - queue handle, opaque to the application
+ */
+struct qdmautils_q;
+
+/**
+ * struct qdmautils_io - one asynchronous transfer on a queue handle
+ */
+struct qdmautils_io {
+	/** @buf: user buffer, owned by the application until reaped */
+	void *buf;
+	/** @len: length of the transfer in bytes */
+	unsigned int len;
+	/** @dir: direction of the transfer */
+	enum qdmautils_io_dir dir;
+	/** @ep_addr: card address, MM queues only */
+	unsigned long long ep_addr;
+	/** @priv: application cookie, not touched by the library */
+	void *priv;
+	/** @res: filled in on reap: bytes transferred or -errno */
+	long res;
+};
+
+/*****************************************************************************/
+/**
+ * qdmautils_q_open() - open a queue handle with a persistent AIO context
+ *
+ * @filename:	queue cdev, e.g. /dev/qdma01000-MM-0
+ * @depth:	max number of transfers outstanding on the handle
+ * @qh:		filled in with the queue handle
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_q_open(const char *filename, unsigned int depth,
+		     struct qdmautils_q **qh);
+
+/*****************************************************************************/
+/**
+ * qdmautils_q_close() - close a queue handle, waits for the outstanding
+ *			 transfers
+ *
+ * @q:		queue handle
+ *
+ * Return:	Nothing
+ *
+ *****************************************************************************/
+void qdmautils_q_close(struct qdmautils_q *q);
+
+/*****************************************************************************/
+/**
+ * qdmautils_q_eventfd() - get an eventfd signalled on every completion,
+ *			   for use with poll/epoll, the application reads it
+ *			   to reset the counter before reaping
+ *
+ * @q:		queue handle
+ *
+ * Return:	eventfd
+ *
+ *****************************************************************************/
+int qdmautils_q_eventfd(struct qdmautils_q *q);
+
+/*****************************************************************************/
+/**
+ * qdmautils_q_submit() - submit transfers with a single system call
+ *
+ * @q:		queue handle
+ * @iov:	transfers, each owned by the library until reaped
+ * @cnt:	number of transfers
+ *
+ * Return:	number of transfers submitted, less than @cnt when the queue
+ *		depth is reached, or <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_q_submit(struct qdmautils_q *q, struct qdmautils_io **iov,
+		       unsigned int cnt);
+
+/*****************************************************************************/
+/**
+ * qdmautils_q_reap() - reap completed transfers, from one thread at a
+ *			time, may run concurrently with qdmautils_q_submit()
+ *
+ * @q:		queue handle
+ * @iov:	filled in with the completed transfers
+ * @min:	number of transfers to wait for
+ * @max:	max number of transfers to return
+ * @timeout_ms:	max time to wait for @min transfers, <0 waits forever
+ *
+ * Return:	number of transfers reaped or <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_q_reap(struct qdmautils_q *q, struct qdmautils_io **iov,
+		     unsigned int min, unsigned int max, int timeout_ms);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_stripe() - stripe the read/write of a queue cdev over a
+ *			     group of started MM queues of the function
+ *
+ * @fd:		open queue cdev
+ * @stripe_len:	stripe size in bytes
+ * @qidx:	queue indexes of the group
+ * @q_cnt:	number of queues, <= QDMA_CDEV_STRIPE_Q_MAX, 0 turns striping
+ *		off
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_stripe(int fd, unsigned int stripe_len,
+			  const unsigned int *qidx, unsigned int q_cnt);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_rw_vec() - transfer a vector of buffers in one system call,
+ *			     all of them in the direction of the first one
+ *
+ * @fd:		open queue cdev
+ * @iov:	transfers, res is filled in with bytes transferred or -errno
+ * @cnt:	number of transfers, <= QDMA_CDEV_RW_VEC_MAX
+ * @timeout_ms:	timeout for the whole vector, 0 - no timeout
+ *
+ * Return:	number of transfers completed without error or <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_rw_vec(int fd, struct qdmautils_io *iov, unsigned int cnt,
+			  unsigned int timeout_ms);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_cmpt_read() - copy the pending entries of the MM completion
+ *				queue with the queue index of the cdev
+ *
+ * @fd:		open queue cdev
+ * @buf:	buffer for the raw completion entries
+ * @len:	length of the buffer in bytes
+ * @entry_len:	filled in with the completion entry size in bytes
+ *
+ * Return:	number of entries copied or <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_cmpt_read(int fd, void *buf, unsigned int len,
+			     unsigned int *entry_len);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_arb_conf() - set the ring budget of the queue arbitration
+ *			       between the files open on a queue cdev
+ *
+ * @fd:		open queue cdev
+ * @inflight_max: max. bytes in the ring, 0 turns arbitration off
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_arb_conf(int fd, unsigned long long inflight_max);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_weight() - set the arbitration weight of an open file
+ *
+ * @fd:		open queue cdev
+ * @weight:	1 ~ QDMA_CDEV_WEIGHT_MAX, QDMA_CDEV_WEIGHT_DEFAULT on open
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_weight(int fd, unsigned int weight);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_stats() - read the counters of an open file
+ *
+ * @fd:		open queue cdev
+ * @stats:	filled in with the counters
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_stats(int fd, struct qdma_cdev_ctx_stats *stats);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_xfer_prep() - pin a buffer and build its MM descriptor
+ *				chain once for repeated submission
+ *
+ * @fd:		open MM queue cdev
+ * @io:		transfer, buf must stay valid until the release
+ * @id:		filled in with the transfer id
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_xfer_prep(int fd, struct qdmautils_io *io,
+			     unsigned int *id);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_xfer_submit() - submit a prepared transfer and wait for it
+ *
+ * @fd:		open MM queue cdev the transfer was prepared on
+ * @id:		transfer id
+ *
+ * Return:	bytes transferred or <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_xfer_submit(int fd, unsigned int id);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cdev_xfer_release() - release a prepared transfer, closing the
+ *				   cdev releases all of them
+ *
+ * @fd:		open MM queue cdev the transfer was prepared on
+ * @id:		transfer id
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cdev_xfer_release(int fd, unsigned int id);
+
+/**
+ * struct qdmautils_bar - mapped BAR, opaque to the application
+ */
+struct qdmautils_bar;
+
+/*****************************************************************************/
+/**
+ * qdmautils_bar_open() - map a BAR of a function for register access
+ *			  without a system call per access
+ *
+ * @pci_bus:	pci bus
+ * @pci_dev:	pci device
+ * @dev_func:	pci function
+ * @barno:	bar number
+ * @barp:	filled in with the BAR handle
+ *
+ * Return:	0 for success and <0 for error, the BAR is mapped read only
+ *		when the resource file is not writable
+ *
+ *****************************************************************************/
+int qdmautils_bar_open(unsigned char pci_bus, unsigned char pci_dev,
+		       unsigned char dev_func, unsigned int barno,
+		       struct qdmautils_bar **barp);
+
+/*****************************************************************************/
+/**
+ * qdmautils_bar_close() - unmap a BAR
+ *
+ * @bar:	BAR handle
+ *
+ * Return:	Nothing
+ *
+ *****************************************************************************/
+void qdmautils_bar_close(struct qdmautils_bar *bar);
+
+/*****************************************************************************/
+/**
+ * qdmautils_bar_read() - read registers, in order
+ *
+ * @bar:	BAR handle
+ * @regs:	register offsets, 32 bit aligned
+ * @vals:	filled in with the register values
+ * @cnt:	number of registers
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_bar_read(struct qdmautils_bar *bar, const unsigned int *regs,
+		       unsigned int *vals, unsigned int cnt);
+
+/*****************************************************************************/
+/**
+ * qdmautils_bar_write() - write registers, in order
+ *
+ * @bar:	BAR handle
+ * @regs:	register offsets, 32 bit aligned
+ * @vals:	register values
+ * @cnt:	number of registers
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_bar_write(struct qdmautils_bar *bar, const unsigned int *regs,
+			const unsigned int *vals, unsigned int cnt);
+
+/**
+ * struct qdmautils_cpu_snap - sample of the cpu time spent on the host
+ *
+ * System wide times are in clock ticks summed over all cpus, the kernel
+ * thread times are the utime + stime of the threads alive at the time of
+ * the sample.
+ */
+struct qdmautils_cpu_snap {
+	/** @wall_ns: CLOCK_MONOTONIC time of the sample */
+	unsigned long long wall_ns;
+	/** @proc_us: cpu time of the process and its waited for children */
+	unsigned long long proc_us;
+	/** @user: user + nice time of all cpus */
+	unsigned long long user;
+	/** @system: system time of all cpus */
+	unsigned long long system;
+	/** @irq: hard interrupt time of all cpus */
+	unsigned long long irq;
+	/** @softirq: softirq time of all cpus */
+	unsigned long long softirq;
+	/** @ksoftirqd: ksoftirqd threads */
+	unsigned long long ksoftirqd;
+	/** @kworker: kworker threads */
+	unsigned long long kworker;
+	/** @qdma_thrd: qdma kernel threads, e.g. qdma_cmpl_status_th */
+	unsigned long long qdma_thrd;
+	/** @intr: interrupt count of the vectors matching the device name */
+	unsigned long long intr;
+};
+
+/*****************************************************************************/
+/**
+ * qdmautils_cpu_snapshot() - sample the process and system wide cpu time,
+ *			      the kernel thread time and the interrupt count
+ *			      of the device vectors
+ *
+ * @snap:	filled in with the sample
+ * @intr_name:	count the interrupts of the vectors whose name contains
+ *		this string, e.g. qdma01000, NULL to skip
+ *
+ * Return:	0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdmautils_cpu_snapshot(struct qdmautils_cpu_snap *snap,
+			   const char *intr_name);
+
+/*****************************************************************************/
+/**
+ * qdmautils_cpu_report() - print the cpu cost of the work done between two
+ *			    samples: cpu time, cores used, interrupts, cycles
+ *			    per byte and per request and cores per Gbps
+ *
+ * @start:	sample taken before the run
+ * @end:	sample taken after the run
+ * @bytes:	bytes transferred during the run
+ * @reqs:	requests completed during the run
+ * @cpu_mhz:	cpu clock used to convert time to cycles, 0 to take the
+ *		average clock from /proc/cpuinfo
+ *
+ * Return:	Nothing
+ *
+ *****************************************************************************/
+void qdmautils_cpu_report(struct qdmautils_cpu_snap *start,
+			  struct qdmautils_cpu_snap *end,
+			  unsigned long long bytes, unsigned long long reqs,
+			  unsigned int cpu_mhz);
+
+/*****************************************************************************/
+/**
+ * qdmautils_crc32c() - CRC32C (Castagnoli) of a buffer, with the crc32
+ *			instruction where the cpu has it
+ *
+ * @crc:	crc of the preceding data, 0 to start
+ * @buf:	data
+ * @len:	length of the data in bytes
+ *
+ * Return:	crc of the preceding data followed by buf
+ *
+ *****************************************************************************/
+uint32_t qdmautils_crc32c(uint32_t crc, const void *buf, size_t len);
+
 #endif /* QDMAUTILS_H */
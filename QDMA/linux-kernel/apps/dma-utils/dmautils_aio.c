@@ -0,0 +1,220 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2019 - 2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <libaio.h>
+#include <sys/eventfd.h>
+
+#include "dmautils.h"
+
+/*
+ * Queue handle: one cdev fd, one AIO context set up at open time and
+ * an iocb per slot. Free slots are kept on a stack, so submit and reap
+ * cost O(1) per transfer and no memory is allocated after open.
+ */
+struct qdmautils_q {
+	int fd;
+	int efd;
+	io_context_t ctxt;
+	unsigned int depth;
+	unsigned int outstanding;
+	/* protects the free slot stack and outstanding, the events array
+	 * belongs to the single reaper
+	 */
+	pthread_mutex_t lock;
+	unsigned int free_cnt;
+	unsigned int *free_slots;
+	struct iocb *iocbs;
+	struct iocb **iocbps;
+	struct io_event *events;
+};
+
+static void q_free(struct qdmautils_q *q)
+{
+	free(q->events);
+	free(q->iocbps);
+	free(q->iocbs);
+	free(q->free_slots);
+	free(q);
+}
+
+int qdmautils_q_open(const char *filename, unsigned int depth,
+		     struct qdmautils_q **qh)
+{
+	struct qdmautils_q *q;
+	unsigned int i;
+	int ret;
+
+	if (!filename || !depth || !qh)
+		return -EINVAL;
+
+	q = calloc(1, sizeof(*q));
+	if (!q)
+		return -ENOMEM;
+	q->depth = depth;
+	q->free_slots = calloc(depth, sizeof(*q->free_slots));
+	q->iocbs = calloc(depth, sizeof(*q->iocbs));
+	q->iocbps = calloc(depth, sizeof(*q->iocbps));
+	q->events = calloc(depth, sizeof(*q->events));
+	if (!q->free_slots || !q->iocbs || !q->iocbps || !q->events) {
+		q_free(q);
+		return -ENOMEM;
+	}
+	for (i = 0; i < depth; i++)
+		q->free_slots[i] = depth - 1 - i;
+	q->free_cnt = depth;
+
+	q->fd = open(filename, O_RDWR);
+	if (q->fd < 0) {
+		ret = -errno;
+		printf("Error: Cannot open %s, %d\n", filename, ret);
+		q_free(q);
+		return ret;
+	}
+
+	q->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (q->efd < 0) {
+		ret = -errno;
+		close(q->fd);
+		q_free(q);
+		return ret;
+	}
+
+	ret = io_setup(depth, &q->ctxt);
+	if (ret < 0) {
+		printf("Error: io_setup error %d on %s\n", ret, filename);
+		close(q->efd);
+		close(q->fd);
+		q_free(q);
+		return ret;
+	}
+
+	pthread_mutex_init(&q->lock, NULL);
+	*qh = q;
+
+	return 0;
+}
+
+void qdmautils_q_close(struct qdmautils_q *q)
+{
+	struct qdmautils_io *iov[64];
+
+	if (!q)
+		return;
+
+	while (q->outstanding) {
+		if (qdmautils_q_reap(q, iov, 1, 64, -1) < 0)
+			break;
+	}
+
+	io_destroy(q->ctxt);
+	pthread_mutex_destroy(&q->lock);
+	close(q->efd);
+	close(q->fd);
+	q_free(q);
+}
+
+int qdmautils_q_eventfd(struct qdmautils_q *q)
+{
+	return q->efd;
+}
+
+int qdmautils_q_submit(struct qdmautils_q *q, struct qdmautils_io **iov,
+		       unsigned int cnt)
+{
+	unsigned int n;
+	unsigned int i;
+	int ret;
+
+	if (!q || !iov)
+		return -EINVAL;
+
+	pthread_mutex_lock(&q->lock);
+	n = cnt < q->free_cnt ? cnt : q->free_cnt;
+	for (i = 0; i < n; i++) {
+		struct iocb *iocb = &q->iocbs[q->free_slots[--q->free_cnt]];
+		struct qdmautils_io *io = iov[i];
+
+		if (io->dir == DMAXFER_IO_WRITE)
+			io_prep_pwrite(iocb, q->fd, io->buf, io->len,
+				       io->ep_addr);
+		else
+			io_prep_pread(iocb, q->fd, io->buf, io->len,
+				      io->ep_addr);
+		io_set_eventfd(iocb, q->efd);
+		iocb->data = io;
+		q->iocbps[i] = iocb;
+	}
+	q->outstanding += n;
+
+	ret = n ? io_submit(q->ctxt, n, q->iocbps) : 0;
+
+	/* give back the slots of what the kernel did not take */
+	for (i = ret < 0 ? 0 : ret; i < n; i++) {
+		q->free_slots[q->free_cnt++] = q->iocbps[i] - q->iocbs;
+		q->outstanding--;
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	return ret;
+}
+
+int qdmautils_q_reap(struct qdmautils_q *q, struct qdmautils_io **iov,
+		     unsigned int min, unsigned int max, int timeout_ms)
+{
+	struct timespec ts;
+	int ret;
+	int i;
+
+	if (!q || !iov || min > max)
+		return -EINVAL;
+	if (max > q->depth)
+		max = q->depth;
+	if (min > max)
+		min = max;
+
+	ts.tv_sec = timeout_ms / 1000;
+	ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+	ret = io_getevents(q->ctxt, min, max, q->events,
+			   timeout_ms < 0 ? NULL : &ts);
+	if (ret <= 0)
+		return ret;
+
+	pthread_mutex_lock(&q->lock);
+	for (i = 0; i < ret; i++) {
+		struct io_event *ev = &q->events[i];
+		struct qdmautils_io *io = ev->data;
+
+		/* the cdev completes with the number of segments done and
+		 * the error in res2
+		 */
+		if ((long)ev->res2 < 0)
+			io->res = (long)ev->res2;
+		else if ((long)ev->res > 0)
+			io->res = io->len;
+		else
+			io->res = -EIO;
+		iov[i] = io;
+		q->free_slots[q->free_cnt++] = (struct iocb *)ev->obj -
+						q->iocbs;
+	}
+	q->outstanding -= ret;
+	pthread_mutex_unlock(&q->lock);
+
+	return ret;
+}
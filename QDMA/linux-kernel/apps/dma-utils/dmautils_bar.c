@@ -0,0 +1,124 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2019 - 2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dmautils.h"
+
+/*
+ * BAR handle: the whole BAR mapped once through its sysfs resource file,
+ * register accesses are plain loads and stores with no system call.
+ */
+struct qdmautils_bar {
+	volatile uint32_t *base;
+	size_t len;
+	int writable;
+};
+
+int qdmautils_bar_open(unsigned char pci_bus, unsigned char pci_dev,
+		       unsigned char dev_func, unsigned int barno,
+		       struct qdmautils_bar **barp)
+{
+	struct qdmautils_bar *bar;
+	char fname[256];
+	struct stat st;
+	void *base;
+	int writable = 1;
+	int fd;
+
+	snprintf(fname, sizeof(fname),
+		 "/sys/bus/pci/devices/0000:%02x:%02x.%x/resource%u",
+		 pci_bus, pci_dev, dev_func, barno);
+
+	fd = open(fname, O_RDWR | O_SYNC);
+	if (fd < 0) {
+		writable = 0;
+		fd = open(fname, O_RDONLY | O_SYNC);
+		if (fd < 0)
+			return -errno;
+	}
+	if (fstat(fd, &st) < 0 || !st.st_size) {
+		close(fd);
+		return -ENODEV;
+	}
+
+	base = mmap(NULL, st.st_size,
+		    writable ? PROT_READ | PROT_WRITE : PROT_READ,
+		    MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return -errno;
+
+	bar = calloc(1, sizeof(*bar));
+	if (!bar) {
+		munmap(base, st.st_size);
+		return -ENOMEM;
+	}
+	bar->base = base;
+	bar->len = st.st_size;
+	bar->writable = writable;
+	*barp = bar;
+
+	return 0;
+}
+
+void qdmautils_bar_close(struct qdmautils_bar *bar)
+{
+	if (!bar)
+		return;
+	munmap((void *)bar->base, bar->len);
+	free(bar);
+}
+
+static int bar_reg_valid(struct qdmautils_bar *bar, unsigned int reg)
+{
+	/* reg + 4 would wrap for the last dwords of the address space */
+	return !(reg & 0x3) && bar->len >= 4 && reg <= bar->len - 4;
+}
+
+int qdmautils_bar_read(struct qdmautils_bar *bar, const unsigned int *regs,
+		       unsigned int *vals, unsigned int cnt)
+{
+	unsigned int i;
+
+	for (i = 0; i < cnt; i++) {
+		if (!bar_reg_valid(bar, regs[i]))
+			return -EINVAL;
+		vals[i] = le32toh(bar->base[regs[i] / 4]);
+	}
+
+	return 0;
+}
+
+int qdmautils_bar_write(struct qdmautils_bar *bar, const unsigned int *regs,
+			const unsigned int *vals, unsigned int cnt)
+{
+	unsigned int i;
+
+	if (!bar->writable)
+		return -EPERM;
+
+	for (i = 0; i < cnt; i++) {
+		if (!bar_reg_valid(bar, regs[i]))
+			return -EINVAL;
+		bar->base[regs[i] / 4] = htole32(vals[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2019 - 2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+
+#include "dmautils.h"
+
+int qdmautils_cdev_stripe(int fd, unsigned int stripe_len,
+			  const unsigned int *qidx, unsigned int q_cnt)
+{
+	struct qdma_cdev_stripe_conf conf;
+	unsigned int i;
+
+	if (q_cnt > QDMA_CDEV_STRIPE_Q_MAX)
+		return -EINVAL;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.stripe_len = stripe_len;
+	conf.q_cnt = q_cnt;
+	for (i = 0; i < q_cnt; i++)
+		conf.qidx[i] = qidx[i];
+
+	if (ioctl(fd, QDMA_CDEV_IOCTL_STRIPE, &conf) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int qdmautils_cdev_rw_vec(int fd, struct qdmautils_io *iov, unsigned int cnt,
+			  unsigned int timeout_ms)
+{
+	struct qdma_cdev_rw_vec_elem *elems;
+	struct qdma_cdev_rw_vec vec;
+	unsigned int i;
+	int ret;
+
+	if (!cnt || cnt > QDMA_CDEV_RW_VEC_MAX)
+		return -EINVAL;
+
+	elems = calloc(cnt, sizeof(*elems));
+	if (!elems)
+		return -ENOMEM;
+	for (i = 0; i < cnt; i++) {
+		elems[i].buf = (uintptr_t)iov[i].buf;
+		elems[i].len = iov[i].len;
+		elems[i].ep_addr = iov[i].ep_addr;
+	}
+
+	memset(&vec, 0, sizeof(vec));
+	vec.elems = (uintptr_t)elems;
+	vec.count = cnt;
+	vec.write = (iov[0].dir == DMAXFER_IO_WRITE);
+	vec.timeout_ms = timeout_ms;
+
+	ret = ioctl(fd, QDMA_CDEV_IOCTL_RW_VEC, &vec);
+	if (ret < 0) {
+		ret = -errno;
+		/* the statuses are copied out on a timeout or signal too */
+		if ((ret != -ETIMEDOUT) && (ret != -EINTR)) {
+			free(elems);
+			return ret;
+		}
+	}
+	for (i = 0; i < cnt; i++)
+		iov[i].res = elems[i].status;
+	free(elems);
+
+	return ret;
+}
+
+int qdmautils_cdev_cmpt_read(int fd, void *buf, unsigned int len,
+			     unsigned int *entry_len)
+{
+	struct qdma_cdev_cmpt_read crd;
+	int ret;
+
+	memset(&crd, 0, sizeof(crd));
+	crd.buf = (uintptr_t)buf;
+	crd.len = len;
+
+	ret = ioctl(fd, QDMA_CDEV_IOCTL_CMPT_READ, &crd);
+	if (ret < 0)
+		return -errno;
+	if (entry_len)
+		*entry_len = crd.entry_len;
+
+	return ret;
+}
+
+int qdmautils_cdev_arb_conf(int fd, unsigned long long inflight_max)
+{
+	struct qdma_cdev_arb_conf conf = {
+		.inflight_max = inflight_max,
+	};
+
+	if (ioctl(fd, QDMA_CDEV_IOCTL_ARB_CONF, &conf) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int qdmautils_cdev_weight(int fd, unsigned int weight)
+{
+	__u32 w = weight;
+
+	if (ioctl(fd, QDMA_CDEV_IOCTL_CTX_WEIGHT, &w) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int qdmautils_cdev_stats(int fd, struct qdma_cdev_ctx_stats *stats)
+{
+	if (ioctl(fd, QDMA_CDEV_IOCTL_CTX_STATS, stats) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int qdmautils_cdev_xfer_prep(int fd, struct qdmautils_io *io,
+			     unsigned int *id)
+{
+	struct qdma_cdev_xfer_prep prep;
+
+	memset(&prep, 0, sizeof(prep));
+	prep.buf = (uintptr_t)io->buf;
+	prep.ep_addr = io->ep_addr;
+	prep.len = io->len;
+	prep.write = (io->dir == DMAXFER_IO_WRITE);
+
+	if (ioctl(fd, QDMA_CDEV_IOCTL_XFER_PREP, &prep) < 0)
+		return -errno;
+	*id = prep.id;
+
+	return 0;
+}
+
+int qdmautils_cdev_xfer_submit(int fd, unsigned int id)
+{
+	__u32 xid = id;
+	int ret;
+
+	ret = ioctl(fd, QDMA_CDEV_IOCTL_XFER_SUBMIT, &xid);
+	if (ret < 0)
+		return -errno;
+
+	return ret;
+}
+
+int qdmautils_cdev_xfer_release(int fd, unsigned int id)
+{
+	__u32 xid = id;
+
+	if (ioctl(fd, QDMA_CDEV_IOCTL_XFER_RELEASE, &xid) < 0)
+		return -errno;
+
+	return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2019 - 2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "dmautils.h"
+
+#define KTHREADD_PID	2
+
+static unsigned long long tv_us(struct timeval *tv)
+{
+	return (unsigned long long)tv->tv_sec * 1000000ULL + tv->tv_usec;
+}
+
+/* kernel thread totals go down when a thread exits during the run */
+static unsigned long long delta(unsigned long long start,
+				unsigned long long end)
+{
+	return end > start ? end - start : 0;
+}
+
+static int cpu_stat_read(struct qdmautils_cpu_snap *snap)
+{
+	unsigned long long user, nice, system, idle, iowait, irq, softirq;
+	FILE *fp;
+	int rv;
+
+	fp = fopen("/proc/stat", "r");
+	if (!fp)
+		return -errno;
+	rv = fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu", &user,
+		    &nice, &system, &idle, &iowait, &irq, &softirq);
+	fclose(fp);
+	if (rv != 7)
+		return -EINVAL;
+
+	snap->user = user + nice;
+	snap->system = system;
+	snap->irq = irq;
+	snap->softirq = softirq;
+
+	return 0;
+}
+
+/*
+ * Kernel threads are children of kthreadd. A kworker that exits during the
+ * run takes its time with it, so the kworker time is a lower bound.
+ */
+static void cpu_kthread_read(struct qdmautils_cpu_snap *snap)
+{
+	DIR *dir;
+	struct dirent *de;
+	char path[300];
+	char buf[512];
+
+	dir = opendir("/proc");
+	if (!dir)
+		return;
+
+	while ((de = readdir(dir)) != NULL) {
+		unsigned long long utime, stime;
+		char *comm, *p;
+		int ppid;
+		FILE *fp;
+
+		if (!isdigit(de->d_name[0]))
+			continue;
+		snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
+		fp = fopen(path, "r");
+		if (!fp)
+			continue;
+		p = fgets(buf, sizeof(buf), fp);
+		fclose(fp);
+		if (!p)
+			continue;
+
+		/* pid (comm) state ppid ..., comm may contain blanks */
+		comm = strchr(buf, '(');
+		p = strrchr(buf, ')');
+		if (!comm || !p)
+			continue;
+		comm++;
+		*p = '\0';
+		if (sscanf(p + 1, " %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+			   "%llu %llu", &ppid, &utime, &stime) != 3)
+			continue;
+		if (ppid != KTHREADD_PID)
+			continue;
+
+		if (!strncmp(comm, "ksoftirqd/", 10))
+			snap->ksoftirqd += utime + stime;
+		else if (!strncmp(comm, "kworker/", 8))
+			snap->kworker += utime + stime;
+		else if (!strncmp(comm, "qdma", 4))
+			snap->qdma_thrd += utime + stime;
+	}
+	closedir(dir);
+}
+
+static void cpu_intr_read(struct qdmautils_cpu_snap *snap,
+			  const char *intr_name)
+{
+	FILE *fp;
+	char *line = NULL;
+	size_t len = 0;
+
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return;
+
+	while (getline(&line, &len, fp) != -1) {
+		char *p, *end;
+		unsigned long long cnt;
+
+		if (!strstr(line, intr_name))
+			continue;
+		p = strchr(line, ':');
+		if (!p)
+			continue;
+		/* one count per cpu, up to the chip and action names */
+		for (p++; ; p = end) {
+			cnt = strtoull(p, &end, 10);
+			if (end == p)
+				break;
+			snap->intr += cnt;
+		}
+	}
+	free(line);
+	fclose(fp);
+}
+
+static unsigned int cpu_mhz_read(void)
+{
+	FILE *fp;
+	char buf[256];
+	double mhz, sum = 0;
+	unsigned int n = 0;
+
+	fp = fopen("/proc/cpuinfo", "r");
+	if (!fp)
+		return 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (sscanf(buf, "cpu MHz : %lf", &mhz) == 1) {
+			sum += mhz;
+			n++;
+		}
+	}
+	fclose(fp);
+
+	return n ? (unsigned int)(sum / n + 0.5) : 0;
+}
+
+int qdmautils_cpu_snapshot(struct qdmautils_cpu_snap *snap,
+			   const char *intr_name)
+{
+	struct timespec ts;
+	struct rusage ru;
+	int rv;
+
+	memset(snap, 0, sizeof(*snap));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	snap->wall_ns = (unsigned long long)ts.tv_sec * 1000000000ULL +
+			ts.tv_nsec;
+
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		snap->proc_us += tv_us(&ru.ru_utime) + tv_us(&ru.ru_stime);
+	if (getrusage(RUSAGE_CHILDREN, &ru) == 0)
+		snap->proc_us += tv_us(&ru.ru_utime) + tv_us(&ru.ru_stime);
+
+	rv = cpu_stat_read(snap);
+	if (rv < 0)
+		return rv;
+	cpu_kthread_read(snap);
+	if (intr_name)
+		cpu_intr_read(snap, intr_name);
+
+	return 0;
+}
+
+void qdmautils_cpu_report(struct qdmautils_cpu_snap *start,
+			  struct qdmautils_cpu_snap *end,
+			  unsigned long long bytes, unsigned long long reqs,
+			  unsigned int cpu_mhz)
+{
+	double hz = (double)sysconf(_SC_CLK_TCK);
+	double wall = (end->wall_ns - start->wall_ns) / 1e9;
+	double user = (end->user - start->user) / hz;
+	double system = (end->system - start->system) / hz;
+	double irq = (end->irq - start->irq) / hz;
+	double softirq = (end->softirq - start->softirq) / hz;
+	double busy = user + system + irq + softirq;
+	double cores = wall > 0 ? busy / wall : 0;
+	double gbps = wall > 0 ? bytes * 8 / wall / 1e9 : 0;
+	double cycles;
+
+	if (!cpu_mhz)
+		cpu_mhz = cpu_mhz_read();
+	cycles = busy * cpu_mhz * 1e6;
+
+	printf("CPU busy = %.3f s, cores = %.3f, user = %.3f s, sys = %.3f s, "
+	       "irq = %.3f s, softirq = %.3f s\n",
+	       busy, cores, user, system, irq, softirq);
+	printf("CPU process = %.3f s, ksoftirqd = %.3f s, kworker = %.3f s, "
+	       "qdma_thrd = %.3f s\n",
+	       (end->proc_us - start->proc_us) / 1e6,
+	       delta(start->ksoftirqd, end->ksoftirqd) / hz,
+	       delta(start->kworker, end->kworker) / hz,
+	       delta(start->qdma_thrd, end->qdma_thrd) / hz);
+	printf("CPU intr = %llu, intr/s = %.0f\n", end->intr - start->intr,
+	       wall > 0 ? (end->intr - start->intr) / wall : 0);
+	printf("CPU MHz = %u, cycles/byte = %.3f, cycles/req = %.1f, "
+	       "cores/Gbps = %.4f\n", cpu_mhz,
+	       bytes ? cycles / bytes : 0, reqs ? cycles / reqs : 0,
+	       gbps > 0 ? cores / gbps : 0);
+}
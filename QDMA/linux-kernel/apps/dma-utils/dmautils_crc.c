@@ -0,0 +1,112 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2019 - 2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <endian.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "dmautils.h"
+
+/* CRC32C (Castagnoli), reflected */
+#define CRC32C_POLY	0x82F63B78
+
+static uint32_t crc32c_tbl[8][256];
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+static uint32_t (*crc32c_fn)(uint32_t crc, const unsigned char *p, size_t len);
+
+/* slicing-by-8, for cpus without a crc32 instruction */
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len)
+{
+	while (len && ((uintptr_t)p & 7)) {
+		crc = crc32c_tbl[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		len--;
+	}
+	while (len >= 8) {
+		uint64_t v;
+
+		memcpy(&v, p, 8);
+		v = le64toh(v) ^ crc;
+		crc = crc32c_tbl[7][v & 0xFF] ^
+		      crc32c_tbl[6][(v >> 8) & 0xFF] ^
+		      crc32c_tbl[5][(v >> 16) & 0xFF] ^
+		      crc32c_tbl[4][(v >> 24) & 0xFF] ^
+		      crc32c_tbl[3][(v >> 32) & 0xFF] ^
+		      crc32c_tbl[2][(v >> 40) & 0xFF] ^
+		      crc32c_tbl[1][(v >> 48) & 0xFF] ^
+		      crc32c_tbl[0][v >> 56];
+		p += 8;
+		len -= 8;
+	}
+	while (len--)
+		crc = crc32c_tbl[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+	return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len)
+{
+	uint64_t crc64;
+
+	while (len && ((uintptr_t)p & 7)) {
+		crc = __builtin_ia32_crc32qi(crc, *p++);
+		len--;
+	}
+	crc64 = crc;
+	while (len >= 8) {
+		uint64_t v;
+
+		memcpy(&v, p, 8);
+		crc64 = __builtin_ia32_crc32di(crc64, v);
+		p += 8;
+		len -= 8;
+	}
+	crc = (uint32_t)crc64;
+	while (len--)
+		crc = __builtin_ia32_crc32qi(crc, *p++);
+
+	return crc;
+}
+#endif
+
+static void crc32c_init(void)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < 256; i++) {
+		uint32_t crc = i;
+
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+		crc32c_tbl[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			crc32c_tbl[j][i] = (crc32c_tbl[j - 1][i] >> 8) ^
+					   crc32c_tbl[0][crc32c_tbl[j - 1][i] & 0xFF];
+
+	crc32c_fn = crc32c_sw;
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.2"))
+		crc32c_fn = crc32c_sse42;
+#endif
+}
+
+uint32_t qdmautils_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	pthread_once(&crc32c_once, crc32c_init);
+
+	return ~crc32c_fn(~crc, buf, len);
+}
@@ -48,25 +48,27 @@ struct dmaxfer_perf_handle {
 	int *child_pid_lst;
 };
 
-struct dma_meminfo {
-	void *memptr;
-	unsigned int num_blks;
-};
-
 enum dmaio_direction {
 	DMAIO_READ,
 	DMAIO_WRITE,
 	DMAIO_RDWR,
 };
 
-#define USE_MEMPOOL
+/* pools of at least this size are tried on 2MB hugepages first */
+#define MEMPOOL_HUGEPAGE_SIZE	(2 * 1024 * 1024)
 
 struct mempool_handle {
 	void *mempool;
-	unsigned int mempool_blkidx;
+	/* mmap()ed length if the pool is on hugepages, 0 otherwise */
+	size_t mempool_len;
 	unsigned int mempool_blksz;
 	unsigned int total_memblks;
-	struct dma_meminfo *mempool_info;
+	/* free stack links, per block */
+	unsigned int *next_free;
+	/* free stack of the allocating thread */
+	unsigned int local_free;
+	/* blocks freed, pushed by any thread */
+	unsigned int remote_free;
 #ifdef DEBUG
 	unsigned int id;
 	unsigned int loop;
@@ -115,88 +117,97 @@ static void dump_thrd_info(struct io_info *_info) {
 	printf("dir = %d\n", _info->dir);
 }
 
+/*
+ * Fixed size block pool. Blocks are handed out from a free stack owned by
+ * the allocating (io) thread, blocks freed by any thread are pushed on a
+ * lock-free remote stack that the allocator takes over in one exchange
+ * when its own stack runs empty, so both sides are O(1). Stack entries
+ * are block index + 1, 0 terminates.
+ */
 static int mempool_create(struct mempool_handle *mpool, unsigned int entry_size,
 		unsigned int max_entries)
 {
-#ifdef USE_MEMPOOL
-	if (posix_memalign((void **)&mpool->mempool, DMAPERF_PAGE_SIZE,
-			   max_entries * (entry_size + sizeof(struct dma_meminfo)))) {
+	size_t len = (size_t)max_entries * entry_size;
+	unsigned int i;
+
+	mpool->mempool = MAP_FAILED;
+	mpool->mempool_len = 0;
+	if (len >= MEMPOOL_HUGEPAGE_SIZE) {
+		size_t hlen = (len + MEMPOOL_HUGEPAGE_SIZE - 1) &
+				~((size_t)MEMPOOL_HUGEPAGE_SIZE - 1);
+
+		/* falls back to normal pages if none are reserved */
+		mpool->mempool = mmap(NULL, hlen, PROT_READ | PROT_WRITE,
+				      MAP_PRIVATE | MAP_ANONYMOUS |
+				      MAP_HUGETLB | MAP_POPULATE, -1, 0);
+		if (mpool->mempool != MAP_FAILED)
+			mpool->mempool_len = hlen;
+	}
+	if (mpool->mempool == MAP_FAILED) {
+		if (posix_memalign((void **)&mpool->mempool,
+				   DMAPERF_PAGE_SIZE, len)) {
+			printf("OOM Mempool\n");
+			return -ENOMEM;
+		}
+		/* pre-fault, the first I/Os should not take page faults */
+		memset(mpool->mempool, 0, len);
+	}
+
+	mpool->next_free = malloc(max_entries * sizeof(unsigned int));
+	if (!mpool->next_free) {
+		if (mpool->mempool_len)
+			munmap(mpool->mempool, mpool->mempool_len);
+		else
+			free(mpool->mempool);
+		mpool->mempool = NULL;
 		printf("OOM Mempool\n");
 		return -ENOMEM;
 	}
-	mpool->mempool_info = (struct dma_meminfo *)(((char *)mpool->mempool) + (max_entries * entry_size));
-#endif
+	for (i = 0; i < max_entries; i++)
+		mpool->next_free[i] = (i + 1 < max_entries) ? i + 2 : 0;
+	mpool->local_free = max_entries ? 1 : 0;
+	mpool->remote_free = 0;
 	mpool->mempool_blksz = entry_size;
 	mpool->total_memblks = max_entries;
-	mpool->mempool_blkidx = 0;
 
 	return 0;
 }
 
 static void mempool_free(struct mempool_handle *mpool)
 {
-#ifdef USE_MEMPOOL
-	free(mpool->mempool);
+	if (mpool->mempool_len)
+		munmap(mpool->mempool, mpool->mempool_len);
+	else
+		free(mpool->mempool);
 	mpool->mempool = NULL;
-#endif
+	free(mpool->next_free);
+	mpool->next_free = NULL;
 }
 
-static void *dma_memalloc(struct mempool_handle *mpool, unsigned int num_blks)
+static void *dma_memalloc(struct mempool_handle *mpool)
 {
-	unsigned int _mempool_blkidx = mpool->mempool_blkidx;
-	unsigned int tmp_blkidx = _mempool_blkidx;
-	unsigned int max_blkcnt = tmp_blkidx + num_blks;
-	unsigned int i, avail = 0;
-	void *memptr = NULL;
-	char *mempool = mpool->mempool;
-	struct dma_meminfo *_mempool_info = mpool->mempool_info;
-	unsigned int _total_memblks = mpool->total_memblks;
-
-#ifdef USE_MEMPOOL
-	if (max_blkcnt > _total_memblks) {
-		tmp_blkidx = 0;
-		max_blkcnt = num_blks;
-	}
-	for (i = tmp_blkidx; (i < _total_memblks) && (i < max_blkcnt); i++) {
-		if (_mempool_info[i].memptr) { /* occupied blks ahead */
-			i += _mempool_info[i].num_blks;
-			max_blkcnt = i + num_blks;
-			avail = 0;
-			tmp_blkidx = i;
-		} else
-			avail++;
-		if (max_blkcnt > _total_memblks) { /* reached the end of mempool. circle through*/
-			if (num_blks > _mempool_blkidx) return NULL; /* Continuous num_blks not available */
-			i = 0;
-			avail = 0;
-			max_blkcnt = num_blks;
-			tmp_blkidx = 0;
-		}
-	}
-	if (avail < num_blks) { /* no required available blocks */
+	unsigned int idx;
+
+	if (!mpool->local_free)
+		mpool->local_free = __atomic_exchange_n(&mpool->remote_free, 0,
+							__ATOMIC_ACQUIRE);
+	if (!mpool->local_free)
 		return NULL;
-	}
 
-	memptr = &(mempool[tmp_blkidx * mpool->mempool_blksz]);
-	_mempool_info[tmp_blkidx].memptr = memptr;
-	_mempool_info[tmp_blkidx].num_blks = num_blks;
-	mpool->mempool_blkidx = tmp_blkidx + num_blks;
-#else
-	memptr = calloc(num_blks, mpool->mempool_blksz);
-#endif
+	idx = mpool->local_free - 1;
+	mpool->local_free = mpool->next_free[idx];
 
-	return memptr;
+	return (char *)mpool->mempool + ((size_t)idx * mpool->mempool_blksz);
 }
 
 static void dma_free(struct mempool_handle *mpool, void *memptr)
 {
-#ifdef USE_MEMPOOL
-	struct dma_meminfo *_meminfo = mpool->mempool_info;
 	unsigned int idx;
+	unsigned int head;
 
 	if (!memptr) return;
 
-	idx = (memptr - mpool->mempool)/mpool->mempool_blksz;
+	idx = ((char *)memptr - (char *)mpool->mempool)/mpool->mempool_blksz;
 #ifdef DEBUG
 	if (idx >= mpool->total_memblks) {
 		printf("Asserting: %u:Invalid memory index %u acquired\n", mpool->id, idx);
@@ -204,11 +215,12 @@ static void dma_free(struct mempool_handle *mpool, void *memptr)
 	}
 #endif
 
-	_meminfo[idx].num_blks = 0;
-	_meminfo[idx].memptr = NULL;
-#else
-	free(memptr);
-#endif
+	head = __atomic_load_n(&mpool->remote_free, __ATOMIC_RELAXED);
+	do {
+		mpool->next_free[idx] = head;
+	} while (!__atomic_compare_exchange_n(&mpool->remote_free, &head,
+					      idx + 1, 1, __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
 }
 
 static int dmasetio_info(struct io_info *info, struct dmaxfer_io_info *ptr,
@@ -594,7 +606,7 @@ static void *io_thread(struct io_info *_info)
 			if (ts_cur.tv_sec >= tsecs)
 				break;
 		}
-		node = dma_memalloc(ctxhandle, 1);
+		node = dma_memalloc(ctxhandle);
 		if (!node) {
 			continue;
 		}
@@ -626,7 +638,7 @@ static void *io_thread(struct io_info *_info)
 				continue;
 			}
 
-			io_list[0] = dma_memalloc(iocbhandle, 1);
+			io_list[0] = dma_memalloc(iocbhandle);
 			if (io_list[0] == NULL) {
 				if (cnt) {
 					node->max_events = cnt;
@@ -639,7 +651,7 @@ static void *io_thread(struct io_info *_info)
 			}
 			iov = (struct iovec *)(io_list[0] + 1);
 			for (iovcnt = 0; iovcnt < burst_cnt; iovcnt++) {
-				iov[iovcnt].iov_base = dma_memalloc(datahandle, 1);
+				iov[iovcnt].iov_base = dma_memalloc(datahandle);
 				if (iov[iovcnt].iov_base == NULL)
 					break;
 				iov[iovcnt].iov_len = io_sz;
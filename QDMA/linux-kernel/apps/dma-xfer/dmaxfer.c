@@ -38,6 +38,7 @@
 #define QDMA_ST_MAX_PKT_SIZE 0x7000  
 #define QDMA_RW_MAX_SIZE	0x7ffff000
 #define QDMA_GLBL_MAX_ENTRIES  (16)
+#define QDMA_CMPT_READ_BUF_SZ	(64 * 1024)
 
 static struct queue_info *q_info;
 static int q_count;
@@ -80,6 +81,10 @@ static char output_file[128];
 static int io_type;
 static char trigmode_str[10];
 static unsigned char trig_mode;
+/* stripe size over the queues of q_range, 0: no striping */
+static unsigned int stripe_len;
+/* read the MM completion queues after the transfers */
+static unsigned int cmpt_read;
 
 static struct option const long_opts[] = {
 	{"config", required_argument, NULL, 'c'},
@@ -481,6 +486,16 @@ static int parse_config_file(const char *cfg_fname)
 		} else if (!strncmp(config, "outputfile", 7)) {
 			copy_value(value, output_file, 128);
 			output_file_provided = 1;
+		} else if (!strncmp(config, "stripe_len", 10)) {
+			if (arg_read_int(value, &stripe_len)) {
+				printf("Error: Invalid stripe_len:%s\n", value);
+				goto prase_cleanup;
+			}
+		} else if (!strncmp(config, "cmpt_read", 9)) {
+			if (arg_read_int(value, &cmpt_read)) {
+				printf("Error: Invalid cmpt_read:%s\n", value);
+				goto prase_cleanup;
+			}
 		} else if (!strncmp(config, "io_type", 6)) {
 			if (!strncmp(value, "io_sync", 6))
 				io_type = 0;
@@ -542,6 +557,19 @@ static int parse_config_file(const char *cfg_fname)
 		return -EINVAL;
 	}
 
+	/* only the synchronous read/write is striped */
+	if (stripe_len && ((mode != QDMA_Q_MODE_MM) || io_type ||
+			   (num_q > QDMA_CDEV_STRIPE_Q_MAX))) {
+		printf("Error: stripe_len needs mode=mm, io_type=io_sync and "
+		       "at most %u queues\n", QDMA_CDEV_STRIPE_Q_MAX);
+		return -EINVAL;
+	}
+
+	if (cmpt_read && (mode != QDMA_Q_MODE_MM)) {
+		printf("Error: cmpt_read needs mode=mm\n");
+		return -EINVAL;
+	}
+
 	if (!strcmp(trigmode_str, "every"))
 		trig_mode = 1;
 	else if (!strcmp(trigmode_str, "usr_cnt"))
@@ -1160,6 +1188,83 @@ out:
 	return ret;
 }
 
+/* stripe group of every queue cdev: all the queues of q_range */
+static int qdmautils_stripe(struct queue_info *q_info, unsigned int count,
+		unsigned int len)
+{
+	unsigned int qidx[QDMA_CDEV_STRIPE_Q_MAX];
+	unsigned int q_cnt = len ? num_q : 0;
+	unsigned int i;
+	int fd;
+	int ret;
+
+	for (i = 0; i < q_cnt; i++)
+		qidx[i] = q_start + i;
+
+	for (i = 0; i < count; i++) {
+		fd = open(q_info[i].q_name, O_RDWR);
+		if (fd < 0) {
+			printf("Error: unable to open %s\n", q_info[i].q_name);
+			return -errno;
+		}
+		ret = qdmautils_cdev_stripe(fd, len, qidx, q_cnt);
+		close(fd);
+		if (ret < 0) {
+			printf("Error: stripe %u over %u queues on %s failed, ret :%d\n",
+					len, q_cnt, q_info[i].q_name, ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int qdmautils_cmpt_read(struct queue_info *q_info, unsigned int count)
+{
+	unsigned int entry_len = 0;
+	unsigned char *buf;
+	unsigned int i;
+	int fd;
+	int ret = 0;
+
+	buf = malloc(QDMA_CMPT_READ_BUF_SZ);
+	if (!buf) {
+		printf("Error: OOM %u.\n", QDMA_CMPT_READ_BUF_SZ);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		/* one completion queue per queue index */
+		if (i && !strcmp(q_info[i].q_name, q_info[i - 1].q_name))
+			continue;
+		fd = open(q_info[i].q_name, O_RDWR);
+		if (fd < 0) {
+			printf("Error: unable to open %s\n", q_info[i].q_name);
+			ret = -errno;
+			break;
+		}
+		ret = qdmautils_cdev_cmpt_read(fd, buf, QDMA_CMPT_READ_BUF_SZ,
+				&entry_len);
+		close(fd);
+		if (ret == -ENODEV) {
+			printf("PF :%d Queue :%d has no CMPT queue\n",
+					q_info[i].pf, q_info[i].qid);
+			ret = 0;
+			continue;
+		}
+		if (ret < 0) {
+			printf("Error: CMPT read on %s failed, ret :%d\n",
+					q_info[i].q_name, ret);
+			break;
+		}
+		printf("PF :%d Queue :%d CMPT entries :%d, %u bytes each\n",
+				q_info[i].pf, q_info[i].qid, ret, entry_len);
+	}
+	free(buf);
+
+	return ret < 0 ? ret : 0;
+}
+
 static int qdmautils_xfer(struct queue_info *q_info,
 		unsigned int count, int io_type)
 {
@@ -1257,10 +1362,25 @@ int main(int argc, char *argv[])
 
 	/* queues has to be deleted upon termination */
 	atexit(qdma_env_cleanup);
+	if (stripe_len) {
+		ret = qdmautils_stripe(q_info, q_count, stripe_len);
+		if (ret < 0)
+			return ret;
+	}
+
 	/* Perform DMA transfers on each Queue */
 	ret = qdmautils_xfer(q_info, q_count, io_type);
 	if (ret < 0)
 		printf("Qdmautils Transfer Failed, ret :%d\n", ret);
 
+	if (stripe_len)
+		qdmautils_stripe(q_info, q_count, 0);
+
+	if ((ret >= 0) && cmpt_read) {
+		ret = qdmautils_cmpt_read(q_info, q_count);
+		if (ret < 0)
+			printf("Qdmautils CMPT read Failed, ret :%d\n", ret);
+	}
+
 	return ret;
 }
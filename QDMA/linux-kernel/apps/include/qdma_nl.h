@@ -68,13 +68,98 @@
 #define XNL_F_CMPT_OVF_CHK_DIS	0x00004000
 /** Q parameter: Completion Queue? */
 #define XNL_F_Q_CMPL         0x00008000
+/** Q parameter: may borrow unused function bandwidth above its rate */
+#define XNL_F_RL_BORROW      0x00010000
+/** Q parameter: high priority completion service class */
+#define XNL_F_Q_PRIO_HIGH    0x00020000
 
 /** maximum number of queue flags to control queue configuration*/
-#define MAX_QFLAGS 17
+#define MAX_QFLAGS 18
 
 /** maximum number of interrupt ring entries*/
 #define QDMA_MAX_INT_RING_ENTRIES 512
 
+/** layout version of the XNL_CMD_DEV_STAT_BIN attributes */
+#define XNL_STAT_BIN_VERSION	2
+/** number of completion latency buckets in struct xnl_q_stat_bin */
+#define XNL_STAT_BIN_LAT_BUCKETS	16
+/** max. queue entries returned by one XNL_CMD_DEV_STAT_BIN */
+#define XNL_STAT_BIN_Q_MAX	256
+
+/**
+ * xnl_dev_stat_bin - XNL_ATTR_DEV_STAT_BIN payload
+ *
+ * fixed width, naturally aligned fields; new fields are only ever
+ * appended and announced through version
+ */
+struct xnl_dev_stat_bin {
+	/** XNL_STAT_BIN_VERSION */
+	unsigned int version;
+	/** sizeof(struct xnl_q_stat_bin) of the sender */
+	unsigned int q_stat_size;
+	/** CLOCK_MONOTONIC time of the snapshot in ns */
+	unsigned long long timestamp_ns;
+	/** mm h2c packets processed */
+	unsigned long long mm_h2c_pkts;
+	/** mm c2h packets processed */
+	unsigned long long mm_c2h_pkts;
+	/** st h2c packets processed */
+	unsigned long long st_h2c_pkts;
+	/** st c2h packets processed */
+	unsigned long long st_c2h_pkts;
+	/** min ping pong latency in cpu ticks */
+	unsigned long long ping_pong_lat_min;
+	/** max ping pong latency in cpu ticks */
+	unsigned long long ping_pong_lat_max;
+	/** total ping pong latency in cpu ticks */
+	unsigned long long ping_pong_lat_total;
+	/** number of entries in XNL_ATTR_Q_STAT_BIN */
+	unsigned int q_cnt;
+	/** first queue index not covered, request again from here,
+	 *  XNL_QIDX_INVALID once the requested range is complete */
+	unsigned int qidx_next;
+	/** function rate limit in Mbit/s, 0: unlimited, version 2 */
+	unsigned int rl_rate_mbps;
+	/** function rate limit bucket depth in bytes, version 2 */
+	unsigned int rl_burst;
+	/** times a queue was held back by the function limit, version 2 */
+	unsigned long long rl_fn_throttled;
+};
+
+/**
+ * xnl_q_stat_bin - one XNL_ATTR_Q_STAT_BIN entry
+ */
+struct xnl_q_stat_bin {
+	/** queue index */
+	unsigned int qidx;
+	/** queue type, 0: h2c, 1: c2h, 2: cmpt */
+	unsigned char q_type;
+	/** 1: streaming mode, 0: memory mapped mode */
+	unsigned char st;
+	/** reserved */
+	unsigned short rsvd;
+	/** packets/requests completed */
+	unsigned long long pkts;
+	/** bytes transferred */
+	unsigned long long bytes;
+	/** descriptors completed */
+	unsigned long long descs;
+	/** pidx doorbell writes */
+	unsigned long long doorbells;
+	/** data interrupts serviced */
+	unsigned long long irqs;
+	/** requests/completions finished with an error */
+	unsigned long long errors;
+	/** completion latency, bucket n counts [2^(n-1), 2^n) us */
+	unsigned long long lat_bucket[XNL_STAT_BIN_LAT_BUCKETS];
+	/** times the queue was held back by a rate limit, version 2 */
+	unsigned long long rl_throttled;
+	/** time spent held back by a rate limit in ns, version 2 */
+	unsigned long long rl_throttle_ns;
+	/** bytes posted on bandwidth borrowed from the function, version 2 */
+	unsigned long long rl_borrowed;
+};
+
 /**
  * xnl_attr_t netlink attributes for qdma(variables):
  * the index in this enum is used as a reference for the type,
@@ -167,6 +252,10 @@ enum xnl_attr_t {
 	XNL_ATTR_QPARAM_ERR_INFO,	/**< queue param info */
 #endif
 	XNL_ATTR_NUM_REGS,			/**< number of regs */
+	XNL_ATTR_DEV_STAT_BIN,		/**< struct xnl_dev_stat_bin */
+	XNL_ATTR_Q_STAT_BIN,		/**< array of struct xnl_q_stat_bin */
+	XNL_ATTR_RL_RATE,		/**< rate limit in Mbit/s */
+	XNL_ATTR_RL_BURST,		/**< rate limit bucket depth in bytes */
 	XNL_ATTR_MAX,
 };
 
@@ -309,6 +398,8 @@ enum xnl_op_t {
 	XNL_CMD_GLOBAL_CSR,	/**< get all global csr register values */
 	XNL_CMD_DEV_CAP,	/**< list h/w capabilities , hw and sw version */
 	XNL_CMD_GET_Q_STATE,	/**< get the queue state */
+	XNL_CMD_DEV_STAT_BIN,	/**< device and queue statistics, binary */
+	XNL_CMD_RATE_LIMIT,	/**< set the queue or function rate limit */
 	XNL_CMD_MAX,		/**< max number of XNL commands*/
 };
 
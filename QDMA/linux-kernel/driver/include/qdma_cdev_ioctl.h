@@ -0,0 +1,215 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef QDMA_CDEV_IOCTL_H__
+#define QDMA_CDEV_IOCTL_H__
+/**
+ * @file
+ * @brief This file contains the ioctl interface of the qdma queue character
+ *	  devices, shared by the driver and the applications
+ *
+ */
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/** qdma queue cdev ioctl type */
+#define QDMA_CDEV_IOC_MAGIC		'q'
+
+/** set no memcpy, argument: unsigned char, the number predates the
+ *  encoded commands and is kept for the existing applications
+ */
+#define QDMA_CDEV_IOCTL_NO_MEMCPY	0
+/** stripe read/write over a queue group, struct qdma_cdev_stripe_conf */
+#define QDMA_CDEV_IOCTL_STRIPE		\
+	_IOW(QDMA_CDEV_IOC_MAGIC, 1, struct qdma_cdev_stripe_conf)
+/** vectored read/write, struct qdma_cdev_rw_vec */
+#define QDMA_CDEV_IOCTL_RW_VEC		\
+	_IOW(QDMA_CDEV_IOC_MAGIC, 2, struct qdma_cdev_rw_vec)
+/** bulk completion read, struct qdma_cdev_cmpt_read */
+#define QDMA_CDEV_IOCTL_CMPT_READ	\
+	_IOWR(QDMA_CDEV_IOC_MAGIC, 3, struct qdma_cdev_cmpt_read)
+/** queue arbitration ring budget, struct qdma_cdev_arb_conf */
+#define QDMA_CDEV_IOCTL_ARB_CONF	\
+	_IOW(QDMA_CDEV_IOC_MAGIC, 4, struct qdma_cdev_arb_conf)
+/** arbitration weight of the open file, __u32 */
+#define QDMA_CDEV_IOCTL_CTX_WEIGHT	\
+	_IOW(QDMA_CDEV_IOC_MAGIC, 5, __u32)
+/** counters of the open file, struct qdma_cdev_ctx_stats */
+#define QDMA_CDEV_IOCTL_CTX_STATS	\
+	_IOR(QDMA_CDEV_IOC_MAGIC, 6, struct qdma_cdev_ctx_stats)
+/** prepare a MM transfer for repeated submission,
+ *  struct qdma_cdev_xfer_prep
+ */
+#define QDMA_CDEV_IOCTL_XFER_PREP	\
+	_IOWR(QDMA_CDEV_IOC_MAGIC, 7, struct qdma_cdev_xfer_prep)
+/** submit a prepared transfer and wait for it, __u32 id, returns the
+ *  bytes transferred
+ */
+#define QDMA_CDEV_IOCTL_XFER_SUBMIT	\
+	_IOW(QDMA_CDEV_IOC_MAGIC, 8, __u32)
+/** release a prepared transfer, __u32 id */
+#define QDMA_CDEV_IOCTL_XFER_RELEASE	\
+	_IOW(QDMA_CDEV_IOC_MAGIC, 9, __u32)
+
+/** max. number of queues in a stripe group */
+#define QDMA_CDEV_STRIPE_Q_MAX		16
+/** max. number of elements in a vectored transfer */
+#define QDMA_CDEV_RW_VEC_MAX		4096
+/** default weight of an open file in the queue arbitration */
+#define QDMA_CDEV_WEIGHT_DEFAULT	100
+/** max. weight of an open file in the queue arbitration */
+#define QDMA_CDEV_WEIGHT_MAX		10000
+/** max. prepared transfers of an open file */
+#define QDMA_CDEV_XFER_MAX		64
+
+/**
+ * @struct - qdma_cdev_stripe_conf
+ * @brief	QDMA_CDEV_IOCTL_STRIPE argument: stripe the cdev's read/write
+ *		over a group of started MM queues, q_cnt 0 turns striping off
+ */
+struct qdma_cdev_stripe_conf {
+	/** stripe size in bytes */
+	__u32 stripe_len;
+	/** number of queues in the group */
+	__u32 q_cnt;
+	/** queue indexes, the group includes the cdev's own queue only if
+	 *  listed here
+	 */
+	__u32 qidx[QDMA_CDEV_STRIPE_Q_MAX];
+};
+
+/**
+ * @struct - qdma_cdev_arb_conf
+ * @brief	QDMA_CDEV_IOCTL_ARB_CONF argument: ring budget of the queue
+ *		arbitration, for both directions of the cdev
+ */
+struct qdma_cdev_arb_conf {
+	/** max. bytes in the ring, 0 turns arbitration off */
+	__u64 inflight_max;
+};
+
+/**
+ * @struct - qdma_cdev_rw_vec_elem
+ * @brief	one element of a QDMA_CDEV_IOCTL_RW_VEC transfer
+ */
+struct qdma_cdev_rw_vec_elem {
+	/** user buffer */
+	__u64 buf;
+	/** length of the user buffer, < 2GB */
+	__u32 len;
+	/** filled in by the driver: bytes transferred or -errno */
+	__s32 status;
+	/** card address, MM only */
+	__u64 ep_addr;
+};
+
+/**
+ * @struct - qdma_cdev_rw_vec
+ * @brief	QDMA_CDEV_IOCTL_RW_VEC argument: all the elements are queued
+ *		at once and posted in a single descriptor pass, the ioctl
+ *		returns the number of elements completed without error.
+ *		If interrupted after some elements were transferred, it
+ *		returns -EINTR instead of restarting the whole vector and
+ *		the per element status tells what was done
+ */
+struct qdma_cdev_rw_vec {
+	/** user pointer to the struct qdma_cdev_rw_vec_elem array */
+	__u64 elems;
+	/** number of elements, <= QDMA_CDEV_RW_VEC_MAX */
+	__u32 count;
+	/** 1: write (H2C), 0: read (C2H) */
+	__u32 write;
+	/** timeout for the whole vector in ms, 0 - no timeout */
+	__u32 timeout_ms;
+	/** reserved */
+	__u32 rsvd;
+};
+
+/**
+ * @struct - qdma_cdev_cmpt_read
+ * @brief	QDMA_CDEV_IOCTL_CMPT_READ argument: copy the pending entries of
+ *		the MM completion queue with the cdev's queue index, the
+ *		ioctl returns the number of entries copied
+ */
+struct qdma_cdev_cmpt_read {
+	/** user buffer for the raw completion entries */
+	__u64 buf;
+	/** length of the user buffer in bytes */
+	__u32 len;
+	/** filled in by the driver: completion entry size in bytes */
+	__u32 entry_len;
+};
+
+/**
+ * @struct - qdma_cdev_ctx_dir_stats
+ * @brief	per direction counters of an open file
+ */
+struct qdma_cdev_ctx_dir_stats {
+	/** requests completed */
+	__u64 reqs;
+	/** bytes transferred */
+	__u64 bytes;
+	/** requests completed with an error */
+	__u64 errors;
+	/** total time spent queued in the arbiter, ns */
+	__u64 wait_ns;
+	/** total time from submission to completion, ns */
+	__u64 lat_ns;
+	/** max. time from submission to completion, ns */
+	__u64 lat_max_ns;
+};
+
+/**
+ * @struct - qdma_cdev_ctx_stats
+ * @brief	QDMA_CDEV_IOCTL_CTX_STATS argument: counters of the open file
+ *		the ioctl is issued on
+ */
+struct qdma_cdev_ctx_stats {
+	/** weight of the file */
+	__u32 weight;
+	/** reserved */
+	__u32 rsvd;
+	/** H2C: index 0, C2H: index 1 */
+	struct qdma_cdev_ctx_dir_stats dir[2];
+};
+
+/**
+ * @struct - qdma_cdev_xfer_prep
+ * @brief	QDMA_CDEV_IOCTL_XFER_PREP argument: the buffer is pinned and
+ *		its descriptor chain built once, each QDMA_CDEV_IOCTL_XFER_SUBMIT
+ *		then only copies the chain into the ring. The transfers are
+ *		released on close, or have to be released before the queue
+ *		is stopped.
+ */
+struct qdma_cdev_xfer_prep {
+	/** user buffer, pinned until the release */
+	__u64 buf;
+	/** card address */
+	__u64 ep_addr;
+	/** length of the user buffer, < 2GB */
+	__u32 len;
+	/** 1: write (H2C), 0: read (C2H) */
+	__u32 write;
+	/** filled in by the driver: transfer id, < QDMA_CDEV_XFER_MAX */
+	__u32 id;
+	/** reserved */
+	__u32 rsvd;
+};
+
+#endif /* ifndef QDMA_CDEV_IOCTL_H__ */
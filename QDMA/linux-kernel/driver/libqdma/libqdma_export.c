@@ -38,6 +38,9 @@
 #include "qdma_resource_mgmt.h"
 #include "qdma_mbox.h"
 #include "qdma_platform.h"
+#include "qdma_trace.h"
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 #ifdef DEBUGFS
 #include "qdma_debugfs_queue.h"
@@ -748,6 +751,114 @@ int qdma_queue_dump(unsigned long dev_hndl, unsigned long id, char *buf,
 	return buflen;
 }
 
+/*****************************************************************************/
+/**
+ * qdma_queue_get_stats() - snapshot of a queue's statistics
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[out]	stats:		queue statistics
+ *
+ * The counters are only updated from the queue's own service context,
+ * so the snapshot is taken without the descq lock.
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_get_stats(unsigned long dev_hndl, unsigned long id,
+				struct qdma_q_stats *stats)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq *descq;
+
+	if (!stats) {
+		pr_err("stats is NULL");
+		return -EINVAL;
+	}
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 0);
+	if (!descq) {
+		pr_err("Invalid qid(%lu)", id);
+		return -EINVAL;
+	}
+
+	memcpy(stats, &descq->stats, sizeof(*stats));
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_set_rate_limit() - change the rate limit of a queue
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[in]	rate_mbps:	rate in Mbit/s, 0 to remove the limit
+ * @param[in]	burst:		bucket depth in bytes, 0 for the default
+ * @param[in]	borrow:		may borrow unused function bandwidth
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_set_rate_limit(unsigned long dev_hndl, unsigned long id,
+				u32 rate_mbps, u32 burst, u8 borrow)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq *descq;
+	int online;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 0);
+	if (!descq) {
+		pr_err("Invalid qid(%lu)", id);
+		return -EINVAL;
+	}
+
+	/** ST C2H rings are filled as the device asks, nothing to pace */
+	if ((descq->conf.st && descq->conf.q_type == Q_C2H) ||
+			descq->conf.q_type == Q_CMPT) {
+		pr_err("%s, rate limit not supported on ST C2H/CMPT queues",
+			descq->conf.name);
+		return -EINVAL;
+	}
+
+	lock_descq(descq);
+	descq->conf.rl_rate_mbps = rate_mbps;
+	descq->conf.rl_burst = burst;
+	descq->conf.rl_borrow = borrow ? 1 : 0;
+	qdma_rl_bucket_set(&descq->rl.bucket, rate_mbps, burst);
+	descq->rl.borrow = descq->conf.rl_borrow;
+	online = descq->q_state == Q_STATE_ONLINE;
+	unlock_descq(descq);
+
+	/** let a throttled queue go on under the new limit */
+	if (online)
+		schedule_work(&descq->rl.work);
+
+	return 0;
+}
+
 /*****************************************************************************/
 /**
  * qdma_queue_dump_desc() - display a queue's descriptor ring from index start
@@ -1680,51 +1791,22 @@ int qdma_queue_add(unsigned long dev_hndl, struct qdma_queue_conf *qconf,
 
 /*****************************************************************************/
 /**
- * qdma_queue_start() - start a queue (i.e, online, ready for dma)
+ * qdma_queue_start_prepare() - validate a queue for start and complete its
+ *				configuration
  *
- * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
- * @param[in]	id:		queue index
+ * @param[in]	descq:		pointer to qdma_descq
  * @param[in]	buflen:		length of the input buffer
  * @param[out]	buf:		message buffer
  *
  * @return	0: success
  * @return	<0: error
  *****************************************************************************/
-int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
-		     char *buf, int buflen)
+static int qdma_queue_start_prepare(struct qdma_descq *descq,
+		char *buf, int buflen)
 {
-	struct qdma_descq *descq;
-	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct xlnx_dma_dev *xdev = descq->xdev;
 	int rv;
 
-	/** make sure that input buffer is not empty, else return error */
-	if (!buf || !buflen) {
-		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
-		return -EINVAL;
-	}
-
-	/** make sure that the dev_hndl passed is Valid */
-	if (!xdev) {
-		pr_err("dev_hndl is NULL");
-		snprintf(buf, buflen, "dev_hndl is NULL");
-		return -EINVAL;
-	}
-
-	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
-		pr_err("Invalid dev_hndl passed");
-		snprintf(buf, buflen, "Invalid dev_hndl passed");
-		return -EINVAL;
-	}
-
-	descq = qdma_device_get_descq_by_id(xdev, id, buf, buflen, 1);
-	/** make sure that descq is not NULL, else return error*/
-	if (!descq) {
-		pr_err("Invalid qid(%lu)", id);
-		snprintf(buf, buflen,
-			"Invalid qid(%lu)\n", id);
-		return -EINVAL;
-	}
-
 	lock_descq(descq);
 	/** if the descq is not enabled,
 	 *  it is in invalid state, return error
@@ -1788,15 +1870,25 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 		return -EIO;
 	}
 
-	/** allocate the queue resources*/
-	rv = qdma_descq_alloc_resource(descq);
-	if (rv < 0) {
-		pr_err("%s alloc resource failed.\n", descq->conf.name);
-		snprintf(buf, buflen,
-			"%s alloc resource failed.\n",
-			descq->conf.name);
-		return rv;
-	}
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_start_online() - program the hw contexts of a queue whose
+ *			       resources are allocated and set it online
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error, the queue resources are released
+ *****************************************************************************/
+static int qdma_queue_start_online(struct qdma_descq *descq,
+		char *buf, int buflen)
+{
+	int rv;
 
 	/** program the hw contexts*/
 	rv = qdma_descq_prog_hw(descq);
@@ -1842,11 +1934,24 @@ clear_context:
 	return rv;
 }
 
-int qdma_get_queue_state(unsigned long dev_hndl, unsigned long id,
-		struct qdma_q_state *q_state, char *buf, int buflen)
+/*****************************************************************************/
+/**
+ * qdma_queue_start() - start a queue (i.e, online, ready for dma)
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
+		     char *buf, int buflen)
 {
 	struct qdma_descq *descq;
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	int rv;
 
 	/** make sure that input buffer is not empty, else return error */
 	if (!buf || !buflen) {
@@ -1868,7 +1973,7 @@ int qdma_get_queue_state(unsigned long dev_hndl, unsigned long id,
 	}
 
 	descq = qdma_device_get_descq_by_id(xdev, id, buf, buflen, 1);
-	/** make sure that descq is not NULL, else return error */
+	/** make sure that descq is not NULL, else return error*/
 	if (!descq) {
 		pr_err("Invalid qid(%lu)", id);
 		snprintf(buf, buflen,
@@ -1876,55 +1981,119 @@ int qdma_get_queue_state(unsigned long dev_hndl, unsigned long id,
 		return -EINVAL;
 	}
 
-	if (!q_state) {
-		pr_err("Invalid q_state:%p", q_state);
-		return -EINVAL;
-	}
-
-	lock_descq(descq);
-	/** mode */
-	q_state->st = descq->conf.st;
-	/** type */
-	q_state->q_type = (enum queue_type_t)descq->conf.q_type;
-	/** qidx */
-	q_state->qidx = descq->conf.qidx;
-	/** q state */
-	q_state->qstate = descq->q_state;
-
-	snprintf(buf, buflen,
-		"queue state for %s id %u : %s\n",
-		descq->conf.name,
-		descq->conf.qidx,
-		q_state_list[descq->q_state].name);
+	rv = qdma_queue_start_prepare(descq, buf, buflen);
+	if (rv < 0)
+		return rv;
 
-	unlock_descq(descq);
+	/** allocate the queue resources*/
+	rv = qdma_descq_alloc_resource(descq);
+	if (rv < 0) {
+		pr_err("%s alloc resource failed.\n", descq->conf.name);
+		snprintf(buf, buflen,
+			"%s alloc resource failed.\n",
+			descq->conf.name);
+		return rv;
+	}
 
-	return 0;
+	return qdma_queue_start_online(descq, buf, buflen);
 }
 
+static int qdma_queue_stop_fence(struct qdma_descq *descq, char *buf,
+		int buflen);
+static void qdma_queue_stop_drain(struct qdma_descq *descq);
+static void qdma_queue_stop_offline(struct qdma_descq *descq);
+
+/** max number of workers allocating queue resources in parallel */
+#define QDMA_BULK_ALLOC_WORKERS_MAX	8
+/** min number of queues handed to one allocation worker */
+#define QDMA_BULK_ALLOC_QCNT_MIN	32
+
+struct qdma_bulk_alloc_work {
+	struct work_struct work;
+	struct qdma_descq **descqs;
+	unsigned int start;
+	unsigned int end;
+	int rv;
+};
 
+static void qdma_bulk_alloc_work_handler(struct work_struct *work)
+{
+	struct qdma_bulk_alloc_work *bw = container_of(work,
+			struct qdma_bulk_alloc_work, work);
+	unsigned int i;
+
+	bw->rv = 0;
+	for (i = bw->start; i < bw->end; i++) {
+		bw->rv = qdma_descq_alloc_ring_resource(bw->descqs[i]);
+		if (bw->rv < 0)
+			break;
+	}
+}
 
 /*****************************************************************************/
 /**
- * qdma_queue_stop() - stop a queue (i.e., offline, NOT ready for dma)
+ * qdma_bulk_alloc_resource() - allocate the rings of a set of queues,
+ *				spreading the work over unbound workers
  *
- * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
- * @param[in]	id:		queue index
- * @param[in]	buflen:		length of the input buffer
- * @param[out]	buf:		message buffer
+ * @param[in]	descqs:		array of queues
+ * @param[in]	q_cnt:		number of entries in descqs
  *
  * @return	0: success
- * @return	<0: error
+ * @return	<0: error, nothing is left allocated
  *****************************************************************************/
-int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
-			int buflen)
+static int qdma_bulk_alloc_resource(struct qdma_descq **descqs,
+		unsigned int q_cnt)
 {
-	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
-	struct qdma_descq *descq;
-	struct qdma_sgt_req_cb *cb, *tmp;
-	struct qdma_request *req;
-	unsigned int pend_list_empty = 0;
+	struct qdma_bulk_alloc_work *bw;
+	unsigned int nr_workers, per_worker, i;
+	int rv = 0;
+
+	nr_workers = min_t(unsigned int, num_online_cpus(),
+			QDMA_BULK_ALLOC_WORKERS_MAX);
+	nr_workers = min_t(unsigned int, nr_workers,
+			DIV_ROUND_UP(q_cnt, QDMA_BULK_ALLOC_QCNT_MIN));
+
+	bw = (nr_workers > 1) ? kcalloc(nr_workers, sizeof(*bw), GFP_KERNEL) :
+			NULL;
+	if (!bw) {
+		/* small set or no memory for the workers, do it inline */
+		for (i = 0; i < q_cnt; i++) {
+			rv = qdma_descq_alloc_ring_resource(descqs[i]);
+			if (rv < 0)
+				break;
+		}
+		goto out;
+	}
+
+	per_worker = DIV_ROUND_UP(q_cnt, nr_workers);
+	for (i = 0; i < nr_workers; i++) {
+		bw[i].descqs = descqs;
+		bw[i].start = min(i * per_worker, q_cnt);
+		bw[i].end = min(bw[i].start + per_worker, q_cnt);
+		INIT_WORK(&bw[i].work, qdma_bulk_alloc_work_handler);
+		queue_work(system_unbound_wq, &bw[i].work);
+	}
+
+	for (i = 0; i < nr_workers; i++) {
+		flush_work(&bw[i].work);
+		if (bw[i].rv < 0)
+			rv = bw[i].rv;
+	}
+	kfree(bw);
+
+out:
+	if (rv < 0) {
+		for (i = 0; i < q_cnt; i++)
+			qdma_descq_free_resource(descqs[i]);
+	}
 
+	return rv;
+}
+
+static int qdma_bulk_check_args(struct xlnx_dma_dev *xdev,
+		unsigned long dev_hndl, void *list, unsigned int q_cnt,
+		char *buf, int buflen, const char *fname)
+{
 	/** make sure that input buffer is not empty, else return error */
 	if (!buf || !buflen) {
 		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
@@ -1938,181 +2107,353 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 		return -EINVAL;
 	}
 
-	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+	if (xdev_check_hndl(fname, xdev->conf.pdev, dev_hndl) < 0) {
 		pr_err("Invalid dev_hndl passed");
 		snprintf(buf, buflen, "Invalid dev_hndl passed");
 		return -EINVAL;
 	}
 
-	descq = qdma_device_get_descq_by_id(xdev, id, buf, buflen, 1);
-	/** make sure that descq is not NULL, else return error */
-	if (!descq) {
-		pr_err("Invalid qid(%ld)", id);
+	/** an empty list is a no-op */
+	if (!list && q_cnt) {
+		pr_err("invalid argument: list=%p, q_cnt=%u", list, q_cnt);
+		snprintf(buf, buflen, "Invalid queue list\n");
 		return -EINVAL;
 	}
 
-	lock_descq(descq);
-		/** if the descq not online donot proceed */
-	if (descq->q_state != Q_STATE_ONLINE) {
-		unlock_descq(descq);
-		pr_err("%s invalid state, q_state %d.\n",
-		descq->conf.name, descq->q_state);
-		snprintf(buf, buflen,
-			"queue %s, idx %u stop failed.\n",
-			 descq->conf.name, descq->conf.qidx);
-		return -EINVAL;
-	}
-	pend_list_empty = descq->pend_list_empty;
+	return 0;
+}
 
-	descq->q_stop_wait = 1;
-	unlock_descq(descq);
-	if (!pend_list_empty) {
-		qdma_waitq_wait_event_timeout(descq->pend_list_wq,
-			descq->pend_list_empty,
-			msecs_to_jiffies(QDMA_Q_PEND_LIST_COMPLETION_TIMEOUT));
-	}
-	lock_descq(descq);
-	/** free the descq by updating the state */
-	descq->q_state = Q_STATE_ENABLED;
-	descq->q_stop_wait = 0;
-	list_for_each_entry_safe(cb, tmp, &descq->pend_list, list) {
-		req = (struct qdma_request *)cb;
-		cb->done = 1;
-		cb->status = -ENXIO;
-		if (req->fp_done) {
-			list_del(&cb->list);
-			req->fp_done(req, 0, -ENXIO);
-		} else
-			qdma_waitq_wakeup(&cb->wq);
+/*****************************************************************************/
+/**
+ * qdma_queue_add_bulk() - add a range of queues with the same configuration
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	qconf:		queue configuration template
+ * @param[in]	q_cnt:		number of queues to add
+ * @param[out]	qhndls:		opaque qhndls of the added queues
+ * @param[out]	stats:		per phase timing, can be NULL
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_add_bulk(unsigned long dev_hndl, struct qdma_queue_conf *qconf,
+			unsigned int q_cnt, unsigned long *qhndls,
+			struct qdma_q_bulk_stats *stats, char *buf, int buflen)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_queue_conf conf;
+	ktime_t start = ktime_get();
+	unsigned int i;
+	int rv;
+
+	if (stats)
+		memset(stats, 0, sizeof(*stats));
+
+	rv = qdma_bulk_check_args(xdev, dev_hndl, qhndls, q_cnt, buf, buflen,
+			__func__);
+	if (rv < 0)
+		return rv;
+	if (!qconf) {
+		pr_err("qconf is NULL");
+		snprintf(buf, buflen, "qconf is NULL\n");
+		return -EINVAL;
 	}
-	list_for_each_entry_safe(cb, tmp, &descq->work_list, list) {
-		req = (struct qdma_request *)cb;
-		cb->done = 1;
-		cb->status = -ENXIO;
-		if (req->fp_done) {
-			qdma_work_queue_del(descq, cb);
-			req->fp_done(req, 0, -ENXIO);
-		} else
-			qdma_waitq_wakeup(&cb->wq);
+
+	for (i = 0; i < q_cnt; i++) {
+		memcpy(&conf, qconf, sizeof(conf));
+		if (qconf->qidx != QDMA_QUEUE_IDX_INVALID)
+			conf.qidx = qconf->qidx + i;
+		rv = qdma_queue_add(dev_hndl, &conf, &qhndls[i], buf, buflen);
+		if (rv < 0)
+			break;
 	}
-	unlock_descq(descq);
 
-	/** remove the work thread associated with the current queue */
-	qdma_thread_remove_work(descq);
+	if (stats) {
+		stats->q_cnt = i;
+		stats->total_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		stats->prep_ns = stats->total_ns;
+	}
 
-	/** clear the queue context */
-	qdma_descq_context_clear(descq->xdev, descq->qidx_hw,
-					descq->conf.st, descq->conf.q_type, 0);
+	if (rv < 0)
+		return rv;
 
-	/** if the device is in direct/indirect interrupt mode,
-	 *  delete the interrupt list for the queue
-	 */
-	if ((descq->xdev->conf.qdma_drv_mode != POLL_MODE) &&
-		(descq->xdev->conf.qdma_drv_mode != LEGACY_INTR_MODE)) {
-		unsigned long flags;
-		struct intr_info_t *dev_intr_info_list =
-			&descq->xdev->dev_intr_info_list[descq->intr_id];
+	snprintf(buf, buflen, "%u queues added.\n", q_cnt);
+	return 0;
+}
 
-		spin_lock_irqsave(&dev_intr_info_list->vec_q_list, flags);
-		list_del(&descq->intr_list);
-		dev_intr_info_list->intr_list_cnt--;
-		spin_unlock_irqrestore(&dev_intr_info_list->vec_q_list, flags);
+/*****************************************************************************/
+/**
+ * qdma_queue_start_bulk() - start a set of queues
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	qhndls:		opaque qhndls of the queues
+ * @param[in]	q_cnt:		number of entries in qhndls
+ * @param[out]	stats:		per phase timing, can be NULL
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_start_bulk(unsigned long dev_hndl, unsigned long *qhndls,
+			unsigned int q_cnt, struct qdma_q_bulk_stats *stats,
+			char *buf, int buflen)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_q_bulk_stats lstats;
+	struct qdma_descq **descqs;
+	ktime_t start, t;
+	unsigned int i, j;
+	int rv;
+
+	if (!stats)
+		stats = &lstats;
+	memset(stats, 0, sizeof(*stats));
+
+	rv = qdma_bulk_check_args(xdev, dev_hndl, qhndls, q_cnt, buf, buflen,
+			__func__);
+	if (rv < 0)
+		return rv;
+
+	descqs = kcalloc(q_cnt, sizeof(*descqs), GFP_KERNEL);
+	if (!descqs) {
+		snprintf(buf, buflen, "OOM for %u queues\n", q_cnt);
+		return -ENOMEM;
 	}
 
-	/** free the queue resources */
-	qdma_descq_free_resource(descq);
-	/** free the descq by updating the state */
-	descq->total_cmpl_descs = 0;
+	/** validate all the queues before touching any of them */
+	start = ktime_get();
+	for (i = 0; i < q_cnt; i++) {
+		descqs[i] = qdma_device_get_descq_by_id(xdev, qhndls[i], buf,
+				buflen, 1);
+		if (!descqs[i]) {
+			pr_err("Invalid qid(%lu)", qhndls[i]);
+			snprintf(buf, buflen, "Invalid qid(%lu)\n", qhndls[i]);
+			rv = -EINVAL;
+			goto free_list;
+		}
+		rv = qdma_queue_start_prepare(descqs[i], buf, buflen);
+		if (rv < 0)
+			goto free_list;
+	}
+	t = ktime_get();
+	stats->prep_ns = ktime_to_ns(ktime_sub(t, start));
 
-	/** fill the return buffer indicating that queue is stopped */
-	snprintf(buf, buflen, "queue %s, idx %u stopped.\n",
-			descq->conf.name, descq->conf.qidx);
+	/** ring allocation does not touch the hw, run it in parallel */
+	rv = qdma_bulk_alloc_resource(descqs, q_cnt);
+	if (rv < 0) {
+		pr_err("alloc resource failed for %u queues, %d.\n", q_cnt, rv);
+		snprintf(buf, buflen, "alloc resource failed for %u queues\n",
+				q_cnt);
+		goto free_list;
+	}
+	stats->alloc_ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+	t = ktime_get();
+
+	/** program the contexts back to back, vectors are picked here so
+	 *  that the load balancing sees the queues started before
+	 */
+	for (i = 0; i < q_cnt; i++) {
+		qdma_descq_alloc_irq(descqs[i]);
+		rv = qdma_queue_start_online(descqs[i], buf, buflen);
+		if (rv < 0) {
+			for (j = i + 1; j < q_cnt; j++)
+				qdma_descq_free_resource(descqs[j]);
+			break;
+		}
+	}
+	stats->q_cnt = i;
+	stats->ctxt_ns = ktime_to_ns(ktime_sub(ktime_get(), t));
 
+free_list:
+	stats->total_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	kfree(descqs);
+	if (rv < 0)
+		return rv;
+
+	snprintf(buf, buflen, "%u queues started.\n", q_cnt);
 	return 0;
 }
 
 /*****************************************************************************/
 /**
- * qdma_get_queue_count() - Function to fetch the total number of queues
+ * qdma_queue_stop_bulk() - stop a set of queues
  *
  * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
- * @param[out]	q_count:	total q count
+ * @param[in]	qhndls:		opaque qhndls of the queues
+ * @param[in]	q_cnt:		number of entries in qhndls
+ * @param[out]	stats:		per phase timing, can be NULL
+ * @param[in]	buflen:		length of the input buffer
  * @param[out]	buf:		message buffer
- * @param[in]	buflen:	length of the input buffer
  *
  * @return	0: success
  * @return	<0: error
  *****************************************************************************/
-int qdma_get_queue_count(unsigned long dev_hndl,
-					struct qdma_queue_count *q_count,
-					char *buf, int buflen)
+int qdma_queue_stop_bulk(unsigned long dev_hndl, unsigned long *qhndls,
+			unsigned int q_cnt, struct qdma_q_bulk_stats *stats,
+			char *buf, int buflen)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_q_bulk_stats lstats;
+	struct qdma_descq **descqs;
+	ktime_t start, t;
+	unsigned int i, fenced;
+	int rv;
 
-	/** make sure that input buffer is not empty, else return error */
-	if (!buf || !buflen || !q_count) {
-		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
-		return -EINVAL;
-	}
+	if (!stats)
+		stats = &lstats;
+	memset(stats, 0, sizeof(*stats));
 
-	/** make sure that the dev_hndl passed is Valid */
-	if (!xdev) {
-		pr_err("dev_hndl is NULL");
-		snprintf(buf, buflen, "dev_hndl is NULL");
-		return -EINVAL;
+	rv = qdma_bulk_check_args(xdev, dev_hndl, qhndls, q_cnt, buf, buflen,
+			__func__);
+	if (rv < 0)
+		return rv;
+
+	descqs = kcalloc(q_cnt, sizeof(*descqs), GFP_KERNEL);
+	if (!descqs) {
+		snprintf(buf, buflen, "OOM for %u queues\n", q_cnt);
+		return -ENOMEM;
 	}
 
-#ifndef __QDMA_VF__
-	q_count->h2c_qcnt = qdma_get_device_active_queue_count(
-			xdev->dma_device_index,
-			xdev->func_id,
-			QDMA_DEV_Q_TYPE_H2C);
+	/** validate all the queues before fencing any of them, a fenced queue
+	 *  only reaps completions and cannot be put back online
+	 */
+	start = ktime_get();
+	for (i = 0; i < q_cnt; i++) {
+		descqs[i] = qdma_device_get_descq_by_id(xdev, qhndls[i], buf,
+				buflen, 1);
+		if (!descqs[i]) {
+			pr_err("Invalid qid(%lu)", qhndls[i]);
+			snprintf(buf, buflen, "Invalid qid(%lu)\n", qhndls[i]);
+			rv = -EINVAL;
+			goto free_list;
+		}
+		if (descqs[i]->q_state != Q_STATE_ONLINE) {
+			pr_err("%s invalid state, q_state %d.\n",
+				descqs[i]->conf.name, descqs[i]->q_state);
+			snprintf(buf, buflen, "queue %s, idx %u stop failed.\n",
+				descqs[i]->conf.name, descqs[i]->conf.qidx);
+			rv = -EINVAL;
+			goto free_list;
+		}
+	}
 
-	q_count->c2h_qcnt = qdma_get_device_active_queue_count(
-			xdev->dma_device_index,
-			xdev->func_id,
-			QDMA_DEV_Q_TYPE_C2H);
+	/** fence all the queues first so that they drain in parallel, the
+	 *  wait is bounded by the slowest queue instead of the sum of them.
+	 *  A queue stopped behind our back since the check above fails the
+	 *  fence, the ones fenced before it are still taken offline.
+	 */
+	for (fenced = 0; fenced < q_cnt; fenced++) {
+		rv = qdma_queue_stop_fence(descqs[fenced], buf, buflen);
+		if (rv < 0)
+			break;
+	}
+	for (i = 0; i < fenced; i++)
+		qdma_queue_stop_drain(descqs[i]);
+	t = ktime_get();
+	stats->prep_ns = ktime_to_ns(ktime_sub(t, start));
 
-	q_count->cmpt_qcnt = qdma_get_device_active_queue_count(
-			xdev->dma_device_index,
-			xdev->func_id,
-			QDMA_DEV_Q_TYPE_CMPT);
-#else
-	qdma_dev_get_active_qcnt(xdev, &(q_count->h2c_qcnt),
-							 &(q_count->c2h_qcnt),
-							 &(q_count->cmpt_qcnt));
-#endif
+	/** the indirect context interface takes one command at a time, the
+	 *  contexts are cleared back to back
+	 */
+	for (i = 0; i < fenced; i++)
+		qdma_queue_stop_offline(descqs[i]);
+	stats->q_cnt = fenced;
+	stats->ctxt_ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+free_list:
+	stats->total_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	kfree(descqs);
+	if (rv < 0)
+		return rv;
 
-	pr_debug("h2c_qcnt = %d, c2h_qcnt = %d, cmpt_qcnt = %d",
-			q_count->h2c_qcnt,
-			q_count->c2h_qcnt,
-			q_count->cmpt_qcnt);
+	snprintf(buf, buflen, "%u queues stopped.\n", q_cnt);
 	return 0;
 }
+
 /*****************************************************************************/
 /**
- * qdma_intr_ring_dump() - display the interrupt ring info of a vector
+ * qdma_queue_remove_bulk() - remove a set of queues
  *
  * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
- * @param[in]	vector_idx:	vector number
- * @param[in]	start_idx:	interrupt ring start idx
- * @param[in]	end_idx:	interrupt ring end idx
+ * @param[in]	qhndls:		opaque qhndls of the queues
+ * @param[in]	q_cnt:		number of entries in qhndls
+ * @param[out]	stats:		per phase timing, can be NULL
  * @param[in]	buflen:		length of the input buffer
  * @param[out]	buf:		message buffer
  *
  * @return	0: success
  * @return	<0: error
  *****************************************************************************/
-int qdma_intr_ring_dump(unsigned long dev_hndl, unsigned int vector_idx,
-	int start_idx, int end_idx, char *buf, int buflen)
+int qdma_queue_remove_bulk(unsigned long dev_hndl, unsigned long *qhndls,
+			unsigned int q_cnt, struct qdma_q_bulk_stats *stats,
+			char *buf, int buflen)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
-	union qdma_intr_ring *ring_entry;
-	struct intr_coal_conf *coal_entry;
-	char *cur = buf;
-	char * const end = buf + buflen;
-	int counter = 0;
-	u32 data[2];
+	ktime_t start = ktime_get();
+	unsigned int i;
+	int rv;
+
+	if (stats)
+		memset(stats, 0, sizeof(*stats));
+
+	rv = qdma_bulk_check_args(xdev, dev_hndl, qhndls, q_cnt, buf, buflen,
+			__func__);
+	if (rv < 0)
+		return rv;
+
+	/** validate all the queues before removing any of them */
+	for (i = 0; i < q_cnt; i++) {
+		struct qdma_descq *descq = qdma_device_get_descq_by_id(xdev,
+					qhndls[i], buf, buflen, 1);
+
+		if (!descq) {
+			pr_err("Invalid qid(%lu)", qhndls[i]);
+			snprintf(buf, buflen, "Invalid qid(%lu)\n", qhndls[i]);
+			return -EINVAL;
+		}
+		if (descq->q_state != Q_STATE_ENABLED) {
+			pr_err("queue %s, id %u cannot be deleted. Invalid q state: %s",
+				descq->conf.name, descq->conf.qidx,
+				q_state_list[descq->q_state].name);
+			snprintf(buf, buflen,
+				"queue %s, id %u cannot be deleted. Invalid q state: %s\n",
+				descq->conf.name, descq->conf.qidx,
+				q_state_list[descq->q_state].name);
+			return -EINVAL;
+		}
+	}
+
+	/** the contexts were cleared when the queues were stopped, removal
+	 *  only returns the queues to the resource manager one by one and has
+	 *  nothing left to batch
+	 */
+	for (i = 0; i < q_cnt; i++) {
+		rv = qdma_queue_remove(dev_hndl, qhndls[i], buf, buflen);
+		if (rv < 0)
+			break;
+	}
+
+	if (stats) {
+		stats->q_cnt = i;
+		stats->total_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		stats->prep_ns = stats->total_ns;
+	}
+
+	if (rv < 0)
+		return rv;
+
+	snprintf(buf, buflen, "%u queues removed.\n", q_cnt);
+	return 0;
+}
+
+int qdma_get_queue_state(unsigned long dev_hndl, unsigned long id,
+		struct qdma_q_state *q_state, char *buf, int buflen)
+{
+	struct qdma_descq *descq;
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
 
 	/** make sure that input buffer is not empty, else return error */
 	if (!buf || !buflen) {
@@ -2133,242 +2474,1449 @@ int qdma_intr_ring_dump(unsigned long dev_hndl, unsigned int vector_idx,
 		return -EINVAL;
 	}
 
-	/** if, interrupt aggregation is not enabled,
-	 *  interrupt ring is not created, return error
-	 */
-	if ((xdev->conf.qdma_drv_mode != INDIRECT_INTR_MODE) &&
-			(xdev->conf.qdma_drv_mode != AUTO_MODE)) {
-		pr_err("Interrupt aggregation not enabled in %s mode",
-				mode_name_list[xdev->conf.qdma_drv_mode].name);
+	descq = qdma_device_get_descq_by_id(xdev, id, buf, buflen, 1);
+	/** make sure that descq is not NULL, else return error */
+	if (!descq) {
+		pr_err("Invalid qid(%lu)", id);
 		snprintf(buf, buflen,
-				"Interrupt aggregation not enabled in %s mode",
-				mode_name_list[xdev->conf.qdma_drv_mode].name);
+			"Invalid qid(%lu)\n", id);
 		return -EINVAL;
 	}
 
-	/** make sure that vector index is with in the
-	 *  start and end vector limit, else return error
-	 */
-	if ((vector_idx < xdev->dvec_start_idx) ||
-		(vector_idx >=
-		(xdev->dvec_start_idx + QDMA_NUM_DATA_VEC_FOR_INTR_CXT))) {
-		pr_err("Vector idx %u is invalid. Shall be in range: %d -  %d.\n",
-			vector_idx,
-			xdev->dvec_start_idx,
-			(xdev->dvec_start_idx +
-			QDMA_NUM_DATA_VEC_FOR_INTR_CXT - 1));
-		snprintf(buf, buflen,
-			"Vector idx %u is invalid. Shall be in range: %d -  %d.\n",
-			vector_idx,
-			xdev->dvec_start_idx,
-			(xdev->dvec_start_idx +
-			QDMA_NUM_DATA_VEC_FOR_INTR_CXT - 1));
+	if (!q_state) {
+		pr_err("Invalid q_state:%p", q_state);
 		return -EINVAL;
 	}
 
-	/** get the intr entry based on vector index */
-	coal_entry = xdev->intr_coal_list + (vector_idx - xdev->dvec_start_idx);
+	lock_descq(descq);
+	/** mode */
+	q_state->st = descq->conf.st;
+	/** type */
+	q_state->q_type = (enum queue_type_t)descq->conf.q_type;
+	/** qidx */
+	q_state->qidx = descq->conf.qidx;
+	/** q state */
+	q_state->qstate = descq->q_state;
 
-	/** make sure that intr ring entry indexes
-	 *  given are with in the range
-	 */
-	if (start_idx > coal_entry->intr_rng_num_entries) {
-		pr_err("start_idx %d is invalid. Shall be less than: %d\n",
-					start_idx,
-					coal_entry->intr_rng_num_entries);
-		snprintf(buf, buflen,
-			"start_idx %d is invalid. Shall be less than: %d\n",
-			start_idx,
-			coal_entry->intr_rng_num_entries);
-		return -EINVAL;
-	}
+	snprintf(buf, buflen,
+		"queue state for %s id %u : %s\n",
+		descq->conf.name,
+		descq->conf.qidx,
+		q_state_list[descq->q_state].name);
 
-	if (end_idx == -1 || end_idx >= coal_entry->intr_rng_num_entries)
-		end_idx = coal_entry->intr_rng_num_entries - 1;
+	unlock_descq(descq);
 
-	if (start_idx == -1)
-		start_idx = 0;
+	return 0;
+}
 
-	if (start_idx > end_idx) {
-		pr_err("start_idx can't be greater than end_idx\n");
+
+
+/*****************************************************************************/
+/**
+ * qdma_queue_stop_fence() - stop accepting requests on an online queue
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error, the queue is not online
+ *****************************************************************************/
+static int qdma_queue_stop_fence(struct qdma_descq *descq, char *buf,
+		int buflen)
+{
+	lock_descq(descq);
+	/** if the descq not online donot proceed */
+	if (descq->q_state != Q_STATE_ONLINE) {
+		unlock_descq(descq);
+		pr_err("%s invalid state, q_state %d.\n",
+		descq->conf.name, descq->q_state);
 		snprintf(buf, buflen,
-			"start_idx can't be greater than end_idx\n");
+			"queue %s, idx %u stop failed.\n",
+			 descq->conf.name, descq->conf.qidx);
 		return -EINVAL;
 	}
+	descq->q_stop_wait = 1;
+	unlock_descq(descq);
 
-	/** read the ring entries based on the range given and
-	 * update the input buffer with details
-	 */
-	for (counter = start_idx; counter <= end_idx; counter++) {
-		ring_entry = coal_entry->intr_ring_base + counter;
-		memcpy(data, ring_entry, sizeof(u32) * 2);
-		cur += snprintf(cur, end - cur,
-				"intr_ring_entry = %d: 0x%08x 0x%08x\n",
-				counter, data[1], data[0]);
-		if (cur >= end)
-			goto handle_truncation;
-	}
-
-	return 0;
-handle_truncation:
-	*buf = '\0';
 	return 0;
 }
 
- /*****************************************************************************/
- /**
-  * qdma_software_version_info  Provides the qdma software version
-  *
-  * @param[out]   software_version:   libqdma software version
-  *
-  * @return  0: success
-  * @return  <0: error
-  *****************************************************************************/
-int qdma_software_version_info(char *software_version, int length)
+/*****************************************************************************/
+/**
+ * qdma_queue_stop_drain() - wait for the requests in flight on a fenced
+ *				queue to complete, bounded by
+ *				QDMA_Q_PEND_LIST_COMPLETION_TIMEOUT
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *****************************************************************************/
+static void qdma_queue_stop_drain(struct qdma_descq *descq)
 {
-	if (!software_version) {
-		pr_err("Invalid input software_version:%p", software_version);
-		return -EINVAL;
+	unsigned int pend_list_empty;
+
+	lock_descq(descq);
+	pend_list_empty = descq->pend_list_empty;
+	unlock_descq(descq);
+	if (!pend_list_empty) {
+		qdma_waitq_wait_event_timeout(descq->pend_list_wq,
+			descq->pend_list_empty,
+			msecs_to_jiffies(QDMA_Q_PEND_LIST_COMPLETION_TIMEOUT));
 	}
+}
 
-	snprintf(software_version, length, "%s", LIBQDMA_VERSION_STR);
+/*****************************************************************************/
+/**
+ * qdma_queue_stop_offline() - fail the requests left on a drained queue,
+ *				clear its context and free its resources
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *****************************************************************************/
+static void qdma_queue_stop_offline(struct qdma_descq *descq)
+{
+	struct qdma_sgt_req_cb *cb, *tmp;
+	struct qdma_request *req;
 
-	return 0;
-}
+	lock_descq(descq);
+	/** free the descq by updating the state */
+	descq->q_state = Q_STATE_ENABLED;
+	descq->q_stop_wait = 0;
+	list_for_each_entry_safe(cb, tmp, &descq->pend_list, list) {
+		req = (struct qdma_request *)cb;
+		cb->done = 1;
+		cb->status = -ENXIO;
+		if (req->fp_done) {
+			list_del(&cb->list);
+			req->fp_done(req, 0, -ENXIO);
+		} else
+			qdma_waitq_wakeup(&cb->wq);
+	}
+	list_for_each_entry_safe(cb, tmp, &descq->work_list, list) {
+		req = (struct qdma_request *)cb;
+		cb->done = 1;
+		cb->status = -ENXIO;
+		if (req->fp_done) {
+			qdma_work_queue_del(descq, cb);
+			req->fp_done(req, 0, -ENXIO);
+		} else
+			qdma_waitq_wakeup(&cb->wq);
+	}
+	unlock_descq(descq);
 
+	/** no more rate limit kicks, the queue is offline */
+	qdma_q_rl_cancel(&descq->rl);
 
-#ifdef __QDMA_VF__
- /*****************************************************************************/
- /**
-  * qdma_vf_qconf    call for VF to request qmax number of Qs
-  *
-  * @param[in]   dev_hndl:   dev_hndl returned from qdma_device_open()
-  * @param[in]   qmax:   number of qs requested by vf
-  *
-  * @return  0: success
-  * @return  <0: error
-  *****************************************************************************/
-int qdma_vf_qconf(unsigned long dev_hndl, int qmax)
+	/** remove the work thread associated with the current queue */
+	qdma_thread_remove_work(descq);
+
+	/** clear the queue context */
+	qdma_descq_context_clear(descq->xdev, descq->qidx_hw,
+					descq->conf.st, descq->conf.q_type, 0);
+
+	/** if the device is in direct/indirect interrupt mode,
+	 *  delete the interrupt list for the queue
+	 */
+	if ((descq->xdev->conf.qdma_drv_mode != POLL_MODE) &&
+		(descq->xdev->conf.qdma_drv_mode != LEGACY_INTR_MODE)) {
+		unsigned long flags;
+		struct intr_info_t *dev_intr_info_list =
+			&descq->xdev->dev_intr_info_list[descq->intr_id];
+
+		spin_lock_irqsave(&dev_intr_info_list->vec_q_list, flags);
+		list_del(&descq->intr_list);
+		dev_intr_info_list->intr_list_cnt--;
+		spin_unlock_irqrestore(&dev_intr_info_list->vec_q_list, flags);
+	}
+
+	/** free the queue resources */
+	qdma_descq_free_resource(descq);
+	/** free the descq by updating the state */
+	descq->total_cmpl_descs = 0;
+	memset(&descq->stats, 0, sizeof(descq->stats));
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_stop() - stop a queue (i.e., offline, NOT ready for dma)
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
+			int buflen)
 {
-	int err = 0;
-	int qbase = -1;
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq *descq;
+	int rv;
+
+	/** make sure that input buffer is not empty, else return error */
+	if (!buf || !buflen) {
+		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
+		return -EINVAL;
+	}
 
+	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
-		pr_err("Invalid dev handle\n");
+		pr_err("dev_hndl is NULL");
+		snprintf(buf, buflen, "dev_hndl is NULL");
 		return -EINVAL;
 	}
 
-	err = device_set_qconf(xdev, &qmax, &qbase);
-	if (err < 0) {
-		pr_err("Setting qconf failed\n");
-		return err;
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		snprintf(buf, buflen, "Invalid dev_hndl passed");
+		return -EINVAL;
 	}
-	qdma_device_cleanup(xdev);
-	xdev->conf.qsets_base = qbase;
-	xdev->conf.qsets_max = qmax;
-	err  = qdma_device_init(xdev);
-	if (err < 0) {
-		pr_warn("qdma_init failed %d.\n", err);
-		qdma_device_cleanup(xdev);
+
+	descq = qdma_device_get_descq_by_id(xdev, id, buf, buflen, 1);
+	/** make sure that descq is not NULL, else return error */
+	if (!descq) {
+		pr_err("Invalid qid(%ld)", id);
+		return -EINVAL;
 	}
 
-	return err;
+	rv = qdma_queue_stop_fence(descq, buf, buflen);
+	if (rv < 0)
+		return rv;
+	qdma_queue_stop_drain(descq);
+	qdma_queue_stop_offline(descq);
+
+	/** fill the return buffer indicating that queue is stopped */
+	snprintf(buf, buflen, "queue %s, idx %u stopped.\n",
+			descq->conf.name, descq->conf.qidx);
+
+	return 0;
 }
-#endif
 
 /*****************************************************************************/
 /**
- * sgl_unmap() - unmap the sg list from host pages
+ * qdma_get_queue_count() - Function to fetch the total number of queues
  *
- * @param[in]	pdev:	pointer to struct pci_dev
- * @param[in]	sg:		qdma sg request list
- * @param[in]	sgcnt:	number of sg lists
- * @param[in]	dir:	direction of the dma transfer
- *			DMA_BIDIRECTIONAL = 0,	DMA_TO_DEVICE = 1,
- *			DMA_FROM_DEVICE = 2, DMA_NONE = 3,
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[out]	q_count:	total q count
+ * @param[out]	buf:		message buffer
+ * @param[in]	buflen:	length of the input buffer
  *
  * @return	0: success
  * @return	<0: error
  *****************************************************************************/
-void sgl_unmap(struct pci_dev *pdev, struct qdma_sw_sg *sg, unsigned int sgcnt,
-		 enum dma_data_direction dir)
+int qdma_get_queue_count(unsigned long dev_hndl,
+					struct qdma_queue_count *q_count,
+					char *buf, int buflen)
 {
-	int i;
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
 
-	/** unmap the sg list and set the dma_addr to 0 all sg entries */
-	for (i = 0; i < sgcnt; i++, sg++) {
-		if (!sg->pg)
-			break;
-		if (sg->dma_addr) {
-			pci_unmap_page(pdev, sg->dma_addr - sg->offset,
-							PAGE_SIZE, dir);
-			sg->dma_addr = 0UL;
+	/** make sure that input buffer is not empty, else return error */
+	if (!buf || !buflen || !q_count) {
+		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
+		return -EINVAL;
+	}
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		snprintf(buf, buflen, "dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+#ifndef __QDMA_VF__
+	q_count->h2c_qcnt = qdma_get_device_active_queue_count(
+			xdev->dma_device_index,
+			xdev->func_id,
+			QDMA_DEV_Q_TYPE_H2C);
+
+	q_count->c2h_qcnt = qdma_get_device_active_queue_count(
+			xdev->dma_device_index,
+			xdev->func_id,
+			QDMA_DEV_Q_TYPE_C2H);
+
+	q_count->cmpt_qcnt = qdma_get_device_active_queue_count(
+			xdev->dma_device_index,
+			xdev->func_id,
+			QDMA_DEV_Q_TYPE_CMPT);
+#else
+	qdma_dev_get_active_qcnt(xdev, &(q_count->h2c_qcnt),
+							 &(q_count->c2h_qcnt),
+							 &(q_count->cmpt_qcnt));
+#endif
+
+	pr_debug("h2c_qcnt = %d, c2h_qcnt = %d, cmpt_qcnt = %d",
+			q_count->h2c_qcnt,
+			q_count->c2h_qcnt,
+			q_count->cmpt_qcnt);
+	return 0;
+}
+/*****************************************************************************/
+/**
+ * qdma_intr_ring_dump() - display the interrupt ring info of a vector
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	vector_idx:	vector number
+ * @param[in]	start_idx:	interrupt ring start idx
+ * @param[in]	end_idx:	interrupt ring end idx
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_intr_ring_dump(unsigned long dev_hndl, unsigned int vector_idx,
+	int start_idx, int end_idx, char *buf, int buflen)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	union qdma_intr_ring *ring_entry;
+	struct intr_coal_conf *coal_entry;
+	char *cur = buf;
+	char * const end = buf + buflen;
+	int counter = 0;
+	u32 data[2];
+
+	/** make sure that input buffer is not empty, else return error */
+	if (!buf || !buflen) {
+		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
+		return -EINVAL;
+	}
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		snprintf(buf, buflen, "dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		snprintf(buf, buflen, "Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	/** if, interrupt aggregation is not enabled,
+	 *  interrupt ring is not created, return error
+	 */
+	if ((xdev->conf.qdma_drv_mode != INDIRECT_INTR_MODE) &&
+			(xdev->conf.qdma_drv_mode != AUTO_MODE)) {
+		pr_err("Interrupt aggregation not enabled in %s mode",
+				mode_name_list[xdev->conf.qdma_drv_mode].name);
+		snprintf(buf, buflen,
+				"Interrupt aggregation not enabled in %s mode",
+				mode_name_list[xdev->conf.qdma_drv_mode].name);
+		return -EINVAL;
+	}
+
+	/** make sure that vector index is with in the
+	 *  start and end vector limit, else return error
+	 */
+	if ((vector_idx < xdev->dvec_start_idx) ||
+		(vector_idx >=
+		(xdev->dvec_start_idx + QDMA_NUM_DATA_VEC_FOR_INTR_CXT))) {
+		pr_err("Vector idx %u is invalid. Shall be in range: %d -  %d.\n",
+			vector_idx,
+			xdev->dvec_start_idx,
+			(xdev->dvec_start_idx +
+			QDMA_NUM_DATA_VEC_FOR_INTR_CXT - 1));
+		snprintf(buf, buflen,
+			"Vector idx %u is invalid. Shall be in range: %d -  %d.\n",
+			vector_idx,
+			xdev->dvec_start_idx,
+			(xdev->dvec_start_idx +
+			QDMA_NUM_DATA_VEC_FOR_INTR_CXT - 1));
+		return -EINVAL;
+	}
+
+	/** get the intr entry based on vector index */
+	coal_entry = xdev->intr_coal_list + (vector_idx - xdev->dvec_start_idx);
+
+	/** make sure that intr ring entry indexes
+	 *  given are with in the range
+	 */
+	if (start_idx > coal_entry->intr_rng_num_entries) {
+		pr_err("start_idx %d is invalid. Shall be less than: %d\n",
+					start_idx,
+					coal_entry->intr_rng_num_entries);
+		snprintf(buf, buflen,
+			"start_idx %d is invalid. Shall be less than: %d\n",
+			start_idx,
+			coal_entry->intr_rng_num_entries);
+		return -EINVAL;
+	}
+
+	if (end_idx == -1 || end_idx >= coal_entry->intr_rng_num_entries)
+		end_idx = coal_entry->intr_rng_num_entries - 1;
+
+	if (start_idx == -1)
+		start_idx = 0;
+
+	if (start_idx > end_idx) {
+		pr_err("start_idx can't be greater than end_idx\n");
+		snprintf(buf, buflen,
+			"start_idx can't be greater than end_idx\n");
+		return -EINVAL;
+	}
+
+	/** read the ring entries based on the range given and
+	 * update the input buffer with details
+	 */
+	for (counter = start_idx; counter <= end_idx; counter++) {
+		ring_entry = coal_entry->intr_ring_base + counter;
+		memcpy(data, ring_entry, sizeof(u32) * 2);
+		cur += snprintf(cur, end - cur,
+				"intr_ring_entry = %d: 0x%08x 0x%08x\n",
+				counter, data[1], data[0]);
+		if (cur >= end)
+			goto handle_truncation;
+	}
+
+	return 0;
+handle_truncation:
+	*buf = '\0';
+	return 0;
+}
+
+ /*****************************************************************************/
+ /**
+  * qdma_software_version_info  Provides the qdma software version
+  *
+  * @param[out]   software_version:   libqdma software version
+  *
+  * @return  0: success
+  * @return  <0: error
+  *****************************************************************************/
+int qdma_software_version_info(char *software_version, int length)
+{
+	if (!software_version) {
+		pr_err("Invalid input software_version:%p", software_version);
+		return -EINVAL;
+	}
+
+	snprintf(software_version, length, "%s", LIBQDMA_VERSION_STR);
+
+	return 0;
+}
+
+
+#ifdef __QDMA_VF__
+ /*****************************************************************************/
+ /**
+  * qdma_vf_qconf    call for VF to request qmax number of Qs
+  *
+  * @param[in]   dev_hndl:   dev_hndl returned from qdma_device_open()
+  * @param[in]   qmax:   number of qs requested by vf
+  *
+  * @return  0: success
+  * @return  <0: error
+  *****************************************************************************/
+int qdma_vf_qconf(unsigned long dev_hndl, int qmax)
+{
+	int err = 0;
+	int qbase = -1;
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+
+	if (!xdev) {
+		pr_err("Invalid dev handle\n");
+		return -EINVAL;
+	}
+
+	err = device_set_qconf(xdev, &qmax, &qbase);
+	if (err < 0) {
+		pr_err("Setting qconf failed\n");
+		return err;
+	}
+	qdma_device_cleanup(xdev);
+	xdev->conf.qsets_base = qbase;
+	xdev->conf.qsets_max = qmax;
+	err  = qdma_device_init(xdev);
+	if (err < 0) {
+		pr_warn("qdma_init failed %d.\n", err);
+		qdma_device_cleanup(xdev);
+	}
+
+	return err;
+}
+#endif
+
+/*****************************************************************************/
+/**
+ * sgl_unmap() - unmap the sg list from host pages
+ *
+ * @param[in]	pdev:	pointer to struct pci_dev
+ * @param[in]	sg:		qdma sg request list
+ * @param[in]	sgcnt:	number of sg lists
+ * @param[in]	dir:	direction of the dma transfer
+ *			DMA_BIDIRECTIONAL = 0,	DMA_TO_DEVICE = 1,
+ *			DMA_FROM_DEVICE = 2, DMA_NONE = 3,
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+void sgl_unmap(struct pci_dev *pdev, struct qdma_sw_sg *sg, unsigned int sgcnt,
+		 enum dma_data_direction dir)
+{
+	int i;
+
+	/** unmap the sg list and set the dma_addr to 0 all sg entries */
+	for (i = 0; i < sgcnt; i++, sg++) {
+		if (!sg->pg)
+			break;
+		if (sg->dma_addr) {
+			pci_unmap_page(pdev, sg->dma_addr - sg->offset,
+							PAGE_SIZE, dir);
+			sg->dma_addr = 0UL;
+		}
+	}
+}
+
+/*****************************************************************************/
+/**
+ * sgl_map() - map sg list to host pages
+ *
+ * @param[in]	pdev:	pointer to struct pci_dev
+ * @param[in]	sg:		qdma sg request list
+ * @param[in]	sgcnt:	number of sg lists
+ * @param[in]	dir:	direction of the dma transfer
+ *			DMA_BIDIRECTIONAL = 0,	DMA_TO_DEVICE = 1,
+ *			DMA_FROM_DEVICE = 2, DMA_NONE = 3,
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int sgl_map(struct pci_dev *pdev, struct qdma_sw_sg *sgl, unsigned int sgcnt,
+		enum dma_data_direction dir)
+{
+	int i;
+	struct qdma_sw_sg *sg = sgl;
+
+	/** Map the sg list onto a dma pages where
+	 *  each page has max of PAGE_SIZE i.e 4K
+	 */
+	for (i = 0; i < sgcnt; i++, sg++) {
+		/* !! TODO  page size !! */
+		sg->dma_addr = pci_map_page(pdev, sg->pg, 0, PAGE_SIZE, dir);
+		if (unlikely(pci_dma_mapping_error(pdev, sg->dma_addr))) {
+			pr_err("map sgl failed, sg %d, %u.\n", i, sg->len);
+			if (i)
+				sgl_unmap(pdev, sgl, i, dir);
+			return -EIO;
+		}
+		sg->dma_addr += sg->offset;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_request_submit() - submit a scatter-gather list of data for dma
+ * operation (for both read and write)
+ * This is a callback function called from upper layer(character device)
+ * to handle the read/write request on the queues
+ *
+ * @param[in]	dev_hndl:	hndl retured from qdma_device_open()
+ * @param[in]	id:			queue index
+ * @param[in]	req:		qdma request
+ *
+ * @return	# of bytes transferred
+ * @return	<0: error
+ *****************************************************************************/
+ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
+			struct qdma_request *req)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq *descq;
+	struct qdma_sgt_req_cb *cb;
+	enum dma_data_direction dir;
+	int wait = 0;
+	int rv = 0;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	if (!req) {
+		pr_err("req is NULL");
+		return -EINVAL;
+	}
+
+	wait = req->fp_done ? 0 : 1;
+
+	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 1);
+	if (!descq) {
+		pr_err("Invalid qid(%ld)", id);
+		return -EINVAL;
+	}
+
+	if (descq->conf.q_type == Q_CMPT) {
+		pr_err("Error : Transfer initiated on completion queue\n");
+		return -EINVAL;
+	}
+
+	cb = qdma_req_cb_get(req);
+
+	pr_debug("%s %s-%s, data len %u, sg cnt %u. ping_pong_en=%d\n",
+		descq->conf.name, descq->conf.st ? "ST" : "MM",
+		(descq->conf.q_type == Q_C2H) ? "C2H" : "H2C",
+		req->count, req->sgcnt, descq->conf.ping_pong_en);
+
+	/** Identify the direction of the transfer */
+	dir = (descq->conf.q_type == Q_C2H) ?  DMA_FROM_DEVICE : DMA_TO_DEVICE;
+
+	/** If write request is given on the C2H direction
+	 *  OR, a read request given on non C2H direction
+	 *  then, its an invalid request, return error in this case
+	 */
+	if ((req->write && (descq->conf.q_type != Q_H2C)) ||
+	    (!req->write && (descq->conf.q_type != Q_C2H))) {
+		pr_err("%s: bad direction, %c.\n",
+			descq->conf.name, req->write ? 'W' : 'R');
+		return -EINVAL;
+	}
+
+	/** Reset the local cb request with 0's */
+	memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
+	cb->submit_ns = ktime_to_ns(ktime_get());
+	/** Initialize the wait queue */
+	qdma_waitq_init(&cb->wq);
+
+	pr_debug("%s: data len %u, ep 0x%llx, sgl 0x%p, sgl cnt %u, tm %u ms.\n",
+		descq->conf.name, req->count, req->ep_addr, req->sgl,
+		req->sgcnt, req->timeout_ms);
+
+	trace_qdma_req_submit(descq, req);
+
+	/** If the request is streaming mode C2H, invoke the
+	 *  handler to perform the read operation
+	 */
+	if (descq->conf.st && (descq->conf.q_type == Q_C2H))
+		return qdma_request_submit_st_c2h(xdev, descq, req);
+
+	if (!req->dma_mapped) {
+		rv = sgl_map(xdev->conf.pdev,  req->sgl, req->sgcnt, dir);
+		if (rv < 0) {
+			pr_err("%s map sgl %u failed, %u.\n",
+				descq->conf.name, req->sgcnt, req->count);
+			goto unmap_sgl;
+		}
+		cb->unmap_needed = 1;
+	}
+
+	lock_descq(descq);
+	/**  if the descq is already in online state*/
+	if (descq->q_state != Q_STATE_ONLINE) {
+		unlock_descq(descq);
+		pr_err("%s descq %s NOT online.\n",
+			xdev->conf.name, descq->conf.name);
+		rv = -EINVAL;
+		goto unmap_sgl;
+	}
+	qdma_work_queue_add(descq, cb);
+	unlock_descq(descq);
+
+	pr_debug("%s: cb 0x%p submitted.\n", descq->conf.name, cb);
+
+	qdma_descq_proc_sgt_request(descq);
+
+	if (!wait)
+		return 0;
+
+	rv = qdma_request_wait_for_cmpl(xdev, descq, req);
+	if (rv < 0)
+		goto unmap_sgl;
+
+	return cb->offset;
+
+unmap_sgl:
+	if (!req->dma_mapped)
+		sgl_unmap(xdev->conf.pdev,  req->sgl, req->sgcnt, dir);
+
+	return rv;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_batch_request_submit() - submit a batch of scatter-gather list of data
+ *  for dma operation (for both read and write)
+ * This is a callback function called from upper layer(character device)
+ * to handle the read/write request on the queues
+ *
+ * @param[in]	dev_hndl:	hndl retured from qdma_device_open()
+ * @param[in]	id:			queue index
+ * @param[in]	count:		Number of qdma requests
+ * @param[in]	reqv:		qdma request vector
+ *
+ * @return	# of bytes transferred
+ * @return	<0: error
+ *****************************************************************************/
+ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
+			  unsigned long count, struct qdma_request **reqv)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq *descq;
+	struct qdma_sgt_req_cb *cb;
+	enum dma_data_direction dir;
+	int rv = 0;
+	unsigned long i;
+	struct qdma_request *req;
+	int st_c2h = 0;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	if (!reqv) {
+		pr_err("reqv is NULL");
+		return -EINVAL;
+	}
+
+	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 0);
+	if (!descq) {
+		pr_err("Invalid qid(%ld)", id);
+		return -EINVAL;
+	}
+
+	if (descq->conf.q_type == Q_CMPT) {
+		pr_err("Error : Transfer initiated on completion queue\n");
+		return -EINVAL;
+	}
+
+	st_c2h = (descq->conf.st && (descq->conf.q_type == Q_C2H)) ? 1 : 0;
+
+	/** Identify the direction of the transfer */
+	dir = (descq->conf.q_type == Q_C2H) ?  DMA_FROM_DEVICE : DMA_TO_DEVICE;
+
+	req = reqv[0];
+	/** If write request is given on the C2H direction
+	 *  OR, a read request given on non C2H direction
+	 *  then, its an invalid request, return error in this case
+	 */
+	if ((req->write && (descq->conf.q_type != Q_H2C))
+			|| (!req->write && (descq->conf.q_type != Q_C2H))) {
+		pr_err("%s: bad direction, %c.\n", descq->conf.name,
+				req->write ? 'W' : 'R');
+		return -EINVAL;
+	}
+	if (!req->fp_done) {
+		pr_err("%s: missing fp_done.\n", descq->conf.name);
+		return -EINVAL;
+	}
+
+	if (st_c2h) {
+		for (i = 0; i < count; i++) {
+			req = reqv[i];
+			cb = qdma_req_cb_get(req);
+			/** Reset the local cb request with 0's */
+			memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
+			cb->submit_ns = ktime_to_ns(ktime_get());
+			trace_qdma_req_submit(descq, req);
+
+			rv = qdma_request_submit_st_c2h(xdev, descq, req);
+			if ((rv < 0) || (rv == req->count))
+				req->fp_done(req, rv, rv);
+		}
+
+		return 0;
+
+	} else {
+		struct pci_dev *pdev = xdev->conf.pdev;
+
+		for (i = 0; i < count; i++) {
+			req = reqv[i];
+			cb = qdma_req_cb_get(req);
+			/** Reset the local cb request with 0's */
+			memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
+			cb->submit_ns = ktime_to_ns(ktime_get());
+			trace_qdma_req_submit(descq, req);
+
+			if (!req->dma_mapped) {
+				rv = sgl_map(pdev, req->sgl, req->sgcnt, dir);
+				if (unlikely(rv < 0)) {
+					pr_err("%s map sgl %u failed, %u.\n",
+						descq->conf.name,
+						req->sgcnt,
+						req->count);
+					/** completed here, do not queue it */
+					cb->done = 1;
+					cb->status = rv;
+					req->fp_done(req, 0, rv);
+					continue;
+				}
+				cb->unmap_needed = 1;
+			}
+		}
+	}
+
+	lock_descq(descq);
+	/**  if the descq is already in online state*/
+	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+		unlock_descq(descq);
+		pr_err("%s descq %s NOT online.\n", xdev->conf.name,
+				descq->conf.name);
+		for (i = 0; i < count; i++) {
+			cb = qdma_req_cb_get(reqv[i]);
+			if (cb->unmap_needed) {
+				sgl_unmap(xdev->conf.pdev, reqv[i]->sgl,
+					reqv[i]->sgcnt, dir);
+				cb->unmap_needed = 0;
+			}
+		}
+		return -EINVAL;
+	}
+
+	/** queue the whole vector before processing it, so it is posted in
+	 *  a single pass with one doorbell (ring space permitting)
+	 */
+	for (i = 0; i < count; i++) {
+		req = reqv[i];
+		cb = qdma_req_cb_get(req);
+
+		if (unlikely(cb->done))
+			continue;
+		qdma_work_queue_add(descq, cb);
+	}
+	unlock_descq(descq);
+
+	qdma_descq_proc_sgt_request(descq);
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_request_cancel() - take a request off its queue before the engine
+ *				got any of it
+ *
+ * @param[in]	dev_hndl:	hndl retured from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[in]	req:		qdma request
+ *
+ * @return	0: cancelled, fp_done will not be called
+ * @return	-EINPROGRESS: descriptors posted, completes through fp_done
+ * @return	-EALREADY: completed or not queued
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_request_cancel(unsigned long dev_hndl, unsigned long id,
+			struct qdma_request *req)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
+	struct qdma_sgt_req_cb *pos;
+	struct qdma_descq *descq;
+	int rv = -EALREADY;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 0);
+	if (!descq) {
+		pr_err("Invalid qid(%ld)", id);
+		return -EINVAL;
+	}
+
+	/** the completions run under the descq lock, a request found on
+	 *  a list here has not been completed and will not be meanwhile
+	 */
+	lock_descq(descq);
+	if (descq->conf.st && (descq->conf.q_type == Q_C2H)) {
+		/** st c2h requests hold no descriptors, the packets are
+		 *  copied into them as they arrive
+		 */
+		list_for_each_entry(pos, &descq->pend_list, list) {
+			if (pos == cb) {
+				list_del(&cb->list);
+				rv = 0;
+				break;
+			}
+		}
+	} else {
+		/** the completions are credited to the posted requests in
+		 *  order, a request with descriptors in the ring has to
+		 *  complete
+		 */
+#ifdef QDMA_SPIN_LOCK_GRANULAR
+		spin_lock_bh(&descq->work_list_lock);
+#endif
+		list_for_each_entry(pos, &descq->work_list, list) {
+			if (pos != cb)
+				continue;
+			if (cb->desc_nr) {
+				rv = -EINPROGRESS;
+			} else {
+				list_del(&cb->list);
+				descq->work_req_pend--;
+				rv = 0;
+			}
+			break;
+		}
+#ifdef QDMA_SPIN_LOCK_GRANULAR
+		spin_unlock_bh(&descq->work_list_lock);
+#endif
+		if (rv == -EALREADY) {
+			list_for_each_entry(pos, &descq->pend_list, list) {
+				if (pos == cb) {
+					rv = -EINPROGRESS;
+					break;
+				}
+			}
+		}
+	}
+
+	if (!rv) {
+		if (cb->unmap_needed) {
+			sgl_unmap(xdev->conf.pdev, req->sgl, req->sgcnt,
+				(descq->conf.q_type == Q_C2H) ?
+				DMA_FROM_DEVICE : DMA_TO_DEVICE);
+			cb->unmap_needed = 0;
+		}
+		cb->status = -ECANCELED;
+		cb->done = 1;
+	}
+	unlock_descq(descq);
+
+	return rv;
+}
+
+/*****************************************************************************/
+/**
+ * state of a striped request, the stripe requests and their sgls follow it
+ * in the same allocation
+ */
+struct qdma_stripe_ctx {
+	/** the request being striped */
+	struct qdma_request *req;
+	/** device the request is submitted to */
+	struct xlnx_dma_dev *xdev;
+	/** queue group, stripe n goes to descqs[n % q_cnt] */
+	struct qdma_descq *descqs[QDMA_STRIPE_Q_MAX];
+	/** number of queues in the group */
+	unsigned int q_cnt;
+	/** number of stripes */
+	unsigned int nr_stripes;
+	/** stripes outstanding + the submitter's reference */
+	atomic_t pending;
+	/** bytes completed over all stripes */
+	atomic_t bytes;
+	/** first stripe error */
+	atomic_t error;
+	/** request sgl mapped here, unmap when done */
+	u8 unmap_needed:1;
+	/** all stripes completed, for the blocking mode */
+	u8 done;
+	/** blocking mode wait queue */
+	qdma_wait_queue wq;
+	/** stripe requests */
+	struct qdma_request *stripes;
+	/** stripe sgls, carved out of the request's sgl */
+	struct qdma_sw_sg *sgl;
+};
+
+/*****************************************************************************/
+/**
+ * qdma_stripe_unmap() - unmap the request sgl if it was mapped for striping
+ *
+ * @param[in]	ctx:	striped request
+ *
+ * @return	none
+ *****************************************************************************/
+static void qdma_stripe_unmap(struct qdma_stripe_ctx *ctx)
+{
+	struct qdma_request *req = ctx->req;
+
+	if (ctx->unmap_needed) {
+		sgl_unmap(ctx->xdev->conf.pdev, req->sgl, req->sgcnt,
+			req->write ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+		ctx->unmap_needed = 0;
+	}
+}
+
+/*****************************************************************************/
+/**
+ * qdma_stripe_put() - drop a reference on the striped request, the last one
+ *			completes it
+ *
+ * @param[in]	ctx:	striped request
+ *
+ * @return	none
+ *****************************************************************************/
+static void qdma_stripe_put(struct qdma_stripe_ctx *ctx)
+{
+	struct qdma_request *req = ctx->req;
+
+	if (!atomic_dec_and_test(&ctx->pending))
+		return;
+
+	/** blocking mode, the waiter owns and frees the context */
+	if (!req->fp_done) {
+		ctx->done = 1;
+		qdma_waitq_wakeup(&ctx->wq);
+		return;
+	}
+
+	qdma_stripe_unmap(ctx);
+	req->fp_done(req, atomic_read(&ctx->bytes), atomic_read(&ctx->error));
+	kfree(ctx);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_stripe_req_done() - stripe completion, called with the stripe's
+ *			queue locked
+ *
+ * @param[in]	sreq:		stripe request
+ * @param[in]	bytes_done:	bytes transferred by the stripe
+ * @param[in]	err:		stripe status
+ *
+ * @return	0
+ *****************************************************************************/
+static int qdma_stripe_req_done(struct qdma_request *sreq,
+				unsigned int bytes_done, int err)
+{
+	struct qdma_stripe_ctx *ctx = (struct qdma_stripe_ctx *)sreq->uld_data;
+
+	atomic_add(bytes_done, &ctx->bytes);
+	if (err)
+		atomic_cmpxchg(&ctx->error, 0, err);
+	qdma_stripe_put(ctx);
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_stripe_build() - split the request into stripe_len sized stripes
+ *
+ * the stripe sgls point into the request's pages and dma mappings, an sg
+ * entry crossing a stripe boundary is split in two.
+ *
+ * @param[in]	ctx:		striped request
+ * @param[in]	stripe_len:	stripe size in bytes
+ *
+ * @return	0: success
+ * @return	<0: sgl shorter than the request
+ *****************************************************************************/
+static int qdma_stripe_build(struct qdma_stripe_ctx *ctx,
+				unsigned int stripe_len)
+{
+	struct qdma_request *req = ctx->req;
+	struct qdma_sw_sg *sg = req->sgl;
+	struct qdma_sw_sg *sg_end = req->sgl + req->sgcnt;
+	struct qdma_sw_sg *ssg = ctx->sgl;
+	unsigned int sg_off = 0;
+	unsigned int offset = 0;
+	unsigned int i;
+
+	for (i = 0; i < ctx->nr_stripes; i++) {
+		struct qdma_request *sreq = ctx->stripes + i;
+		unsigned int left = min_t(unsigned int, stripe_len,
+					req->count - offset);
+
+		sreq->uld_data = (unsigned long)ctx;
+		sreq->fp_done = qdma_stripe_req_done;
+		sreq->count = left;
+		sreq->ep_addr = req->ep_addr + offset;
+		sreq->no_memcpy = req->no_memcpy;
+		sreq->write = req->write;
+		sreq->dma_mapped = 1;
+		sreq->h2c_eot = req->h2c_eot;
+		sreq->sgl = ssg;
+		offset += left;
+
+		while (left) {
+			unsigned int len;
+
+			if (sg == sg_end)
+				return -EINVAL;
+			if (sg_off == sg->len) {
+				sg++;
+				sg_off = 0;
+				continue;
+			}
+
+			len = min_t(unsigned int, sg->len - sg_off, left);
+			ssg->next = ssg + 1;
+			ssg->pg = sg->pg;
+			ssg->offset = sg->offset + sg_off;
+			ssg->len = len;
+			ssg->dma_addr = sg->dma_addr + sg_off;
+			ssg++;
+			sreq->sgcnt++;
+
+			sg_off += len;
+			left -= len;
+		}
+		ssg[-1].next = NULL;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_stripe_wait_for_cmpl() - wait for a blocking striped request
+ *
+ * @param[in]	ctx:	striped request, freed on return
+ *
+ * @return	# of bytes transferred
+ * @return	<0: error
+ *****************************************************************************/
+static ssize_t qdma_stripe_wait_for_cmpl(struct qdma_stripe_ctx *ctx)
+{
+	struct qdma_request *req = ctx->req;
+	unsigned int cancelled = 0;
+	unsigned int i, q;
+	ssize_t rv;
+
+	if (req->timeout_ms)
+		qdma_waitq_wait_event_timeout(ctx->wq, ctx->done,
+			msecs_to_jiffies(req->timeout_ms));
+	else
+		qdma_waitq_wait_event(ctx->wq, ctx->done);
+
+	/** pull the stripes not done yet off their queues, taking every
+	 *  queue lock also waits out the stripe completions still running
+	 */
+	for (q = 0; q < ctx->q_cnt; q++) {
+		struct qdma_descq *descq = ctx->descqs[q];
+
+		lock_descq(descq);
+		for (i = q; i < ctx->nr_stripes; i += ctx->q_cnt) {
+			struct qdma_request *sreq = ctx->stripes + i;
+			struct qdma_sgt_req_cb *cb = qdma_req_cb_get(sreq);
+
+			if (cb->done)
+				continue;
+			if (cb->offset < sreq->count)
+				qdma_work_queue_del(descq, cb);
+			else
+				list_del(&cb->list);
+			cancelled++;
+		}
+		unlock_descq(descq);
+	}
+
+	if (cancelled || atomic_read(&ctx->error)) {
+		pr_err("req 0x%p, %c,%u/%u,0x%llx, stripes %u/%u timed out, err %d, tm %u.\n",
+			req, req->write ? 'W' : 'R',
+			atomic_read(&ctx->bytes), req->count, req->ep_addr,
+			cancelled, ctx->nr_stripes, atomic_read(&ctx->error),
+			req->timeout_ms);
+		rv = -EIO;
+	} else {
+		rv = atomic_read(&ctx->bytes);
+	}
+
+	qdma_stripe_unmap(ctx);
+	kfree(ctx);
+
+	return rv;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_stripe_request_submit() - submit a MM request striped across a group
+ * of queues
+ *
+ * @param[in]	dev_hndl:	hndl retured from qdma_device_open()
+ * @param[in]	qhndls:		queue group
+ * @param[in]	q_cnt:		number of queues in the group
+ * @param[in]	stripe_len:	stripe size in bytes
+ * @param[in]	req:		qdma request
+ *
+ * @return	# of bytes transferred, 0 if fp_done is set
+ * @return	<0: error
+ *****************************************************************************/
+ssize_t qdma_stripe_request_submit(unsigned long dev_hndl,
+			unsigned long *qhndls, unsigned int q_cnt,
+			unsigned int stripe_len, struct qdma_request *req)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_stripe_ctx *ctx;
+	struct qdma_descq *descq;
+	unsigned int nr_stripes;
+	unsigned int i, q;
+	int wait;
+	int rv;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	if (!req || !qhndls || !q_cnt || q_cnt > QDMA_STRIPE_Q_MAX ||
+	    !stripe_len) {
+		pr_err("req 0x%p, qhndls 0x%p, q_cnt %u/%u, stripe %u invalid.\n",
+			req, qhndls, q_cnt, QDMA_STRIPE_Q_MAX, stripe_len);
+		return -EINVAL;
+	}
+
+	/** a keyhole is a FIFO behind one window, its stripes would all hit
+	 *  the window base and interleave across the queues
+	 */
+	descq = qdma_device_get_descq_by_id(xdev, qhndls[0], NULL, 0, 0);
+	if (descq && descq->conf.aperture_size) {
+		pr_err("%s: keyhole queue, can not be striped.\n",
+			descq->conf.name);
+		return -EINVAL;
+	}
+
+	/** nothing to stripe */
+	nr_stripes = DIV_ROUND_UP(req->count, stripe_len);
+	if (nr_stripes <= 1)
+		return qdma_request_submit(dev_hndl, qhndls[0], req);
+
+	/** every stripe adds at most one split sg entry */
+	ctx = kzalloc(sizeof(struct qdma_stripe_ctx) +
+			nr_stripes * sizeof(struct qdma_request) +
+			(req->sgcnt + nr_stripes) * sizeof(struct qdma_sw_sg),
+			GFP_KERNEL);
+	if (!ctx) {
+		pr_err("%s, %u stripes OOM.\n", xdev->conf.name, nr_stripes);
+		return -ENOMEM;
+	}
+	ctx->req = req;
+	ctx->xdev = xdev;
+	ctx->q_cnt = q_cnt;
+	ctx->nr_stripes = nr_stripes;
+	ctx->stripes = (struct qdma_request *)(ctx + 1);
+	ctx->sgl = (struct qdma_sw_sg *)(ctx->stripes + nr_stripes);
+	qdma_waitq_init(&ctx->wq);
+
+	for (q = 0; q < q_cnt; q++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[q], NULL, 0, 1);
+		if (!descq) {
+			pr_err("Invalid qid(%ld)", qhndls[q]);
+			rv = -EINVAL;
+			goto free_ctx;
+		}
+		if (descq->conf.st || (descq->conf.q_type == Q_CMPT) ||
+		    (req->write != (descq->conf.q_type == Q_H2C))) {
+			pr_err("%s: not a MM %s queue.\n", descq->conf.name,
+				req->write ? "H2C" : "C2H");
+			rv = -EINVAL;
+			goto free_ctx;
+		}
+		if (descq->conf.aperture_size) {
+			pr_err("%s: keyhole queue, can not be striped.\n",
+				descq->conf.name);
+			rv = -EINVAL;
+			goto free_ctx;
+		}
+		ctx->descqs[q] = descq;
+	}
+
+	if (!req->dma_mapped) {
+		rv = sgl_map(xdev->conf.pdev, req->sgl, req->sgcnt,
+			req->write ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+		if (rv < 0) {
+			pr_err("%s map sgl %u failed, %u.\n", xdev->conf.name,
+				req->sgcnt, req->count);
+			goto free_ctx;
+		}
+		ctx->unmap_needed = 1;
+	}
+
+	rv = qdma_stripe_build(ctx, stripe_len);
+	if (rv < 0) {
+		pr_err("%s, sgl %u shorter than %u.\n", xdev->conf.name,
+			req->sgcnt, req->count);
+		goto unmap_sgl;
+	}
+
+	/** queue all the stripes first, then kick the queues, so the
+	 *  queues run in parallel from the first doorbell on
+	 */
+	atomic_set(&ctx->pending, nr_stripes + 1);
+	wait = req->fp_done ? 0 : 1;
+	for (q = 0; q < q_cnt; q++) {
+		int online;
+
+		descq = ctx->descqs[q];
+		lock_descq(descq);
+		online = (descq->q_state == Q_STATE_ONLINE);
+		for (i = q; online && i < nr_stripes; i += q_cnt) {
+			struct qdma_request *sreq = ctx->stripes + i;
+			struct qdma_sgt_req_cb *cb = qdma_req_cb_get(sreq);
+
+			cb->submit_ns = ktime_to_ns(ktime_get());
+			trace_qdma_req_submit(descq, sreq);
+			qdma_work_queue_add(descq, cb);
+		}
+		unlock_descq(descq);
+
+		if (online)
+			continue;
+
+		pr_err("%s descq %s NOT online.\n", xdev->conf.name,
+			descq->conf.name);
+		for (i = q; i < nr_stripes; i += q_cnt) {
+			struct qdma_request *sreq = ctx->stripes + i;
+			struct qdma_sgt_req_cb *cb = qdma_req_cb_get(sreq);
+
+			cb->done = 1;
+			cb->status = -EINVAL;
+			qdma_stripe_req_done(sreq, 0, -EINVAL);
 		}
 	}
+
+	for (q = 0; q < q_cnt; q++)
+		qdma_descq_proc_sgt_request(ctx->descqs[q]);
+
+	/** ctx may be gone after dropping the submitter's reference */
+	qdma_stripe_put(ctx);
+	if (!wait)
+		return 0;
+
+	return qdma_stripe_wait_for_cmpl(ctx);
+
+unmap_sgl:
+	qdma_stripe_unmap(ctx);
+free_ctx:
+	kfree(ctx);
+	return rv;
 }
 
 /*****************************************************************************/
 /**
- * sgl_map() - map sg list to host pages
+ * qdma_mm_xfer_build() - build the descriptor chain of a MM request in one
+ *			pass, the way descq_mm_proc_request() would
  *
- * @param[in]	pdev:	pointer to struct pci_dev
- * @param[in]	sg:		qdma sg request list
- * @param[in]	sgcnt:	number of sg lists
- * @param[in]	dir:	direction of the dma transfer
- *			DMA_BIDIRECTIONAL = 0,	DMA_TO_DEVICE = 1,
- *			DMA_FROM_DEVICE = 2, DMA_NONE = 3,
+ * @param[in]	descq:	pointer to qdma_descq
+ * @param[in]	req:	qdma request, sgl dma mapped
+ * @param[out]	desc:	descriptor chain, NULL to only count
  *
- * @return	0: success
- * @return	<0: error
+ * @return	number of descriptors
+ * @return	<0: sgl shorter than the request
  *****************************************************************************/
-int sgl_map(struct pci_dev *pdev, struct qdma_sw_sg *sgl, unsigned int sgcnt,
-		enum dma_data_direction dir)
+static int qdma_mm_xfer_build(struct qdma_descq *descq,
+			struct qdma_request *req, struct qdma_mm_desc *desc)
 {
-	int i;
-	struct qdma_sw_sg *sg = sgl;
+	struct qdma_queue_conf *qconf = &descq->conf;
+	u32 aperture = qconf->aperture_size ?
+				qconf->aperture_size : QDMA_DESC_BLEN_MAX;
+	u8 keyhole_en = qconf->aperture_size ? 1 : 0;
+	u64 ep_addr = req->ep_addr;
+	u64 ep_addr_max = req->ep_addr + aperture - 1;
+	struct qdma_sw_sg *sg = req->sgl;
+	unsigned int left = req->count;
+	unsigned int desc_len = 0;
+	dma_addr_t desc_src_end = 0;
+	u64 desc_ep_end = 0;
+	unsigned int i;
+	int desc_nr = 0;
+
+	for (i = 0; i < req->sgcnt && left; i++, sg++) {
+		dma_addr_t addr = sg->dma_addr;
+		unsigned int tlen = min_t(unsigned int, sg->len, left);
+
+		left -= tlen;
+		while (tlen) {
+			unsigned int len = min_t(unsigned int, tlen, aperture);
+
+			if (keyhole_en) {
+				if (ep_addr > ep_addr_max)
+					ep_addr = req->ep_addr;
+
+				if (ep_addr + len > ep_addr_max)
+					len = ep_addr_max - ep_addr + 1;
+			}
 
-	/** Map the sg list onto a dma pages where
-	 *  each page has max of PAGE_SIZE i.e 4K
-	 */
-	for (i = 0; i < sgcnt; i++, sg++) {
-		/* !! TODO  page size !! */
-		sg->dma_addr = pci_map_page(pdev, sg->pg, 0, PAGE_SIZE, dir);
-		if (unlikely(pci_dma_mapping_error(pdev, sg->dma_addr))) {
-			pr_err("map sgl failed, sg %d, %u.\n", i, sg->len);
-			if (i)
-				sgl_unmap(pdev, sgl, i, dir);
-			return -EIO;
+			/** contiguous with the previous descriptor, grow it */
+			if (desc_nr && addr == desc_src_end &&
+			    ep_addr == desc_ep_end && desc_len < aperture) {
+				len = min_t(unsigned int, len,
+					aperture - desc_len);
+				desc_len += len;
+				if (desc)
+					(desc - 1)->flag_len += len;
+			} else {
+				desc_len = len;
+				desc_nr++;
+				if (desc) {
+					desc->rsvd1 = 0UL;
+					desc->rsvd0 = 0U;
+					if (qconf->q_type == Q_C2H) {
+						desc->src_addr = ep_addr;
+						desc->dst_addr = addr;
+					} else {
+						desc->dst_addr = ep_addr;
+						desc->src_addr = addr;
+					}
+					desc->flag_len = len;
+					desc->flag_len |= (1 << S_DESC_F_DV);
+					desc++;
+				}
+			}
+
+			ep_addr += len;
+			addr += len;
+			tlen -= len;
+			desc_src_end = addr;
+			desc_ep_end = ep_addr;
 		}
-		sg->dma_addr += sg->offset;
 	}
 
-	return 0;
+	if (left || !desc_nr)
+		return -EINVAL;
+
+	if (desc) {
+		(desc - desc_nr)->flag_len |= (1 << S_DESC_F_SOP);
+		(desc - 1)->flag_len |= (1 << S_DESC_F_EOP);
+	}
+
+	return desc_nr;
 }
 
 /*****************************************************************************/
 /**
- * qdma_request_submit() - submit a scatter-gather list of data for dma
- * operation (for both read and write)
- * This is a callback function called from upper layer(character device)
- * to handle the read/write request on the queues
+ * qdma_mm_xfer_prepare() - prepare a MM transfer for repeated submission
  *
  * @param[in]	dev_hndl:	hndl retured from qdma_device_open()
- * @param[in]	id:			queue index
+ * @param[in]	id:		queue index
  * @param[in]	req:		qdma request
+ * @param[out]	xfer_hndl:	prepared transfer handle
  *
- * @return	# of bytes transferred
+ * @return	0: success
  * @return	<0: error
  *****************************************************************************/
-ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
-			struct qdma_request *req)
+int qdma_mm_xfer_prepare(unsigned long dev_hndl, unsigned long id,
+			struct qdma_request *req, unsigned long *xfer_hndl)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
 	struct qdma_descq *descq;
-	struct qdma_sgt_req_cb *cb;
+	struct qdma_mm_xfer *xfer;
 	enum dma_data_direction dir;
-	int wait = 0;
-	int rv = 0;
+	u8 unmap_needed = 0;
+	int desc_nr;
+	int rv;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -2381,128 +3929,90 @@ ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
 		return -EINVAL;
 	}
 
-	if (!req) {
-		pr_err("req is NULL");
+	if (!req || !xfer_hndl) {
+		pr_err("req 0x%p, xfer_hndl 0x%p invalid.\n", req, xfer_hndl);
 		return -EINVAL;
 	}
 
-	wait = req->fp_done ? 0 : 1;
-
 	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 1);
 	if (!descq) {
 		pr_err("Invalid qid(%ld)", id);
 		return -EINVAL;
 	}
 
-	if (descq->conf.q_type == Q_CMPT) {
-		pr_err("Error : Transfer initiated on completion queue\n");
+	if (descq->conf.st || (descq->conf.q_type == Q_CMPT) ||
+	    (descq->conf.desc_bypass && descq->conf.fp_bypass_desc_fill)) {
+		pr_err("%s: not a MM queue with driver built descriptors.\n",
+			descq->conf.name);
 		return -EINVAL;
 	}
 
-	cb = qdma_req_cb_get(req);
-
-	pr_debug("%s %s-%s, data len %u, sg cnt %u. ping_pong_en=%d\n",
-		descq->conf.name, descq->conf.st ? "ST" : "MM",
-		(descq->conf.q_type == Q_C2H) ? "C2H" : "H2C",
-		req->count, req->sgcnt, descq->conf.ping_pong_en);
-
-	/** Identify the direction of the transfer */
-	dir = (descq->conf.q_type == Q_C2H) ?  DMA_FROM_DEVICE : DMA_TO_DEVICE;
-
-	/** If write request is given on the C2H direction
-	 *  OR, a read request given on non C2H direction
-	 *  then, its an invalid request, return error in this case
-	 */
-	if ((req->write && (descq->conf.q_type != Q_H2C)) ||
-	    (!req->write && (descq->conf.q_type != Q_C2H))) {
+	if (req->write != (descq->conf.q_type == Q_H2C)) {
 		pr_err("%s: bad direction, %c.\n",
 			descq->conf.name, req->write ? 'W' : 'R');
 		return -EINVAL;
 	}
 
-	/** Reset the local cb request with 0's */
-	memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
-	/** Initialize the wait queue */
-	qdma_waitq_init(&cb->wq);
-
-	pr_debug("%s: data len %u, ep 0x%llx, sgl 0x%p, sgl cnt %u, tm %u ms.\n",
-		descq->conf.name, req->count, req->ep_addr, req->sgl,
-		req->sgcnt, req->timeout_ms);
-
-	/** If the request is streaming mode C2H, invoke the
-	 *  handler to perform the read operation
-	 */
-	if (descq->conf.st && (descq->conf.q_type == Q_C2H))
-		return qdma_request_submit_st_c2h(xdev, descq, req);
-
+	dir = req->write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
 	if (!req->dma_mapped) {
-		rv = sgl_map(xdev->conf.pdev,  req->sgl, req->sgcnt, dir);
+		rv = sgl_map(xdev->conf.pdev, req->sgl, req->sgcnt, dir);
 		if (rv < 0) {
 			pr_err("%s map sgl %u failed, %u.\n",
 				descq->conf.name, req->sgcnt, req->count);
-			goto unmap_sgl;
+			return rv;
 		}
-		cb->unmap_needed = 1;
+		unmap_needed = 1;
 	}
 
-	lock_descq(descq);
-	/**  if the descq is already in online state*/
-	if (descq->q_state != Q_STATE_ONLINE) {
-		unlock_descq(descq);
-		pr_err("%s descq %s NOT online.\n",
-			xdev->conf.name, descq->conf.name);
-		rv = -EINVAL;
+	desc_nr = qdma_mm_xfer_build(descq, req, NULL);
+	if (desc_nr < 0 || desc_nr >= descq->conf.rngsz) {
+		pr_err("%s: req %u/%u, %d desc, ring %u.\n",
+			descq->conf.name, req->sgcnt, req->count, desc_nr,
+			descq->conf.rngsz);
+		rv = desc_nr < 0 ? desc_nr : -E2BIG;
 		goto unmap_sgl;
 	}
-	qdma_work_queue_add(descq, cb);
-	unlock_descq(descq);
-
-	pr_debug("%s: cb 0x%p submitted.\n", descq->conf.name, cb);
-
-	qdma_descq_proc_sgt_request(descq);
-
-	if (!wait)
-		return 0;
 
-	rv = qdma_request_wait_for_cmpl(xdev, descq, req);
-	if (rv < 0)
+	xfer = kzalloc(sizeof(struct qdma_mm_xfer) +
+			desc_nr * sizeof(struct qdma_mm_desc), GFP_KERNEL);
+	if (!xfer) {
+		pr_err("%s: xfer %d desc OOM.\n", descq->conf.name, desc_nr);
+		rv = -ENOMEM;
 		goto unmap_sgl;
+	}
+	memcpy(&xfer->req, req, sizeof(struct qdma_request));
+	xfer->req.dma_mapped = 1;
+	xfer->descq = descq;
+	xfer->unmap_needed = unmap_needed;
+	xfer->desc_nr = qdma_mm_xfer_build(descq, &xfer->req, xfer->desc);
 
-	return cb->offset;
+	*xfer_hndl = (unsigned long)xfer;
+	return 0;
 
 unmap_sgl:
-	if (!req->dma_mapped)
-		sgl_unmap(xdev->conf.pdev,  req->sgl, req->sgcnt, dir);
-
+	if (unmap_needed)
+		sgl_unmap(xdev->conf.pdev, req->sgl, req->sgcnt, dir);
 	return rv;
 }
 
 /*****************************************************************************/
 /**
- * qdma_batch_request_submit() - submit a batch of scatter-gather list of data
- *  for dma operation (for both read and write)
- * This is a callback function called from upper layer(character device)
- * to handle the read/write request on the queues
+ * qdma_mm_xfer_submit() - submit a prepared MM transfer
  *
  * @param[in]	dev_hndl:	hndl retured from qdma_device_open()
- * @param[in]	id:			queue index
- * @param[in]	count:		Number of qdma requests
- * @param[in]	reqv:		qdma request vector
+ * @param[in]	xfer_hndl:	hndl retured from qdma_mm_xfer_prepare()
  *
- * @return	# of bytes transferred
+ * @return	# of bytes transferred, 0 if fp_done is set
  * @return	<0: error
  *****************************************************************************/
-ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
-			  unsigned long count, struct qdma_request **reqv)
+ssize_t qdma_mm_xfer_submit(unsigned long dev_hndl, unsigned long xfer_hndl)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_mm_xfer *xfer = (struct qdma_mm_xfer *)xfer_hndl;
+	struct qdma_request *req;
 	struct qdma_descq *descq;
 	struct qdma_sgt_req_cb *cb;
-	enum dma_data_direction dir;
-	int rv = 0;
-	unsigned long i;
-	struct qdma_request *req;
-	int st_c2h = 0;
+	int rv;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -2515,98 +4025,106 @@ ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 		return -EINVAL;
 	}
 
-	if (!reqv) {
-		pr_err("reqv is NULL");
-		return -EINVAL;
-	}
-
-	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 0);
-	if (!descq) {
-		pr_err("Invalid qid(%ld)", id);
-		return -EINVAL;
-	}
-
-	if (descq->conf.q_type == Q_CMPT) {
-		pr_err("Error : Transfer initiated on completion queue\n");
+	if (!xfer) {
+		pr_err("xfer_hndl is NULL");
 		return -EINVAL;
 	}
 
-	st_c2h = (descq->conf.st && (descq->conf.q_type == Q_C2H)) ? 1 : 0;
-
-	/** Identify the direction of the transfer */
-	dir = (descq->conf.q_type == Q_C2H) ?  DMA_FROM_DEVICE : DMA_TO_DEVICE;
+	descq = xfer->descq;
+	req = &xfer->req;
+	cb = qdma_req_cb_get(req);
 
-	req = reqv[0];
-	/** If write request is given on the C2H direction
-	 *  OR, a read request given on non C2H direction
-	 *  then, its an invalid request, return error in this case
-	 */
-	if ((req->write && (descq->conf.q_type != Q_H2C))
-			|| (!req->write && (descq->conf.q_type != Q_C2H))) {
-		pr_err("%s: bad direction, %c.\n", descq->conf.name,
-				req->write ? 'W' : 'R');
+	lock_descq(descq);
+	if (descq->q_state != Q_STATE_ONLINE) {
+		unlock_descq(descq);
+		pr_err("%s descq %s NOT online.\n",
+			xdev->conf.name, descq->conf.name);
 		return -EINVAL;
 	}
-	if (!req->fp_done) {
-		pr_err("%s: missing fp_done.\n", descq->conf.name);
-		return -EINVAL;
+	if (xfer->submitted && !cb->done) {
+		unlock_descq(descq);
+		pr_err("%s: xfer 0x%p still in flight.\n",
+			descq->conf.name, xfer);
+		return -EBUSY;
 	}
 
-	if (st_c2h) {
-		for (i = 0; i < count; i++) {
-			req = reqv[i];
-			cb = qdma_req_cb_get(req);
-			/** Reset the local cb request with 0's */
-			memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
+	/** Reset the local cb request with 0's */
+	memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
+	cb->prepared = 1;
+	cb->submit_ns = ktime_to_ns(ktime_get());
+	qdma_waitq_init(&cb->wq);
+	xfer->submitted = 1;
+	trace_qdma_req_submit(descq, req);
+	qdma_work_queue_add(descq, cb);
+	unlock_descq(descq);
 
-			rv = qdma_request_submit_st_c2h(xdev, descq, req);
-			if ((rv < 0) || (rv == req->count))
-				req->fp_done(req, rv, rv);
-		}
+	qdma_descq_proc_sgt_request(descq);
 
+	if (req->fp_done)
 		return 0;
 
-	} else {
-		struct pci_dev *pdev = xdev->conf.pdev;
+	rv = qdma_request_wait_for_cmpl(xdev, descq, req);
+	if (rv < 0) {
+		/** timed out and dequeued, allow the next submission */
+		lock_descq(descq);
+		cb->done = 1;
+		unlock_descq(descq);
+		return rv;
+	}
 
-		for (i = 0; i < count; i++) {
-			req = reqv[i];
-			cb = qdma_req_cb_get(req);
-			/** Reset the local cb request with 0's */
-			memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
+	return cb->offset;
+}
 
-			if (!req->dma_mapped) {
-				rv = sgl_map(pdev, req->sgl, req->sgcnt, dir);
-				if (unlikely(rv < 0)) {
-					pr_err("%s map sgl %u failed, %u.\n",
-						descq->conf.name,
-						req->sgcnt,
-						req->count);
-					req->fp_done(req, 0, rv);
-				}
-				cb->unmap_needed = 1;
-			}
-		}
-	}
+/*****************************************************************************/
+/**
+ * qdma_mm_xfer_release() - release a prepared MM transfer
+ *
+ * @param[in]	dev_hndl:	hndl retured from qdma_device_open()
+ * @param[in]	xfer_hndl:	hndl retured from qdma_mm_xfer_prepare()
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_mm_xfer_release(unsigned long dev_hndl, unsigned long xfer_hndl)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_mm_xfer *xfer = (struct qdma_mm_xfer *)xfer_hndl;
+	struct qdma_descq *descq;
+	struct qdma_sgt_req_cb *cb;
+	int busy;
 
-	lock_descq(descq);
-	/**  if the descq is already in online state*/
-	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
-		unlock_descq(descq);
-		pr_err("%s descq %s NOT online.\n", xdev->conf.name,
-				descq->conf.name);
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
 		return -EINVAL;
 	}
 
-	for (i = 0; i < count; i++) {
-		req = reqv[i];
-		cb = qdma_req_cb_get(req);
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
 
-		list_add_tail(&cb->list, &descq->work_list);
+	if (!xfer) {
+		pr_err("xfer_hndl is NULL");
+		return -EINVAL;
 	}
+
+	descq = xfer->descq;
+	cb = qdma_req_cb_get(&xfer->req);
+
+	lock_descq(descq);
+	busy = xfer->submitted && !cb->done;
 	unlock_descq(descq);
+	if (busy) {
+		pr_err("%s: xfer 0x%p still in flight.\n",
+			descq->conf.name, xfer);
+		return -EBUSY;
+	}
 
-	qdma_descq_proc_sgt_request(descq);
+	if (xfer->unmap_needed)
+		sgl_unmap(xdev->conf.pdev, xfer->req.sgl, xfer->req.sgcnt,
+			xfer->req.write ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+	kfree(xfer);
 
 	return 0;
 }
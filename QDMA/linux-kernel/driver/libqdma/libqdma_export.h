@@ -84,13 +84,24 @@
 /**
  * QDMA_REQ_OPAQUE_SIZE - Maximum request length
  */
-#define QDMA_REQ_OPAQUE_SIZE	80
+#define QDMA_REQ_OPAQUE_SIZE	96
 
 /**
  * QDMA_UDD_MAXLEN - Maximum length of the user defined data
  */
 #define QDMA_UDD_MAXLEN		32
 
+/**
+ * QDMA_Q_STATS_LAT_BUCKETS - Number of request completion latency buckets,
+ * bucket n counts the requests completed in [2^(n-1), 2^n) us
+ */
+#define QDMA_Q_STATS_LAT_BUCKETS	16
+
+/**
+ * QDMA_STRIPE_Q_MAX - Maximum number of queues a request can be striped over
+ */
+#define QDMA_STRIPE_Q_MAX	16
+
 /** @} */
 
 
@@ -116,6 +127,19 @@ enum qdma_q_dir {
 	QDMA_Q_DIR_C2H
 };
 
+/**
+ * Completion service priority class of the queue
+ *
+ * High priority queues are serviced first with a small budget, bulk
+ * queues share the time left
+ * @ingroup libqdma_enums
+ */
+enum qdma_q_prio {
+	/** bulk, the default */
+	QDMA_Q_PRIO_BULK,
+	/** high priority */
+	QDMA_Q_PRIO_HIGH
+};
 
 /**
  * PF/VF qdma driver modes
@@ -655,6 +679,14 @@ struct qdma_queue_conf {
 	unsigned long quld;		/* set by user for per Q data */
 	/**  acummulate PIDX to batch packets */
 	u32 pidx_acc:8;
+	/**  MM, ST H2C: rate the queue may post at in Mbit/s, 0: unlimited */
+	u32 rl_rate_mbps;
+	/**  rate limit bucket depth in bytes, 0: 1ms worth of the rate */
+	u32 rl_burst;
+	/**  may post above rl_rate_mbps while the function has bandwidth left */
+	u8 rl_borrow:1;
+	/**  completion service priority class, enum qdma_q_prio */
+	u8 prio:1;
 	/**
 	 *  @brief  Q interrupt top, per-queue additional handling
 	 *  code for example, network rx napi_schedule(&Q->napi)
@@ -838,6 +870,68 @@ struct qdma_queue_count {
 	u32 cmpt_qcnt;
 };
 
+/**
+ * Per phase timing of a bulk queue operation
+ * @ingroup libqdma_struct
+ */
+struct qdma_q_bulk_stats {
+	/** number of queues processed successfully */
+	unsigned int q_cnt;
+	/** time spent validating and completing the queue configuration */
+	u64 prep_ns;
+	/** time spent allocating the rings and buffers */
+	u64 alloc_ns;
+	/** time spent programming/clearing the hw contexts */
+	u64 ctxt_ns;
+	/** total time of the operation */
+	u64 total_ns;
+};
+
+/**
+ * Per queue statistics, each counter has a single writer (the queue's
+ * service context) so they are read without locking
+ * @ingroup libqdma_struct
+ */
+struct qdma_q_stats {
+	/** number of packets/requests completed */
+	u64 pkts;
+	/** number of bytes transferred */
+	u64 bytes;
+	/** number of descriptors completed */
+	u64 descs;
+	/** number of pidx doorbell writes */
+	u64 doorbells;
+	/** number of data interrupts serviced */
+	u64 irqs;
+	/** number of requests/completions finished with an error */
+	u64 errors;
+	/** request completion latency histogram, log2 us buckets */
+	u64 lat_bucket[QDMA_Q_STATS_LAT_BUCKETS];
+	/** number of times posting was held back by the rate limiter */
+	u64 rl_throttled;
+	/** time spent held back by the rate limiter in ns */
+	u64 rl_throttle_ns;
+	/** bytes posted above the queue rate on unused function bandwidth */
+	u64 rl_borrowed;
+};
+
+/**
+ * Per device packet statistics, summed over all cpus
+ * @ingroup libqdma_struct
+ */
+struct qdma_dev_stats {
+	/** mm h2c packets processed */
+	u64 mm_h2c_pkts;
+	/** mm c2h packets processed */
+	u64 mm_c2h_pkts;
+	/** st h2c packets processed */
+	u64 st_h2c_pkts;
+	/** st c2h packets processed */
+	u64 st_c2h_pkts;
+	/** number of times a queue was held back by the function rate limit */
+	u64 rl_fn_throttled;
+};
+
 
 /**
  * Initializes the QDMA core library
@@ -1099,6 +1193,51 @@ int qdma_device_get_ping_pong_max_lat(unsigned long dev_hndl,
 int qdma_device_get_ping_pong_tot_lat(unsigned long dev_hndl,
 				unsigned long long *lat_total);
 
+/*****************************************************************************/
+/**
+ * Get a snapshot of the device packet counters
+ *
+ * @param dev_hndl	dev_hndl retunred from qdma_device_open()
+ * @param stats		device statistics
+ *
+ * @returns		0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_device_get_stats(unsigned long dev_hndl,
+				struct qdma_dev_stats *stats);
+
+/*****************************************************************************/
+/**
+ * Set the rate limit of the function, the ceiling of all its queues
+ *
+ * Queues within their own rate limit always post and count against the
+ * function, queues without a rate limit or borrowing above it post while
+ * the function bucket has tokens.
+ *
+ * @param dev_hndl	dev_hndl retunred from qdma_device_open()
+ * @param rate_mbps	rate in Mbit/s, 0: unlimited
+ * @param burst		bucket depth in bytes, 0: 1ms worth of the rate
+ *
+ * @returns		0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_device_set_rate_limit(unsigned long dev_hndl, u32 rate_mbps,
+				u32 burst);
+
+/*****************************************************************************/
+/**
+ * Get the rate limit of the function
+ *
+ * @param dev_hndl	dev_hndl retunred from qdma_device_open()
+ * @param rate_mbps	rate in Mbit/s, 0: unlimited
+ * @param burst		bucket depth in bytes
+ *
+ * @returns		0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_device_get_rate_limit(unsigned long dev_hndl, u32 *rate_mbps,
+				u32 *burst);
+
 /*****************************************************************************/
 /**
  * Set the current device configuration
@@ -1278,6 +1417,74 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 				int buflen);
 
+/*****************************************************************************/
+/**
+ * Add a range of queues with the same configuration
+ *
+ * If qconf->qidx is QDMA_QUEUE_IDX_INVALID, libqdma picks the queue indexes,
+ * otherwise queues qconf->qidx ~ qconf->qidx + q_cnt - 1 are added.
+ * On failure the queues added so far are left in place, stats->q_cnt holds
+ * their count.
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param qconf		queue configuration parameters, used as a template
+ * @param q_cnt		number of queues to add
+ * @param qhndls	array of q_cnt entries to hold the opaque qhndls
+ * @param stats		per phase timing, can be NULL
+ * @param buflen	length of the input buffer
+ * @param buf		message buffer
+ *
+ * @returns		0: success <0: error
+ *****************************************************************************/
+int qdma_queue_add_bulk(unsigned long dev_hndl, struct qdma_queue_conf *qconf,
+			unsigned int q_cnt, unsigned long *qhndls,
+			struct qdma_q_bulk_stats *stats, char *buf, int buflen);
+
+/*****************************************************************************/
+/**
+ * Start a set of queues
+ *
+ * All the queues are validated first, then the rings of all the queues are
+ * allocated in parallel and finally the hw contexts are programmed back to
+ * back. If the validation or the allocation fails none of the queues are
+ * started. If programming a context fails, the queues started before it
+ * stay online and stats->q_cnt holds their count.
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param qhndls	array of opaque qhndls
+ * @param q_cnt		number of entries in qhndls
+ * @param stats		per phase timing, can be NULL
+ * @param buflen	length of the input buffer
+ * @param buf		message buffer
+ *
+ * @returns		0 for success and <0 for error
+ *****************************************************************************/
+int qdma_queue_start_bulk(unsigned long dev_hndl, unsigned long *qhndls,
+			unsigned int q_cnt, struct qdma_q_bulk_stats *stats,
+			char *buf, int buflen);
+
+/*****************************************************************************/
+/**
+ * Stop a set of queues
+ *
+ * All the queues are validated first, then all of them stop accepting
+ * requests and the requests in flight drain in parallel, finally the hw
+ * contexts are cleared back to back. If the validation fails none of the
+ * queues are stopped. An empty set is a no-op.
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param qhndls	array of opaque qhndls
+ * @param q_cnt		number of entries in qhndls
+ * @param stats		per phase timing, can be NULL
+ * @param buflen	length of the input buffer
+ * @param buf		message buffer
+ *
+ * @returns		0 for success and <0 for error
+ *****************************************************************************/
+int qdma_queue_stop_bulk(unsigned long dev_hndl, unsigned long *qhndls,
+			unsigned int q_cnt, struct qdma_q_bulk_stats *stats,
+			char *buf, int buflen);
+
 /*****************************************************************************/
 /**
  * Get the state of the queue
@@ -1309,6 +1516,26 @@ int qdma_get_queue_state(unsigned long dev_hndl, unsigned long id,
 int qdma_queue_remove(unsigned long dev_hndl, unsigned long id, char *buf,
 				int buflen);
 
+/*****************************************************************************/
+/**
+ * Remove a set of queues
+ *
+ * All the queues are validated first, if one of them is not stopped none of
+ * them are removed. An empty set is a no-op.
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param qhndls	array of opaque qhndls
+ * @param q_cnt		number of entries in qhndls
+ * @param stats		per phase timing, can be NULL
+ * @param buflen	length of the input buffer
+ * @param buf		message buffer
+ *
+ * @returns		0 for success and <0 for error
+ *****************************************************************************/
+int qdma_queue_remove_bulk(unsigned long dev_hndl, unsigned long *qhndls,
+			unsigned int q_cnt, struct qdma_q_bulk_stats *stats,
+			char *buf, int buflen);
+
 /*****************************************************************************/
 /**
  * retrieve the configuration of a queue
@@ -1371,6 +1598,38 @@ int qdma_config_reg_dump(unsigned long dev_hndl, char *buf,
 int qdma_queue_dump(unsigned long dev_hndl, unsigned long id, char *buf,
 				int buflen);
 
+/*****************************************************************************/
+/**
+ * Get a snapshot of a queue's statistics
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param id		an opaque queue handle of type unsigned long
+ * @param stats		queue statistics
+ *
+ * @returns		0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_queue_get_stats(unsigned long dev_hndl, unsigned long id,
+				struct qdma_q_stats *stats);
+
+/*****************************************************************************/
+/**
+ * Change the rate limit of a MM or ST H2C queue, it applies from the next
+ * request posted and is kept until the queue is started again
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param id		an opaque queue handle of type unsigned long
+ * @param rate_mbps	rate in Mbit/s, 0: unlimited
+ * @param burst		bucket depth in bytes, 0: 1ms worth of the rate
+ * @param borrow	may post above rate_mbps while the function has
+ *			bandwidth left
+ *
+ * @returns		0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_queue_set_rate_limit(unsigned long dev_hndl, unsigned long id,
+				u32 rate_mbps, u32 burst, u8 borrow);
+
 /*****************************************************************************/
 /**
  * Display a queue's descriptor ring from index start
@@ -1461,6 +1720,103 @@ ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
 ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 			  unsigned long count, struct qdma_request **reqv);
 
+/*****************************************************************************/
+/**
+ * Cancel a request submitted with fp_done set, as long as none of it has
+ * been handed to the engine. A cancelled request is not completed through
+ * fp_done, the caller owns its buffers again.
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param id		queue index
+ * @param req		qdma request
+ *
+ * @returns		0: cancelled
+ * @returns		-EINPROGRESS: descriptors posted, fp_done will be called
+ * @returns		-EALREADY: completed already or not queued
+ * @returns		<0 for other errors
+ *
+ *****************************************************************************/
+int qdma_request_cancel(unsigned long dev_hndl, unsigned long id,
+			struct qdma_request *req);
+
+/*****************************************************************************/
+/**
+ * Submit a MM request striped across a group of queues
+ *
+ * The sgl is split into stripe_len sized stripes with matching ep_addr
+ * offsets, stripe n is queued on qhndls[n % q_cnt] and all the queues are
+ * kicked before waiting. The request completes when its last stripe does:
+ * blocking if fp_done is not set, otherwise fp_done is called with the
+ * total bytes transferred and the first error seen.
+ * Keyhole queues are rejected, the stripes would all target the window
+ * base and interleave the stream behind it.
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param qhndls	queue group, MM queues of the request's direction
+ * @param q_cnt		number of queues in the group, <= QDMA_STRIPE_Q_MAX
+ * @param stripe_len	stripe size in bytes
+ * @param req		qdma request
+ *
+ * @returns		# of bytes transferred (0 with fp_done) for success
+ *			and <0 for error
+ *
+ *****************************************************************************/
+ssize_t qdma_stripe_request_submit(unsigned long dev_hndl,
+			unsigned long *qhndls, unsigned int q_cnt,
+			unsigned int stripe_len, struct qdma_request *req);
+
+/*****************************************************************************/
+/**
+ * Prepare a MM transfer for repeated submission
+ *
+ * The request's sgl is dma mapped (unless dma_mapped is set) and its
+ * descriptor chain built once. qdma_mm_xfer_submit() then only copies the
+ * chain into the ring and rings the doorbell. The request is copied, its
+ * sgl must stay valid until qdma_mm_xfer_release(). The transfer has to
+ * be released before its queue is stopped or removed.
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param id		MM queue index, driver built descriptors
+ * @param req		qdma request, the chain must fit in the ring
+ *
+ * filled in by libqdma:
+ * @param xfer_hndl	prepared transfer handle
+ *
+ * @returns		0 for success and <0 for error
+ *
+ *****************************************************************************/
+int qdma_mm_xfer_prepare(unsigned long dev_hndl, unsigned long id,
+			struct qdma_request *req, unsigned long *xfer_hndl);
+
+/*****************************************************************************/
+/**
+ * Submit a prepared MM transfer
+ *
+ * One submission can be in flight per prepared transfer. Blocking unless
+ * the request had fp_done set, fp_done is called with libqdma's copy of
+ * the request (uld_data is preserved).
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param xfer_hndl	hndl returned from qdma_mm_xfer_prepare()
+ *
+ * @returns		# of bytes transferred (0 with fp_done) for success
+ *			and <0 for error
+ *
+ *****************************************************************************/
+ssize_t qdma_mm_xfer_submit(unsigned long dev_hndl, unsigned long xfer_hndl);
+
+/*****************************************************************************/
+/**
+ * Release a prepared MM transfer
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param xfer_hndl	hndl returned from qdma_mm_xfer_prepare()
+ *
+ * @returns		0 for success and <0 for error (-EBUSY while in flight)
+ *
+ *****************************************************************************/
+int qdma_mm_xfer_release(unsigned long dev_hndl, unsigned long xfer_hndl);
+
 /*****************************************************************************/
 /**
  * Peek a receive (c2h) queue
@@ -1617,6 +1973,28 @@ int qdma_descq_read_cmpt_data(unsigned long dev_hndl, unsigned long id,
 				u32 *num_entries,  u8 **cmpt_entries,
 				char *buf, int buflen);
 
+/*****************************************************************************/
+/**
+ * Function to read the pending completion entries of a MM completion queue
+ * in bulk
+ *
+ * The entries are copied raw, including the color and error bits, and the
+ * consumer index is written to the hardware once per call. Safe to call
+ * from atomic context.
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param id		completion queue handle
+ * @param buf		buffer for the entries
+ * @param buflen	length of the buffer in bytes
+ * @param entry_len	if not NULL, filled with the completion entry size
+ *
+ * @returns		number of entries copied or <0 for error
+ *
+ *****************************************************************************/
+int qdma_descq_cmpt_read_raw(unsigned long dev_hndl, unsigned long id,
+				u8 *buf, unsigned int buflen,
+				unsigned int *entry_len);
+
 /*****************************************************************************/
 /**
  * Function to receive the queue count
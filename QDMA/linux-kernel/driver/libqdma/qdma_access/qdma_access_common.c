@@ -48,7 +48,7 @@ enum qdma_ip {
 int hw_monitor_reg(void *dev_hndl, uint32_t reg, uint32_t mask,
 		uint32_t val, uint32_t interval_us, uint32_t timeout_us)
 {
-	int count;
+	int count, fast_cnt;
 	uint32_t v;
 
 	if (!interval_us)
@@ -58,6 +58,17 @@ int hw_monitor_reg(void *dev_hndl, uint32_t reg, uint32_t mask,
 
 	count = timeout_us / interval_us;
 
+	/* Most indirect commands complete within a couple of register
+	 * reads, re-check back to back before falling back to interval
+	 * polling so that programming contexts for many queues is not
+	 * dominated by the poll interval
+	 */
+	for (fast_cnt = 0; fast_cnt < QDMA_REG_POLL_FAST_CNT; fast_cnt++) {
+		v = qdma_reg_read(dev_hndl, reg);
+		if ((v & mask) == val)
+			return QDMA_SUCCESS;
+	}
+
 	do {
 		v = qdma_reg_read(dev_hndl, reg);
 		if ((v & mask) == val)
@@ -120,6 +120,7 @@ enum ind_ctxt_cmd_sel {
 /* polling a register */
 #define	QDMA_REG_POLL_DFLT_INTERVAL_US	10		    /* 10us per poll */
 #define	QDMA_REG_POLL_DFLT_TIMEOUT_US	(500*1000)	/* 500ms */
+#define	QDMA_REG_POLL_FAST_CNT		8	/* reads before interval poll */
 
 /** Constants */
 #define QDMA_NUM_RING_SIZES                                 16
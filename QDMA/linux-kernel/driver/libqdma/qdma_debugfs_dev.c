@@ -36,6 +36,8 @@ enum dbgfs_dev_dbg_file_type {
 	DBGFS_DEV_DBGF_INFO = 0,
 	DBGFS_DEV_DBGF_REGS = 1,
 	DBGFS_DEV_DBGF_REG_INFO = 2,
+	DBGFS_DEV_DBGF_RING_ARENA = 3,
+	DBGFS_DEV_DBGF_PG_POOL = 4,
 	DBGFS_DEV_DBGF_END,
 };
 
@@ -108,6 +110,8 @@ static int dump_banner(char *dev_name, char *buf, int buf_sz)
 
 
 #define BANNER_LEN (81 * 5)
+#define DBGFS_RING_ARENA_SZ (1024)
+#define DBGFS_PG_POOL_SZ (1024)
 
 /*****************************************************************************/
 /**
@@ -294,6 +298,101 @@ static int dbgfs_dump_qdma_info(unsigned long dev_hndl, char *dev_name,
 	return len;
 }
 
+/*****************************************************************************/
+/**
+ * dbgfs_dump_ring_arena() - static function to dump ring arena utilization
+ *
+ * @param[in]	dev_hndl:	device handle
+ * @param[in]	dev_name:	device name
+ * @param[out]	data:	buffer holding the dump
+ * @param[out]	data_len:	size of the buffer
+ *
+ * @return	>=0: length of the dump
+ * @return	<0: error
+ *****************************************************************************/
+static int dbgfs_dump_ring_arena(unsigned long dev_hndl, char *dev_name,
+		char **data, int *data_len)
+{
+	int len = 0;
+	int rv;
+	char *buf = NULL;
+	int buflen = DBGFS_RING_ARENA_SZ + BANNER_LEN;
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+
+	if (!xdev)
+		return -EINVAL;
+
+	/** allocate memory */
+	buf = (char *) kzalloc(buflen, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	/* print the banner with device info */
+	rv = dump_banner(dev_name, buf + len, buflen - len);
+	if (rv < 0) {
+		pr_warn("insufficient space to dump ring arena banner, err =%d\n",
+				rv);
+		kfree(buf);
+		return len;
+	}
+	len += rv;
+
+	len += qdma_ring_arena_dump(&xdev->ring_arena, buf + len,
+			buflen - len);
+
+	*data = buf;
+	*data_len = buflen;
+
+	return len;
+}
+
+/*****************************************************************************/
+/**
+ * dbgfs_dump_pg_pool() - static function to dump C2H page pool utilization
+ *
+ * @param[in]	dev_hndl:	device handle
+ * @param[in]	dev_name:	device name
+ * @param[out]	data:	buffer holding the dump
+ * @param[out]	data_len:	size of the buffer
+ *
+ * @return	>=0: length of the dump
+ * @return	<0: error
+ *****************************************************************************/
+static int dbgfs_dump_pg_pool(unsigned long dev_hndl, char *dev_name,
+		char **data, int *data_len)
+{
+	int len = 0;
+	int rv;
+	char *buf = NULL;
+	int buflen = DBGFS_PG_POOL_SZ + BANNER_LEN;
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+
+	if (!xdev)
+		return -EINVAL;
+
+	/** allocate memory */
+	buf = (char *) kzalloc(buflen, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	/* print the banner with device info */
+	rv = dump_banner(dev_name, buf + len, buflen - len);
+	if (rv < 0) {
+		pr_warn("insufficient space to dump page pool banner, err =%d\n",
+				rv);
+		kfree(buf);
+		return len;
+	}
+	len += rv;
+
+	len += qdma_pg_pool_dump(&xdev->pg_pool, buf + len, buflen - len);
+
+	*data = buf;
+	*data_len = buflen;
+
+	return len;
+}
+
 /*****************************************************************************/
 /**
  * dbgfs_dump_intr_cntx() - static function to dump interrupt context
@@ -522,6 +621,12 @@ static ssize_t dev_dbg_file_read(struct file *fp, char __user *user_buffer,
 		} else if (type == DBGFS_DEV_DBGF_REG_INFO) {
 			rv = dbgfs_dump_qdma_reg_info(dev_priv->dev_hndl,
 					dev_priv->dev_name, &buf, &buf_len);
+		} else if (type == DBGFS_DEV_DBGF_RING_ARENA) {
+			rv = dbgfs_dump_ring_arena(dev_priv->dev_hndl,
+					dev_priv->dev_name, &buf, &buf_len);
+		} else if (type == DBGFS_DEV_DBGF_PG_POOL) {
+			rv = dbgfs_dump_pg_pool(dev_priv->dev_hndl,
+					dev_priv->dev_name, &buf, &buf_len);
 		}
 
 		if (rv < 0)
@@ -735,6 +840,74 @@ static ssize_t dev_reg_info_read(struct file *fp, char __user *user_buffer,
 	return dev_dbg_file_read(fp, user_buffer, count, ppos,
 			DBGFS_DEV_DBGF_REG_INFO);
 }
+
+/*****************************************************************************/
+/**
+ * dev_ring_arena_open() - static function to open ring arena debug file
+ *
+ * @param[in]	inode:	pointer to file inode
+ * @param[in]	fp:	pointer to file structure
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+static int dev_ring_arena_open(struct inode *inode, struct file *fp)
+{
+	return dev_dbg_file_open(inode, fp);
+}
+
+/*****************************************************************************/
+/**
+ * dev_ring_arena_read() - static function that executes ring arena read
+ *
+ * @param[in]	fp:	pointer to file structure
+ * @param[out]	user_buffer: pointer to user buffer
+ * @param[in]	count: size of data to read
+ * @param[in/out]	ppos: pointer to offset read
+ *
+ * @return	>0: size read
+ * @return	<0: error
+ *****************************************************************************/
+static ssize_t dev_ring_arena_read(struct file *fp, char __user *user_buffer,
+		size_t count, loff_t *ppos)
+{
+	return dev_dbg_file_read(fp, user_buffer, count, ppos,
+			DBGFS_DEV_DBGF_RING_ARENA);
+}
+
+/*****************************************************************************/
+/**
+ * dev_pg_pool_open() - static function to open page pool debug file
+ *
+ * @param[in]	inode:	pointer to file inode
+ * @param[in]	fp:	pointer to file structure
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+static int dev_pg_pool_open(struct inode *inode, struct file *fp)
+{
+	return dev_dbg_file_open(inode, fp);
+}
+
+/*****************************************************************************/
+/**
+ * dev_pg_pool_read() - static function that executes page pool read
+ *
+ * @param[in]	fp:	pointer to file structure
+ * @param[out]	user_buffer: pointer to user buffer
+ * @param[in]	count: size of data to read
+ * @param[in/out]	ppos: pointer to offset read
+ *
+ * @return	>0: size read
+ * @return	<0: error
+ *****************************************************************************/
+static ssize_t dev_pg_pool_read(struct file *fp, char __user *user_buffer,
+		size_t count, loff_t *ppos)
+{
+	return dev_dbg_file_read(fp, user_buffer, count, ppos,
+			DBGFS_DEV_DBGF_PG_POOL);
+}
 /*****************************************************************************/
 /**
  * dev_intr_cntx_open() -static function to open interrupt context debug file
@@ -843,6 +1016,18 @@ static int create_dev_dbg_files(struct xlnx_dma_dev *xdev,
 			fops->read = dev_reg_info_read;
 			fops->release = dev_dbg_file_release;
 			break;
+		case DBGFS_DEV_DBGF_RING_ARENA:
+			snprintf(dbgf[i].name, 64, "%s", "qdma_ring_arena");
+			fops->open = dev_ring_arena_open;
+			fops->read = dev_ring_arena_read;
+			fops->release = dev_dbg_file_release;
+			break;
+		case DBGFS_DEV_DBGF_PG_POOL:
+			snprintf(dbgf[i].name, 64, "%s", "qdma_pg_pool");
+			fops->open = dev_pg_pool_open;
+			fops->read = dev_pg_pool_read;
+			fops->release = dev_dbg_file_release;
+			break;
 		}
 	}
 
@@ -23,6 +23,8 @@
 
 #include <linux/kernel.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include "qdma_device.h"
 #include "qdma_intr.h"
@@ -33,6 +35,7 @@
 #include "qdma_access_common.h"
 #include "thread.h"
 #include "qdma_ul_ext.h"
+#include "qdma_trace.h"
 #include "version.h"
 #ifdef ERR_DEBUG
 #include "qdma_nl.h"
@@ -107,6 +110,107 @@ int qdma_sgl_find_offset(struct qdma_request *req, struct qdma_sw_sg **sg_p,
 	return -EINVAL;
 }
 
+/*
+ * Rate limiting: a queue within its own rate always posts and charges the
+ * function bucket too, so what is guaranteed to the queues counts against
+ * the function ceiling. A queue without a rate of its own, or a borrowing
+ * one above it, posts only while the function bucket has tokens, that is
+ * while the other queues leave bandwidth unused. A request is let through
+ * whole once the bucket is positive and may overdraw it, the queue is then
+ * held back until the debt is paid off.
+ */
+static inline int descq_rl_active(struct qdma_descq *descq)
+{
+	return descq->rl.bucket.rate_mbps ||
+		READ_ONCE(descq->xdev->fn_rl.bucket.rate_mbps);
+}
+
+static int descq_rl_admit(struct qdma_descq *descq)
+{
+	struct qdma_q_rl *qrl = &descq->rl;
+	struct qdma_fn_rl *frl = &descq->xdev->fn_rl;
+	u64 now = ktime_to_ns(ktime_get());
+	u64 wait_ns = 0;
+	u64 fn_wait_ns;
+
+	qrl->borrowing = 0;
+	if (qrl->bucket.rate_mbps) {
+		if (qdma_rl_bucket_refill(&qrl->bucket, now) > 0)
+			goto admit;
+		wait_ns = qdma_rl_bucket_wait_ns(&qrl->bucket);
+		if (!qrl->borrow)
+			goto throttle;
+		qrl->borrowing = 1;
+	}
+
+	spin_lock(&frl->lock);
+	if (!frl->bucket.rate_mbps ||
+	    qdma_rl_bucket_refill(&frl->bucket, now) > 0) {
+		spin_unlock(&frl->lock);
+		goto admit;
+	}
+	fn_wait_ns = qdma_rl_bucket_wait_ns(&frl->bucket);
+	spin_unlock(&frl->lock);
+
+	/* a borrower goes again as soon as either bucket lets it */
+	if (!qrl->borrowing || fn_wait_ns < wait_ns)
+		wait_ns = fn_wait_ns;
+	if (!qrl->throttled)
+		this_cpu_inc(descq->xdev->stats->rl_fn_throttled);
+
+throttle:
+	if (!qrl->throttled) {
+		qrl->throttled = 1;
+		qrl->throttle_start = now;
+		descq->stats.rl_throttled++;
+	}
+	qdma_q_rl_kick(qrl, wait_ns);
+	return -EAGAIN;
+
+admit:
+	if (unlikely(qrl->throttled)) {
+		qrl->throttled = 0;
+		descq->stats.rl_throttle_ns += now - qrl->throttle_start;
+	}
+	return 0;
+}
+
+static void descq_rl_charge(struct qdma_descq *descq, unsigned int bytes)
+{
+	struct qdma_q_rl *qrl = &descq->rl;
+	struct qdma_fn_rl *frl = &descq->xdev->fn_rl;
+
+	if (qrl->borrowing)
+		descq->stats.rl_borrowed += bytes;
+	else if (qrl->bucket.rate_mbps)
+		qdma_rl_bucket_charge(&qrl->bucket, bytes);
+
+	spin_lock(&frl->lock);
+	if (frl->bucket.rate_mbps)
+		qdma_rl_bucket_charge(&frl->bucket, bytes);
+	spin_unlock(&frl->lock);
+}
+
+/**
+ * descq_rl_throttled() - called with the descq lock held before posting the
+ * next request, true if the rate limit holds the queue back
+ */
+static inline bool descq_rl_throttled(struct qdma_descq *descq)
+{
+	if (likely(!descq_rl_active(descq)))
+		return false;
+
+	return descq_rl_admit(descq) < 0;
+}
+
+static void descq_rl_work(struct work_struct *work)
+{
+	struct qdma_descq *descq = container_of(work, struct qdma_descq,
+						rl.work);
+
+	qdma_descq_proc_sgt_request(descq);
+}
+
 void qdma_update_request(void *q_hndl, struct qdma_request *req,
 			unsigned int num_desc,
 			unsigned int data_cnt,
@@ -116,6 +220,10 @@ void qdma_update_request(void *q_hndl, struct qdma_request *req,
 	struct qdma_descq *descq = (struct qdma_descq *)q_hndl;
 	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
 
+	if (num_desc)
+		trace_qdma_desc_post(descq, req, num_desc, data_cnt);
+	if (data_cnt && descq_rl_active(descq))
+		descq_rl_charge(descq, data_cnt);
 	cb->desc_nr += num_desc;
 	cb->offset += data_cnt;
 	cb->sg_offset = sg_offset;
@@ -167,8 +275,7 @@ static inline int qdma_pidx_update(struct qdma_descq *descq,
 		goto exit_update;
 
 update:
-	ret = queue_pidx_update(descq->xdev, descq->conf.qidx,
-			descq->conf.q_type, &descq->pidx_info);
+	ret = descq_pidx_update(descq);
 	if (ret < 0) {
 		pr_err("%s: Failed to update pidx\n",
 				descq->conf.name);
@@ -181,6 +288,29 @@ exit_update:
 	return ret;
 }
 
+/*****************************************************************************/
+/**
+ * descq_mm_xfer_post() - copy a prepared descriptor chain into the ring
+ *
+ * @param[in]	descq:	pointer to qdma_descq
+ * @param[in]	xfer:	prepared transfer
+ * @param[in]	pidx:	ring index to start at
+ *
+ * @return	none
+ *****************************************************************************/
+static void descq_mm_xfer_post(struct qdma_descq *descq,
+				struct qdma_mm_xfer *xfer, unsigned int pidx)
+{
+	struct qdma_mm_desc *ring = (struct qdma_mm_desc *)descq->desc;
+	unsigned int n = min_t(unsigned int, xfer->desc_nr,
+				descq->conf.rngsz - pidx);
+
+	memcpy(ring + pidx, xfer->desc, n * sizeof(struct qdma_mm_desc));
+	if (n < xfer->desc_nr)
+		memcpy(ring, xfer->desc + n,
+			(xfer->desc_nr - n) * sizeof(struct qdma_mm_desc));
+}
+
 static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 {
 	int rv = 0;
@@ -232,6 +362,10 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 		unsigned int data_cnt = 0;
 		unsigned int desc_cnt = 0;
 		unsigned int len = 0;
+		/* end of desc_end, to extend it with a contiguous chunk */
+		unsigned int desc_len = 0;
+		dma_addr_t desc_src_end = 0;
+		u64 desc_ep_end = 0;
 		int i = 0;
 		int rv;
 
@@ -255,6 +389,35 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 		if (!desc_max)
 			break;
 
+		if (descq_rl_throttled(descq))
+			break;
+
+		if (cb->prepared) {
+			struct qdma_mm_xfer *xfer = container_of(req,
+						struct qdma_mm_xfer, req);
+
+			/** a prepared chain is always posted whole */
+			if (xfer->desc_nr > desc_max) {
+				descq_poll_mm_n_h2c_cmpl_status(descq);
+				if (xfer->desc_nr > descq->avail)
+					break;
+			}
+
+			descq_mm_xfer_post(descq, xfer, pidx);
+			desc_cnt = xfer->desc_nr;
+			data_cnt = req->count;
+			pidx += desc_cnt;
+			if (pidx >= rngsz)
+				pidx -= rngsz;
+			desc = (struct qdma_mm_desc *)descq->desc + pidx;
+
+			qdma_update_request(descq, req, desc_cnt, data_cnt, 0,
+					    NULL);
+			descq->pidx = pidx;
+			descq->avail -= desc_cnt;
+			goto update_pidx;
+		}
+
 		if (is_ul_ext) {
 			int desc_consumed =
 				qconf->fp_bypass_desc_fill(descq,
@@ -309,37 +472,55 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 						len = ep_addr_max - ep_addr + 1;
 				}
 
-				desc_end = desc;
-				sg_offset += len;
-
-				desc->rsvd1 = 0UL;
-				desc->rsvd0 = 0U;
-
-				if (descq->conf.q_type == Q_C2H) {
-					desc->src_addr = ep_addr;
-					desc->dst_addr = src_addr;
+				/*
+				 * dma contiguous with the previous descriptor
+				 * and not wrapped in the keyhole: grow it up to
+				 * the aperture instead of starting a new one
+				 */
+				if (desc_end && src_addr == desc_src_end &&
+				    ep_addr == desc_ep_end &&
+				    desc_len < aperture) {
+					len = min_t(unsigned int, len,
+						    aperture - desc_len);
+					desc_end->flag_len += len;
+					desc_len += len;
 				} else {
-					desc->dst_addr = ep_addr;
-					desc->src_addr = src_addr;
+					desc_end = desc;
+					desc_len = len;
+
+					desc->rsvd1 = 0UL;
+					desc->rsvd0 = 0U;
+
+					if (descq->conf.q_type == Q_C2H) {
+						desc->src_addr = ep_addr;
+						desc->dst_addr = src_addr;
+					} else {
+						desc->dst_addr = ep_addr;
+						desc->src_addr = src_addr;
+					}
+
+					desc->flag_len = len;
+					desc->flag_len |= (1 << S_DESC_F_DV);
+
+					if (++pidx == rngsz) {
+						pidx = 0;
+						desc =
+						(struct qdma_mm_desc *)descq->desc;
+					} else {
+						desc++;
+					}
+					desc_cnt++;
 				}
 
-				desc->flag_len = len;
-				desc->flag_len |= (1 << S_DESC_F_DV);
+				sg_offset += len;
 				ep_addr += len;
 				data_cnt += len;
 				src_addr += len;
 				tlen -= len;
 				pg_off += len;
+				desc_src_end = src_addr;
+				desc_ep_end = ep_addr;
 
-				if (++pidx == rngsz) {
-					pidx = 0;
-					desc =
-					(struct qdma_mm_desc *)descq->desc;
-				} else {
-					desc++;
-				}
-
-				desc_cnt++;
 				if (desc_cnt == desc_max)
 					break;
 			} while (tlen);
@@ -379,8 +560,7 @@ update_pidx:
 	if (desc_written) {
 		descq->pend_list_empty = 0;
 		descq->pidx_info.pidx = descq->pidx;
-		rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
-				descq->conf.q_type, &descq->pidx_info);
+		rv = descq_pidx_update(descq);
 		if (unlikely(rv < 0)) {
 			pr_err("%s: Failed to update pidx\n",
 					descq->conf.name);
@@ -429,6 +609,8 @@ static ssize_t descq_proc_st_h2c_request_qep(struct qdma_descq *descq)
 
 setup_desc:
 	while (qdma_work_queue_len(descq) && descq->avail) {
+		if (descq_rl_throttled(descq))
+			break;
 		req = qdma_work_queue_first_entry(descq);
 		desc_cnt = descq->conf.fp_bypass_desc_fill(descq,
 			QDMA_Q_MODE_ST, QDMA_Q_DIR_H2C, req);
@@ -445,7 +627,8 @@ setup_desc:
 	if (unlikely(!desc_written)) {
 		/* packet queued while holding lock and no interrupt pending */
 		if (unlikely(qdma_work_queue_len(descq) &&
-				descq->avail == descq->conf.rngsz - 1)) {
+				descq->avail == descq->conf.rngsz - 1 &&
+				!descq->rl.throttled)) {
 			unlock_descq(descq);
 			descq_proc_st_h2c_request_qep(descq);
 			return 0;
@@ -536,6 +719,9 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 		if (!desc_max)
 			break;
 
+		if (descq_rl_throttled(descq))
+			break;
+
 #ifdef DEBUG
 		pr_info("%s, req %u.\n", descq->conf.name, req->count);
 		sgl_dump(req->sgl, sg_max);
@@ -664,8 +850,7 @@ update_pidx:
 		}
 
 
-		ret = queue_pidx_update(descq->xdev, descq->conf.qidx,
-				descq->conf.q_type, &descq->pidx_info);
+		ret = descq_pidx_update(descq);
 		if (ret < 0) {
 			pr_err("%s: Failed to update pidx\n",
 					descq->conf.name);
@@ -714,7 +899,7 @@ static inline void desc_ring_free(struct xlnx_dma_dev *xdev, int ring_sz,
 	pr_debug("free %u(0x%x)=%d*%u+%d, 0x%p, bus 0x%llx.\n",
 		len, len, desc_sz, ring_sz, cs_sz, desc, desc_bus);
 
-	dma_free_coherent(&xdev->conf.pdev->dev,
+	qdma_ring_arena_free(&xdev->ring_arena,
 			((size_t)ring_sz * desc_sz + cs_sz),
 			desc, desc_bus);
 }
@@ -723,7 +908,7 @@ static void *desc_ring_alloc(struct xlnx_dma_dev *xdev, int ring_sz,
 			int desc_sz, int cs_sz, dma_addr_t *bus, u8 **cs_pp)
 {
 	unsigned int len = ring_sz * desc_sz + cs_sz;
-	u8 *p = dma_alloc_coherent(&xdev->conf.pdev->dev, len, bus, GFP_KERNEL);
+	u8 *p = qdma_ring_arena_alloc(&xdev->ring_arena, len, bus);
 
 	if (!p) {
 		pr_err("%s, OOM, sz ring %d, desc %d, cmpl status sz %d.\n",
@@ -740,7 +925,7 @@ static void *desc_ring_alloc(struct xlnx_dma_dev *xdev, int ring_sz,
 	return p;
 }
 
-static void desc_alloc_irq(struct qdma_descq *descq)
+void qdma_descq_alloc_irq(struct qdma_descq *descq)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
 	unsigned long flags;
@@ -829,6 +1014,7 @@ static int descq_mm_n_h2c_cmpl_status(struct qdma_descq *descq)
 	descq->credit += cr;
 
 	incr_cmpl_desc_cnt(descq, cr);
+	trace_qdma_cmpl_proc(descq, cr, 0);
 
 	/* completes requests */
 	pr_debug("%s %s, 0x%p, credit %u + %u.\n",
@@ -887,6 +1073,7 @@ void qdma_descq_init(struct qdma_descq *descq, struct xlnx_dma_dev *xdev,
 	INIT_LIST_HEAD(&descq->intr_list);
 	INIT_LIST_HEAD(&descq->legacy_intr_q_list);
 	INIT_WORK(&descq->work, intr_work);
+	qdma_q_rl_init(&descq->rl, descq_rl_work);
 	descq->xdev = xdev;
 	descq->channel = 0;
 	descq->qidx_hw = qdev->qbase + idx_hw;
@@ -950,8 +1137,7 @@ int qdma_q_init_pointers(void *q_hndl)
 				return 0;
 
 			descq->pidx_info.pidx = descq->conf.rngsz - 1;
-			rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
-					descq->conf.q_type, &descq->pidx_info);
+			rv = descq_pidx_update(descq);
 			if (unlikely(rv < 0)) {
 				pr_err("%s: Failed to update pidx\n",
 						descq->conf.name);
@@ -994,10 +1180,7 @@ int qdma_queue_update_pointers(unsigned long dev_hndl, unsigned long qhndl)
 				ret = -EBUSY;
 				goto func_exit;
 			}
-			ret = queue_pidx_update(descq->xdev,
-					descq->conf.qidx,
-					descq->conf.q_type,
-					&descq->pidx_info);
+			ret = descq_pidx_update(descq);
 			if (ret < 0) {
 				pr_err("%s: Failed to update pidx\n",
 						descq->conf.name);
@@ -1025,7 +1208,7 @@ func_exit:
 
 }
 
-int qdma_descq_alloc_resource(struct qdma_descq *descq)
+int qdma_descq_alloc_ring_resource(struct qdma_descq *descq)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
 	struct qdma_queue_conf *qconf = &descq->conf;
@@ -1137,9 +1320,6 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq)
 		descq->conf.rngsz, descq->conf.rngsz_cmpt, descq->desc,
 		descq->desc_cmpt);
 
-	/* interrupt vectors */
-	desc_alloc_irq(descq);
-
 	/* Fill in the descriptors with some hard coded value for testing */
 #ifdef TEST_64B_DESC_BYPASS_FEATURE
 	desc_bypass = descq->desc;
@@ -1162,6 +1342,19 @@ err_out:
 	return -ENOMEM;
 }
 
+int qdma_descq_alloc_resource(struct qdma_descq *descq)
+{
+	int rv = qdma_descq_alloc_ring_resource(descq);
+
+	if (rv < 0)
+		return rv;
+
+	/* interrupt vectors */
+	qdma_descq_alloc_irq(descq);
+
+	return 0;
+}
+
 void qdma_descq_free_resource(struct qdma_descq *descq)
 {
 	if (!descq)
@@ -1259,6 +1452,10 @@ void qdma_descq_config(struct qdma_descq *descq, struct qdma_queue_conf *qconf,
 		descq->conf.ping_pong_en = qconf->ping_pong_en;
 		descq->conf.aperture_size = qconf->aperture_size;
 		descq->conf.pidx_acc = qconf->pidx_acc;
+		descq->conf.rl_rate_mbps = qconf->rl_rate_mbps;
+		descq->conf.rl_burst = qconf->rl_burst;
+		descq->conf.rl_borrow = qconf->rl_borrow;
+		descq->conf.prio = qconf->prio;
 	}
 }
 
@@ -1322,6 +1519,16 @@ int qdma_descq_config_complete(struct qdma_descq *descq)
 	descq->credit = 0;
 	descq->work_req_pend = 0;
 
+	/* ST C2H posts what the device asks for, there is nothing to pace */
+	if (!(qconf->st && (qconf->q_type == Q_C2H)) &&
+			qconf->q_type != Q_CMPT)
+		qdma_rl_bucket_set(&descq->rl.bucket, qconf->rl_rate_mbps,
+				qconf->rl_burst);
+	else
+		qdma_rl_bucket_set(&descq->rl.bucket, 0, 0);
+	descq->rl.borrow = qconf->rl_borrow;
+	descq->rl.throttled = 0;
+
 	/* ST C2H only */
 	if ((qconf->st && (qconf->q_type == Q_C2H)) ||
 			(!qconf->st && (qconf->q_type == Q_CMPT))) {
@@ -1402,8 +1609,7 @@ int qdma_descq_prog_hw(struct qdma_descq *descq)
 				return rv;
 
 			descq->pidx_info.pidx = descq->conf.rngsz - 1;
-			rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
-					descq->conf.q_type, &descq->pidx_info);
+			rv = descq_pidx_update(descq);
 			if (unlikely(rv < 0)) {
 				pr_err("%s: Failed to update pidx\n",
 						descq->conf.name);
@@ -1425,7 +1631,7 @@ int qdma_descq_service_cmpl_update(struct qdma_descq *descq, int budget,
 		if (descq->q_state == Q_STATE_ONLINE) {
 			rv = descq_process_completion_st_c2h(descq, budget,
 						c2h_upd_cmpl);
-			if (rv && (rv != -ENODATA))
+			if ((rv < 0) && (rv != -ENODATA))
 				pr_err("Error detected in %s",
 				       descq->conf.name);
 		} else {
@@ -1473,25 +1679,56 @@ ssize_t qdma_descq_proc_sgt_request(struct qdma_descq *descq)
 
 void incr_cmpl_desc_cnt(struct qdma_descq *descq, unsigned int cnt)
 {
+	struct qdma_dev_stats __percpu *stats = descq->xdev->stats;
+
 	descq->total_cmpl_descs += cnt;
+	descq->stats.descs += cnt;
 	switch ((descq->conf.st << 1) | descq->conf.q_type) {
 	case 0:
-		descq->xdev->total_mm_h2c_pkts += cnt;
+		this_cpu_add(stats->mm_h2c_pkts, cnt);
 		break;
 	case 1:
-		descq->xdev->total_mm_c2h_pkts += cnt;
+		this_cpu_add(stats->mm_c2h_pkts, cnt);
 		break;
 	case 2:
-		descq->xdev->total_st_h2c_pkts += cnt;
+		this_cpu_add(stats->st_h2c_pkts, cnt);
 		break;
 	case 3:
-		descq->xdev->total_st_c2h_pkts += cnt;
+		this_cpu_add(stats->st_c2h_pkts, cnt);
 		break;
 	default:
 		break;
 	}
 }
 
+void descq_stats_lat_update(struct qdma_descq *descq, u64 submit_ns)
+{
+	u64 now = ktime_to_ns(ktime_get());
+	unsigned int idx = 0;
+
+	if (likely(now > submit_ns))
+		idx = fls64(div_u64(now - submit_ns, NSEC_PER_USEC));
+	if (idx >= QDMA_Q_STATS_LAT_BUCKETS)
+		idx = QDMA_Q_STATS_LAT_BUCKETS - 1;
+	descq->stats.lat_bucket[idx]++;
+}
+
+static inline void descq_stats_req_done(struct qdma_descq *descq,
+				struct qdma_sgt_req_cb *cb, int error)
+{
+	/* st c2h packets and bytes are accounted per completion entry */
+	if (!(descq->conf.st && (descq->conf.q_type == Q_C2H))) {
+		descq->stats.pkts++;
+		descq->stats.bytes += cb->offset;
+	}
+	if (unlikely(error))
+		descq->stats.errors++;
+	if (cb->submit_ns)
+		descq_stats_lat_update(descq, cb->submit_ns);
+	trace_qdma_req_done(descq, (struct qdma_request *)cb, cb->offset,
+			    error, cb->submit_ns);
+}
+
 void qdma_sgt_req_done(struct qdma_descq *descq, struct qdma_sgt_req_cb *cb,
 			int error)
 {
@@ -1516,11 +1753,13 @@ void qdma_sgt_req_done(struct qdma_descq *descq, struct qdma_sgt_req_cb *cb,
 				req, cb->offset, req->count);
 			error = -EINVAL;
 		}
+		descq_stats_req_done(descq, cb, error);
 		cb->status = error;
 		cb->done = 1;
 		req->fp_done(req, cb->offset, error);
 	} else {
 		pr_debug("req 0x%p, cb 0x%p, wake up.\n", req, cb);
+		descq_stats_req_done(descq, cb, error);
 		cb->status = error;
 		cb->done = 1;
 		qdma_waitq_wakeup(&cb->wq);
@@ -1717,12 +1956,21 @@ int qdma_descq_dump(struct qdma_descq *descq, char *buf, int buflen, int detail)
 		goto handle_truncation;
 
 	if (descq->conf.st && (descq->conf.q_type == Q_C2H)) {
+		struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+
 		cur += snprintf(cur, end - cur,
 			"\tcmpt desc 0x%p/0x%llx, %u\n",
 			descq->desc_cmpt, descq->desc_cmpt_bus,
 			descq->conf.rngsz_cmpt);
 		if (cur >= end)
 			goto handle_truncation;
+
+		cur += snprintf(cur, end - cur,
+			"\tflq pages %u, recycle %lu, alloc %lu, map %lu, alloc_fail %lu, mapping_err %lu\n",
+			flq->num_pages, flq->pg_recycle, flq->pg_alloc,
+			flq->pg_map, flq->alloc_fail, flq->mapping_err);
+		if (cur >= end)
+			goto handle_truncation;
 	}
 
 	if (!detail)
@@ -2113,3 +2361,87 @@ int qdma_descq_read_cmpt_data(unsigned long dev_hndl, unsigned long id,
 
 	return rv;
 }
+
+int qdma_descq_cmpt_read_raw(unsigned long dev_hndl, unsigned long id,
+				u8 *buf, unsigned int buflen,
+				unsigned int *entry_len)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq *descq;
+	struct qdma_c2h_cmpt_cmpl_status *cs;
+	unsigned int stride;
+	unsigned int rngsz;
+	unsigned int pend;
+	unsigned int cnt;
+	int rv;
+
+	if (!xdev || !buf) {
+		pr_err("Invalid dev_hndl 0x%lx, buf 0x%p", dev_hndl, buf);
+		return -EINVAL;
+	}
+
+	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 1);
+	if (!descq) {
+		pr_err("Invalid qid, qid = %ld", id);
+		return -EINVAL;
+	}
+
+	if (descq->conf.st || descq->conf.q_type != Q_CMPT) {
+		pr_err("%s: only MM completion queues supported",
+			descq->conf.name);
+		return -EINVAL;
+	}
+
+	stride = descq->cmpt_entry_len;
+	rngsz = descq->conf.rngsz_cmpt;
+	if (entry_len)
+		*entry_len = stride;
+	if (buflen < stride) {
+		pr_err("%s: buflen %u < cmpt entry %u",
+			descq->conf.name, buflen, stride);
+		return -EINVAL;
+	}
+
+	lock_descq(descq);
+	if (descq->q_state != Q_STATE_ONLINE || !descq->desc_cmpt) {
+		unlock_descq(descq);
+		return -EINVAL;
+	}
+
+	cs = (struct qdma_c2h_cmpt_cmpl_status *)
+				descq->desc_cmpt_cmpl_status;
+	pend = ring_idx_delta(cs->pidx, descq->cidx_cmpt, rngsz);
+	cnt = min(pend, buflen / stride);
+	if (!cnt && descq->xdev->conf.qdma_drv_mode == POLL_MODE) {
+		unlock_descq(descq);
+		return 0;
+	}
+
+	/* entries are valid once the status pidx covers them */
+	dma_rmb();
+
+	if (cnt) {
+		unsigned int first = min(cnt, rngsz - descq->cidx_cmpt);
+
+		memcpy(buf, descq->desc_cmpt + (descq->cidx_cmpt * stride),
+			first * stride);
+		if (cnt > first)
+			memcpy(buf + (first * stride), descq->desc_cmpt,
+				(cnt - first) * stride);
+		descq->cidx_cmpt = ring_idx_incr(descq->cidx_cmpt, cnt, rngsz);
+	}
+
+	/* one cidx update for the whole batch, with nothing pending it
+	 * re-arms the interrupt
+	 */
+	descq->cmpt_cidx_info.wrb_cidx = descq->cidx_cmpt;
+	rv = queue_cmpt_cidx_update(descq->xdev, descq->conf.qidx,
+				&descq->cmpt_cidx_info);
+	unlock_descq(descq);
+	if (unlikely(rv < 0)) {
+		pr_err("%s: Failed to update cmpt cidx\n", descq->conf.name);
+		return -EINVAL;
+	}
+
+	return cnt;
+}
@@ -29,6 +29,7 @@
 #include "qdma_compat.h"
 #include "libqdma_export.h"
 #include "qdma_regs.h"
+#include "qdma_rl.h"
 #ifdef ERR_DEBUG
 #include "qdma_nl.h"
 #endif
@@ -152,6 +153,10 @@ struct qdma_descq {
 	unsigned int cidx_cmpt;
 	/** number of packets processed in q */
 	unsigned long long total_cmpl_descs;
+	/** queue statistics, kept on their own cache line */
+	struct qdma_q_stats stats ____cacheline_aligned_in_smp;
+	/** rate limiter, MM and ST H2C */
+	struct qdma_q_rl rl;
 	/** descriptor writeback, data type depends on the cmpt_entry_len */
 	void *desc_cmpt_cur;
 	/* descriptor list to be provided for ul extenstion call */
@@ -279,6 +284,31 @@ int qdma_descq_config_complete(struct qdma_descq *descq);
  *****************************************************************************/
 int qdma_descq_alloc_resource(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * qdma_descq_alloc_ring_resource() - allocate the descriptor/completion
+ *				      rings and buffers of a queue, without
+ *				      picking an interrupt vector
+ *
+ * Safe to call for different queues in parallel.
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int qdma_descq_alloc_ring_resource(struct qdma_descq *descq);
+
+/*****************************************************************************/
+/**
+ * qdma_descq_alloc_irq() - pick the least loaded interrupt vector for a queue
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_descq_alloc_irq(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * qdma_descq_free_resource() - free up the resources assigned to a request
@@ -319,7 +349,8 @@ int qdma_descq_context_cleanup(struct qdma_descq *descq);
  * @param[in]	budget:		number of descriptors to process
  * @param[in]	c2h_upd_cmpl:	C2H only: if update completion needed
  *
- * @return	0 - success, < 0 for failure
+ * @return	ST C2H: number of completions processed, 0 for other queues,
+ *		< 0 for failure
  *****************************************************************************/
 int qdma_descq_service_cmpl_update(struct qdma_descq *descq, int budget,
 			bool c2h_upd_cmpl);
@@ -389,6 +420,16 @@ void intr_cidx_update(struct qdma_descq *descq, unsigned int sw_cidx,
  *****************************************************************************/
 void incr_cmpl_desc_cnt(struct qdma_descq *descq, unsigned int cnt);
 
+/*****************************************************************************/
+/**
+ * descq_stats_lat_update() - account a request completion latency
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ * @param[in]	submit_ns:	request submission timestamp in ns
+ *
+ *****************************************************************************/
+void descq_stats_lat_update(struct qdma_descq *descq, u64 submit_ns);
+
 /**
  * @struct - qdma_sgt_req_cb
  * @brief	qdma_sgt_req_cb fits in qdma_request.opaque
@@ -416,11 +457,35 @@ struct qdma_sgt_req_cb {
 	u8 done;
 	/** indicates whether to unmap the kernel pages*/
 	u8 unmap_needed:1;
+	/** request is a qdma_mm_xfer, post its prepared descriptors */
+	u8 prepared:1;
+	/** request submission timestamp in ns, for the latency buckets */
+	u64 submit_ns;
 };
 
 /** macro to get the request call back data */
 #define qdma_req_cb_get(req)	(struct qdma_sgt_req_cb *)((req)->opaque)
 
+/**
+ * @struct - qdma_mm_xfer
+ * @brief	prepared MM transfer, its descriptor chain is built once and
+ *		copied into the ring as is on every submission
+ */
+struct qdma_mm_xfer {
+	/** request re-submitted by qdma_mm_xfer_submit() */
+	struct qdma_request req;
+	/** queue the chain was built for */
+	struct qdma_descq *descq;
+	/** sgl mapped by the prepare, unmap on release */
+	u8 unmap_needed:1;
+	/** submitted at least once */
+	u8 submitted:1;
+	/** number of descriptors in the chain, < ring size */
+	unsigned int desc_nr;
+	/** descriptor chain, sop on the first and eop on the last */
+	struct qdma_mm_desc desc[0];
+};
+
 /*****************************************************************************/
 /**
  * qdma_descq_proc_sgt_request() - handler to process the qdma
@@ -509,6 +574,14 @@ void cmpt_next(struct qdma_descq *descq);
 					pidx_info))
 #endif
 
+/* pidx doorbell of a descq, accounted in the queue statistics and traced,
+ * users need to include qdma_trace.h
+ */
+#define descq_pidx_update(descq) \
+	((descq)->stats.doorbells++, trace_qdma_doorbell(descq), \
+	 queue_pidx_update((descq)->xdev, (descq)->conf.qidx, \
+			   (descq)->conf.q_type, &(descq)->pidx_info))
+
 #ifndef __QDMA_VF__
 #define queue_cmpt_cidx_update(xdev, qid, cmpt_cidx_info) \
 	(xdev->hw.qdma_queue_cmpt_cidx_update(xdev, QDMA_DEV_PF, qid, \
@@ -24,6 +24,7 @@
 #include "qdma_device.h"
 #include "qdma_regs.h"
 #include "thread.h"
+#include "qdma_thread.h"
 #include "version.h"
 #include "qdma_mbox_protocol.h"
 #include "qdma_intr.h"
@@ -31,6 +32,7 @@
 #include "qdma_reg_dump.h"
 #endif
 #include "qdma_access_common.h"
+#include "qdma_trace.h"
 
 #ifndef __QDMA_VF__
 static LIST_HEAD(legacy_intr_q_list);
@@ -96,6 +98,23 @@ free_buf:
 #endif
 #endif
 
+/*
+ * queue the completion service of the queue, the high priority queues go to
+ * the high priority workqueue so they are not held up by the bulk ones
+ */
+static void intr_work_schedule(struct qdma_descq *descq)
+{
+	struct workqueue_struct *wq = system_wq;
+
+	if (descq->conf.prio == QDMA_Q_PRIO_HIGH)
+		wq = system_highpri_wq;
+
+	if (descq->cpu_assigned)
+		queue_work_on(descq->intr_work_cpu, wq, &descq->work);
+	else
+		queue_work(wq, &descq->work);
+}
+
 #ifndef MBOX_INTERRUPT_DISABLE
 static irqreturn_t mbox_intr_handler(int irq_index, int irq, void *dev_id)
 {
@@ -225,15 +244,13 @@ static void data_intr_aggregate(struct xlnx_dma_dev *xdev, int vidx, int irq,
 			descq->conf.q_type == Q_C2H && descq->conf.st)
 			descq->ping_pong_rx_time = timestamp;
 
+		descq->stats.irqs++;
+		trace_qdma_cmpl_detect(descq, QDMA_TRACE_DETECT_IRQ);
 		if (descq->conf.fp_descq_isr_top) {
 			descq->conf.fp_descq_isr_top(descq->q_hndl,
 					descq->conf.quld);
 		} else {
-			if (descq->cpu_assigned)
-				schedule_work_on(descq->intr_work_cpu,
-						&descq->work);
-			else
-				schedule_work(&descq->work);
+			intr_work_schedule(descq);
 		}
 
 		if (++intr_cidx_info->sw_cidx ==
@@ -283,15 +300,13 @@ static void data_intr_direct(struct xlnx_dma_dev *xdev, int vidx, int irq,
 				descq->conf.q_type == Q_C2H && descq->conf.st)
 			descq->ping_pong_rx_time = timestamp;
 
+		descq->stats.irqs++;
+		trace_qdma_cmpl_detect(descq, QDMA_TRACE_DETECT_IRQ);
 		if (descq->conf.fp_descq_isr_top) {
 			descq->conf.fp_descq_isr_top(descq->q_hndl,
 					descq->conf.quld);
 		} else {
-			if (descq->cpu_assigned)
-				schedule_work_on(descq->intr_work_cpu,
-						&descq->work);
-			else
-				schedule_work(&descq->work);
+			intr_work_schedule(descq);
 		}
 	}
 	spin_unlock_irqrestore(&xdev->dev_intr_info_list[vidx].vec_q_list,
@@ -324,15 +339,15 @@ static inline void intr_ring_free(struct xlnx_dma_dev *xdev, int ring_sz,
 	pr_debug("free %u(0x%x)=%d*%u, 0x%p, bus 0x%llx.\n",
 		len, len, intr_desc_sz, ring_sz, intr_desc, desc_bus);
 
-	dma_free_coherent(&xdev->conf.pdev->dev, (size_t)ring_sz * intr_desc_sz,
-			intr_desc, desc_bus);
+	qdma_ring_arena_free(&xdev->ring_arena,
+			(size_t)ring_sz * intr_desc_sz, intr_desc, desc_bus);
 }
 
 static void *intr_ring_alloc(struct xlnx_dma_dev *xdev, int ring_sz,
 				int intr_desc_sz, dma_addr_t *bus)
 {
 	unsigned int len = ring_sz * intr_desc_sz;
-	u8 *p = dma_alloc_coherent(&xdev->conf.pdev->dev, len, bus, GFP_KERNEL);
+	u8 *p = qdma_ring_arena_alloc(&xdev->ring_arena, len, bus);
 
 	if (!p) {
 		pr_err("%s, OOM, sz ring %d, intr_desc %d.\n",
@@ -737,6 +752,8 @@ static irqreturn_t irq_legacy(int irq, void *irq_data)
 						     struct qdma_descq,
 						     legacy_intr_q_list);
 
+			descq->stats.irqs++;
+			trace_qdma_cmpl_detect(descq, QDMA_TRACE_DETECT_IRQ);
 			qdma_descq_service_cmpl_update(descq, 0, 1);
 		}
 		xdev->hw.qdma_clear_pend_legacy_intr(xdev);
@@ -931,9 +948,28 @@ err_out:
 void intr_work(struct work_struct *work)
 {
 	struct qdma_descq *descq;
+	int budget = 0;
+	int rv;
 
 	descq = container_of(work, struct qdma_descq, work);
-	qdma_descq_service_cmpl_update(descq, 0, 1);
+
+	/*
+	 * bulk queues only take a slice while high priority queues are
+	 * online, so the workers are freed up in between
+	 */
+	if (descq->conf.prio == QDMA_Q_PRIO_HIGH)
+		budget = QDMA_Q_PRIO_HIGH_BUDGET;
+	else if (atomic_read(&descq->xdev->prio_hi_qcnt))
+		budget = QDMA_Q_PRIO_BULK_BUDGET;
+
+	/*
+	 * the budget used up means completions are left over, queue the next
+	 * slice. Less than the budget processed is all there was, or the
+	 * consumer cannot take more now and is not to be polled in a loop
+	 */
+	rv = qdma_descq_service_cmpl_update(descq, budget, 1);
+	if (budget && (rv == budget))
+		intr_work_schedule(descq);
 }
 
 /**
@@ -948,6 +984,7 @@ int qdma_queue_service(unsigned long dev_hndl, unsigned long id, int budget,
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
 	struct qdma_descq *descq;
+	int rv;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -961,11 +998,12 @@ int qdma_queue_service(unsigned long dev_hndl, unsigned long id, int budget,
 	}
 
 	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 0);
-	if (descq)
-		return qdma_descq_service_cmpl_update(descq,
-					budget, c2h_upd_cmpl);
+	if (!descq)
+		return -EINVAL;
+
+	rv = qdma_descq_service_cmpl_update(descq, budget, c2h_upd_cmpl);
 
-	return -EINVAL;
+	return (rv > 0) ? 0 : rv;
 }
 
 static u8 get_intr_vec_index(struct xlnx_dma_dev *xdev, u8 intr_type)
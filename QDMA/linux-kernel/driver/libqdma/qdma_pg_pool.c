@@ -0,0 +1,279 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#define pr_fmt(fmt)	KBUILD_MODNAME ":%s: " fmt, __func__
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/dma-mapping.h>
+#include "qdma_pg_pool.h"
+
+static int pg_pool_alloc_map(struct qdma_pg_pool *pool, unsigned char pg_order,
+			gfp_t gfp, struct page **pg, dma_addr_t *dma_addr)
+{
+	struct page *p;
+	dma_addr_t mapping;
+
+	p = alloc_pages_node(pool->node, __GFP_COMP | gfp, pg_order);
+	if (unlikely(!p)) {
+		pr_err("failed to allocate the pages, order %d.\n", pg_order);
+		return -ENOMEM;
+	}
+
+	mapping = dma_map_page(pool->dev, p, 0, (PAGE_SIZE << pg_order),
+				DMA_FROM_DEVICE);
+	if (unlikely(dma_mapping_error(pool->dev, mapping))) {
+		dev_err(pool->dev, "page 0x%p mapping error 0x%llx.\n",
+			p, (unsigned long long)mapping);
+		__free_pages(p, pg_order);
+		return -EINVAL;
+	}
+
+	*pg = p;
+	*dma_addr = mapping;
+	return 1;
+}
+
+static inline void pg_pool_unmap_free(struct qdma_pg_pool *pool,
+			unsigned char pg_order, struct page *pg,
+			dma_addr_t dma_addr)
+{
+	dma_unmap_page(pool->dev, dma_addr, (PAGE_SIZE << pg_order),
+			DMA_FROM_DEVICE);
+	put_page(pg);
+}
+
+static inline void pg_pool_push(struct qdma_pg_pool_order *po,
+			struct page *pg, dma_addr_t dma_addr)
+{
+	struct qdma_pg_pool_ent *e = po->ent + ((po->head + po->cnt) %
+						po->size);
+
+	e->pg = pg;
+	e->dma_addr = dma_addr;
+	po->cnt++;
+}
+
+static inline struct qdma_pg_pool_ent *pg_pool_pop(
+			struct qdma_pg_pool_order *po)
+{
+	struct qdma_pg_pool_ent *e = po->ent + po->head;
+
+	po->head = (po->head + 1) % po->size;
+	po->cnt--;
+	return e;
+}
+
+void qdma_pg_pool_init(struct qdma_pg_pool *pool, struct device *dev)
+{
+	int i;
+
+	memset(pool, 0, sizeof(*pool));
+	pool->dev = dev;
+	pool->node = dev_to_node(dev);
+	for (i = 0; i <= QDMA_PG_POOL_MAX_ORDER; i++)
+		spin_lock_init(&pool->order[i].lock);
+}
+
+void qdma_pg_pool_destroy(struct qdma_pg_pool *pool)
+{
+	struct qdma_pg_pool_order *po;
+	struct qdma_pg_pool_ent *e;
+	int i;
+
+	for (i = 0; i <= QDMA_PG_POOL_MAX_ORDER; i++) {
+		po = &pool->order[i];
+
+		spin_lock_bh(&po->lock);
+		if (po->cap)
+			pr_warn("%s: order %d, %u pages still reserved.\n",
+				dev_name(pool->dev), i, po->cap);
+		while (po->cnt) {
+			e = pg_pool_pop(po);
+			pg_pool_unmap_free(pool, i, e->pg, e->dma_addr);
+		}
+		kfree(po->ent);
+		po->ent = NULL;
+		po->size = 0;
+		po->cap = 0;
+		spin_unlock_bh(&po->lock);
+	}
+}
+
+int qdma_pg_pool_reserve(struct qdma_pg_pool *pool, unsigned char pg_order,
+			unsigned int num_pages)
+{
+	struct qdma_pg_pool_order *po;
+	struct qdma_pg_pool_ent *ent, *old;
+	unsigned int size;
+	unsigned int i;
+
+	if (pg_order > QDMA_PG_POOL_MAX_ORDER)
+		return 0;
+
+	po = &pool->order[pg_order];
+
+	spin_lock_bh(&po->lock);
+	while (po->cap + num_pages > po->size) {
+		size = po->cap + num_pages;
+		spin_unlock_bh(&po->lock);
+
+		ent = kzalloc_node(size * sizeof(*ent), GFP_KERNEL,
+				pool->node);
+		if (!ent) {
+			pr_err("%s: OOM, sz %u * %zu.\n", dev_name(pool->dev),
+				size, sizeof(*ent));
+			return -ENOMEM;
+		}
+
+		spin_lock_bh(&po->lock);
+		if (size <= po->size) {
+			/* grown by someone else meanwhile */
+			kfree(ent);
+			continue;
+		}
+		for (i = 0; i < po->cnt; i++)
+			ent[i] = po->ent[(po->head + i) % po->size];
+		old = po->ent;
+		po->ent = ent;
+		po->size = size;
+		po->head = 0;
+		kfree(old);
+	}
+	po->cap += num_pages;
+	spin_unlock_bh(&po->lock);
+
+	return 0;
+}
+
+void qdma_pg_pool_unreserve(struct qdma_pg_pool *pool, unsigned char pg_order,
+			unsigned int num_pages)
+{
+	struct qdma_pg_pool_order *po;
+	struct qdma_pg_pool_ent *e;
+
+	if (pg_order > QDMA_PG_POOL_MAX_ORDER)
+		return;
+
+	po = &pool->order[pg_order];
+
+	spin_lock_bh(&po->lock);
+	po->cap -= min(po->cap, num_pages);
+	while (po->cnt > po->cap) {
+		e = pg_pool_pop(po);
+		pg_pool_unmap_free(pool, pg_order, e->pg, e->dma_addr);
+		po->nr_release++;
+	}
+	spin_unlock_bh(&po->lock);
+}
+
+int qdma_pg_pool_get(struct qdma_pg_pool *pool, unsigned char pg_order,
+			gfp_t gfp, struct page **pg, dma_addr_t *dma_addr)
+{
+	struct qdma_pg_pool_order *po;
+	struct qdma_pg_pool_ent *e;
+	unsigned int scan;
+	int rv;
+
+	if (pg_order > QDMA_PG_POOL_MAX_ORDER)
+		return pg_pool_alloc_map(pool, pg_order, gfp, pg, dma_addr);
+
+	po = &pool->order[pg_order];
+
+	spin_lock_bh(&po->lock);
+	/* the oldest pages are the most likely to be released by the user */
+	for (scan = 0; po->cnt && scan < QDMA_PG_POOL_SCAN_MAX; scan++) {
+		e = pg_pool_pop(po);
+		if (page_count(e->pg) == 1) {
+			*pg = e->pg;
+			*dma_addr = e->dma_addr;
+			po->nr_hit++;
+			spin_unlock_bh(&po->lock);
+			return 0;
+		}
+		/* still referenced by a consumer, keep it mapped for later */
+		pg_pool_push(po, e->pg, e->dma_addr);
+		po->nr_busy++;
+	}
+	spin_unlock_bh(&po->lock);
+
+	rv = pg_pool_alloc_map(pool, pg_order, gfp, pg, dma_addr);
+
+	spin_lock_bh(&po->lock);
+	if (rv == -EINVAL)
+		po->nr_alloc++;
+	else if (rv > 0) {
+		po->nr_alloc++;
+		po->nr_map++;
+	}
+	spin_unlock_bh(&po->lock);
+
+	return rv;
+}
+
+void qdma_pg_pool_put(struct qdma_pg_pool *pool, unsigned char pg_order,
+			struct page *pg, dma_addr_t dma_addr)
+{
+	struct qdma_pg_pool_order *po;
+
+	if (pg_order > QDMA_PG_POOL_MAX_ORDER) {
+		pg_pool_unmap_free(pool, pg_order, pg, dma_addr);
+		return;
+	}
+
+	po = &pool->order[pg_order];
+
+	spin_lock_bh(&po->lock);
+	if (po->cnt < po->cap) {
+		pg_pool_push(po, pg, dma_addr);
+		po->nr_recycle++;
+		spin_unlock_bh(&po->lock);
+		return;
+	}
+	po->nr_release++;
+	spin_unlock_bh(&po->lock);
+
+	pg_pool_unmap_free(pool, pg_order, pg, dma_addr);
+}
+
+int qdma_pg_pool_dump(struct qdma_pg_pool *pool, char *buf, int buflen)
+{
+	struct qdma_pg_pool_order *po;
+	int len = 0;
+	int i;
+
+	len += scnprintf(buf + len, buflen - len,
+		"node %d\n%-5s %8s %8s %10s %10s %10s %10s %10s %10s\n",
+		pool->node, "order", "pages", "cap", "hit", "alloc", "map",
+		"recycle", "release", "busy");
+	for (i = 0; i <= QDMA_PG_POOL_MAX_ORDER; i++) {
+		po = &pool->order[i];
+
+		spin_lock_bh(&po->lock);
+		len += scnprintf(buf + len, buflen - len,
+			"%-5d %8u %8u %10lu %10lu %10lu %10lu %10lu %10lu\n",
+			i, po->cnt, po->cap, po->nr_hit, po->nr_alloc,
+			po->nr_map, po->nr_recycle, po->nr_release,
+			po->nr_busy);
+		spin_unlock_bh(&po->lock);
+	}
+
+	return len;
+}
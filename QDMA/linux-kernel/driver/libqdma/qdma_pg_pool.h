@@ -0,0 +1,199 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef LIBQDMA_QDMA_PG_POOL_H_
+#define LIBQDMA_QDMA_PG_POOL_H_
+/**
+ * @file
+ * @brief This file contains the declarations for the per-device C2H page pool
+ *
+ * ST C2H freelist pages are allocated on the device's NUMA node, DMA mapped
+ * once and then kept mapped for the life of the device. Pages released by a
+ * queue go back to the pool and are handed out again to any queue with the
+ * same page order, so C2H refill does not hit the page allocator or the
+ * IOMMU map path once the pool is warm.
+ */
+#include <linux/types.h>
+#include <linux/spinlock.h>
+#include <linux/device.h>
+
+/** highest page order kept in the pool, larger pages bypass it */
+#define QDMA_PG_POOL_MAX_ORDER		4
+/** max busy pages rotated to the tail before falling back to alloc */
+#define QDMA_PG_POOL_SCAN_MAX		4
+
+/**
+ * @struct - qdma_pg_pool_ent
+ * @brief	a DMA mapped page held by the pool
+ */
+struct qdma_pg_pool_ent {
+	/** pointer to the page */
+	struct page *pg;
+	/** dma address of the page */
+	dma_addr_t dma_addr;
+};
+
+/**
+ * @struct - qdma_pg_pool_order
+ * @brief	fifo of mapped pages of one page order
+ */
+struct qdma_pg_pool_order {
+	/** protects the fifo and the stats */
+	spinlock_t lock;
+	/** fifo of mapped pages */
+	struct qdma_pg_pool_ent *ent;
+	/** number of entries allocated in ent */
+	unsigned int size;
+	/** max number of pages held, sum of reservations */
+	unsigned int cap;
+	/** fifo head */
+	unsigned int head;
+	/** number of pages in the fifo */
+	unsigned int cnt;
+	/** number of pages handed out from the fifo */
+	unsigned long nr_hit;
+	/** number of pages allocated from the page allocator */
+	unsigned long nr_alloc;
+	/** number of pages DMA mapped */
+	unsigned long nr_map;
+	/** number of pages returned to the fifo */
+	unsigned long nr_recycle;
+	/** number of pages unmapped and released */
+	unsigned long nr_release;
+	/** number of busy pages skipped over */
+	unsigned long nr_busy;
+};
+
+/**
+ * @struct - qdma_pg_pool
+ * @brief	per-device C2H page pool
+ */
+struct qdma_pg_pool {
+	/** device the pages are mapped for */
+	struct device *dev;
+	/** NUMA node the pages are allocated on */
+	int node;
+	/** per page order fifos */
+	struct qdma_pg_pool_order order[QDMA_PG_POOL_MAX_ORDER + 1];
+};
+
+/*****************************************************************************/
+/**
+ * qdma_pg_pool_init() - initialize the page pool of a device
+ *
+ * @param[in]	pool:	pointer to the page pool
+ * @param[in]	dev:	device the pages are mapped for
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_pg_pool_init(struct qdma_pg_pool *pool, struct device *dev);
+
+/*****************************************************************************/
+/**
+ * qdma_pg_pool_destroy() - unmap and release all the pages of the pool
+ *
+ * @param[in]	pool:	pointer to the page pool
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_pg_pool_destroy(struct qdma_pg_pool *pool);
+
+/*****************************************************************************/
+/**
+ * qdma_pg_pool_reserve() - grow the pool for a queue's freelist
+ *
+ * Called when a C2H queue sets up its freelist, so the pool can hold every
+ * page of that queue once the queue releases them.
+ *
+ * @param[in]	pool:	pointer to the page pool
+ * @param[in]	pg_order:	page order of the queue
+ * @param[in]	num_pages:	number of pages in the queue's freelist
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int qdma_pg_pool_reserve(struct qdma_pg_pool *pool, unsigned char pg_order,
+			unsigned int num_pages);
+
+/*****************************************************************************/
+/**
+ * qdma_pg_pool_unreserve() - undo qdma_pg_pool_reserve()
+ *
+ * Pages above the new capacity are unmapped and released.
+ *
+ * @param[in]	pool:	pointer to the page pool
+ * @param[in]	pg_order:	page order of the queue
+ * @param[in]	num_pages:	number of pages in the queue's freelist
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_pg_pool_unreserve(struct qdma_pg_pool *pool, unsigned char pg_order,
+			unsigned int num_pages);
+
+/*****************************************************************************/
+/**
+ * qdma_pg_pool_get() - get a DMA mapped page
+ *
+ * A pool page is only handed out once nobody else holds a reference to it.
+ * Otherwise a new page is allocated and mapped.
+ *
+ * @param[in]	pool:	pointer to the page pool
+ * @param[in]	pg_order:	page order
+ * @param[in]	gfp:	allocation flags used when the pool is empty
+ * @param[out]	pg:	page
+ * @param[out]	dma_addr:	dma address of the page
+ *
+ * @return	0: page taken from the pool
+ * @return	1: page newly allocated and mapped
+ * @return	-ENOMEM: page allocation failed
+ * @return	-EINVAL: page mapping failed
+ *****************************************************************************/
+int qdma_pg_pool_get(struct qdma_pg_pool *pool, unsigned char pg_order,
+			gfp_t gfp, struct page **pg, dma_addr_t *dma_addr);
+
+/*****************************************************************************/
+/**
+ * qdma_pg_pool_put() - return a page to the pool
+ *
+ * The caller's reference is handed over to the pool. The page is kept mapped
+ * if the pool has room, otherwise it is unmapped and released.
+ *
+ * @param[in]	pool:	pointer to the page pool
+ * @param[in]	pg_order:	page order
+ * @param[in]	pg:	page
+ * @param[in]	dma_addr:	dma address of the page
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_pg_pool_put(struct qdma_pg_pool *pool, unsigned char pg_order,
+			struct page *pg, dma_addr_t dma_addr);
+
+/*****************************************************************************/
+/**
+ * qdma_pg_pool_dump() - dump the page pool utilization
+ *
+ * @param[in]	pool:	pointer to the page pool
+ * @param[out]	buf:	buffer to dump into
+ * @param[in]	buflen:	length of the buffer
+ *
+ * @return	number of bytes written to buf
+ *****************************************************************************/
+int qdma_pg_pool_dump(struct qdma_pg_pool *pool, char *buf, int buflen);
+
+#endif /* LIBQDMA_QDMA_PG_POOL_H_ */
@@ -0,0 +1,277 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#define pr_fmt(fmt)	KBUILD_MODNAME ":%s: " fmt, __func__
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/dma-mapping.h>
+#include "qdma_ring_arena.h"
+
+static inline int ring_arena_class_idx(size_t size)
+{
+	unsigned int shift = order_base_2(size);
+
+	if (shift > QDMA_RING_ARENA_MAX_SHIFT)
+		return -1;
+	if (shift < QDMA_RING_ARENA_MIN_SHIFT)
+		shift = QDMA_RING_ARENA_MIN_SHIFT;
+
+	return shift - QDMA_RING_ARENA_MIN_SHIFT;
+}
+
+static struct qdma_ring_arena_chunk *ring_arena_chunk_alloc(
+				struct qdma_ring_arena *arena,
+				struct qdma_ring_arena_class *cls)
+{
+	struct qdma_ring_arena_chunk *chunk;
+
+	chunk = kzalloc_node(sizeof(*chunk), GFP_KERNEL,
+			dev_to_node(arena->dev));
+	if (!chunk)
+		return NULL;
+
+	/* dma_alloc_coherent places the chunk on the device's NUMA node */
+	chunk->vaddr = dma_alloc_coherent(arena->dev, QDMA_RING_ARENA_CHUNK_SZ,
+				&chunk->dma_addr, GFP_KERNEL | __GFP_NOWARN);
+	if (!chunk->vaddr) {
+		kfree(chunk);
+		return NULL;
+	}
+
+	chunk->nr_blks = QDMA_RING_ARENA_CHUNK_SZ >> cls->blk_shift;
+	chunk->nr_free = chunk->nr_blks;
+	list_add(&chunk->list, &cls->chunks);
+	cls->nr_chunks++;
+
+	pr_debug("%s: chunk 0x%p, bus 0x%llx, blk sz %lu.\n",
+		dev_name(arena->dev), chunk->vaddr,
+		(unsigned long long)chunk->dma_addr, 1UL << cls->blk_shift);
+
+	return chunk;
+}
+
+static void ring_arena_chunk_free(struct qdma_ring_arena *arena,
+				struct qdma_ring_arena_class *cls,
+				struct qdma_ring_arena_chunk *chunk)
+{
+	list_del(&chunk->list);
+	cls->nr_chunks--;
+	dma_free_coherent(arena->dev, QDMA_RING_ARENA_CHUNK_SZ, chunk->vaddr,
+			chunk->dma_addr);
+	kfree(chunk);
+}
+
+void qdma_ring_arena_init(struct qdma_ring_arena *arena, struct device *dev)
+{
+	int i;
+
+	memset(arena, 0, sizeof(*arena));
+	arena->dev = dev;
+	mutex_init(&arena->lock);
+
+	for (i = 0; i < QDMA_RING_ARENA_NUM_CLASSES; i++) {
+		arena->cls[i].blk_shift = QDMA_RING_ARENA_MIN_SHIFT + i;
+		INIT_LIST_HEAD(&arena->cls[i].chunks);
+	}
+}
+
+void qdma_ring_arena_destroy(struct qdma_ring_arena *arena)
+{
+	struct qdma_ring_arena_chunk *chunk, *tmp;
+	int i;
+
+	mutex_lock(&arena->lock);
+	for (i = 0; i < QDMA_RING_ARENA_NUM_CLASSES; i++) {
+		struct qdma_ring_arena_class *cls = &arena->cls[i];
+
+		list_for_each_entry_safe(chunk, tmp, &cls->chunks, list) {
+			if (chunk->nr_free != chunk->nr_blks) {
+				pr_warn("%s: chunk 0x%p, %u/%u rings in use, leaked.\n",
+					dev_name(arena->dev), chunk->vaddr,
+					chunk->nr_blks - chunk->nr_free,
+					chunk->nr_blks);
+				list_del(&chunk->list);
+				cls->nr_chunks--;
+				continue;
+			}
+			ring_arena_chunk_free(arena, cls, chunk);
+		}
+	}
+	if (arena->nr_direct)
+		pr_warn("%s: %lu direct rings still in use.\n",
+			dev_name(arena->dev), arena->nr_direct);
+	mutex_unlock(&arena->lock);
+	mutex_destroy(&arena->lock);
+}
+
+void *qdma_ring_arena_alloc(struct qdma_ring_arena *arena, size_t size,
+			dma_addr_t *dma_addr)
+{
+	struct qdma_ring_arena_class *cls;
+	struct qdma_ring_arena_chunk *chunk;
+	unsigned int blk;
+	int idx = ring_arena_class_idx(size);
+	void *p;
+
+	if (idx < 0)
+		goto direct;
+
+	cls = &arena->cls[idx];
+
+	mutex_lock(&arena->lock);
+	/* chunks with free blocks are kept at the head of the list */
+	chunk = list_first_entry_or_null(&cls->chunks,
+				struct qdma_ring_arena_chunk, list);
+	if (!chunk || !chunk->nr_free) {
+		chunk = ring_arena_chunk_alloc(arena, cls);
+		if (!chunk) {
+			arena->nr_chunk_alloc_fail++;
+			mutex_unlock(&arena->lock);
+			goto direct;
+		}
+	}
+
+	blk = find_first_zero_bit(chunk->used, chunk->nr_blks);
+	set_bit(blk, chunk->used);
+	chunk->nr_free--;
+	if (!chunk->nr_free)
+		list_move_tail(&chunk->list, &cls->chunks);
+
+	cls->nr_blks_used++;
+	cls->bytes_req += size;
+	arena->nr_alloc++;
+	mutex_unlock(&arena->lock);
+
+	*dma_addr = chunk->dma_addr + ((dma_addr_t)blk << cls->blk_shift);
+	return chunk->vaddr + ((size_t)blk << cls->blk_shift);
+
+direct:
+	p = dma_alloc_coherent(arena->dev, size, dma_addr, GFP_KERNEL);
+	if (!p)
+		return NULL;
+
+	mutex_lock(&arena->lock);
+	arena->nr_direct++;
+	arena->nr_alloc++;
+	mutex_unlock(&arena->lock);
+
+	return p;
+}
+
+void qdma_ring_arena_free(struct qdma_ring_arena *arena, size_t size,
+			void *vaddr, dma_addr_t dma_addr)
+{
+	struct qdma_ring_arena_class *cls;
+	struct qdma_ring_arena_chunk *chunk;
+	unsigned int blk;
+	int idx = ring_arena_class_idx(size);
+
+	if (idx < 0)
+		goto direct;
+
+	cls = &arena->cls[idx];
+
+	mutex_lock(&arena->lock);
+	list_for_each_entry(chunk, &cls->chunks, list) {
+		if (vaddr < chunk->vaddr ||
+		    vaddr >= chunk->vaddr + QDMA_RING_ARENA_CHUNK_SZ)
+			continue;
+
+		blk = (vaddr - chunk->vaddr) >> cls->blk_shift;
+		if (!test_and_clear_bit(blk, chunk->used)) {
+			pr_err("%s: double free of ring 0x%p.\n",
+				dev_name(arena->dev), vaddr);
+			mutex_unlock(&arena->lock);
+			return;
+		}
+
+		if (!chunk->nr_free)
+			list_move(&chunk->list, &cls->chunks);
+		chunk->nr_free++;
+		cls->nr_blks_used--;
+		cls->bytes_req -= size;
+		arena->nr_free++;
+
+		/* keep one chunk per class around for the next queue add */
+		if (chunk->nr_free == chunk->nr_blks && cls->nr_chunks > 1)
+			ring_arena_chunk_free(arena, cls, chunk);
+
+		mutex_unlock(&arena->lock);
+		return;
+	}
+	/* not carved out of a chunk, the chunk allocation had failed */
+	mutex_unlock(&arena->lock);
+
+direct:
+	dma_free_coherent(arena->dev, size, vaddr, dma_addr);
+
+	mutex_lock(&arena->lock);
+	arena->nr_direct--;
+	arena->nr_free++;
+	mutex_unlock(&arena->lock);
+}
+
+int qdma_ring_arena_dump(struct qdma_ring_arena *arena, char *buf,
+			int buflen)
+{
+	unsigned long chunk_bytes = 0;
+	unsigned long used_bytes = 0;
+	unsigned long req_bytes = 0;
+	int len = 0;
+	int i;
+
+	mutex_lock(&arena->lock);
+	len += scnprintf(buf + len, buflen - len,
+		"%-10s %8s %10s %10s %12s\n",
+		"blk_size", "chunks", "blks_used", "blks_total", "bytes_req");
+	for (i = 0; i < QDMA_RING_ARENA_NUM_CLASSES; i++) {
+		struct qdma_ring_arena_class *cls = &arena->cls[i];
+		unsigned int blks_per_chunk =
+			QDMA_RING_ARENA_CHUNK_SZ >> cls->blk_shift;
+
+		len += scnprintf(buf + len, buflen - len,
+			"%-10lu %8u %10u %10u %12lu\n",
+			1UL << cls->blk_shift, cls->nr_chunks,
+			cls->nr_blks_used, cls->nr_chunks * blks_per_chunk,
+			cls->bytes_req);
+
+		chunk_bytes += cls->nr_chunks * QDMA_RING_ARENA_CHUNK_SZ;
+		used_bytes += (unsigned long)cls->nr_blks_used <<
+				cls->blk_shift;
+		req_bytes += cls->bytes_req;
+	}
+
+	len += scnprintf(buf + len, buflen - len,
+		"\nchunk size %lu, mapped %lu, blocks used %lu, requested %lu\n",
+		QDMA_RING_ARENA_CHUNK_SZ, chunk_bytes, used_bytes, req_bytes);
+	if (chunk_bytes)
+		len += scnprintf(buf + len, buflen - len,
+			"utilization %lu%%, fill %lu%%\n",
+			used_bytes * 100 / chunk_bytes,
+			req_bytes * 100 / chunk_bytes);
+	len += scnprintf(buf + len, buflen - len,
+		"allocs %lu, frees %lu, direct %lu, chunk alloc fail %lu\n",
+		arena->nr_alloc, arena->nr_free, arena->nr_direct,
+		arena->nr_chunk_alloc_fail);
+	mutex_unlock(&arena->lock);
+
+	return len;
+}
@@ -0,0 +1,174 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef LIBQDMA_QDMA_RING_ARENA_H_
+#define LIBQDMA_QDMA_RING_ARENA_H_
+/**
+ * @file
+ * @brief This file contains the declarations for the per-device ring arena
+ *
+ * Descriptor, completion and interrupt aggregation rings are carved out of
+ * large DMA-coherent chunks instead of one dma_alloc_coherent() per ring.
+ * Each chunk serves a single power-of-two size class, so every ring is
+ * naturally aligned to its block size and a chunk is mapped by the IOMMU
+ * as one contiguous region.
+ */
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/bitmap.h>
+#include <linux/device.h>
+
+/** chunk size: 2MB, one PMD sized, physically contiguous region */
+#define QDMA_RING_ARENA_CHUNK_SHIFT	21
+#define QDMA_RING_ARENA_CHUNK_SZ	(1UL << QDMA_RING_ARENA_CHUNK_SHIFT)
+/** smallest ring block: 4KB */
+#define QDMA_RING_ARENA_MIN_SHIFT	12
+/** largest pooled ring block: 512KB, bigger rings are allocated directly */
+#define QDMA_RING_ARENA_MAX_SHIFT	19
+#define QDMA_RING_ARENA_NUM_CLASSES	\
+	(QDMA_RING_ARENA_MAX_SHIFT - QDMA_RING_ARENA_MIN_SHIFT + 1)
+/** max blocks per chunk, reached by the smallest class */
+#define QDMA_RING_ARENA_MAX_BLKS	\
+	(1U << (QDMA_RING_ARENA_CHUNK_SHIFT - QDMA_RING_ARENA_MIN_SHIFT))
+
+/**
+ * @struct - qdma_ring_arena_chunk
+ * @brief	one DMA-coherent chunk split into equal sized blocks
+ */
+struct qdma_ring_arena_chunk {
+	/** link in the size class chunk list */
+	struct list_head list;
+	/** kernel virtual address of the chunk */
+	void *vaddr;
+	/** bus address of the chunk */
+	dma_addr_t dma_addr;
+	/** number of blocks in this chunk */
+	unsigned int nr_blks;
+	/** number of free blocks in this chunk */
+	unsigned int nr_free;
+	/** block usage bitmap */
+	DECLARE_BITMAP(used, QDMA_RING_ARENA_MAX_BLKS);
+};
+
+/**
+ * @struct - qdma_ring_arena_class
+ * @brief	free list of chunks for one power-of-two block size
+ */
+struct qdma_ring_arena_class {
+	/** log2 of the block size */
+	unsigned int blk_shift;
+	/** chunks of this class, chunks with free blocks first */
+	struct list_head chunks;
+	/** number of chunks */
+	unsigned int nr_chunks;
+	/** number of blocks handed out */
+	unsigned int nr_blks_used;
+	/** sum of the requested sizes of the blocks handed out */
+	unsigned long bytes_req;
+};
+
+/**
+ * @struct - qdma_ring_arena
+ * @brief	per-device ring arena
+ */
+struct qdma_ring_arena {
+	/** device used for the DMA-coherent allocations */
+	struct device *dev;
+	/** protects the size classes */
+	struct mutex lock;
+	/** size classes */
+	struct qdma_ring_arena_class cls[QDMA_RING_ARENA_NUM_CLASSES];
+	/** number of rings allocated */
+	unsigned long nr_alloc;
+	/** number of rings freed */
+	unsigned long nr_free;
+	/** number of rings outstanding that bypassed the arena */
+	unsigned long nr_direct;
+	/** number of failed chunk allocations */
+	unsigned long nr_chunk_alloc_fail;
+};
+
+/*****************************************************************************/
+/**
+ * qdma_ring_arena_init() - initialize the ring arena of a device
+ *
+ * @param[in]	arena:	pointer to the ring arena
+ * @param[in]	dev:	device the rings are mapped for
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_ring_arena_init(struct qdma_ring_arena *arena, struct device *dev);
+
+/*****************************************************************************/
+/**
+ * qdma_ring_arena_destroy() - release all the chunks of the ring arena
+ *
+ * All the rings are expected to be freed already. Chunks with rings still
+ * in use are reported and left allocated.
+ *
+ * @param[in]	arena:	pointer to the ring arena
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_ring_arena_destroy(struct qdma_ring_arena *arena);
+
+/*****************************************************************************/
+/**
+ * qdma_ring_arena_alloc() - allocate a DMA-coherent ring
+ *
+ * The returned memory is not zeroed.
+ *
+ * @param[in]	arena:	pointer to the ring arena
+ * @param[in]	size:	ring size in bytes
+ * @param[out]	dma_addr:	bus address of the ring
+ *
+ * @return	kernel virtual address of the ring on success, NULL on failure
+ *****************************************************************************/
+void *qdma_ring_arena_alloc(struct qdma_ring_arena *arena, size_t size,
+			dma_addr_t *dma_addr);
+
+/*****************************************************************************/
+/**
+ * qdma_ring_arena_free() - free a ring allocated by qdma_ring_arena_alloc()
+ *
+ * @param[in]	arena:	pointer to the ring arena
+ * @param[in]	size:	ring size in bytes, as passed for the allocation
+ * @param[in]	vaddr:	kernel virtual address of the ring
+ * @param[in]	dma_addr:	bus address of the ring
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_ring_arena_free(struct qdma_ring_arena *arena, size_t size,
+			void *vaddr, dma_addr_t dma_addr);
+
+/*****************************************************************************/
+/**
+ * qdma_ring_arena_dump() - dump the ring arena utilization
+ *
+ * @param[in]	arena:	pointer to the ring arena
+ * @param[out]	buf:	buffer to dump into
+ * @param[in]	buflen:	length of the buffer
+ *
+ * @return	number of bytes written to buf
+ *****************************************************************************/
+int qdma_ring_arena_dump(struct qdma_ring_arena *arena, char *buf,
+			int buflen);
+
+#endif /* LIBQDMA_QDMA_RING_ARENA_H_ */
@@ -0,0 +1,126 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#define pr_fmt(fmt)	KBUILD_MODNAME ":%s: " fmt, __func__
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include "qdma_rl.h"
+
+/** ns per byte at 1 Mbit/s */
+#define RL_NS_PER_BYTE_MBPS	8000ULL
+
+void qdma_rl_bucket_set(struct qdma_rl_bucket *b, u32 rate_mbps, u32 burst)
+{
+	if (rate_mbps && !burst) {
+		/* 1 Mbit/s moves 125 bytes per ms */
+		u64 def = div_u64((u64)rate_mbps * 125 *
+				  QDMA_RL_BURST_DEFAULT_US, 1000);
+
+		burst = (u32)min_t(u64, def, U32_MAX);
+	}
+	if (rate_mbps && burst < QDMA_RL_BURST_MIN)
+		burst = QDMA_RL_BURST_MIN;
+
+	b->rate_mbps = rate_mbps;
+	b->burst = burst;
+	b->tokens = burst;
+	b->t_last = ktime_to_ns(ktime_get());
+}
+
+s64 qdma_rl_bucket_refill(struct qdma_rl_bucket *b, u64 now)
+{
+	u64 elapsed;
+	u64 full_ns;
+	u64 add;
+
+	if (!b->rate_mbps || now <= b->t_last || b->tokens >= b->burst) {
+		b->t_last = max(now, b->t_last);
+		return b->tokens;
+	}
+
+	/* time to fill the bucket up, also keeps elapsed * rate in range */
+	elapsed = now - b->t_last;
+	full_ns = div_u64((u64)(b->burst - b->tokens) * RL_NS_PER_BYTE_MBPS,
+			  b->rate_mbps);
+	if (elapsed >= full_ns) {
+		b->tokens = b->burst;
+		b->t_last = now;
+		return b->tokens;
+	}
+
+	/*
+	 * only move the time stamp by the time the whole bytes added stand
+	 * for, or a slow rate polled often would never accrue a token
+	 */
+	add = div_u64(elapsed * b->rate_mbps, RL_NS_PER_BYTE_MBPS);
+	b->tokens += add;
+	b->t_last += div_u64(add * RL_NS_PER_BYTE_MBPS, b->rate_mbps);
+
+	return b->tokens;
+}
+
+u64 qdma_rl_bucket_wait_ns(struct qdma_rl_bucket *b)
+{
+	if (b->tokens > 0 || !b->rate_mbps)
+		return 0;
+
+	return div_u64((u64)(1 - b->tokens) * RL_NS_PER_BYTE_MBPS +
+		       b->rate_mbps - 1, b->rate_mbps);
+}
+
+static enum hrtimer_restart q_rl_timer_fn(struct hrtimer *timer)
+{
+	struct qdma_q_rl *qrl = container_of(timer, struct qdma_q_rl, timer);
+
+	/* the request processing takes the descq lock with bh disabled */
+	schedule_work(&qrl->work);
+
+	return HRTIMER_NORESTART;
+}
+
+void qdma_q_rl_init(struct qdma_q_rl *qrl, work_func_t fn)
+{
+	memset(&qrl->bucket, 0, sizeof(qrl->bucket));
+	qrl->borrow = 0;
+	qrl->borrowing = 0;
+	qrl->throttled = 0;
+	hrtimer_init(&qrl->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	qrl->timer.function = q_rl_timer_fn;
+	INIT_WORK(&qrl->work, fn);
+}
+
+void qdma_q_rl_kick(struct qdma_q_rl *qrl, u64 delay_ns)
+{
+	hrtimer_start(&qrl->timer, ns_to_ktime(delay_ns), HRTIMER_MODE_REL);
+}
+
+void qdma_q_rl_cancel(struct qdma_q_rl *qrl)
+{
+	hrtimer_cancel(&qrl->timer);
+	cancel_work_sync(&qrl->work);
+	qrl->throttled = 0;
+}
+
+void qdma_fn_rl_init(struct qdma_fn_rl *frl)
+{
+	spin_lock_init(&frl->lock);
+	memset(&frl->bucket, 0, sizeof(frl->bucket));
+}
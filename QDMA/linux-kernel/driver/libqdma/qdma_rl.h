@@ -0,0 +1,174 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef LIBQDMA_QDMA_RL_H_
+#define LIBQDMA_QDMA_RL_H_
+/**
+ * @file
+ * @brief This file contains the declarations for the token bucket rate
+ * limiter of the request submit path
+ *
+ * Every queue and every function has a token bucket, filled at the
+ * configured rate up to the bucket depth and drained by the bytes posted
+ * to the descriptor ring. The buckets are refilled lazily when they are
+ * looked at, a queue that runs out of tokens is kicked again by a timer
+ * once it may post again.
+ */
+#include <linux/types.h>
+#include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
+
+/** bucket depth when none is given: this many us worth of the rate */
+#define QDMA_RL_BURST_DEFAULT_US	1000
+/** smallest bucket depth in bytes */
+#define QDMA_RL_BURST_MIN		(64 * 1024)
+
+/**
+ * @struct - qdma_rl_bucket
+ * @brief	token bucket, bytes
+ */
+struct qdma_rl_bucket {
+	/** fill rate in Mbit/s, 0: unlimited */
+	u32 rate_mbps;
+	/** bucket depth in bytes */
+	u32 burst;
+	/** tokens in bytes, negative while a request is paid back */
+	s64 tokens;
+	/** time of the last refill in ns */
+	u64 t_last;
+};
+
+/**
+ * @struct - qdma_q_rl
+ * @brief	per queue rate limiter state, protected by the descq lock
+ */
+struct qdma_q_rl {
+	/** queue bucket, the rate guaranteed to the queue */
+	struct qdma_rl_bucket bucket;
+	/** may use the unused function bandwidth above its own rate */
+	u8 borrow;
+	/** the request being posted is paid from the function bucket */
+	u8 borrowing;
+	/** posting is held back for lack of tokens */
+	u8 throttled;
+	/** time the queue got throttled in ns */
+	u64 throttle_start;
+	/** fires when the queue may post again */
+	struct hrtimer timer;
+	/** processes the queue's pending requests, out of the timer irq */
+	struct work_struct work;
+};
+
+/**
+ * @struct - qdma_fn_rl
+ * @brief	per function rate limiter, the ceiling of all its queues
+ */
+struct qdma_fn_rl {
+	/** protects the bucket */
+	spinlock_t lock;
+	/** function bucket */
+	struct qdma_rl_bucket bucket;
+};
+
+/*****************************************************************************/
+/**
+ * qdma_rl_bucket_set() - configure a bucket and fill it
+ *
+ * @param[in]	b:	pointer to the bucket
+ * @param[in]	rate_mbps:	rate in Mbit/s, 0 to disable the limit
+ * @param[in]	burst:	bucket depth in bytes, 0 for the default
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_rl_bucket_set(struct qdma_rl_bucket *b, u32 rate_mbps, u32 burst);
+
+/*****************************************************************************/
+/**
+ * qdma_rl_bucket_refill() - add the tokens accrued since the last refill
+ *
+ * @param[in]	b:	pointer to the bucket
+ * @param[in]	now:	current time in ns
+ *
+ * @return	tokens in the bucket
+ *****************************************************************************/
+s64 qdma_rl_bucket_refill(struct qdma_rl_bucket *b, u64 now);
+
+/*****************************************************************************/
+/**
+ * qdma_rl_bucket_wait_ns() - time until the bucket has tokens again
+ *
+ * @param[in]	b:	pointer to the refilled bucket
+ *
+ * @return	time in ns, 0 if there are tokens
+ *****************************************************************************/
+u64 qdma_rl_bucket_wait_ns(struct qdma_rl_bucket *b);
+
+/**
+ * qdma_rl_bucket_charge() - take the bytes posted out of the bucket
+ */
+static inline void qdma_rl_bucket_charge(struct qdma_rl_bucket *b,
+					unsigned int bytes)
+{
+	b->tokens -= bytes;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_q_rl_init() - initialize the rate limiter of a queue, unlimited
+ *
+ * @param[in]	qrl:	pointer to the queue rate limiter
+ * @param[in]	fn:	work function processing the queue's requests
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_q_rl_init(struct qdma_q_rl *qrl, work_func_t fn);
+
+/*****************************************************************************/
+/**
+ * qdma_q_rl_kick() - process the queue's requests again after a delay
+ *
+ * @param[in]	qrl:	pointer to the queue rate limiter
+ * @param[in]	delay_ns:	delay in ns
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_q_rl_kick(struct qdma_q_rl *qrl, u64 delay_ns);
+
+/*****************************************************************************/
+/**
+ * qdma_q_rl_cancel() - cancel a pending kick and wait for it to finish
+ *
+ * @param[in]	qrl:	pointer to the queue rate limiter
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_q_rl_cancel(struct qdma_q_rl *qrl);
+
+/*****************************************************************************/
+/**
+ * qdma_fn_rl_init() - initialize the rate limiter of a function, unlimited
+ *
+ * @param[in]	frl:	pointer to the function rate limiter
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_fn_rl_init(struct qdma_fn_rl *frl);
+
+#endif /* LIBQDMA_QDMA_RL_H_ */
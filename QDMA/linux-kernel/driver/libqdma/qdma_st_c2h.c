@@ -24,6 +24,7 @@
 #include <asm/cacheflush.h>
 #include <linux/kernel.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
 
 #include "qdma_device.h"
 #include "qdma_intr.h"
@@ -35,6 +36,7 @@
 #include "qdma_st_c2h.h"
 #include "qdma_access_common.h"
 #include "qdma_ul_ext.h"
+#include "qdma_trace.h"
 #include "version.h"
 
 /*
@@ -123,20 +125,8 @@ static inline int flq_fill_one(struct qdma_descq *descq,
 	return 0;
 }
 
-static inline void flq_unmap_page_one(struct qdma_sw_pg_sg *pg_sdesc,
-				struct device *dev,
-				unsigned char pg_order)
-{
-	if (pg_sdesc && pg_sdesc->pg_dma_base_addr) {
-		dma_unmap_page(dev, pg_sdesc->pg_dma_base_addr,
-				PAGE_SIZE << pg_order,
-				DMA_FROM_DEVICE);
-		pg_sdesc->pg_dma_base_addr = 0UL;
-	}
-}
-
 static inline void flq_free_page_one(struct qdma_sw_pg_sg *pg_sdesc,
-				struct device *dev,
+				struct qdma_pg_pool *pool,
 				unsigned char pg_order,
 				unsigned int pg_shift)
 {
@@ -144,14 +134,16 @@ static inline void flq_free_page_one(struct qdma_sw_pg_sg *pg_sdesc,
 	unsigned int i = 0;
 
 	if (pg_sdesc && pg_sdesc->pg_base) {
-		/* +1 for dma_unmap*/
-		page_count = (pg_sdesc->pg_offset >> pg_shift) + 1;
-
-		flq_unmap_page_one(pg_sdesc, dev, pg_order);
+		/* one reference per buffer still posted */
+		page_count = (pg_sdesc->pg_offset >> pg_shift);
 
 		for (i = 0; i < page_count; i++)
 			put_page(pg_sdesc->pg_base);
 
+		/* base reference goes back to the pool, still mapped */
+		qdma_pg_pool_put(pool, pg_order, pg_sdesc->pg_base,
+				pg_sdesc->pg_dma_base_addr);
+
 		pg_sdesc->pg_base = NULL;
 		pg_sdesc->pg_dma_base_addr = 0UL;
 	}
@@ -160,15 +152,18 @@ static inline void flq_free_page_one(struct qdma_sw_pg_sg *pg_sdesc,
 void descq_flq_free_page_resource(struct qdma_descq *descq)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
-	struct device *dev = &xdev->conf.pdev->dev;
 	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
 	struct qdma_sw_pg_sg *pg_sdesc = flq->pg_sdesc;
 	unsigned char pg_order = flq->desc_pg_order;
 	int i;
 
-	for (i = 0; i < flq->num_pages; i++, pg_sdesc++)
-		flq_free_page_one(pg_sdesc, dev,
-				pg_order, flq->desc_pg_shift);
+	if (pg_sdesc) {
+		for (i = 0; i < flq->num_pages; i++, pg_sdesc++)
+			flq_free_page_one(pg_sdesc, &xdev->pg_pool,
+					pg_order, flq->desc_pg_shift);
+		qdma_pg_pool_unreserve(&xdev->pg_pool, pg_order,
+				flq->num_pages);
+	}
 
 	kfree(flq->pg_sdesc);
 	flq->pg_sdesc = NULL;
@@ -200,29 +195,28 @@ void descq_flq_free_resource(struct qdma_descq *descq)
 }
 
 
-static inline int flq_fill_page_one(struct qdma_sw_pg_sg *pg_sdesc,
-				struct device *dev,
-				int node, unsigned char pg_order, gfp_t gfp)
+static inline int flq_fill_page_one(struct qdma_flq *flq,
+				struct qdma_sw_pg_sg *pg_sdesc,
+				struct qdma_pg_pool *pool, gfp_t gfp)
 {
 	struct page *pg;
 	dma_addr_t mapping;
+	int rv;
 
-	pg = alloc_pages_node(node, __GFP_COMP | gfp, pg_order);
-	if (unlikely(!pg)) {
-		pr_err("%s: failed to allocate the pages, order %d.\n",
-				__func__,
-				pg_order);
-		return -ENOMEM;
+	rv = qdma_pg_pool_get(pool, flq->desc_pg_order, gfp, &pg, &mapping);
+	if (unlikely(rv < 0)) {
+		if (rv == -ENOMEM)
+			flq->alloc_fail++;
+		else
+			flq->mapping_err++;
+		return rv;
 	}
 
-	mapping = dma_map_page(dev, pg, 0, (PAGE_SIZE << pg_order),
-				PCI_DMA_FROMDEVICE);
-	if (unlikely(dma_mapping_error(dev, mapping))) {
-		dev_err(dev, "page 0x%p mapping error 0x%llx.\n",
-			pg, (unsigned long long)mapping);
-		__free_pages(pg, pg_order);
-		return -EINVAL;
-	}
+	if (rv) {
+		flq->pg_alloc++;
+		flq->pg_map++;
+	} else
+		flq->pg_recycle++;
 
 	pg_sdesc->pg_base = pg;
 	pg_sdesc->pg_dma_base_addr = mapping;
@@ -290,12 +284,20 @@ int descq_flq_alloc_resource(struct qdma_descq *descq)
 				(sizeof(struct qdma_sw_pg_sg)));
 		return -ENOMEM;
 	}
+
+	/* let the device pool hold all of this queue's pages on release */
+	rv = qdma_pg_pool_reserve(&xdev->pg_pool, flq->desc_pg_order,
+			flq->num_pages);
+	if (rv < 0) {
+		kfree(pg_sdesc);
+		return rv;
+	}
 	flq->pg_sdesc = pg_sdesc;
 
 	for (pg_sdesc = flq->pg_sdesc, i = 0;
 			i < flq->num_pages; i++, pg_sdesc++) {
-		rv = flq_fill_page_one(pg_sdesc, dev, node,
-				flq->desc_pg_order, GFP_KERNEL);
+		rv = flq_fill_page_one(flq, pg_sdesc, &xdev->pg_pool,
+				GFP_KERNEL);
 		if (rv < 0) {
 			descq_flq_free_page_resource(descq);
 			return rv;
@@ -348,13 +350,13 @@ static inline int flq_refill_pages(struct qdma_descq *descq,
 		int count, bool recycle, gfp_t gfp)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
-	struct device *dev = &xdev->conf.pdev->dev;
-	int node = dev_to_node(dev);
 	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
 	unsigned int n_recycle_index = flq->recycle_idx;
 	/* find the most significant bit number */
 	unsigned int div_bits = flq->desc_pg_shift;
 	struct qdma_sw_pg_sg *pg_sdesc = flq->pg_sdesc;
+	struct page *old_pg;
+	dma_addr_t old_dma;
 	unsigned int free_bufs_in_pg;
 	unsigned int i = 0, j = 0;
 	int rv;
@@ -402,12 +404,14 @@ static inline int flq_refill_pages(struct qdma_descq *descq,
 				flq->recycle_idx == flq->alloc_idx)
 				break;
 
-			flq_unmap_page_one(pg_sdesc, dev, flq->desc_pg_order);
-			put_page(pg_sdesc->pg_base);
-			rv = flq_fill_page_one(pg_sdesc,
-					dev, node, flq->desc_pg_order, gfp);
+			old_pg = pg_sdesc->pg_base;
+			old_dma = pg_sdesc->pg_dma_base_addr;
+			rv = flq_fill_page_one(flq, pg_sdesc, &xdev->pg_pool,
+					gfp);
 			if (rv < 0)
 				break;
+			qdma_pg_pool_put(&xdev->pg_pool, flq->desc_pg_order,
+					old_pg, old_dma);
 
 			flq->recycle_idx++;
 		}
@@ -597,8 +601,7 @@ int descq_st_c2h_read(struct qdma_descq *descq, struct qdma_request *req,
 	if (i && update_pidx) {
 		i = ring_idx_decr(flq->pidx_pend, 1, flq->size);
 		descq->pidx_info.pidx = i;
-		rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
-				descq->conf.q_type, &descq->pidx_info);
+		rv = descq_pidx_update(descq);
 		if (unlikely(rv < 0)) {
 			pr_err("%s: Failed to update pidx\n",
 					descq->conf.name);
@@ -1026,6 +1029,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 			qconf->fp_proc_ul_cmpt_entry) ? 1 : 0;
 	int pend, ret = 0;
 	int proc_cnt = 0;
+	unsigned int proc_bytes = 0;
 	int rv = 0;
 	int read_weight = budget;
 
@@ -1082,8 +1086,10 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 		if (rv < 0)
 			return rv;
 		rv = descq_cmpl_err_check(descq, &cmpl);
-		if (rv < 0)
+		if (rv < 0) {
+			descq->stats.errors++;
 			return rv;
+		}
 
 		if (!is_new_cmpl_entry(descq, &cmpl))
 			break;
@@ -1092,6 +1098,11 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 
 		if (cmpl.f.desc_used) {
 			rv = rcv_pkt(descq, &cmpl, cmpl.len);
+			if (rv >= 0) {
+				descq->stats.pkts++;
+				descq->stats.bytes += cmpl.len;
+				proc_bytes += cmpl.len;
+			}
 		} else if (descq->conf.cmpl_udd_en) {
 			/* udd only: no descriptor used */
 			rv = rcv_udd_only(descq, &cmpl);
@@ -1107,6 +1118,8 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 	}
 
 	flq->pkt_cnt -= proc_cnt;
+	if (proc_cnt)
+		trace_qdma_cmpl_proc(descq, proc_cnt, proc_bytes);
 
 	if ((xdev->conf.intr_moderation) &&
 			(descq->cmpt_cidx_info.trig_mode ==
@@ -1159,10 +1172,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 						     flq->size);
 				descq->pidx_info.pidx = pend;
 				if (!descq->conf.fp_descq_c2h_packet) {
-					ret = queue_pidx_update(descq->xdev,
-							descq->conf.qidx,
-							descq->conf.q_type,
-							&descq->pidx_info);
+					ret = descq_pidx_update(descq);
 					if (unlikely(ret < 0))  {
 						pr_err("%s: Failed to update pidx\n",
 							descq->conf.name);
@@ -1173,7 +1183,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 		}
 	}
 
-	return 0;
+	return proc_cnt;
 }
 
 int qdma_queue_c2h_peek(unsigned long dev_hndl, unsigned long id,
@@ -1275,6 +1285,8 @@ int qdma_queue_packet_read(unsigned long dev_hndl, unsigned long id,
 	}
 
 	memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
+	cb->submit_ns = ktime_to_ns(ktime_get());
+	trace_qdma_req_submit(descq, req);
 
 	qdma_waitq_init(&cb->wq);
 
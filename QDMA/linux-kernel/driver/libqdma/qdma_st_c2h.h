@@ -122,6 +122,12 @@ struct qdma_flq {
 	unsigned long alloc_fail;
 	/** RW: # of RX Buffer DMA Mapping failures */
 	unsigned long mapping_err;
+	/** RW: # of pages taken from the device page pool */
+	unsigned long pg_recycle;
+	/** RW: # of pages allocated from the page allocator */
+	unsigned long pg_alloc;
+	/** RW: # of pages DMA mapped */
+	unsigned long pg_map;
 	/** RW: consumer index */
 	unsigned int cidx;
 	/** RW: producer index */
@@ -203,7 +209,7 @@ int descq_flq_alloc_resource(struct qdma_descq *descq);
  * @param[in]	budget:		number of descriptors to process
  * @param[in]	upd_cmpl:	if update completion required
  *
- * @return	0: success
+ * @return	>=0: number of completions processed
  * @return	<0: failure
  *****************************************************************************/
 int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
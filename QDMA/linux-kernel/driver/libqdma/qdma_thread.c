@@ -26,6 +26,7 @@
 #include "qdma_descq.h"
 #include "thread.h"
 #include "xdev.h"
+#include "qdma_trace.h"
 
 /* ********************* global variables *********************************** */
 
@@ -56,12 +57,54 @@ static int qdma_thread_cmpl_status_pend(struct list_head *work_item)
 	return pend;
 }
 
+/*
+ * service the high priority queues, they are kept at the head of the
+ * work list, called with the thread lock held
+ */
+static void qdma_thread_service_hi(struct qdma_kthread *thp)
+{
+	struct qdma_descq *descq;
+
+	list_for_each_entry(descq, &thp->work_list, cmplthp_list) {
+		if (descq->conf.prio != QDMA_Q_PRIO_HIGH)
+			break;
+		qdma_descq_service_cmpl_update(descq,
+					QDMA_Q_PRIO_HIGH_BUDGET, 1);
+	}
+}
+
 static int qdma_thread_cmpl_status_proc(struct list_head *work_item)
 {
 	struct qdma_descq *descq;
+	struct qdma_kthread *thp;
+	int budget = 0;
+	int rv;
 
 	descq = list_entry(work_item, struct qdma_descq, cmplthp_list);
-	qdma_descq_service_cmpl_update(descq, 0, 1);
+	thp = descq->cmplthp;
+	trace_qdma_cmpl_detect(descq, QDMA_TRACE_DETECT_POLL);
+
+	if (descq->conf.prio == QDMA_Q_PRIO_HIGH) {
+		budget = QDMA_Q_PRIO_HIGH_BUDGET;
+	} else if (thp && thp->work_hi_cnt) {
+		/*
+		 * strict priority: the high priority queues go before every
+		 * bulk slice, the bulk queue is cut down to a slice so the
+		 * high priority ones do not wait behind a full ring
+		 */
+		qdma_thread_service_hi(thp);
+		budget = QDMA_Q_PRIO_BULK_BUDGET;
+	}
+
+	/*
+	 * the budget used up means completions are left over, go round again
+	 * without sleeping. Less than the budget processed is all there was,
+	 * or the consumer cannot take more now and is not to be spun on
+	 */
+	rv = qdma_descq_service_cmpl_update(descq, budget, 1);
+	if (budget && (rv == budget) && thp)
+		thp->schedule = 1;
+
 	return 0;
 }
 
@@ -98,8 +141,13 @@ void qdma_thread_remove_work(struct qdma_descq *descq)
 		lock_thread(cmpl_thread);
 		list_del(&descq->cmplthp_list);
 		cmpl_thread->work_cnt--;
+		if (descq->conf.prio == QDMA_Q_PRIO_HIGH)
+			cmpl_thread->work_hi_cnt--;
 		unlock_thread(cmpl_thread);
 	}
+
+	if (descq->conf.prio == QDMA_Q_PRIO_HIGH)
+		atomic_dec(&descq->xdev->prio_hi_qcnt);
 }
 
 void qdma_thread_add_work(struct qdma_descq *descq)
@@ -108,6 +156,9 @@ void qdma_thread_add_work(struct qdma_descq *descq)
 	unsigned int v = 0;
 	int i, idx = thread_cnt;
 
+	if (descq->conf.prio == QDMA_Q_PRIO_HIGH)
+		atomic_inc(&descq->xdev->prio_hi_qcnt);
+
 	if (descq->xdev->conf.qdma_drv_mode != POLL_MODE) {
 		spin_lock(&qcnt_lock);
 		idx = cpu_count - 1;
@@ -150,7 +201,12 @@ void qdma_thread_add_work(struct qdma_descq *descq)
 
 	thp = cs_threads + idx;
 	lock_thread(thp);
-	list_add_tail(&descq->cmplthp_list, &thp->work_list);
+	/* high priority queues at the head, serviced first on every pass */
+	if (descq->conf.prio == QDMA_Q_PRIO_HIGH) {
+		list_add(&descq->cmplthp_list, &thp->work_list);
+		thp->work_hi_cnt++;
+	} else
+		list_add_tail(&descq->cmplthp_list, &thp->work_list);
 	descq->intr_work_cpu = idx;
 	thp->work_cnt++;
 	unlock_thread(thp);
@@ -25,6 +25,11 @@
  *
  */
 
+/** completion budget of a high priority queue per service slice */
+#define QDMA_Q_PRIO_HIGH_BUDGET		16
+/** completion budget of a bulk queue while high priority queues share */
+#define QDMA_Q_PRIO_BULK_BUDGET		256
+
 /** qdma_descq forward declaration */
 struct qdma_descq;
 
@@ -0,0 +1,189 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2020,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#undef TRACE_SYSTEM
+#ifdef __QDMA_VF__
+#define TRACE_SYSTEM qdma_vf
+#else
+#define TRACE_SYSTEM qdma_pf
+#endif
+
+#if !defined(LIBQDMA_QDMA_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define LIBQDMA_QDMA_TRACE_H_
+/**
+ * @file
+ * @brief This file contains the tracepoints of the qdma datapath
+ *
+ * A request is followed through submit, descriptor post, pidx doorbell,
+ * completion detection (interrupt or poll), completion processing and
+ * done. Every event carries the device bdf, the queue index and type and
+ * a CLOCK_MONOTONIC timestamp in ns, the request events also carry the
+ * request pointer so the stages of one request can be matched up.
+ * scripts/qdma_trace_lat.py turns a trace into per stage latency
+ * histograms.
+ */
+#include <linux/tracepoint.h>
+#include <linux/ktime.h>
+#include "xdev.h"
+#include "qdma_descq.h"
+
+/** completion detected from a data interrupt */
+#define QDMA_TRACE_DETECT_IRQ		0
+/** completion detected by a completion/poll thread */
+#define QDMA_TRACE_DETECT_POLL		1
+
+#define QDMA_TRACE_Q_FIELDS \
+	__field(u32, bdf) \
+	__field(u16, qidx) \
+	__field(u8, q_type) \
+	__field(u8, st) \
+	__field(u64, ts_ns)
+
+#define QDMA_TRACE_Q_ASSIGN(descq) \
+	do { \
+		__entry->bdf = (descq)->xdev->conf.bdf; \
+		__entry->qidx = (descq)->conf.qidx; \
+		__entry->q_type = (descq)->conf.q_type; \
+		__entry->st = (descq)->conf.st; \
+		__entry->ts_ns = ktime_to_ns(ktime_get()); \
+	} while (0)
+
+#define QDMA_TRACE_Q_FMT	"dev=%05x qid=%u type=%u st=%u ts=%llu"
+#define QDMA_TRACE_Q_ARGS \
+	__entry->bdf, __entry->qidx, __entry->q_type, __entry->st, \
+	__entry->ts_ns
+
+TRACE_EVENT(qdma_req_submit,
+	TP_PROTO(struct qdma_descq *descq, struct qdma_request *req),
+	TP_ARGS(descq, req),
+	TP_STRUCT__entry(
+		QDMA_TRACE_Q_FIELDS
+		__field(void *, req)
+		__field(u32, bytes)
+	),
+	TP_fast_assign(
+		QDMA_TRACE_Q_ASSIGN(descq);
+		__entry->req = req;
+		__entry->bytes = req->count;
+	),
+	TP_printk(QDMA_TRACE_Q_FMT " req=%p bytes=%u",
+		QDMA_TRACE_Q_ARGS, __entry->req, __entry->bytes)
+);
+
+TRACE_EVENT(qdma_desc_post,
+	TP_PROTO(struct qdma_descq *descq, struct qdma_request *req,
+		unsigned int num_desc, unsigned int bytes),
+	TP_ARGS(descq, req, num_desc, bytes),
+	TP_STRUCT__entry(
+		QDMA_TRACE_Q_FIELDS
+		__field(void *, req)
+		__field(u32, num_desc)
+		__field(u32, bytes)
+	),
+	TP_fast_assign(
+		QDMA_TRACE_Q_ASSIGN(descq);
+		__entry->req = req;
+		__entry->num_desc = num_desc;
+		__entry->bytes = bytes;
+	),
+	TP_printk(QDMA_TRACE_Q_FMT " req=%p descs=%u bytes=%u",
+		QDMA_TRACE_Q_ARGS, __entry->req, __entry->num_desc,
+		__entry->bytes)
+);
+
+TRACE_EVENT(qdma_doorbell,
+	TP_PROTO(struct qdma_descq *descq),
+	TP_ARGS(descq),
+	TP_STRUCT__entry(
+		QDMA_TRACE_Q_FIELDS
+		__field(u16, pidx)
+	),
+	TP_fast_assign(
+		QDMA_TRACE_Q_ASSIGN(descq);
+		__entry->pidx = descq->pidx_info.pidx;
+	),
+	TP_printk(QDMA_TRACE_Q_FMT " pidx=%u",
+		QDMA_TRACE_Q_ARGS, __entry->pidx)
+);
+
+TRACE_EVENT(qdma_cmpl_detect,
+	TP_PROTO(struct qdma_descq *descq, unsigned int source),
+	TP_ARGS(descq, source),
+	TP_STRUCT__entry(
+		QDMA_TRACE_Q_FIELDS
+		__field(u8, source)
+	),
+	TP_fast_assign(
+		QDMA_TRACE_Q_ASSIGN(descq);
+		__entry->source = source;
+	),
+	TP_printk(QDMA_TRACE_Q_FMT " src=%s",
+		QDMA_TRACE_Q_ARGS,
+		__entry->source == QDMA_TRACE_DETECT_IRQ ? "irq" : "poll")
+);
+
+TRACE_EVENT(qdma_cmpl_proc,
+	TP_PROTO(struct qdma_descq *descq, unsigned int cnt,
+		unsigned int bytes),
+	TP_ARGS(descq, cnt, bytes),
+	TP_STRUCT__entry(
+		QDMA_TRACE_Q_FIELDS
+		__field(u32, cnt)
+		__field(u32, bytes)
+	),
+	TP_fast_assign(
+		QDMA_TRACE_Q_ASSIGN(descq);
+		__entry->cnt = cnt;
+		__entry->bytes = bytes;
+	),
+	TP_printk(QDMA_TRACE_Q_FMT " cnt=%u bytes=%u",
+		QDMA_TRACE_Q_ARGS, __entry->cnt, __entry->bytes)
+);
+
+TRACE_EVENT(qdma_req_done,
+	TP_PROTO(struct qdma_descq *descq, struct qdma_request *req,
+		unsigned int bytes, int error, u64 submit_ns),
+	TP_ARGS(descq, req, bytes, error, submit_ns),
+	TP_STRUCT__entry(
+		QDMA_TRACE_Q_FIELDS
+		__field(void *, req)
+		__field(u32, bytes)
+		__field(int, error)
+		__field(u64, submit_ns)
+	),
+	TP_fast_assign(
+		QDMA_TRACE_Q_ASSIGN(descq);
+		__entry->req = req;
+		__entry->bytes = bytes;
+		__entry->error = error;
+		__entry->submit_ns = submit_ns;
+	),
+	TP_printk(QDMA_TRACE_Q_FMT " req=%p bytes=%u err=%d submit=%llu",
+		QDMA_TRACE_Q_ARGS, __entry->req, __entry->bytes,
+		__entry->error, __entry->submit_ns)
+);
+
+#endif /* LIBQDMA_QDMA_TRACE_H_ */
+
+/* this part must be outside the header guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE qdma_trace
+#include <trace/define_trace.h>
@@ -56,6 +56,8 @@ struct qdma_kthread {
 	struct task_struct *task;
 	/**  thread work list count */
 	unsigned int work_cnt;
+	/**  high priority work items, kept at the head of work_list */
+	unsigned int work_hi_cnt;
 	/**  thread work list count */
 	struct list_head work_list;
 	/**  thread initialization handler */
@@ -32,6 +32,7 @@
 #include <linux/sched.h>
 #include <linux/vmalloc.h>
 #include <linux/delay.h>
+#include <linux/percpu.h>
 
 #include "qdma_regs.h"
 #include "xdev.h"
@@ -609,12 +610,24 @@ static struct xlnx_dma_dev *xdev_alloc(struct qdma_dev_conf *conf)
 	if (!xdev)
 		return NULL;
 
+	/* per cpu packet counters, summed up when read */
+	xdev->stats = alloc_percpu(struct qdma_dev_stats);
+	if (!xdev->stats) {
+		kfree(xdev);
+		return NULL;
+	}
+
 	spin_lock_init(&xdev->hw_prg_lock);
 	spin_lock_init(&xdev->lock);
 
 	/* create a driver to device reference */
 	memcpy(&xdev->conf, conf, sizeof(*conf));
 
+	qdma_ring_arena_init(&xdev->ring_arena, &conf->pdev->dev);
+	qdma_pg_pool_init(&xdev->pg_pool, &conf->pdev->dev);
+	qdma_fn_rl_init(&xdev->fn_rl);
+	atomic_set(&xdev->prio_hi_qcnt, 0);
+
 	xdev->magic = QDMA_MAGIC_DEVICE;
 
 	/* !! FIXME default to enabled for everything */
@@ -1178,6 +1191,9 @@ cleanup_qdma:
 unmap_bars:
 	xdev_unmap_bars(xdev, pdev);
 	xdev_list_remove(xdev);
+	qdma_pg_pool_destroy(&xdev->pg_pool);
+	qdma_ring_arena_destroy(&xdev->ring_arena);
+	free_percpu(xdev->stats);
 	kfree(xdev);
 
 disable_device:
@@ -1231,6 +1247,9 @@ int qdma_device_close(struct pci_dev *pdev, unsigned long dev_hndl)
 	qdma_dev_entry_destroy(xdev->dma_device_index, xdev->func_id);
 	qdma_master_resource_destroy(xdev->dma_device_index);
 #endif
+	qdma_pg_pool_destroy(&xdev->pg_pool);
+	qdma_ring_arena_destroy(&xdev->ring_arena);
+	free_percpu(xdev->stats);
 
 	xdev_unmap_bars(xdev, pdev);
 
@@ -1291,6 +1310,7 @@ int qdma_device_get_config(unsigned long dev_hndl, struct qdma_dev_conf *conf,
 int qdma_device_clear_stats(unsigned long dev_hndl)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
+	int cpu;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -1303,10 +1323,9 @@ int qdma_device_clear_stats(unsigned long dev_hndl)
 		return -EINVAL;
 	}
 
-	xdev->total_mm_h2c_pkts = 0;
-	xdev->total_mm_c2h_pkts = 0;
-	xdev->total_st_h2c_pkts = 0;
-	xdev->total_st_c2h_pkts = 0;
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(xdev->stats, cpu), 0,
+		       sizeof(struct qdma_dev_stats));
 	xdev->ping_pong_lat_max = 0;
 	xdev->ping_pong_lat_min = 0;
 	xdev->ping_pong_lat_total = 0;
@@ -1318,6 +1337,7 @@ int qdma_device_get_mmh2c_pkts(unsigned long dev_hndl,
 				unsigned long long *mmh2c_pkts)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
+	int cpu;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -1330,7 +1350,9 @@ int qdma_device_get_mmh2c_pkts(unsigned long dev_hndl,
 		return -EINVAL;
 	}
 
-	*mmh2c_pkts = xdev->total_mm_h2c_pkts;
+	*mmh2c_pkts = 0;
+	for_each_possible_cpu(cpu)
+		*mmh2c_pkts += per_cpu_ptr(xdev->stats, cpu)->mm_h2c_pkts;
 
 	return 0;
 }
@@ -1339,6 +1361,7 @@ int qdma_device_get_mmc2h_pkts(unsigned long dev_hndl,
 				unsigned long long *mmc2h_pkts)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
+	int cpu;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -1351,7 +1374,9 @@ int qdma_device_get_mmc2h_pkts(unsigned long dev_hndl,
 		return -EINVAL;
 	}
 
-	*mmc2h_pkts = xdev->total_mm_c2h_pkts;
+	*mmc2h_pkts = 0;
+	for_each_possible_cpu(cpu)
+		*mmc2h_pkts += per_cpu_ptr(xdev->stats, cpu)->mm_c2h_pkts;
 
 	return 0;
 }
@@ -1360,6 +1385,7 @@ int qdma_device_get_sth2c_pkts(unsigned long dev_hndl,
 				unsigned long long *sth2c_pkts)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
+	int cpu;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -1372,7 +1398,9 @@ int qdma_device_get_sth2c_pkts(unsigned long dev_hndl,
 		return -EINVAL;
 	}
 
-	*sth2c_pkts = xdev->total_st_h2c_pkts;
+	*sth2c_pkts = 0;
+	for_each_possible_cpu(cpu)
+		*sth2c_pkts += per_cpu_ptr(xdev->stats, cpu)->st_h2c_pkts;
 
 	return 0;
 }
@@ -1381,6 +1409,61 @@ int qdma_device_get_stc2h_pkts(unsigned long dev_hndl,
 				unsigned long long *stc2h_pkts)
 {
 	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
+	int cpu;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	*stc2h_pkts = 0;
+	for_each_possible_cpu(cpu)
+		*stc2h_pkts += per_cpu_ptr(xdev->stats, cpu)->st_c2h_pkts;
+
+	return 0;
+}
+
+int qdma_device_get_stats(unsigned long dev_hndl,
+				struct qdma_dev_stats *stats)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
+	int cpu;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev || !stats) {
+		pr_err("dev_hndl or stats is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	for_each_possible_cpu(cpu) {
+		struct qdma_dev_stats *pcpu = per_cpu_ptr(xdev->stats, cpu);
+
+		stats->mm_h2c_pkts += pcpu->mm_h2c_pkts;
+		stats->mm_c2h_pkts += pcpu->mm_c2h_pkts;
+		stats->st_h2c_pkts += pcpu->st_h2c_pkts;
+		stats->st_c2h_pkts += pcpu->st_c2h_pkts;
+		stats->rl_fn_throttled += pcpu->rl_fn_throttled;
+	}
+
+	return 0;
+}
+
+int qdma_device_set_rate_limit(unsigned long dev_hndl, u32 rate_mbps,
+				u32 burst)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
 
 	/** make sure that the dev_hndl passed is Valid */
 	if (!xdev) {
@@ -1393,7 +1476,33 @@ int qdma_device_get_stc2h_pkts(unsigned long dev_hndl,
 		return -EINVAL;
 	}
 
-	*stc2h_pkts = xdev->total_st_c2h_pkts;
+	spin_lock_bh(&xdev->fn_rl.lock);
+	qdma_rl_bucket_set(&xdev->fn_rl.bucket, rate_mbps, burst);
+	spin_unlock_bh(&xdev->fn_rl.lock);
+
+	return 0;
+}
+
+int qdma_device_get_rate_limit(unsigned long dev_hndl, u32 *rate_mbps,
+				u32 *burst)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *) dev_hndl;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev || !rate_mbps || !burst) {
+		pr_err("dev_hndl or rate_mbps/burst is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	spin_lock_bh(&xdev->fn_rl.lock);
+	*rate_mbps = xdev->fn_rl.bucket.rate_mbps;
+	*burst = xdev->fn_rl.bucket.burst;
+	spin_unlock_bh(&xdev->fn_rl.lock);
 
 	return 0;
 }
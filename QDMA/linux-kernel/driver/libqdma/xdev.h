@@ -32,6 +32,9 @@
 #include "libqdma_export.h"
 #include "qdma_mbox.h"
 #include "qdma_access_errors.h"
+#include "qdma_ring_arena.h"
+#include "qdma_pg_pool.h"
+#include "qdma_rl.h"
 #ifdef DEBUGFS
 #include "qdma_debugfs.h"
 
@@ -229,6 +232,8 @@ struct xlnx_dma_dev {
 	 * interrupt gets triggered again
 	 */
 	struct qdma_descq *prev_descq;
+	/**< high priority queues online, bulk queues get a budget if any */
+	atomic_t prio_hi_qcnt;
 	/**< DMA device configuration */
 	struct qdma_dev_conf conf;
 	/**< csr info */
@@ -284,6 +289,12 @@ struct xlnx_dma_dev {
 	void *dev_priv;
 	/**< list of interrupt coalescing configuration for each vector */
 	struct intr_coal_conf  *intr_coal_list;
+	/**< pool of DMA-coherent desc, cmpt and intr rings */
+	struct qdma_ring_arena ring_arena;
+	/**< pool of DMA mapped ST C2H freelist pages */
+	struct qdma_pg_pool pg_pool;
+	/**< rate limit of the function, ceiling of all its queues */
+	struct qdma_fn_rl fn_rl;
 	/**< legacy interrupt vector */
 	int vector_legacy;
 	/**< error lock */
@@ -305,10 +316,8 @@ struct xlnx_dma_dev {
 
 	/** number of packets processed in pf */
 	struct qdma_mbox mbox;
-	unsigned long long total_mm_h2c_pkts;
-	unsigned long long total_mm_c2h_pkts;
-	unsigned long long total_st_h2c_pkts;
-	unsigned long long total_st_c2h_pkts;
+	/** per cpu packet counters */
+	struct qdma_dev_stats __percpu *stats;
 	/** max ping_pong latency */
 	u64 ping_pong_lat_max;
 	/** min ping_pong latency */
@@ -35,6 +35,9 @@
 #include <linux/sched.h>
 #include <linux/wait.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/bitmap.h>
 #include <linux/version.h>
 #if KERNEL_VERSION(3, 16, 0) <= LINUX_VERSION_CODE
 #include <linux/uio.h>
@@ -68,11 +71,6 @@ struct cdev_async_io {
 	struct work_struct wrk_itm;
 };
 
-enum qdma_cdev_ioctl_cmd {
-	QDMA_CDEV_IOCTL_NO_MEMCPY,
-	QDMA_CDEV_IOCTL_CMDS
-};
-
 static struct class *qdma_class;
 static struct kmem_cache *cdev_cache;
 
@@ -80,6 +78,16 @@ static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 		size_t count, loff_t *pos, bool write);
 static void unmap_user_buf(struct qdma_io_cb *iocb, bool write);
 static inline void iocb_release(struct qdma_io_cb *iocb);
+static long cdev_rw_vec(struct qdma_cdev *xcdev, unsigned long arg);
+static long cdev_arb_conf(struct qdma_cdev *xcdev, unsigned long arg);
+static long cdev_ctx_weight(struct qdma_cdev_ctx *ctx, unsigned long arg);
+static long cdev_ctx_stats(struct qdma_cdev_ctx *ctx, unsigned long arg);
+static long cdev_xfer_prep(struct qdma_cdev_ctx *ctx, unsigned long arg);
+static long cdev_xfer_submit(struct qdma_cdev_ctx *ctx, unsigned long arg);
+static long cdev_xfer_release(struct qdma_cdev_ctx *ctx, unsigned long arg);
+static void cdev_xfer_release_all(struct qdma_cdev_ctx *ctx);
+static void cdev_arb_init(struct qdma_cdev *xcdev);
+static void cdev_arb_drain(struct qdma_cdev_arb *arb, int err);
 
 static inline void xlnx_phy_dev_list_remove(struct xlnx_phy_dev *phy_dev)
 {
@@ -150,31 +158,69 @@ static int qdma_req_completed(struct qdma_request *req,
 /*
  * character device file operations
  */
+static inline struct qdma_cdev *cdev_file_xcdev(struct file *file)
+{
+	struct qdma_cdev_ctx *ctx = (struct qdma_cdev_ctx *)file->private_data;
+
+	return ctx ? ctx->xcdev : NULL;
+}
+
 static int cdev_gen_open(struct inode *inode, struct file *file)
 {
 	struct qdma_cdev *xcdev = container_of(inode->i_cdev, struct qdma_cdev,
 						cdev);
-	file->private_data = xcdev;
+	struct qdma_cdev_ctx *ctx;
+	int rv = 0;
+	int i;
+
+	ctx = kzalloc(sizeof(struct qdma_cdev_ctx), GFP_KERNEL);
+	if (!ctx) {
+		pr_err("%s: OOM.\n", xcdev->name);
+		return -ENOMEM;
+	}
+	ctx->xcdev = xcdev;
+	ctx->weight = QDMA_CDEV_WEIGHT_DEFAULT;
+	ctx->stats.weight = ctx->weight;
+	init_waitqueue_head(&ctx->wq);
+	mutex_init(&ctx->xfer_lock);
+	for (i = 0; i < 2; i++) {
+		ctx->q[i].ctx = ctx;
+		INIT_LIST_HEAD(&ctx->q[i].pend);
+		INIT_LIST_HEAD(&ctx->q[i].active);
+	}
+	file->private_data = ctx;
 
 	if (xcdev->fp_open_extra)
-		return xcdev->fp_open_extra(xcdev);
+		rv = xcdev->fp_open_extra(xcdev);
+	if (rv < 0) {
+		file->private_data = NULL;
+		kfree(ctx);
+	}
 
-	return 0;
+	return rv;
 }
 
 static int cdev_gen_close(struct inode *inode, struct file *file)
 {
-	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
+	struct qdma_cdev_ctx *ctx = (struct qdma_cdev_ctx *)file->private_data;
+	struct qdma_cdev *xcdev = ctx ? ctx->xcdev : NULL;
+	int rv = 0;
 
 	if (xcdev && xcdev->fp_close_extra)
-		return xcdev->fp_close_extra(xcdev);
+		rv = xcdev->fp_close_extra(xcdev);
 
-	return 0;
+	/* aio holds the file, nothing of ctx is queued or in flight here */
+	if (ctx)
+		cdev_xfer_release_all(ctx);
+	file->private_data = NULL;
+	kfree(ctx);
+
+	return rv;
 }
 
 static loff_t cdev_gen_llseek(struct file *file, loff_t off, int whence)
 {
-	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
+	struct qdma_cdev *xcdev = cdev_file_xcdev(file);
 
 	loff_t newpos = 0;
 
@@ -200,15 +246,215 @@ static loff_t cdev_gen_llseek(struct file *file, loff_t off, int whence)
 	return newpos;
 }
 
+/*
+ * resolve the stripe group queues of one direction, 0: all of them are
+ * there, -ENOENT: the group lacks the direction, <0: a queue is unfit
+ */
+static int cdev_stripe_resolve(struct qdma_cdev *xcdev,
+			struct qdma_cdev_stripe_conf *conf, u8 q_type,
+			unsigned long *qhndls)
+{
+	struct xlnx_pci_dev *xpdev = xcdev->xcb->xpdev;
+	struct qdma_queue_conf qconf;
+	struct qdma_q_state qstate;
+	char ebuf[XNL_EBUFLEN];
+	unsigned int i;
+	int rv;
+
+	for (i = 0; i < conf->q_cnt; i++) {
+		struct xlnx_qdata *qdata = xpdev_queue_get(xpdev,
+						conf->qidx[i], q_type, 1,
+						NULL, 0);
+
+		if (!qdata) {
+			if (i) {
+				pr_err("%s: stripe qidx %u %s missing.\n",
+					xcdev->name, conf->qidx[i],
+					q_type == Q_H2C ? "H2C" : "C2H");
+				return -EINVAL;
+			}
+			return -ENOENT;
+		}
+
+		rv = qdma_queue_get_config(xpdev->dev_hndl, qdata->qhndl,
+					&qconf, ebuf, XNL_EBUFLEN);
+		if (rv < 0)
+			return rv;
+		rv = qdma_get_queue_state(xpdev->dev_hndl, qdata->qhndl,
+					&qstate, ebuf, XNL_EBUFLEN);
+		if (rv < 0)
+			return rv;
+		if (qconf.st || qstate.qstate != Q_STATE_ONLINE) {
+			pr_err("%s: stripe qidx %u %s %s.\n", xcdev->name,
+				conf->qidx[i], q_type == Q_H2C ? "H2C" : "C2H",
+				qconf.st ? "is ST" : "not started");
+			return -EINVAL;
+		}
+		if (qconf.aperture_size) {
+			pr_err("%s: stripe qidx %u keyhole, aperture %u.\n",
+				xcdev->name, conf->qidx[i],
+				qconf.aperture_size);
+			return -EINVAL;
+		}
+		qhndls[i] = qdata->qhndl;
+	}
+
+	return 0;
+}
+
+static long cdev_stripe_conf(struct qdma_cdev *xcdev, unsigned long arg)
+{
+	struct qdma_cdev_stripe_conf conf;
+	unsigned int qmax = xcdev->xcb->xpdev->qmax;
+	unsigned long qhndl[2][QDMA_STRIPE_Q_MAX];
+	unsigned int dir_mask = 0;
+	unsigned int i;
+	int rv;
+
+	if (copy_from_user(&conf, (void __user *)arg, sizeof(conf)))
+		return -EFAULT;
+
+	if (conf.q_cnt > QDMA_STRIPE_Q_MAX ||
+	    (conf.q_cnt && !conf.stripe_len)) {
+		pr_err("%s: stripe q_cnt %u/%u, len %u invalid.\n",
+			xcdev->name, conf.q_cnt, QDMA_STRIPE_Q_MAX,
+			conf.stripe_len);
+		return -EINVAL;
+	}
+	for (i = 0; i < conf.q_cnt; i++) {
+		if (conf.qidx[i] >= qmax) {
+			pr_err("%s: stripe qidx %u >= qmax %u.\n",
+				xcdev->name, conf.qidx[i], qmax);
+			return -EINVAL;
+		}
+	}
+
+	memset(qhndl, 0, sizeof(qhndl));
+	if (conf.q_cnt) {
+		/* a group may serve one direction only, not none */
+		rv = cdev_stripe_resolve(xcdev, &conf, Q_H2C, qhndl[0]);
+		if (!rv)
+			dir_mask |= 1 << 0;
+		else if (rv != -ENOENT)
+			return rv;
+		rv = cdev_stripe_resolve(xcdev, &conf, Q_C2H, qhndl[1]);
+		if (!rv)
+			dir_mask |= 1 << 1;
+		else if (rv != -ENOENT)
+			return rv;
+		if (!dir_mask) {
+			pr_err("%s: stripe qidx %u NOT configured.\n",
+				xcdev->name, conf.qidx[0]);
+			return -ENODEV;
+		}
+	}
+
+	spin_lock(&xcdev->xcb->lock);
+	xcdev->stripe_len = conf.stripe_len;
+	xcdev->stripe_q_cnt = conf.q_cnt;
+	xcdev->stripe_dir_mask = dir_mask;
+	memcpy(xcdev->stripe_qhndl, qhndl, sizeof(qhndl));
+	spin_unlock(&xcdev->xcb->lock);
+
+	return 0;
+}
+
+static long cdev_cmpt_read(struct qdma_cdev *xcdev, unsigned long arg)
+{
+	struct qdma_cdev_cmpt_read crd;
+	struct qdma_cdev_cmpt_read __user *ucrd = (void __user *)arg;
+	struct xlnx_pci_dev *xpdev = xcdev->xcb->xpdev;
+	unsigned long dev_hndl = xpdev->dev_hndl;
+	struct qdma_queue_conf qconf;
+	struct xlnx_qdata *qdata;
+	char ebuf[XNL_EBUFLEN];
+	unsigned int entry_len = 0;
+	unsigned int done = 0;
+	unsigned int chunk;
+	u8 *kbuf;
+	int rv = 0;
+
+	if (!xcdev->fp_cmpt_read)
+		return -EINVAL;
+	if (copy_from_user(&crd, ucrd, sizeof(crd)))
+		return -EFAULT;
+	if (!crd.len)
+		return -EINVAL;
+
+	/* the completion queue shares the queue index of the cdev's queues */
+	rv = qdma_queue_get_config(dev_hndl,
+			(xcdev->dir_init & (1 << Q_H2C)) ? xcdev->h2c_qhndl :
+			xcdev->c2h_qhndl, &qconf, ebuf, XNL_EBUFLEN);
+	if (rv < 0)
+		return -EINVAL;
+	qdata = xpdev_queue_get(xpdev, qconf.qidx, Q_CMPT, 1, NULL, 0);
+	if (!qdata) {
+		pr_err("%s: qidx %u has no CMPT queue.\n", xcdev->name,
+			qconf.qidx);
+		return -ENODEV;
+	}
+
+	chunk = min_t(unsigned int, crd.len, QDMA_CDEV_CMPT_READ_CHUNK);
+	kbuf = kmalloc(chunk, GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
+
+	/* drain in chunks until the ring is empty or the user buffer full */
+	while (done < crd.len) {
+		unsigned int len = min(crd.len - done, chunk);
+
+		rv = xcdev->fp_cmpt_read(dev_hndl, qdata->qhndl, kbuf, len,
+					&entry_len);
+		if (rv <= 0)
+			break;
+		if (copy_to_user((void __user *)(unsigned long)(crd.buf + done),
+				kbuf, rv * entry_len)) {
+			rv = -EFAULT;
+			break;
+		}
+		done += rv * entry_len;
+		/* a chunk with room left over means the ring is drained */
+		if (rv * entry_len + entry_len <= len)
+			break;
+	}
+	kfree(kbuf);
+
+	if (rv < 0 && !done)
+		return rv;
+	if (put_user(entry_len, &ucrd->entry_len))
+		return -EFAULT;
+
+	return entry_len ? done / entry_len : 0;
+}
+
 static long cdev_gen_ioctl(struct file *file, unsigned int cmd,
 			unsigned long arg)
 {
-	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
+	struct qdma_cdev_ctx *ctx = (struct qdma_cdev_ctx *)file->private_data;
+	struct qdma_cdev *xcdev = ctx->xcdev;
 
 	switch (cmd) {
 	case QDMA_CDEV_IOCTL_NO_MEMCPY:
 		get_user(xcdev->no_memcpy, (unsigned char *)arg);
 		return 0;
+	case QDMA_CDEV_IOCTL_STRIPE:
+		return cdev_stripe_conf(xcdev, arg);
+	case QDMA_CDEV_IOCTL_RW_VEC:
+		return cdev_rw_vec(xcdev, arg);
+	case QDMA_CDEV_IOCTL_CMPT_READ:
+		return cdev_cmpt_read(xcdev, arg);
+	case QDMA_CDEV_IOCTL_ARB_CONF:
+		return cdev_arb_conf(xcdev, arg);
+	case QDMA_CDEV_IOCTL_CTX_WEIGHT:
+		return cdev_ctx_weight(ctx, arg);
+	case QDMA_CDEV_IOCTL_CTX_STATS:
+		return cdev_ctx_stats(ctx, arg);
+	case QDMA_CDEV_IOCTL_XFER_PREP:
+		return cdev_xfer_prep(ctx, arg);
+	case QDMA_CDEV_IOCTL_XFER_SUBMIT:
+		return cdev_xfer_submit(ctx, arg);
+	case QDMA_CDEV_IOCTL_XFER_RELEASE:
+		return cdev_xfer_release(ctx, arg);
 	default:
 		break;
 	}
@@ -337,15 +583,815 @@ err_out:
 	return rv;
 }
 
+/*
+ * per open file arbitration
+ *
+ * Start-time fair queuing: a request queued by an open file gets the start
+ * tag max(vtime, finish tag of the file's previous request) and its finish
+ * tag is the start tag plus its length scaled by the file's weight. The
+ * dispatch pass hands the queued request with the smallest start tag to
+ * the ring as long as the ring budget allows, so a file gets its share of
+ * the queue however much the others have queued, and a file that went idle
+ * gets no credit for the time it did not use.
+ */
+#define CDEV_ARB_IDX(write)	((write) ? 0 : 1)
+
+static void cdev_arb_dispatch(struct qdma_cdev_arb *arb);
+
+static inline u64 cdev_now_ns(void)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+/* called with the arbiter lock held */
+static void cdev_ctx_account(struct qdma_cdev_ctx *ctx, unsigned int idx,
+		struct qdma_io_cb *qiocb, unsigned int bytes_done, int err)
+{
+	struct qdma_cdev_ctx_dir_stats *st = &ctx->stats.dir[idx];
+	u64 lat = cdev_now_ns() - qiocb->enq_ns;
+
+	st->reqs++;
+	if (err < 0)
+		st->errors++;
+	else
+		st->bytes += bytes_done;
+	st->wait_ns += qiocb->disp_ns - qiocb->enq_ns;
+	st->lat_ns += lat;
+	if (lat > st->lat_max_ns)
+		st->lat_max_ns = lat;
+}
+
+/* called with the arbiter lock held */
+static void cdev_arb_queue(struct qdma_cdev_arb *arb,
+		struct qdma_cdev_ctx *ctx, struct qdma_io_cb *qiocb)
+{
+	struct qdma_cdev_ctx_q *q = &ctx->q[CDEV_ARB_IDX(arb->write)];
+	u64 len = max_t(u64, qiocb->len, 1);
+
+	qiocb->arb_tag = max(arb->vtime, q->finish);
+	q->finish = qiocb->arb_tag + div_u64(len * QDMA_CDEV_WEIGHT_DEFAULT,
+					     ctx->weight);
+	if (list_empty(&q->pend))
+		list_add_tail(&q->active, &arb->active);
+	list_add_tail(&qiocb->arb_list, &q->pend);
+}
+
+/* called with the arbiter lock held */
+static void cdev_arb_unqueue(struct qdma_cdev_arb *arb,
+		struct qdma_io_cb *qiocb)
+{
+	struct qdma_cdev_ctx_q *q = &qiocb->ctx->q[CDEV_ARB_IDX(arb->write)];
+
+	list_del(&qiocb->arb_list);
+	if (list_empty(&q->pend))
+		list_del_init(&q->active);
+}
+
+/* called with the arbiter lock held, the head request with the lowest tag */
+static struct qdma_io_cb *cdev_arb_pick(struct qdma_cdev_arb *arb)
+{
+	struct qdma_cdev_ctx_q *q;
+	struct qdma_io_cb *best = NULL;
+
+	list_for_each_entry(q, &arb->active, active) {
+		struct qdma_io_cb *qiocb = list_first_entry(&q->pend,
+						struct qdma_io_cb, arb_list);
+
+		if (!best || qiocb->arb_tag < best->arb_tag)
+			best = qiocb;
+	}
+
+	return best;
+}
+
+static int cdev_arb_req_done(struct qdma_request *req,
+		unsigned int bytes_done, int err)
+{
+	struct qdma_io_cb *qiocb = container_of(req, struct qdma_io_cb, req);
+	struct qdma_cdev_ctx *ctx = qiocb->ctx;
+	unsigned int idx = CDEV_ARB_IDX(req->write);
+	struct qdma_cdev_arb *arb = &ctx->xcdev->arb[idx];
+	int (*fp_done)(struct qdma_request *req, unsigned int bytes_done,
+			int err) = qiocb->fp_done;
+	unsigned long flags;
+	bool kick;
+
+	spin_lock_irqsave(&arb->lock, flags);
+	cdev_ctx_account(ctx, idx, qiocb, bytes_done, err);
+	if (qiocb->arb_charged) {
+		arb->inflight -= qiocb->len;
+		qiocb->arb_charged = 0;
+	}
+	/* completed within the submit call, see cdev_arb_dispatch() */
+	if (arb->submitter == current && !in_interrupt())
+		set_bit(qiocb->arb_idx, arb->batch_done);
+	kick = !list_empty(&arb->active);
+	spin_unlock_irqrestore(&arb->lock, flags);
+
+	/* completions run under the descq lock, dispatch from the work */
+	if (kick)
+		schedule_work(&arb->work);
+
+	/* frees qiocb, and ctx with the last reference to the file */
+	return fp_done(req, bytes_done, err);
+}
+
+static void cdev_arb_work(struct work_struct *work)
+{
+	cdev_arb_dispatch(container_of(work, struct qdma_cdev_arb, work));
+}
+
+/*
+ * Hands queued requests to the ring in tag order while the budget allows.
+ * One pass runs at a time, a caller finding one running leaves its work to
+ * it.
+ */
+static void cdev_arb_dispatch(struct qdma_cdev_arb *arb)
+{
+	struct qdma_cdev *xcdev = arb->xcdev;
+	struct qdma_request *reqv[QDMA_CDEV_ARB_BATCH];
+	unsigned long qhndl;
+	unsigned long flags;
+	unsigned int n, i;
+	ssize_t rv;
+
+	spin_lock_irqsave(&arb->lock, flags);
+	if (arb->busy) {
+		arb->again = 1;
+		spin_unlock_irqrestore(&arb->lock, flags);
+		return;
+	}
+	arb->busy = 1;
+
+	do {
+		arb->again = 0;
+		n = 0;
+		while (n < QDMA_CDEV_ARB_BATCH) {
+			struct qdma_io_cb *qiocb = cdev_arb_pick(arb);
+
+			if (!qiocb)
+				break;
+			/* one request always fits, however large */
+			if (arb->inflight_max && arb->inflight &&
+			    arb->inflight + qiocb->len > arb->inflight_max)
+				break;
+
+			cdev_arb_unqueue(arb, qiocb);
+			arb->vtime = qiocb->arb_tag;
+			arb->inflight += qiocb->len;
+			qiocb->arb_charged = 1;
+			qiocb->disp_ns = cdev_now_ns();
+			if (!qiocb->fp_done) {
+				/* sync request, its caller submits it */
+				qiocb->arb_granted = 1;
+				wake_up_all(&qiocb->ctx->wq);
+				continue;
+			}
+			qiocb->arb_idx = n;
+			reqv[n++] = &qiocb->req;
+		}
+		if (!n)
+			continue;
+
+		bitmap_zero(arb->batch_done, QDMA_CDEV_ARB_BATCH);
+		arb->submitter = current;
+		spin_unlock_irqrestore(&arb->lock, flags);
+
+		qhndl = arb->write ? xcdev->h2c_qhndl : xcdev->c2h_qhndl;
+		rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl, n,
+				reqv);
+
+		spin_lock_irqsave(&arb->lock, flags);
+		arb->submitter = NULL;
+		if (rv < 0) {
+			unsigned int cnt = 0;
+
+			/* nothing queued, fail what did not complete already */
+			for (i = 0; i < n; i++)
+				if (!test_bit(i, arb->batch_done))
+					reqv[cnt++] = reqv[i];
+			spin_unlock_irqrestore(&arb->lock, flags);
+			pr_err("%s: arb submit %u/%u failed %ld.\n",
+				xcdev->name, cnt, n, (long)rv);
+			for (i = 0; i < cnt; i++)
+				cdev_arb_req_done(reqv[i], 0, rv);
+			spin_lock_irqsave(&arb->lock, flags);
+		}
+		arb->again = 1;
+	} while (arb->again);
+
+	arb->busy = 0;
+	spin_unlock_irqrestore(&arb->lock, flags);
+}
+
+/* async requests: queued in the arbiter, or straight to the ring */
+static ssize_t cdev_arb_submit(struct qdma_cdev_ctx *ctx, bool write,
+		struct qdma_io_cb *qiocb, struct qdma_request **reqv,
+		unsigned long count)
+{
+	struct qdma_cdev *xcdev = ctx->xcdev;
+	struct qdma_cdev_arb *arb = &xcdev->arb[CDEV_ARB_IDX(write)];
+	u64 now = cdev_now_ns();
+	unsigned long flags;
+	unsigned long i;
+
+	for (i = 0; i < count; i++) {
+		qiocb[i].ctx = ctx;
+		qiocb[i].fp_done = reqv[i]->fp_done;
+		qiocb[i].enq_ns = now;
+		qiocb[i].disp_ns = now;
+		reqv[i]->fp_done = cdev_arb_req_done;
+	}
+
+	spin_lock_irqsave(&arb->lock, flags);
+	if (!arb->inflight_max) {
+		spin_unlock_irqrestore(&arb->lock, flags);
+		return xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl,
+				write ? xcdev->h2c_qhndl : xcdev->c2h_qhndl,
+				count, reqv);
+	}
+	for (i = 0; i < count; i++)
+		cdev_arb_queue(arb, ctx, qiocb + i);
+	spin_unlock_irqrestore(&arb->lock, flags);
+
+	cdev_arb_dispatch(arb);
+
+	return 0;
+}
+
+/* sync requests: wait for the turn of the request */
+static int cdev_arb_wait(struct qdma_cdev_ctx *ctx, bool write,
+		struct qdma_io_cb *qiocb)
+{
+	struct qdma_cdev_arb *arb = &ctx->xcdev->arb[CDEV_ARB_IDX(write)];
+	unsigned long flags;
+	int rv;
+
+	qiocb->ctx = ctx;
+	qiocb->fp_done = NULL;
+	qiocb->enq_ns = cdev_now_ns();
+	qiocb->disp_ns = qiocb->enq_ns;
+
+	spin_lock_irqsave(&arb->lock, flags);
+	if (!arb->inflight_max) {
+		spin_unlock_irqrestore(&arb->lock, flags);
+		return 0;
+	}
+	cdev_arb_queue(arb, ctx, qiocb);
+	spin_unlock_irqrestore(&arb->lock, flags);
+
+	cdev_arb_dispatch(arb);
+
+	rv = wait_event_interruptible(ctx->wq, READ_ONCE(qiocb->arb_granted));
+	if (!rv)
+		return 0;
+
+	spin_lock_irqsave(&arb->lock, flags);
+	if (qiocb->arb_granted) {
+		spin_unlock_irqrestore(&arb->lock, flags);
+		return 0;
+	}
+	cdev_arb_unqueue(arb, qiocb);
+	spin_unlock_irqrestore(&arb->lock, flags);
+
+	return rv;
+}
+
+static void cdev_arb_sync_done(struct qdma_cdev_ctx *ctx, bool write,
+		struct qdma_io_cb *qiocb, ssize_t res)
+{
+	unsigned int idx = CDEV_ARB_IDX(write);
+	struct qdma_cdev_arb *arb = &ctx->xcdev->arb[idx];
+	unsigned long flags;
+	bool kick;
+
+	spin_lock_irqsave(&arb->lock, flags);
+	cdev_ctx_account(ctx, idx, qiocb, res > 0 ? res : 0,
+			res < 0 ? res : 0);
+	if (qiocb->arb_charged) {
+		arb->inflight -= qiocb->len;
+		qiocb->arb_charged = 0;
+	}
+	kick = !list_empty(&arb->active);
+	spin_unlock_irqrestore(&arb->lock, flags);
+
+	if (kick)
+		cdev_arb_dispatch(arb);
+}
+
+static void cdev_arb_init(struct qdma_cdev *xcdev)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		struct qdma_cdev_arb *arb = &xcdev->arb[i];
+
+		spin_lock_init(&arb->lock);
+		INIT_LIST_HEAD(&arb->active);
+		INIT_WORK(&arb->work, cdev_arb_work);
+		arb->xcdev = xcdev;
+		arb->write = (i == CDEV_ARB_IDX(1));
+	}
+}
+
+/*
+ * Fails the requests still queued in the arbiter and turns it off, for a
+ * cdev going away. A kick scheduled by a completion may be cancelled
+ * before it runs, so nothing is left for the dispatch work to do.
+ */
+static void cdev_arb_drain(struct qdma_cdev_arb *arb, int err)
+{
+	struct qdma_io_cb *qiocb, *tmp;
+	unsigned long flags;
+	LIST_HEAD(failed);
+
+	spin_lock_irqsave(&arb->lock, flags);
+	/* anything submitted from now on goes straight to the ring */
+	arb->inflight_max = 0;
+	while ((qiocb = cdev_arb_pick(arb))) {
+		cdev_arb_unqueue(arb, qiocb);
+		qiocb->disp_ns = cdev_now_ns();
+		if (!qiocb->fp_done) {
+			/* sync request, its caller gets the error from the
+			 * queue
+			 */
+			qiocb->arb_granted = 1;
+			wake_up_all(&qiocb->ctx->wq);
+			continue;
+		}
+		list_add_tail(&qiocb->arb_list, &failed);
+	}
+	spin_unlock_irqrestore(&arb->lock, flags);
+
+	list_for_each_entry_safe(qiocb, tmp, &failed, arb_list) {
+		list_del(&qiocb->arb_list);
+		cdev_arb_req_done(&qiocb->req, 0, err);
+	}
+
+	cancel_work_sync(&arb->work);
+}
+
+static long cdev_arb_conf(struct qdma_cdev *xcdev, unsigned long arg)
+{
+	struct qdma_cdev_arb_conf conf;
+	unsigned long flags;
+	int i;
+
+	if (copy_from_user(&conf, (void __user *)arg, sizeof(conf)))
+		return -EFAULT;
+
+	for (i = 0; i < 2; i++) {
+		struct qdma_cdev_arb *arb = &xcdev->arb[i];
+
+		spin_lock_irqsave(&arb->lock, flags);
+		arb->inflight_max = conf.inflight_max;
+		spin_unlock_irqrestore(&arb->lock, flags);
+		/* a larger budget, or none, lets queued requests go */
+		cdev_arb_dispatch(arb);
+	}
+
+	return 0;
+}
+
+static long cdev_ctx_weight(struct qdma_cdev_ctx *ctx, unsigned long arg)
+{
+	unsigned int weight;
+	unsigned long flags;
+	int i;
+
+	if (get_user(weight, (unsigned int __user *)arg))
+		return -EFAULT;
+	if (!weight || weight > QDMA_CDEV_WEIGHT_MAX) {
+		pr_err("%s: weight %u not in 1 ~ %u.\n", ctx->xcdev->name,
+			weight, QDMA_CDEV_WEIGHT_MAX);
+		return -EINVAL;
+	}
+
+	/* applies from the next request queued */
+	for (i = 0; i < 2; i++) {
+		spin_lock_irqsave(&ctx->xcdev->arb[i].lock, flags);
+		ctx->weight = weight;
+		ctx->stats.weight = weight;
+		spin_unlock_irqrestore(&ctx->xcdev->arb[i].lock, flags);
+	}
+
+	return 0;
+}
+
+static long cdev_ctx_stats(struct qdma_cdev_ctx *ctx, unsigned long arg)
+{
+	struct qdma_cdev_ctx_stats stats;
+	unsigned long flags;
+	int i;
+
+	memset(&stats, 0, sizeof(stats));
+	for (i = 0; i < 2; i++) {
+		spin_lock_irqsave(&ctx->xcdev->arb[i].lock, flags);
+		stats.weight = ctx->stats.weight;
+		stats.dir[i] = ctx->stats.dir[i];
+		spin_unlock_irqrestore(&ctx->xcdev->arb[i].lock, flags);
+	}
+
+	if (copy_to_user((void __user *)arg, &stats, sizeof(stats)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*
+ * prepared MM transfers, see qdma_mm_xfer_prepare(), the user buffer stays
+ * pinned while libqdma still has the transfer in flight
+ */
+static int cdev_xfer_free(struct qdma_cdev *xcdev, struct qdma_cdev_xfer *x)
+{
+	int rv;
+
+	if (x->hndl) {
+		rv = qdma_mm_xfer_release(xcdev->xcb->xpdev->dev_hndl,
+					x->hndl);
+		if (rv < 0)
+			return rv;
+	}
+	unmap_user_buf(&x->iocb, x->write);
+	iocb_release(&x->iocb);
+	kfree(x);
+
+	return 0;
+}
+
+static long cdev_xfer_prep(struct qdma_cdev_ctx *ctx, unsigned long arg)
+{
+	struct qdma_cdev *xcdev = ctx->xcdev;
+	struct qdma_cdev_xfer_prep prep;
+	struct qdma_cdev_xfer *x;
+	struct qdma_request *req;
+	unsigned long qhndl;
+	unsigned int id;
+	int rv;
+
+	if (copy_from_user(&prep, (void __user *)arg, sizeof(prep)))
+		return -EFAULT;
+	if (!prep.len || prep.len > INT_MAX)
+		return -EINVAL;
+	if (!(xcdev->dir_init & (1 << (prep.write ? Q_H2C : Q_C2H)))) {
+		pr_err("%s: no %s queue.\n", xcdev->name,
+			prep.write ? "H2C" : "C2H");
+		return -EINVAL;
+	}
+	qhndl = prep.write ? xcdev->h2c_qhndl : xcdev->c2h_qhndl;
+
+	x = kzalloc(sizeof(struct qdma_cdev_xfer), GFP_KERNEL);
+	if (!x)
+		return -ENOMEM;
+	x->write = prep.write ? 1 : 0;
+	x->iocb.buf = (void __user *)(unsigned long)prep.buf;
+	x->iocb.len = prep.len;
+	rv = map_user_buf_to_sgl(&x->iocb, x->write);
+	if (rv < 0) {
+		kfree(x);
+		return rv;
+	}
+
+	req = &x->iocb.req;
+	req->sgcnt = x->iocb.pages_nr;
+	req->sgl = x->iocb.sgl;
+	req->write = x->write;
+	req->dma_mapped = 0;
+	req->ep_addr = prep.ep_addr;
+	req->count = prep.len;
+	req->timeout_ms = 10 * 1000;	/* 10 seconds */
+	req->fp_done = NULL;		/* blocking */
+	rv = qdma_mm_xfer_prepare(xcdev->xcb->xpdev->dev_hndl, qhndl, req,
+				&x->hndl);
+	if (rv < 0) {
+		x->hndl = 0;
+		cdev_xfer_free(xcdev, x);
+		return rv;
+	}
+
+	mutex_lock(&ctx->xfer_lock);
+	for (id = 0; id < QDMA_CDEV_XFER_MAX; id++)
+		if (!ctx->xfer[id])
+			break;
+	if (id < QDMA_CDEV_XFER_MAX)
+		ctx->xfer[id] = x;
+	mutex_unlock(&ctx->xfer_lock);
+	if (id == QDMA_CDEV_XFER_MAX) {
+		cdev_xfer_free(xcdev, x);
+		return -ENOSPC;
+	}
+
+	if (put_user(id, &((struct qdma_cdev_xfer_prep __user *)arg)->id)) {
+		mutex_lock(&ctx->xfer_lock);
+		ctx->xfer[id] = NULL;
+		mutex_unlock(&ctx->xfer_lock);
+		cdev_xfer_free(xcdev, x);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static long cdev_xfer_submit(struct qdma_cdev_ctx *ctx, unsigned long arg)
+{
+	struct qdma_cdev_xfer *x;
+	ssize_t res = 0;
+	u32 id;
+
+	if (get_user(id, (u32 __user *)arg))
+		return -EFAULT;
+	if (id >= QDMA_CDEV_XFER_MAX)
+		return -EINVAL;
+
+	mutex_lock(&ctx->xfer_lock);
+	x = ctx->xfer[id];
+	if (!x)
+		res = -EINVAL;
+	else if (x->busy)
+		res = -EBUSY;
+	else
+		x->busy = 1;
+	mutex_unlock(&ctx->xfer_lock);
+	if (res < 0)
+		return res;
+
+	res = qdma_mm_xfer_submit(ctx->xcdev->xcb->xpdev->dev_hndl, x->hndl);
+
+	mutex_lock(&ctx->xfer_lock);
+	x->busy = 0;
+	mutex_unlock(&ctx->xfer_lock);
+
+	return res;
+}
+
+static long cdev_xfer_release(struct qdma_cdev_ctx *ctx, unsigned long arg)
+{
+	struct qdma_cdev_xfer *x;
+	int rv;
+	u32 id;
+
+	if (get_user(id, (u32 __user *)arg))
+		return -EFAULT;
+	if (id >= QDMA_CDEV_XFER_MAX)
+		return -EINVAL;
+
+	mutex_lock(&ctx->xfer_lock);
+	x = ctx->xfer[id];
+	if (!x)
+		rv = -EINVAL;
+	else if (x->busy)
+		rv = -EBUSY;
+	else
+		rv = cdev_xfer_free(ctx->xcdev, x);
+	if (!rv)
+		ctx->xfer[id] = NULL;
+	mutex_unlock(&ctx->xfer_lock);
+
+	return rv;
+}
+
+/* the file is going away, no submission can be running */
+static void cdev_xfer_release_all(struct qdma_cdev_ctx *ctx)
+{
+	unsigned int id;
+
+	for (id = 0; id < QDMA_CDEV_XFER_MAX; id++) {
+		if (ctx->xfer[id] && cdev_xfer_free(ctx->xcdev, ctx->xfer[id]))
+			pr_err("%s: xfer %u in flight, left pinned.\n",
+				ctx->xcdev->name, id);
+		ctx->xfer[id] = NULL;
+	}
+}
+
+/*
+ * vectored r/w
+ */
+struct cdev_rw_vec_io {
+	spinlock_t lock;
+	wait_queue_head_t wq;
+	unsigned int count;
+	unsigned int done_cnt;
+	/* elements outstanding + the ioctl, the last one frees */
+	unsigned int refs;
+	struct qdma_cdev_rw_vec_elem *elems;
+	struct qdma_io_cb *qiocb;
+	struct qdma_request **reqv;
+};
+
+static void cdev_rw_vec_put(struct cdev_rw_vec_io *vio, bool elem_done)
+{
+	bool last;
+
+	/* wake up under the lock, the ioctl drops its reference under it */
+	spin_lock_bh(&vio->lock);
+	if (elem_done && ++vio->done_cnt == vio->count)
+		wake_up(&vio->wq);
+	last = (--vio->refs == 0);
+	spin_unlock_bh(&vio->lock);
+
+	if (last)
+		kfree(vio);
+}
+
+static int cdev_rw_vec_req_done(struct qdma_request *req,
+		       unsigned int bytes_done, int err)
+{
+	struct qdma_io_cb *qiocb = container_of(req, struct qdma_io_cb, req);
+	struct cdev_rw_vec_io *vio = (struct cdev_rw_vec_io *)qiocb->private;
+
+	unmap_user_buf(qiocb, req->write);
+	iocb_release(qiocb);
+	vio->elems[qiocb - vio->qiocb].status = (err < 0) ? err : bytes_done;
+	cdev_rw_vec_put(vio, true);
+
+	return 0;
+}
+
+static long cdev_rw_vec(struct qdma_cdev *xcdev, unsigned long arg)
+{
+	struct qdma_cdev_rw_vec vec;
+	struct cdev_rw_vec_io *vio;
+	void __user *elems;
+	unsigned long qhndl;
+	unsigned int xfered = 0;
+	unsigned int i;
+	bool done;
+	long wait;
+	long rv;
+
+	if (copy_from_user(&vec, (void __user *)arg, sizeof(vec)))
+		return -EFAULT;
+
+	if (!vec.count || vec.count > QDMA_CDEV_RW_VEC_MAX) {
+		pr_err("%s: rw vec count %u/%u invalid.\n",
+			xcdev->name, vec.count, QDMA_CDEV_RW_VEC_MAX);
+		return -EINVAL;
+	}
+
+	if (!xcdev->fp_aiorw) {
+		pr_err("%s, NO rw vec handler.\n", xcdev->name);
+		return -EINVAL;
+	}
+
+	vio = kzalloc(sizeof(struct cdev_rw_vec_io) + vec.count *
+			(sizeof(struct qdma_io_cb) +
+			 sizeof(struct qdma_request *) +
+			 sizeof(struct qdma_cdev_rw_vec_elem)), GFP_KERNEL);
+	if (!vio) {
+		pr_err("%s: rw vec %u OOM.\n", xcdev->name, vec.count);
+		return -ENOMEM;
+	}
+	vio->qiocb = (struct qdma_io_cb *)(vio + 1);
+	vio->reqv = (struct qdma_request **)(vio->qiocb + vec.count);
+	vio->elems = (struct qdma_cdev_rw_vec_elem *)(vio->reqv + vec.count);
+	spin_lock_init(&vio->lock);
+	init_waitqueue_head(&vio->wq);
+	vio->count = vec.count;
+	vio->refs = vec.count + 1;
+
+	elems = (void __user *)(unsigned long)vec.elems;
+	if (copy_from_user(vio->elems, elems,
+			vec.count * sizeof(struct qdma_cdev_rw_vec_elem))) {
+		kfree(vio);
+		return -EFAULT;
+	}
+
+	for (i = 0; i < vec.count; i++) {
+		struct qdma_cdev_rw_vec_elem *elem = vio->elems + i;
+		struct qdma_io_cb *qiocb = vio->qiocb + i;
+		struct qdma_request *req = &qiocb->req;
+
+		if (elem->len > INT_MAX) {
+			pr_err("%s: rw vec %u, len %u too big.\n",
+				xcdev->name, i, elem->len);
+			rv = -EINVAL;
+			goto unmap;
+		}
+
+		qiocb->private = vio;
+		qiocb->buf = (void __user *)(unsigned long)elem->buf;
+		qiocb->len = elem->len;
+		rv = map_user_buf_to_sgl(qiocb, vec.write);
+		if (rv < 0)
+			goto unmap;
+
+		req->sgcnt = qiocb->pages_nr;
+		req->sgl = qiocb->sgl;
+		req->write = vec.write ? 1 : 0;
+		req->dma_mapped = 0;
+		req->udd_len = 0;
+		req->ep_addr = elem->ep_addr;
+		req->no_memcpy = xcdev->no_memcpy ? 1 : 0;
+		req->count = elem->len;
+		req->fp_done = cdev_rw_vec_req_done;
+		req->h2c_eot = 1;
+		elem->status = -EINPROGRESS;
+		vio->reqv[i] = req;
+	}
+
+	qhndl = vec.write ? xcdev->h2c_qhndl : xcdev->c2h_qhndl;
+	rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl, vec.count,
+			vio->reqv);
+	if (rv < 0) {
+		/* nothing queued, fail what did not complete already */
+		for (i = 0; i < vec.count; i++)
+			if (vio->elems[i].status == -EINPROGRESS)
+				cdev_rw_vec_req_done(vio->reqv[i], 0, rv);
+	}
+
+	if (vec.timeout_ms) {
+		wait = wait_event_interruptible_timeout(vio->wq,
+				vio->done_cnt == vio->count,
+				msecs_to_jiffies(vec.timeout_ms));
+		if (!wait)
+			wait = -ETIMEDOUT;
+	} else {
+		wait = wait_event_interruptible(vio->wq,
+				vio->done_cnt == vio->count);
+	}
+
+	spin_lock_bh(&vio->lock);
+	done = (vio->done_cnt == vio->count);
+	spin_unlock_bh(&vio->lock);
+
+	if (!done) {
+		/* timed out or signalled: take back what the engine does not
+		 * have yet, the elements with descriptors in the ring have to
+		 * complete before their buffers can be released
+		 */
+		for (i = 0; i < vec.count; i++)
+			if (!xcdev->fp_cancel(xcdev->xcb->xpdev->dev_hndl,
+					qhndl, vio->reqv[i]))
+				cdev_rw_vec_req_done(vio->reqv[i], 0,
+						-ECANCELED);
+
+		if (!wait_event_timeout(vio->wq, vio->done_cnt == vio->count,
+				msecs_to_jiffies(QDMA_CDEV_RW_VEC_DRAIN_MS))) {
+			/* the engine is stuck, the elements still in the
+			 * ring own the buffers until the queue is stopped
+			 */
+			spin_lock_bh(&vio->lock);
+			pr_err("%s: rw vec %u/%u done, tm %u, not drained.\n",
+				xcdev->name, vio->done_cnt, vio->count,
+				vec.timeout_ms);
+			for (i = 0; i < vec.count; i++)
+				if (vio->elems[i].status >= 0)
+					xfered++;
+			spin_unlock_bh(&vio->lock);
+			cdev_rw_vec_put(vio, false);
+			/* a restart would issue the whole vector again */
+			if (wait == -ERESTARTSYS && xfered)
+				return -EINTR;
+			return (wait < 0) ? wait : -ETIMEDOUT;
+		}
+	}
+
+	for (i = 0; i < vec.count; i++)
+		if (vio->elems[i].status >= 0)
+			xfered++;
+	rv = xfered;
+	if (copy_to_user(elems, vio->elems,
+			vec.count * sizeof(struct qdma_cdev_rw_vec_elem)))
+		rv = -EFAULT;
+	/* the last completer may still hold the lock, drop the reference
+	 * through it instead of freeing directly
+	 */
+	cdev_rw_vec_put(vio, false);
+
+	if (!done && wait < 0) {
+		/* a restart would issue the whole vector again, only allow
+		 * it when nothing has been transferred
+		 */
+		if (wait == -ERESTARTSYS && xfered)
+			return -EINTR;
+		return wait;
+	}
+
+	return rv;
+
+unmap:
+	while (i--) {
+		unmap_user_buf(vio->qiocb + i, vec.write);
+		iocb_release(vio->qiocb + i);
+	}
+	kfree(vio);
+	return rv;
+}
+
 static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 		size_t count, loff_t *pos, bool write)
 {
-	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
+	struct qdma_cdev_ctx *ctx = (struct qdma_cdev_ctx *)file->private_data;
+	struct qdma_cdev *xcdev = ctx ? ctx->xcdev : NULL;
 	struct qdma_io_cb iocb;
 	struct qdma_request *req = &iocb.req;
 	ssize_t res = 0;
 	int rv;
 	unsigned long qhndl;
+	unsigned long stripe_qhndls[QDMA_STRIPE_Q_MAX];
+	unsigned int stripe_q_cnt;
+	unsigned int stripe_len;
+	unsigned int stripe_dir_mask;
 
 	if (!xcdev) {
 		pr_err("file 0x%p, xcdev NULL, 0x%p,%llu, pos %llu, W %d.\n",
@@ -383,8 +1429,40 @@ static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 	req->fp_done = NULL;		/* blocking */
 	req->h2c_eot = 1;		/* set to 1 for STM tests */
 
-	res = xcdev->fp_rw(xcdev->xcb->xpdev->dev_hndl, qhndl, req);
+	spin_lock(&xcdev->xcb->lock);
+	stripe_len = xcdev->stripe_len;
+	stripe_q_cnt = xcdev->stripe_q_cnt;
+	stripe_dir_mask = xcdev->stripe_dir_mask;
+	memcpy(stripe_qhndls, xcdev->stripe_qhndl[write ? 0 : 1],
+		stripe_q_cnt * sizeof(unsigned long));
+	spin_unlock(&xcdev->xcb->lock);
+
+	/* the group lacks this direction */
+	if (stripe_q_cnt && !(stripe_dir_mask & (1 << (write ? 0 : 1)))) {
+		pr_err("%s: stripe group has no %s queues.\n", xcdev->name,
+			write ? "H2C" : "C2H");
+		res = -EINVAL;
+		goto unmap;
+	}
+
+	/* striped requests span a queue group, they are not arbitrated */
+	if (stripe_q_cnt && xcdev->fp_stripe_rw) {
+		iocb.ctx = ctx;
+		iocb.enq_ns = cdev_now_ns();
+		iocb.disp_ns = iocb.enq_ns;
+		res = xcdev->fp_stripe_rw(xcdev->xcb->xpdev->dev_hndl,
+				stripe_qhndls, stripe_q_cnt, stripe_len, req);
+		cdev_arb_sync_done(ctx, write, &iocb, res);
+	} else {
+		res = cdev_arb_wait(ctx, write, &iocb);
+		if (!res) {
+			res = xcdev->fp_rw(xcdev->xcb->xpdev->dev_hndl, qhndl,
+					req);
+			cdev_arb_sync_done(ctx, write, &iocb, res);
+		}
+	}
 
+unmap:
 	unmap_user_buf(&iocb, write);
 	iocb_release(&iocb);
 
@@ -406,12 +1484,12 @@ static ssize_t cdev_gen_read(struct file *file, char __user *buf,
 static ssize_t cdev_aio_write(struct kiocb *iocb, const struct iovec *io,
 				unsigned long count, loff_t pos)
 {
-	struct qdma_cdev *xcdev =
-		(struct qdma_cdev *)iocb->ki_filp->private_data;
+	struct qdma_cdev_ctx *ctx =
+		(struct qdma_cdev_ctx *)iocb->ki_filp->private_data;
+	struct qdma_cdev *xcdev = ctx ? ctx->xcdev : NULL;
 	struct cdev_async_io *caio;
 	int rv = 0;
 	unsigned long i;
-	unsigned long qhndl;
 
 	if (!xcdev) {
 		pr_err("file 0x%p, xcdev NULL, %llu, pos %llu, W %d.\n",
@@ -462,9 +1540,8 @@ static ssize_t cdev_aio_write(struct kiocb *iocb, const struct iovec *io,
 		iocb->private = caio;
 		caio->iocb = iocb;
 		caio->req_count = i;
-		qhndl = xcdev->h2c_qhndl;
-		rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl,
-				     caio->req_count, caio->reqv);
+		rv = cdev_arb_submit(ctx, true, caio->qiocb, caio->reqv,
+				     caio->req_count);
 		if (rv >= 0)
 			rv = -EIOCBQUEUED;
 	} else {
@@ -479,12 +1556,12 @@ static ssize_t cdev_aio_write(struct kiocb *iocb, const struct iovec *io,
 static ssize_t cdev_aio_read(struct kiocb *iocb, const struct iovec *io,
 						unsigned long count, loff_t pos)
 {
-	struct qdma_cdev *xcdev =
-		(struct qdma_cdev *)iocb->ki_filp->private_data;
+	struct qdma_cdev_ctx *ctx =
+		(struct qdma_cdev_ctx *)iocb->ki_filp->private_data;
+	struct qdma_cdev *xcdev = ctx ? ctx->xcdev : NULL;
 	struct cdev_async_io *caio;
 	int rv = 0;
 	unsigned long i;
-	unsigned long qhndl;
 
 	if (!xcdev) {
 		pr_err("file 0x%p, xcdev NULL, %llu, pos %llu, W %d.\n",
@@ -534,9 +1611,8 @@ static ssize_t cdev_aio_read(struct kiocb *iocb, const struct iovec *io,
 		iocb->private = caio;
 		caio->iocb = iocb;
 		caio->req_count = i;
-		qhndl = xcdev->c2h_qhndl;
-		rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl,
-				     caio->req_count, caio->reqv);
+		rv = cdev_arb_submit(ctx, false, caio->qiocb, caio->reqv,
+				     caio->req_count);
 		if (rv >= 0)
 			rv = -EIOCBQUEUED;
 	} else {
@@ -598,6 +1674,10 @@ void qdma_cdev_destroy(struct qdma_cdev *xcdev)
 
 	cdev_del(&xcdev->cdev);
 
+	/* the aio of the requests still queued has to complete */
+	cdev_arb_drain(&xcdev->arb[0], -ESHUTDOWN);
+	cdev_arb_drain(&xcdev->arb[1], -ESHUTDOWN);
+
 	kfree(xcdev);
 }
 
@@ -627,6 +1707,7 @@ int qdma_cdev_create(struct qdma_cdev_cb *xcb, struct pci_dev *pdev,
 
 	xcdev->cdev.owner = THIS_MODULE;
 	xcdev->xcb = xcb;
+	cdev_arb_init(xcdev);
 	priv_data = (qconf->q_type == Q_C2H) ?
 			&xcdev->c2h_qhndl : &xcdev->h2c_qhndl;
 	*priv_data = qhndl;
@@ -681,6 +1762,9 @@ int qdma_cdev_create(struct qdma_cdev_cb *xcb, struct pci_dev *pdev,
 
 	xcdev->fp_rw = qdma_request_submit;
 	xcdev->fp_aiorw = qdma_batch_request_submit;
+	xcdev->fp_cancel = qdma_request_cancel;
+	xcdev->fp_stripe_rw = qdma_stripe_request_submit;
+	xcdev->fp_cmpt_read = qdma_descq_cmpt_read_raw;
 
 	*xcdev_pp = xcdev;
 	return 0;
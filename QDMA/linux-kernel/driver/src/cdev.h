@@ -29,13 +29,99 @@
 #include <linux/spinlock_types.h>
 
 #include "libqdma/libqdma_export.h"
+#include "qdma_cdev_ioctl.h"
 #include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
 
 /** QDMA character device class name */
 #define QDMA_CDEV_CLASS_NAME  DRV_MODULE_NAME
 /** QDMA character device max minor number*/
 #define QDMA_MINOR_MAX (2048)
 
+#if QDMA_CDEV_STRIPE_Q_MAX != QDMA_STRIPE_Q_MAX
+#error "QDMA_CDEV_STRIPE_Q_MAX and QDMA_STRIPE_Q_MAX differ"
+#endif
+
+/** max. requests handed to the queue in one arbitration pass */
+#define QDMA_CDEV_ARB_BATCH		32
+
+struct qdma_cdev;
+
+/**
+ * @struct - qdma_cdev_arb
+ * @brief	per direction arbiter of a queue cdev: the requests of the open
+ *		files are queued per file and moved into the descriptor ring
+ *		in weighted fair order, with at most inflight_max bytes in the
+ *		ring. inflight_max 0 turns arbitration off, requests then go to
+ *		the ring as they come.
+ */
+struct qdma_cdev_arb {
+	/** arbiter lock, taken from the completion path */
+	spinlock_t lock;
+	/** character device of the arbiter */
+	struct qdma_cdev *xcdev;
+	/** 1: H2C, 0: C2H */
+	unsigned char write;
+	/** a dispatch pass is running */
+	unsigned char busy;
+	/** new requests or completions showed up during the dispatch pass */
+	unsigned char again;
+	/** open files with requests queued */
+	struct list_head active;
+	/** virtual time, start tag of the last request dispatched */
+	u64 vtime;
+	/** bytes handed to the ring and not completed yet */
+	u64 inflight;
+	/** ring budget in bytes */
+	u64 inflight_max;
+	/** task handing a batch to the ring, see cdev_arb_req_done() */
+	struct task_struct *submitter;
+	/** requests of the batch completed within the submit call */
+	DECLARE_BITMAP(batch_done, QDMA_CDEV_ARB_BATCH);
+	/** dispatch work, run on completions */
+	struct work_struct work;
+};
+
+struct qdma_cdev_ctx;
+struct qdma_cdev_xfer;
+
+/**
+ * @struct - qdma_cdev_ctx_q
+ * @brief	per direction arbiter queue of an open file
+ */
+struct qdma_cdev_ctx_q {
+	/** open file of the queue */
+	struct qdma_cdev_ctx *ctx;
+	/** requests queued in the arbiter */
+	struct list_head pend;
+	/** on the arbiter's active list while pend is not empty */
+	struct list_head active;
+	/** finish tag of the last request queued */
+	u64 finish;
+};
+
+/**
+ * @struct - qdma_cdev_ctx
+ * @brief	per open file submission context of a queue cdev
+ */
+struct qdma_cdev_ctx {
+	/** character device the file is open on */
+	struct qdma_cdev *xcdev;
+	/** share of the queue relative to the other open files */
+	unsigned int weight;
+	/** sync requests wait here for their turn */
+	wait_queue_head_t wq;
+	/** arbiter queues, H2C: index 0, C2H: index 1 */
+	struct qdma_cdev_ctx_q q[2];
+	/** counters, under the arbiter lock of the direction */
+	struct qdma_cdev_ctx_stats stats;
+	/** serializes the prepared transfer slots */
+	struct mutex xfer_lock;
+	/** prepared MM transfers, see QDMA_CDEV_IOCTL_XFER_PREP */
+	struct qdma_cdev_xfer *xfer[QDMA_CDEV_XFER_MAX];
+};
+
 /* per pci device control */
 /**
  * @struct - qdma_cdev_cb
@@ -89,10 +175,38 @@ struct qdma_cdev {
 			struct qdma_request *req);
 	ssize_t (*fp_aiorw)(unsigned long dev_hndl, unsigned long qhndl,
 			unsigned long count, struct qdma_request **reqv);
+	/** call back function to cancel a request not posted yet */
+	int (*fp_cancel)(unsigned long dev_hndl, unsigned long qhndl,
+			struct qdma_request *req);
+	/** call back function to handle a striped read write request */
+	ssize_t (*fp_stripe_rw)(unsigned long dev_hndl, unsigned long *qhndls,
+			unsigned int q_cnt, unsigned int stripe_len,
+			struct qdma_request *req);
+	/** call back function to read completion entries in bulk */
+	int (*fp_cmpt_read)(unsigned long dev_hndl, unsigned long qhndl,
+			u8 *buf, unsigned int buflen, unsigned int *entry_len);
+	/** stripe size, read/write are striped when stripe_q_cnt is set */
+	unsigned int stripe_len;
+	/** number of queues in the stripe group */
+	unsigned int stripe_q_cnt;
+	/** directions the stripe group serves, bit 0: H2C, bit 1: C2H */
+	unsigned int stripe_dir_mask;
+	/** queue handles of the stripe group, H2C: 0, C2H: 1, validated by
+	 *  QDMA_CDEV_IOCTL_STRIPE
+	 */
+	unsigned long stripe_qhndl[2][QDMA_STRIPE_Q_MAX];
+	/** request arbitration between the open files, H2C: 0, C2H: 1 */
+	struct qdma_cdev_arb arb[2];
 	/** name of the character device*/
 	char name[0];
 };
 
+/** time the elements posted to the ring get to complete after a cancel */
+#define QDMA_CDEV_RW_VEC_DRAIN_MS	1000
+
+/** QDMA character device bounce buffer size for completion reads */
+#define QDMA_CDEV_CMPT_READ_CHUNK	(64 * 1024)
+
 /**
  * @struct - qdma_io_cb
  * @brief	QDMA character device io call back book keeping parameters
@@ -109,13 +223,50 @@ struct qdma_io_cb {
 	struct qdma_sw_sg *sgl;
 	/** pages allocated to accommodate the scatter gather list */
 	struct page **pages;
+	/** open file the request is accounted to */
+	struct qdma_cdev_ctx *ctx;
+	/** completion handler, called after the accounting */
+	int (*fp_done)(struct qdma_request *req, unsigned int bytes_done,
+			int err);
+	/** position in the open file's arbiter queue */
+	struct list_head arb_list;
+	/** start tag in the arbiter's virtual time */
+	u64 arb_tag;
+	/** time the request was queued, ns */
+	u64 enq_ns;
+	/** time the request was handed to the ring, ns */
+	u64 disp_ns;
+	/** index in the batch being submitted */
+	unsigned int arb_idx;
+	/** counted in the arbiter's inflight bytes */
+	unsigned char arb_charged;
+	/** sync request: may go to the ring */
+	unsigned char arb_granted;
 	/** qdma request */
 	struct qdma_request req;
 };
 
+/**
+ * @struct - qdma_cdev_xfer
+ * @brief	prepared MM transfer of an open file, the user buffer stays
+ *		pinned and mapped until the release
+ */
+struct qdma_cdev_xfer {
+	/** hndl returned by qdma_mm_xfer_prepare() */
+	unsigned long hndl;
+	/** a submission is running, the slot can not be released */
+	unsigned char busy;
+	/** 1: H2C, 0: C2H */
+	unsigned char write;
+	/** pinned user buffer and its sgl */
+	struct qdma_io_cb iocb;
+};
+
 /*****************************************************************************/
 /**
- * qdma_cdev_destroy() - handler to destroy the character device
+ * qdma_cdev_destroy() - handler to destroy the character device, fails the
+ * requests still queued in its arbiter. It sleeps, do not call it in atomic
+ * context.
  *
  * @param[in]	xcdev: pointer to character device
  *
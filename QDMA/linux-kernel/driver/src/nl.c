@@ -22,6 +22,8 @@
 #include <linux/version.h>
 #include <linux/kernel.h>
 #include <linux/pci.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
 #include <net/genetlink.h>
 
 #include "libqdma/libqdma_export.h"
@@ -99,6 +101,8 @@ static struct nla_policy xnl_policy[XNL_ATTR_MAX] = {
 					  .len = QDMA_DEV_ATTR_STRUCT_SIZE, },
 	[XNL_ATTR_GLOBAL_CSR]		=	{ .type = NLA_BINARY,
 				.len = QDMA_DEV_GLOBAL_CSR_STRUCT_SIZE, },
+	[XNL_ATTR_RL_RATE] =		{ .type = NLA_U32 },
+	[XNL_ATTR_RL_BURST] =		{ .type = NLA_U32 },
 #ifdef ERR_DEBUG
 	[XNL_ATTR_QPARAM_ERR_INFO] =    { .type = NLA_U32 },
 #endif
@@ -166,6 +170,8 @@ static struct nla_policy xnl_policy[XNL_ATTR_MAX] = {
 					  .len = QDMA_DEV_ATTR_STRUCT_SIZE, },
 	[XNL_ATTR_GLOBAL_CSR]		=	{ .type = NLA_BINARY,
 				.len = QDMA_DEV_GLOBAL_CSR_STRUCT_SIZE, },
+	[XNL_ATTR_RL_RATE] =		{ .type = NLA_U32 },
+	[XNL_ATTR_RL_BURST] =		{ .type = NLA_U32 },
 #ifdef ERR_DEBUG
 	[XNL_ATTR_QPARAM_ERR_INFO] =    { .type = NLA_U32 },
 #endif
@@ -199,6 +205,8 @@ static int xnl_register_write(struct sk_buff *, struct genl_info *);
 static int xnl_get_global_csr(struct sk_buff *skb2, struct genl_info *info);
 static int xnl_get_queue_state(struct sk_buff *, struct genl_info *);
 static int xnl_config_reg_info_dump(struct sk_buff *, struct genl_info *);
+static int xnl_dev_stat_bin(struct sk_buff *, struct genl_info *);
+static int xnl_rate_limit(struct sk_buff *, struct genl_info *);
 #ifdef ERR_DEBUG
 static int xnl_err_induce(struct sk_buff *skb2, struct genl_info *info);
 #endif
@@ -503,6 +511,32 @@ static struct genl_ops xnl_ops[] = {
 #endif
 		.doit = xnl_get_queue_state,
 	},
+	{
+		.cmd = XNL_CMD_DEV_STAT_BIN,
+#ifdef RHEL_RELEASE_VERSION
+#if RHEL_RELEASE_VERSION(8, 3) > RHEL_RELEASE_CODE
+		.policy = xnl_policy,
+#endif
+#else
+#if KERNEL_VERSION(5, 2, 0) > LINUX_VERSION_CODE
+		.policy = xnl_policy,
+#endif
+#endif
+		.doit = xnl_dev_stat_bin,
+	},
+	{
+		.cmd = XNL_CMD_RATE_LIMIT,
+#ifdef RHEL_RELEASE_VERSION
+#if RHEL_RELEASE_VERSION(8, 3) > RHEL_RELEASE_CODE
+		.policy = xnl_policy,
+#endif
+#else
+#if KERNEL_VERSION(5, 2, 0) > LINUX_VERSION_CODE
+		.policy = xnl_policy,
+#endif
+#endif
+		.doit = xnl_rate_limit,
+	},
 #ifdef ERR_DEBUG
 	{
 		.cmd = XNL_CMD_Q_ERR_INDUCE,
@@ -926,6 +960,9 @@ static void xnl_extract_extra_config_attr(struct genl_info *info,
 	qconf->cmpl_en_intr = (f & XNL_F_C2H_CMPL_INTR_EN) ? 1 : 0;
 	qconf->cmpl_udd_en = (f & XNL_F_CMPL_UDD_EN) ? 1 : 0;
 	qconf->cmpl_ovf_chk_dis = (f & XNL_F_CMPT_OVF_CHK_DIS) ? 1 : 0;
+	qconf->rl_borrow = (f & XNL_F_RL_BORROW) ? 1 : 0;
+	qconf->prio = (f & XNL_F_Q_PRIO_HIGH) ?
+			QDMA_Q_PRIO_HIGH : QDMA_Q_PRIO_BULK;
 
 	if (qconf->q_type == Q_CMPT)
 		qconf->cmpl_udd_en = 1;
@@ -963,6 +1000,12 @@ static void xnl_extract_extra_config_attr(struct genl_info *info,
 					 info, qconf->qidx, NULL, 0) == 0)
 		qconf->aperture_size =
 			nla_get_u32(info->attrs[XNL_ATTR_APERTURE_SZ]);
+	if (xnl_chk_attr(XNL_ATTR_RL_RATE, info, qconf->qidx, NULL, 0) == 0)
+		qconf->rl_rate_mbps =
+			nla_get_u32(info->attrs[XNL_ATTR_RL_RATE]);
+	if (xnl_chk_attr(XNL_ATTR_RL_BURST, info, qconf->qidx, NULL, 0) == 0)
+		qconf->rl_burst =
+			nla_get_u32(info->attrs[XNL_ATTR_RL_BURST]);
 	if (xnl_chk_attr(XNL_ATTR_CMPT_TRIG_MODE, info,
 				qconf->qidx, NULL, 0) == 0)
 		qconf->cmpl_trig_mode =
@@ -1423,6 +1466,229 @@ static int xnl_dev_stat_clear(struct sk_buff *skb2, struct genl_info *info)
 	return rv;
 }
 
+static int xnl_q_stat_bin_fill(struct xlnx_pci_dev *xpdev,
+				struct xlnx_qdata *qdata, unsigned int qidx,
+				u8 q_type, struct xnl_q_stat_bin *qs)
+{
+	struct qdma_queue_conf qconf;
+	struct qdma_q_stats stats;
+	char ebuf[XNL_ERR_BUFLEN];
+	int rv;
+
+	rv = qdma_queue_get_stats(xpdev->dev_hndl, qdata->qhndl, &stats);
+	if (rv < 0)
+		return rv;
+	rv = qdma_queue_get_config(xpdev->dev_hndl, qdata->qhndl, &qconf,
+				ebuf, XNL_ERR_BUFLEN);
+	if (rv < 0)
+		return rv;
+
+	memset(qs, 0, sizeof(*qs));
+	qs->qidx = qidx;
+	qs->q_type = q_type;
+	qs->st = qconf.st;
+	qs->pkts = stats.pkts;
+	qs->bytes = stats.bytes;
+	qs->descs = stats.descs;
+	qs->doorbells = stats.doorbells;
+	qs->irqs = stats.irqs;
+	qs->errors = stats.errors;
+	memcpy(qs->lat_bucket, stats.lat_bucket, sizeof(qs->lat_bucket));
+	qs->rl_throttled = stats.rl_throttled;
+	qs->rl_throttle_ns = stats.rl_throttle_ns;
+	qs->rl_borrowed = stats.rl_borrowed;
+
+	return 0;
+}
+
+static int xnl_dev_stat_bin(struct sk_buff *skb2, struct genl_info *info)
+{
+	struct xlnx_pci_dev *xpdev;
+	struct xnl_dev_stat_bin ds;
+	struct xnl_q_stat_bin *qs;
+	struct qdma_dev_stats stats;
+	struct sk_buff *skb;
+	void *hdr;
+	unsigned int qidx = 0;
+	unsigned int num_q;
+	unsigned int i;
+	u8 q_type;
+	int rv;
+
+	BUILD_BUG_ON(XNL_STAT_BIN_LAT_BUCKETS != QDMA_Q_STATS_LAT_BUCKETS);
+
+	if (info == NULL)
+		return -EINVAL;
+
+	xnl_dump_attrs(info);
+
+	xpdev = xnl_rcv_check_xpdev(info);
+	if (!xpdev)
+		return -EINVAL;
+
+	num_q = xpdev->qmax;
+	if (info->attrs[XNL_ATTR_QIDX])
+		qidx = nla_get_u32(info->attrs[XNL_ATTR_QIDX]);
+	if (info->attrs[XNL_ATTR_NUM_Q])
+		num_q = nla_get_u32(info->attrs[XNL_ATTR_NUM_Q]);
+	if (qidx > xpdev->qmax)
+		qidx = xpdev->qmax;
+	if (num_q > (xpdev->qmax - qidx))
+		num_q = xpdev->qmax - qidx;
+
+	qs = kcalloc(XNL_STAT_BIN_Q_MAX, sizeof(*qs), GFP_KERNEL);
+	if (!qs)
+		return -ENOMEM;
+
+	memset(&ds, 0, sizeof(ds));
+	ds.version = XNL_STAT_BIN_VERSION;
+	ds.q_stat_size = sizeof(*qs);
+	ds.timestamp_ns = ktime_to_ns(ktime_get());
+
+	rv = qdma_device_get_stats(xpdev->dev_hndl, &stats);
+	if (rv < 0)
+		goto free_qs;
+	ds.mm_h2c_pkts = stats.mm_h2c_pkts;
+	ds.mm_c2h_pkts = stats.mm_c2h_pkts;
+	ds.st_h2c_pkts = stats.st_h2c_pkts;
+	ds.st_c2h_pkts = stats.st_c2h_pkts;
+	qdma_device_get_ping_pong_min_lat(xpdev->dev_hndl,
+				&ds.ping_pong_lat_min);
+	qdma_device_get_ping_pong_max_lat(xpdev->dev_hndl,
+				&ds.ping_pong_lat_max);
+	qdma_device_get_ping_pong_tot_lat(xpdev->dev_hndl,
+				&ds.ping_pong_lat_total);
+	qdma_device_get_rate_limit(xpdev->dev_hndl, &ds.rl_rate_mbps,
+				&ds.rl_burst);
+	ds.rl_fn_throttled = stats.rl_fn_throttled;
+
+	/* a queue index is never split across two replies */
+	for (i = qidx; i < qidx + num_q; i++) {
+		if (ds.q_cnt + Q_CMPT + 1 > XNL_STAT_BIN_Q_MAX)
+			break;
+		for (q_type = Q_H2C; q_type <= Q_CMPT; q_type++) {
+			struct xlnx_qdata *qdata = xpdev_queue_get(xpdev, i,
+						q_type, 0, NULL, 0);
+
+			if (!qdata || !qdata->qhndl)
+				continue;
+			if (xnl_q_stat_bin_fill(xpdev, qdata, i, q_type,
+						qs + ds.q_cnt) < 0)
+				continue;
+			ds.q_cnt++;
+		}
+	}
+	ds.qidx_next = (i < qidx + num_q) ? i : XNL_QIDX_INVALID;
+
+	skb = xnl_msg_alloc(XNL_CMD_DEV_STAT_BIN,
+			    sizeof(ds) + ds.q_cnt * sizeof(*qs) +
+			    2 * NLA_HDRLEN + NLA_ALIGNTO, &hdr, info);
+	if (!skb) {
+		rv = -ENOMEM;
+		goto free_qs;
+	}
+
+	rv = xnl_msg_add_attr_data(skb, XNL_ATTR_DEV_STAT_BIN, &ds,
+				   sizeof(ds));
+	if (rv < 0)
+		goto free_skb;
+	rv = xnl_msg_add_attr_data(skb, XNL_ATTR_Q_STAT_BIN, qs,
+				   ds.q_cnt * sizeof(*qs));
+	if (rv < 0)
+		goto free_skb;
+
+	kfree(qs);
+	return xnl_msg_send(skb, hdr, info);
+
+free_skb:
+	pr_err("xnl_msg_add_attr_data() failed: %d", rv);
+	nlmsg_free(skb);
+free_qs:
+	kfree(qs);
+	return rv;
+}
+
+static int xnl_rate_limit(struct sk_buff *skb2, struct genl_info *info)
+{
+	struct xlnx_pci_dev *xpdev;
+	struct qdma_queue_conf qconf;
+	struct qdma_queue_conf qc;
+	char buf[XNL_RESP_BUFLEN_MIN];
+	struct xlnx_qdata *qdata;
+	unsigned char is_qp;
+	unsigned char dir;
+	u32 rate = 0;
+	u32 burst = 0;
+	u8 borrow;
+	int rv;
+
+	if (info == NULL)
+		return 0;
+
+	xnl_dump_attrs(info);
+
+	xpdev = xnl_rcv_check_xpdev(info);
+	if (!xpdev)
+		return 0;
+
+	if (info->attrs[XNL_ATTR_RL_RATE])
+		rate = nla_get_u32(info->attrs[XNL_ATTR_RL_RATE]);
+	if (info->attrs[XNL_ATTR_RL_BURST])
+		burst = nla_get_u32(info->attrs[XNL_ATTR_RL_BURST]);
+
+	/* without a queue the limit is the function's */
+	if (!info->attrs[XNL_ATTR_QIDX]) {
+		rv = qdma_device_set_rate_limit(xpdev->dev_hndl, rate, burst);
+		if (rv < 0)
+			snprintf(buf, XNL_RESP_BUFLEN_MIN,
+				"qdma%05x rate limit failed %d.\n",
+				xpdev->idx, rv);
+		else
+			snprintf(buf, XNL_RESP_BUFLEN_MIN,
+				"qdma%05x rate limit %u Mbit/s.\n",
+				xpdev->idx, rate);
+		goto send_resp;
+	}
+
+	rv = qconf_get(&qconf, info, buf, XNL_RESP_BUFLEN_MIN, &is_qp);
+	if (rv < 0)
+		return rv;
+	borrow = (nla_get_u32(info->attrs[XNL_ATTR_QFLAG]) &
+			XNL_F_RL_BORROW) ? 1 : 0;
+
+	dir = qconf.q_type;
+set_q:
+	qdata = xnl_rcv_check_qidx(info, xpdev, &qconf, buf,
+				XNL_RESP_BUFLEN_MIN);
+	if (!qdata)
+		return -EINVAL;
+	rv = qdma_queue_get_config(xpdev->dev_hndl, qdata->qhndl, &qc, buf,
+				XNL_RESP_BUFLEN_MIN);
+	if (rv < 0)
+		goto send_resp;
+	/* ST C2H is paced by the device, a pair limits its H2C side only */
+	if (!is_qp || !qc.st || (qc.q_type != Q_C2H)) {
+		rv = qdma_queue_set_rate_limit(xpdev->dev_hndl, qdata->qhndl,
+					rate, burst, borrow);
+		if (rv < 0) {
+			snprintf(buf, XNL_RESP_BUFLEN_MIN,
+				"qdma%05x queue %u rate limit failed %d.\n",
+				xpdev->idx, qconf.qidx, rv);
+			goto send_resp;
+		}
+	}
+	if (is_qp && (dir == qconf.q_type)) {
+		qconf.q_type = (~qconf.q_type) & 0x1;
+		goto set_q;
+	}
+	snprintf(buf, XNL_RESP_BUFLEN_MIN,
+		"qdma%05x queue %u rate limit %u Mbit/s%s.\n",
+		xpdev->idx, qconf.qidx, rate, borrow ? ", borrowing" : "");
+
+send_resp:
+	return xnl_respond_buffer(info, buf, XNL_RESP_BUFLEN_MIN, rv);
+}
+
 
 
 static int xnl_get_queue_state(struct sk_buff *skb2, struct genl_info *info)
@@ -1581,14 +1847,13 @@ static int xnl_q_add(struct sk_buff *skb2, struct genl_info *info)
 {
 	struct xlnx_pci_dev *xpdev = NULL;
 	struct qdma_queue_conf qconf;
+	struct qdma_q_bulk_stats stats;
 	char *buf, *cur, *end;
 	int rv = 0;
 	int rv2 = 0;
 	unsigned char is_qp;
 	unsigned int num_q;
-	unsigned int i;
 	unsigned short qidx;
-	unsigned char dir;
 	int buf_len = XNL_RESP_BUFLEN_MAX;
 
 	if (info == NULL)
@@ -1631,28 +1896,16 @@ static int xnl_q_add(struct sk_buff *skb2, struct genl_info *info)
 		goto send_resp;
 	}
 
-	dir = qconf.q_type;
-	for (i = 0; i < num_q; i++) {
-		if (qconf.q_type != Q_CMPT)
-			qconf.q_type = dir;
-add_q:
-		if (qidx != QDMA_QUEUE_IDX_INVALID)
-			qconf.qidx = qidx + i;
-		rv = xpdev_queue_add(xpdev, &qconf, cur, end - cur);
-		if (rv < 0) {
-			pr_err("xpdev_queue_add() failed: %d\n", rv);
-			goto send_resp;
-		}
-		cur = buf + strlen(buf);
-		if (qconf.q_type != Q_CMPT) {
-			if (is_qp && (dir == qconf.q_type)) {
-				qconf.q_type = (~qconf.q_type) & 0x1;
-				goto add_q;
-			}
-		}
+	rv = xpdev_queue_add_bulk(xpdev, &qconf, num_q, is_qp, &stats, cur,
+				  end - cur);
+	if (rv < 0) {
+		pr_err("xpdev_queue_add_bulk() failed: %d, %u added\n", rv,
+			stats.q_cnt);
+		goto send_resp;
 	}
 
-	cur += snprintf(cur, end - cur, "Added %u Queues.\n", i);
+	cur += snprintf(cur, end - cur, "Added %u Queues in %llu us.\n",
+			num_q, stats.total_ns / NSEC_PER_USEC);
 
 send_resp:
 	rv2 = xnl_respond_buffer(info, buf, strlen(buf), rv);
@@ -1794,6 +2047,9 @@ static int xnl_q_stop(struct sk_buff *skb2, struct genl_info *info)
 	struct qdma_queue_conf qconf;
 	char buf[XNL_RESP_BUFLEN_MIN];
 	struct xlnx_qdata *qdata;
+	struct qdma_q_bulk_stats stats;
+	unsigned long *qhndls = NULL;
+	unsigned int nhndls = 0;
 	int rv = 0, rv2 = 0;
 	unsigned char is_qp;
 	unsigned short num_q;
@@ -1831,6 +2087,15 @@ static int xnl_q_stop(struct sk_buff *skb2, struct genl_info *info)
 
 	num_q = nla_get_u32(info->attrs[XNL_ATTR_NUM_Q]);
 
+	qhndls = kcalloc(num_q * (is_qp ? 2 : 1), sizeof(*qhndls),
+			GFP_KERNEL);
+	if (!qhndls) {
+		rv = -ENOMEM;
+		snprintf(buf, XNL_RESP_BUFLEN_MIN, "qdma%05x OOM.\n",
+			xpdev->idx);
+		goto send_resp;
+	}
+
 	qidx = qconf.qidx;
 	dir = qconf.q_type;
 	for (i = qidx; i < (qidx + num_q); i++) {
@@ -1842,12 +2107,7 @@ stop_q:
 					XNL_RESP_BUFLEN_MIN);
 		if (!qdata)
 			goto send_resp;
-		rv = qdma_queue_stop(xpdev->dev_hndl, qdata->qhndl,
-				     buf, XNL_RESP_BUFLEN_MIN);
-		if (rv < 0) {
-			pr_err("qdma_queue_stop() failed: %d", rv);
-			goto send_resp;
-		}
+		qhndls[nhndls++] = qdata->qhndl;
 		if (qconf.q_type != Q_CMPT) {
 			if (is_qp && (dir == qconf.q_type)) {
 				qconf.q_type = (~qconf.q_type) & 0x1;
@@ -1855,9 +2115,19 @@ stop_q:
 			}
 		}
 	}
+
+	rv = qdma_queue_stop_bulk(xpdev->dev_hndl, qhndls, nhndls, &stats,
+				  buf, XNL_RESP_BUFLEN_MIN);
+	if (rv < 0) {
+		pr_err("qdma_queue_stop_bulk() failed: %d, %u stopped", rv,
+			stats.q_cnt);
+		goto send_resp;
+	}
 	rv2 = snprintf(buf + rv, XNL_RESP_BUFLEN_MIN - rv,
-				  "Stopped Queues %u -> %u.\n", qidx, i - 1);
+				  "Stopped Queues %u -> %u in %llu us.\n",
+				  qidx, i - 1, stats.total_ns / NSEC_PER_USEC);
 send_resp:
+	kfree(qhndls);
 	rv = xnl_respond_buffer(info, buf, XNL_RESP_BUFLEN_MIN, rv);
 	return rv;
 }
@@ -1867,12 +2137,11 @@ static int xnl_q_del(struct sk_buff *skb2, struct genl_info *info)
 	struct xlnx_pci_dev *xpdev;
 	struct qdma_queue_conf qconf;
 	char buf[XNL_RESP_BUFLEN_MIN];
+	struct qdma_q_bulk_stats stats;
 	int rv = 0, rv2 = 0;
 	unsigned char is_qp;
 	unsigned short num_q;
-	unsigned int i;
 	unsigned short qidx;
-	unsigned char dir;
 
 	if (info == NULL)
 		return 0;
@@ -1905,27 +2174,17 @@ static int xnl_q_del(struct sk_buff *skb2, struct genl_info *info)
 
 	qidx = qconf.qidx;
 
-	dir = qconf.q_type;
-	for (i = qidx; i < (qidx + num_q); i++) {
-		if (qconf.q_type != Q_CMPT)
-			qconf.q_type = dir;
-del_q:
-		qconf.qidx = i;
-		rv = xpdev_queue_delete(xpdev, qconf.qidx, qconf.q_type,
-					buf, XNL_RESP_BUFLEN_MIN);
-		if (rv < 0) {
-			pr_err("xpdev_queue_delete() failed: %d", rv);
-			goto send_resp;
-		}
-		if (qconf.q_type != Q_CMPT) {
-			if (is_qp && (dir == qconf.q_type)) {
-				qconf.q_type = (~qconf.q_type) & 0x1;
-				goto del_q;
-			}
-		}
+	rv = xpdev_queue_delete_bulk(xpdev, qidx, num_q, qconf.q_type, is_qp,
+				     &stats, buf, XNL_RESP_BUFLEN_MIN);
+	if (rv < 0) {
+		pr_err("xpdev_queue_delete_bulk() failed: %d, %u deleted", rv,
+			stats.q_cnt);
+		goto send_resp;
 	}
 	rv2 = snprintf(buf + rv, XNL_RESP_BUFLEN_MIN - rv,
-				  "Deleted Queues %u -> %u.\n", qidx, i - 1);
+				  "Deleted Queues %u -> %u in %llu us.\n",
+				  qidx, qidx + num_q - 1,
+				  stats.total_ns / NSEC_PER_USEC);
 send_resp:
 	rv = xnl_respond_buffer(info, buf, XNL_RESP_BUFLEN_MIN, rv);
 	return rv;
@@ -1087,6 +1087,28 @@ struct xlnx_qdata *xpdev_queue_get(struct xlnx_pci_dev *xpdev,
 	return qdata;
 }
 
+/* drop the queue from its cdev, the queue is removed from libqdma already */
+static void xpdev_queue_unbind(struct xlnx_pci_dev *xpdev,
+			struct xlnx_qdata *qdata, u8 q_type)
+{
+	struct qdma_cdev *xcdev = NULL;
+
+	if (q_type != Q_CMPT) {
+		spin_lock(&xpdev->cdev_lock);
+		qdata->xcdev->dir_init &= ~(1 << (q_type ? 1 : 0));
+
+		if (!qdata->xcdev->dir_init)
+			xcdev = qdata->xcdev;
+		spin_unlock(&xpdev->cdev_lock);
+	}
+
+	memset(qdata, 0, sizeof(*qdata));
+
+	/* sleeps, outside of the cdev lock */
+	if (xcdev)
+		qdma_cdev_destroy(xcdev);
+}
+
 int xpdev_queue_delete(struct xlnx_pci_dev *xpdev, unsigned int qidx, u8 q_type,
 			char *ebuf, int ebuflen)
 {
@@ -1109,20 +1131,11 @@ int xpdev_queue_delete(struct xlnx_pci_dev *xpdev, unsigned int qidx, u8 q_type,
 		pr_err("qidx %u/%u, type %d, qhndl invalid.\n",
 			qidx, xpdev->qmax, q_type);
 	if (rv < 0)
-		goto exit;
+		return rv;
 
-	if (q_type != Q_CMPT) {
-		spin_lock(&xpdev->cdev_lock);
-		qdata->xcdev->dir_init &= ~(1 << (q_type ? 1 : 0));
+	xpdev_queue_unbind(xpdev, qdata, q_type);
 
-		if (!qdata->xcdev->dir_init)
-			qdma_cdev_destroy(qdata->xcdev);
-		spin_unlock(&xpdev->cdev_lock);
-	}
-
-	memset(qdata, 0, sizeof(*qdata));
-exit:
-	return rv;
+	return 0;
 }
 
 #if KERNEL_VERSION(3, 16, 0) <= LINUX_VERSION_CODE
@@ -1137,7 +1150,9 @@ static void xpdev_queue_delete_all(struct xlnx_pci_dev *xpdev)
 }
 #endif
 
-int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
+/* attach a queue added to libqdma to its qdata and cdev */
+static int xpdev_queue_bind(struct xlnx_pci_dev *xpdev,
+			struct qdma_queue_conf *qconf, unsigned long qhndl,
 			char *ebuf, int ebuflen)
 {
 	struct xlnx_qdata *qdata;
@@ -1145,12 +1160,7 @@ int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
 	struct xlnx_qdata *qdata_tmp;
 	struct qdma_dev_conf dev_config;
 	u8 dir;
-	unsigned long qhndl;
-	int rv;
-
-	rv = qdma_queue_add(xpdev->dev_hndl, qconf, &qhndl, ebuf, ebuflen);
-	if (rv < 0)
-		return rv;
+	int rv = 0;
 
 	pr_debug("qdma%05x idx %u, st %d, q_type %s, added, qhndl 0x%lx.\n",
 		xpdev->idx, qconf->qidx, qconf->st,
@@ -1212,19 +1222,193 @@ int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
 	return rv;
 }
 
+int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
+			char *ebuf, int ebuflen)
+{
+	unsigned long qhndl;
+	int rv;
+
+	rv = qdma_queue_add(xpdev->dev_hndl, qconf, &qhndl, ebuf, ebuflen);
+	if (rv < 0)
+		return rv;
+
+	return xpdev_queue_bind(xpdev, qconf, qhndl, ebuf, ebuflen);
+}
+
+static void xpdev_bulk_stats_add(struct qdma_q_bulk_stats *total,
+			struct qdma_q_bulk_stats *stats)
+{
+	total->q_cnt += stats->q_cnt;
+	total->prep_ns += stats->prep_ns;
+	total->alloc_ns += stats->alloc_ns;
+	total->ctxt_ns += stats->ctxt_ns;
+	total->total_ns += stats->total_ns;
+}
+
+/* add q_cnt queues of one type with qdma_queue_add_bulk() and bind them */
+static int xpdev_queue_add_range(struct xlnx_pci_dev *xpdev,
+			struct qdma_queue_conf *qconf, unsigned int q_cnt,
+			unsigned long *qhndls, struct qdma_q_bulk_stats *stats,
+			char *ebuf, int ebuflen)
+{
+	struct qdma_q_bulk_stats lstats;
+	struct qdma_queue_conf conf;
+	char cbuf[XNL_EBUFLEN];
+	unsigned int i;
+	int rv, rv2;
+
+	rv = qdma_queue_add_bulk(xpdev->dev_hndl, qconf, q_cnt, qhndls,
+				 &lstats, ebuf, ebuflen);
+	xpdev_bulk_stats_add(stats, &lstats);
+
+	/* bind the queues added before a failure too, so that they can be
+	 * deleted
+	 */
+	for (i = 0; i < lstats.q_cnt; i++) {
+		rv2 = qdma_queue_get_config(xpdev->dev_hndl, qhndls[i], &conf,
+					    cbuf, XNL_EBUFLEN);
+		if (rv2 == 0)
+			rv2 = xpdev_queue_bind(xpdev, &conf, qhndls[i], ebuf,
+					       ebuflen);
+		if (rv2 < 0 && rv == 0)
+			rv = rv2;
+	}
+
+	return rv;
+}
+
+int xpdev_queue_add_bulk(struct xlnx_pci_dev *xpdev,
+			struct qdma_queue_conf *qconf, unsigned int q_cnt,
+			u8 is_qp, struct qdma_q_bulk_stats *stats,
+			char *ebuf, int ebuflen)
+{
+	struct qdma_queue_conf pconf;
+	struct qdma_queue_conf conf;
+	unsigned long *qhndls;
+	unsigned int i;
+	int rv;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!q_cnt)
+		return 0;
+
+	qhndls = kcalloc(q_cnt, sizeof(*qhndls), GFP_KERNEL);
+	if (!qhndls) {
+		snprintf(ebuf, ebuflen, "qdma%05x OOM.\n", xpdev->idx);
+		return -ENOMEM;
+	}
+
+	rv = xpdev_queue_add_range(xpdev, qconf, q_cnt, qhndls, stats, ebuf,
+				   ebuflen);
+	if (rv < 0 || !is_qp || (qconf->q_type == Q_CMPT))
+		goto free_list;
+
+	/* the other direction of the pairs */
+	memcpy(&pconf, qconf, sizeof(pconf));
+	pconf.q_type = (qconf->q_type == Q_H2C) ? Q_C2H : Q_H2C;
+	if (qconf->qidx != QDMA_QUEUE_IDX_INVALID) {
+		rv = xpdev_queue_add_range(xpdev, &pconf, q_cnt, qhndls, stats,
+					   ebuf, ebuflen);
+		goto free_list;
+	}
+
+	/* libqdma picked the indexes, pair the queues one by one */
+	for (i = 0; i < q_cnt; i++) {
+		rv = qdma_queue_get_config(xpdev->dev_hndl, qhndls[i], &conf,
+					   ebuf, ebuflen);
+		if (rv < 0)
+			break;
+		pconf.qidx = conf.qidx;
+		rv = xpdev_queue_add_range(xpdev, &pconf, 1, &qhndls[i], stats,
+					   ebuf, ebuflen);
+		if (rv < 0)
+			break;
+	}
+
+free_list:
+	kfree(qhndls);
+	return rv;
+}
+
+int xpdev_queue_delete_bulk(struct xlnx_pci_dev *xpdev, unsigned int qidx,
+			unsigned int q_cnt, u8 q_type, u8 is_qp,
+			struct qdma_q_bulk_stats *stats, char *ebuf, int ebuflen)
+{
+	unsigned int nhndls = q_cnt * ((is_qp && q_type != Q_CMPT) ? 2 : 1);
+	struct xlnx_qdata **qdata;
+	unsigned long *qhndls;
+	u8 *q_types;
+	unsigned int i, n = 0;
+	u8 type;
+	int rv = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!q_cnt)
+		return 0;
+
+	qdata = kcalloc(nhndls, sizeof(*qdata), GFP_KERNEL);
+	qhndls = kcalloc(nhndls, sizeof(*qhndls), GFP_KERNEL);
+	q_types = kcalloc(nhndls, sizeof(*q_types), GFP_KERNEL);
+	if (!qdata || !qhndls || !q_types) {
+		snprintf(ebuf, ebuflen, "qdma%05x OOM.\n", xpdev->idx);
+		rv = -ENOMEM;
+		goto free_list;
+	}
+
+	/* collect all the queues first, nothing is removed on a bad index */
+	for (i = qidx; i < qidx + q_cnt; i++) {
+		type = q_type;
+del_q:
+		qdata[n] = xpdev_queue_get(xpdev, i, type, 1, ebuf, ebuflen);
+		if (!qdata[n] || ((type != Q_CMPT) && !qdata[n]->xcdev)) {
+			rv = -EINVAL;
+			goto free_list;
+		}
+		qhndls[n] = qdata[n]->qhndl;
+		q_types[n++] = type;
+		if (is_qp && (type == q_type) && (type != Q_CMPT)) {
+			type = (~type) & 0x1;
+			goto del_q;
+		}
+	}
+
+	rv = qdma_queue_remove_bulk(xpdev->dev_hndl, qhndls, n, stats, ebuf,
+				    ebuflen);
+	for (i = 0; i < stats->q_cnt; i++)
+		xpdev_queue_unbind(xpdev, qdata[i], q_types[i]);
+
+free_list:
+	kfree(q_types);
+	kfree(qhndls);
+	kfree(qdata);
+	return rv;
+}
+
 static void nl_work_handler_q_start(struct work_struct *work)
 {
 	struct xlnx_nl_work *nl_work = container_of(work, struct xlnx_nl_work,
 						work);
 	struct xlnx_pci_dev *xpdev = nl_work->xpdev;
 	struct xlnx_nl_work_q_ctrl *qctrl = &nl_work->qctrl;
+	struct qdma_q_bulk_stats stats;
 	unsigned int qidx = qctrl->qidx;
 	u8 is_qp = qctrl->is_qp;
 	u8 q_type = qctrl->q_type;
+	unsigned long *qhndls;
+	unsigned int nhndls = 0;
 	int i;
 	char *ebuf = nl_work->buf;
 	int rv = 0;
 
+	qhndls = kcalloc(qctrl->qcnt * (is_qp ? 2 : 1), sizeof(*qhndls),
+			GFP_KERNEL);
+	if (!qhndls) {
+		rv = -ENOMEM;
+		snprintf(ebuf, nl_work->buflen, "qdma%05x OOM.\n",
+			xpdev->idx);
+		goto send_resp;
+	}
+
 	for (i = 0; i < qctrl->qcnt; i++, qidx++) {
 		struct xlnx_qdata *qdata;
 
@@ -1241,17 +1425,7 @@ q_start:
 			goto send_resp;
 		}
 
-		rv = qdma_queue_start(xpdev->dev_hndl, qdata->qhndl, ebuf,
-				      nl_work->buflen);
-		if (rv < 0) {
-			pr_err("%s, idx %u, q_type %s, start failed %d.\n",
-				dev_name(&xpdev->pdev->dev), qidx,
-				q_type_list[q_type].name, rv);
-			snprintf(ebuf, nl_work->buflen,
-				"Q idx %u, q_type %s, start failed %d.\n",
-				qidx, q_type_list[q_type].name, rv);
-			goto send_resp;
-		}
+		qhndls[nhndls++] = qdata->qhndl;
 		if (qctrl->q_type != Q_CMPT) {
 			if (is_qp && q_type == qctrl->q_type) {
 				q_type = !qctrl->q_type;
@@ -1262,11 +1436,25 @@ q_start:
 		}
 	}
 
+	/* validate, allocate and program all the queues in one go */
+	rv = qdma_queue_start_bulk(xpdev->dev_hndl, qhndls, nhndls, &stats,
+				   ebuf, nl_work->buflen);
+	if (rv < 0) {
+		pr_err("%s, idx %u ~ %u, start failed %d, %u started.\n",
+			dev_name(&xpdev->pdev->dev), qctrl->qidx, qidx - 1, rv,
+			stats.q_cnt);
+		goto send_resp;
+	}
+
 	snprintf(ebuf, nl_work->buflen,
-		 "%u Queues started, idx %u ~ %u.\n",
-		qctrl->qcnt, qctrl->qidx, qidx - 1);
+		 "%u Queues started, idx %u ~ %u.\n"
+		 "prep %llu us, alloc %llu us, ctxt %llu us, total %llu us.\n",
+		qctrl->qcnt, qctrl->qidx, qidx - 1,
+		stats.prep_ns / NSEC_PER_USEC, stats.alloc_ns / NSEC_PER_USEC,
+		stats.ctxt_ns / NSEC_PER_USEC, stats.total_ns / NSEC_PER_USEC);
 
 send_resp:
+	kfree(qhndls);
 	nl_work->q_start_handled = 1;
 	nl_work->ret = rv;
 	wake_up_interruptible(&nl_work->wq);
@@ -1643,6 +1831,8 @@ static void xpdev_device_cleanup(struct xlnx_pci_dev *xpdev)
 {
 	struct xlnx_qdata *qdata = xpdev->qdata;
 	struct xlnx_qdata *qmax = qdata + (xpdev->qmax * 2); /* h2c and c2h */
+	struct qdma_cdev *xcdev, *tmp;
+	LIST_HEAD(destroy_list);
 
 	spin_lock(&xpdev->cdev_lock);
 	for (; qdata != qmax; qdata++) {
@@ -1650,7 +1840,8 @@ static void xpdev_device_cleanup(struct xlnx_pci_dev *xpdev)
 			/* if either h2c(1) or c2h(2) bit set, but not both */
 			if (qdata->xcdev->dir_init == 1 ||
 				qdata->xcdev->dir_init == 2) {
-				qdma_cdev_destroy(qdata->xcdev);
+				list_add_tail(&qdata->xcdev->list_head,
+						&destroy_list);
 			} else { /* both bits are set so remove one */
 				qdata->xcdev->dir_init >>= 1;
 			}
@@ -1658,6 +1849,12 @@ static void xpdev_device_cleanup(struct xlnx_pci_dev *xpdev)
 		memset(qdata, 0, sizeof(*qdata));
 	}
 	spin_unlock(&xpdev->cdev_lock);
+
+	/* qdma_cdev_destroy() sleeps, outside of the cdev lock */
+	list_for_each_entry_safe(xcdev, tmp, &destroy_list, list_head) {
+		list_del(&xcdev->list_head);
+		qdma_cdev_destroy(xcdev);
+	}
 }
 
 static void remove_one(struct pci_dev *pdev)
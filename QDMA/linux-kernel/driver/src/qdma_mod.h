@@ -176,6 +176,46 @@ int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
 int xpdev_queue_delete(struct xlnx_pci_dev *xpdev, unsigned int qidx,
 		u8 q_type, char *ebuf, int ebuflen);
 
+/*****************************************************************************/
+/**
+ * xpdev_queue_add_bulk() - add a range of queues with qdma_queue_add_bulk()
+ *
+ * @param[in]	xpdev:		pointer to xlnx_pci_dev
+ * @param[in]	qconf:		queue configuration template
+ * @param[in]	q_cnt:		number of queues (pairs) to add
+ * @param[in]	is_qp:		add the other direction of each queue too
+ * @param[out]	stats:		per phase timing, summed over the directions
+ * @param[in]	ebuflen:	buffer length
+ * @param[out]	ebuf:		error message buffer
+ *
+ * @return	0: success
+ * @return	<0: failure, the queues added so far are kept
+ *****************************************************************************/
+int xpdev_queue_add_bulk(struct xlnx_pci_dev *xpdev,
+		struct qdma_queue_conf *qconf, unsigned int q_cnt, u8 is_qp,
+		struct qdma_q_bulk_stats *stats, char *ebuf, int ebuflen);
+
+/*****************************************************************************/
+/**
+ * xpdev_queue_delete_bulk() - delete a range of queues with
+ *				qdma_queue_remove_bulk()
+ *
+ * @param[in]	xpdev:		pointer to xlnx_pci_dev
+ * @param[in]	qidx:		first queue index
+ * @param[in]	q_cnt:		number of queues (pairs) to delete
+ * @param[in]	q_type:		queue type
+ * @param[in]	is_qp:		delete the other direction of each queue too
+ * @param[out]	stats:		per phase timing
+ * @param[in]	ebuflen:	buffer length
+ * @param[out]	ebuf:		error message buffer
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int xpdev_queue_delete_bulk(struct xlnx_pci_dev *xpdev, unsigned int qidx,
+		unsigned int q_cnt, u8 q_type, u8 is_qp,
+		struct qdma_q_bulk_stats *stats, char *ebuf, int ebuflen);
+
 int xpdev_nl_queue_start(struct xlnx_pci_dev *xpdev, void *nl_info, u8 is_qp,
 			u8 q_type, unsigned short qidx, unsigned short qcnt);
 
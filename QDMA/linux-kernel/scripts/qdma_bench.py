@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+#
+# Parameter sweep driver for dma-perf and dma-latency with JSON/CSV output.
+#
+# The spec is a JSON file naming the tool, the config keys common to all
+# points and the keys to sweep, every combination of the sweep values is
+# one run:
+#
+#   {
+#     "tool": "dma-perf",
+#     "base": {"mode": "mm", "dir": "bi", "pf_range": "0:0",
+#              "pci_bus": "17", "pci_device": "00", "runtime": 10,
+#              "num_pkt": 64, "tmr_idx": 5, "cntr_idx": 6},
+#     "sweep": {"pkt_sz": [64, 4096, 65536], "num_q": [1, 4],
+#               "rngidx": [5, 9], "trig_mode": ["cntr_tmr"],
+#               "num_threads": [1, 4]}
+#   }
+#
+#   ./qdma_bench.py spec.json --json out.json --csv out.csv
+#
+# Sweep keys are written to the tool config as they are, except num_q
+# which becomes q_range=0:<num_q - 1>. For every point the throughput and
+# IOPS (dma-perf), the latency (dma-latency) and the utilization of every
+# cpu over the run, from /proc/stat, are recorded. With "cpu_acct": 1 in
+# the base config the cpu cost reported by the tool (cpu_cycles_per_byte,
+# cpu_cores_per_gbps, ...) is recorded as well, with "integrity": 1 the
+# data integrity error counts (integrity_crc_err, ...).
+#
+
+import argparse
+import csv
+import itertools
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+PERF_RE = re.compile(r'^(WRITE|READ): total pps = (\d+)')
+PINGPONG_RE = re.compile(r'^(Min|Max|Avg) Ping Pong Latency = (\d+)')
+LAT_RE = re.compile(r'^(Latency|Service time) (min|max|avg|p[\d.]+) = (\d+)')
+CPU_RE = re.compile(r'([\w/]+) = ([\d.]+)')
+
+
+def cpu_times():
+    cpus = {}
+    with open('/proc/stat') as f:
+        for line in f:
+            if not line.startswith('cpu') or line.startswith('cpu '):
+                continue
+            v = line.split()
+            t = [int(x) for x in v[1:]]
+            # idle + iowait
+            cpus[v[0]] = (sum(t), t[3] + (t[4] if len(t) > 4 else 0))
+    return cpus
+
+
+def cpu_util(before, after):
+    util = {}
+    for cpu, (total, idle) in after.items():
+        if cpu not in before:
+            continue
+        dt = total - before[cpu][0]
+        di = idle - before[cpu][1]
+        util[cpu] = round(100.0 * (dt - di) / dt, 2) if dt else 0.0
+    return util
+
+
+def points(spec):
+    sweep = spec.get('sweep', {})
+    keys = sorted(sweep)
+    for vals in itertools.product(*[sweep[k] for k in keys]):
+        yield dict(zip(keys, vals))
+
+
+def write_config(path, spec, point):
+    conf = dict(spec.get('base', {}))
+    for k, v in point.items():
+        if k == 'num_q':
+            conf['q_range'] = '0:%u' % (int(v) - 1)
+        else:
+            conf[k] = v
+    with open(path, 'w') as f:
+        for k, v in conf.items():
+            f.write('%s=%s\n' % (k, v))
+    return conf
+
+
+def parse_output(out, conf):
+    res = {}
+    pkt_sz = int(conf.get('pkt_sz', 0))
+    for line in out.splitlines():
+        m = PERF_RE.match(line.strip())
+        if m:
+            d = m.group(1).lower()
+            pps = int(m.group(2))
+            res['%s_iops' % d] = pps
+            res['%s_bytes_per_sec' % d] = pps * pkt_sz
+            continue
+        m = PINGPONG_RE.match(line.strip())
+        if m:
+            res['pingpong_%s' % m.group(1).lower()] = int(m.group(2))
+            continue
+        m = LAT_RE.match(line.strip())
+        if m:
+            kind = 'lat' if m.group(1) == 'Latency' else 'svc'
+            res['%s_%s_ns' % (kind, m.group(2))] = int(m.group(3))
+            continue
+        if line.startswith('CPU '):
+            for k, v in CPU_RE.findall(line[4:]):
+                k = k.lower().replace('/', '_per_')
+                res['cpu_%s' % k] = float(v)
+            continue
+        if line.startswith('INTEGRITY '):
+            for k, v in CPU_RE.findall(line[10:]):
+                res['integrity_%s' % k] = int(v)
+    return res
+
+
+def run_point(spec, point, binary, timeout):
+    fd, cfg = tempfile.mkstemp(prefix='qdma_bench_', text=True)
+    os.close(fd)
+    try:
+        conf = write_config(cfg, spec, point)
+        before = cpu_times()
+        t0 = time.time()
+        p = subprocess.run([binary, '-c', cfg], stdout=subprocess.PIPE,
+                           stderr=subprocess.STDOUT,
+                           universal_newlines=True, timeout=timeout)
+        elapsed = time.time() - t0
+        util = cpu_util(before, cpu_times())
+    finally:
+        os.unlink(cfg)
+
+    rec = dict(point)
+    rec['rc'] = p.returncode
+    rec['elapsed_sec'] = round(elapsed, 3)
+    rec.update(parse_output(p.stdout, conf))
+    rec['cpu_util'] = util
+    return rec, p.stdout
+
+
+def write_csv(path, recs):
+    cpus = sorted({c for r in recs for c in r['cpu_util']},
+                  key=lambda c: int(c[3:]))
+    cols = []
+    for r in recs:
+        for k in r:
+            if k != 'cpu_util' and k not in cols:
+                cols.append(k)
+    with open(path, 'w', newline='') as f:
+        w = csv.writer(f)
+        w.writerow(cols + ['%s_util' % c for c in cpus])
+        for r in recs:
+            w.writerow([r.get(k, '') for k in cols] +
+                       [r['cpu_util'].get(c, '') for c in cpus])
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='qdma benchmark parameter sweeps')
+    parser.add_argument('spec', help='sweep spec, JSON')
+    parser.add_argument('--bin', help='tool binary, default the spec '
+                        '"bin" or the tool name from PATH')
+    parser.add_argument('--json', help='write the results as JSON')
+    parser.add_argument('--csv', help='write the results as CSV')
+    parser.add_argument('--timeout', type=int, default=600,
+                        help='timeout per point in seconds')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='echo the tool output')
+    args = parser.parse_args()
+
+    with open(args.spec) as f:
+        spec = json.load(f)
+    tool = spec.get('tool', 'dma-perf')
+    if tool not in ('dma-perf', 'dma-latency'):
+        sys.exit('unsupported tool %s' % tool)
+    binary = args.bin or spec.get('bin', tool)
+
+    recs = []
+    for point in points(spec):
+        sys.stderr.write('%s %s\n' % (tool, json.dumps(point,
+                                                        sort_keys=True)))
+        rec, out = run_point(spec, point, binary, args.timeout)
+        if args.verbose:
+            sys.stderr.write(out)
+        recs.append(rec)
+
+    result = {'tool': tool, 'spec': spec,
+              'host': os.uname().nodename,
+              'kernel': os.uname().release,
+              'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+              'results': recs}
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(result, f, indent=1)
+    if args.csv:
+        write_csv(args.csv, recs)
+    if not args.json and not args.csv:
+        json.dump(result, sys.stdout, indent=1)
+        sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+    main()
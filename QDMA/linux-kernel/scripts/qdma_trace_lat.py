@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+#
+# Per stage request latency histograms from the qdma tracepoints.
+#
+# Enable the events, run the traffic and feed the trace to this script:
+#
+#   echo 1 > /sys/kernel/tracing/events/qdma_pf/enable   (qdma_vf for VFs)
+#   ... run traffic ...
+#   cat /sys/kernel/tracing/trace | ./qdma_trace_lat.py
+#
+# "trace-cmd report" output works as well. Each request is followed
+#   submit -> desc_post -> doorbell -> detect -> cmpl -> done
+# with the stages a request type does not have (e.g. post/doorbell for
+# ST C2H reads) skipped. doorbell, detect and cmpl are per queue events:
+# a doorbell is charged to the requests posted before it, detect and cmpl
+# are the last such events on the queue before the request is done.
+#
+
+import argparse
+import re
+import sys
+
+STAGES = ['submit', 'post', 'doorbell', 'detect', 'cmpl', 'done']
+EVENT_RE = re.compile(r'\bqdma_(req_submit|desc_post|doorbell|cmpl_detect|'
+                      r'cmpl_proc|req_done):\s+(.*)$')
+KV_RE = re.compile(r'(\w+)=(\S+)')
+NR_BUCKETS = 16
+
+
+class Queue:
+    def __init__(self):
+        self.posted = []
+        self.last_detect = 0
+        self.last_cmpl = 0
+
+
+class Hist:
+    def __init__(self):
+        self.samples = []
+
+    def add(self, ns):
+        self.samples.append(ns)
+
+    def dump(self, name, out):
+        s = sorted(self.samples)
+        n = len(s)
+        if not n:
+            return
+        pct = lambda p: s[min(n - 1, int(n * p / 100))]
+        out.write('%-18s n %-8u min %9.2f p50 %9.2f p99 %9.2f max %9.2f '
+                  'avg %9.2f us\n' %
+                  (name, n, s[0] / 1e3, pct(50) / 1e3, pct(99) / 1e3,
+                   s[-1] / 1e3, sum(s) / n / 1e3))
+        buckets = [0] * NR_BUCKETS
+        for ns in s:
+            b = min((ns // 1000).bit_length(), NR_BUCKETS - 1)
+            buckets[b] += 1
+        peak = max(buckets)
+        for b, cnt in enumerate(buckets):
+            if not cnt:
+                continue
+            if b == NR_BUCKETS - 1:
+                label = '>= %u' % (1 << (b - 1))
+            else:
+                label = '< %u' % (1 << b)
+            out.write('    %10s us %10u %s\n' %
+                      (label, cnt, '#' * max(1, cnt * 40 // peak)))
+
+
+def qkey(kv, per_queue):
+    if not per_queue:
+        return 'all'
+    return 'dev %s q %s %s %s' % (kv['dev'], kv['qid'],
+                                  'st' if kv['st'] == '1' else 'mm',
+                                  ['h2c', 'c2h', 'cmpt'][int(kv['type'])])
+
+
+def process(lines, per_queue):
+    queues = {}
+    reqs = {}
+    hists = {}
+
+    for line in lines:
+        m = EVENT_RE.search(line)
+        if not m:
+            continue
+        ev = m.group(1)
+        kv = dict(KV_RE.findall(m.group(2)))
+        ts = int(kv['ts'])
+        q = queues.setdefault((kv['dev'], kv['qid'], kv['type']), Queue())
+
+        if ev == 'req_submit':
+            reqs[kv['req']] = {'submit': ts}
+        elif ev == 'desc_post':
+            r = reqs.get(kv['req'])
+            if r is not None and 'post' not in r:
+                r['post'] = ts
+                q.posted.append(r)
+        elif ev == 'doorbell':
+            for r in q.posted:
+                r.setdefault('doorbell', ts)
+            q.posted = []
+        elif ev == 'cmpl_detect':
+            q.last_detect = ts
+        elif ev == 'cmpl_proc':
+            q.last_cmpl = ts
+        elif ev == 'req_done':
+            r = reqs.pop(kv['req'], None)
+            if r is None:
+                continue
+            last = max(r.values())
+            if q.last_detect >= last:
+                r['detect'] = q.last_detect
+                last = q.last_detect
+            if q.last_cmpl >= last:
+                r['cmpl'] = q.last_cmpl
+            r['done'] = ts
+            q.posted = [p for p in q.posted if p is not r]
+
+            h = hists.setdefault(qkey(kv, per_queue), {})
+            prev = None
+            for st in STAGES:
+                if st not in r:
+                    continue
+                if prev is not None:
+                    h.setdefault('%s->%s' % (prev, st),
+                                 Hist()).add(r[st] - r[prev])
+                prev = st
+            h.setdefault('total', Hist()).add(r['done'] - r['submit'])
+
+    return hists
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='qdma per stage request latency histograms')
+    parser.add_argument('trace', nargs='?', default='-',
+                        help='ftrace text output, default stdin')
+    parser.add_argument('-q', '--per-queue', action='store_true',
+                        help='report every queue separately')
+    args = parser.parse_args()
+
+    f = sys.stdin if args.trace == '-' else open(args.trace)
+    hists = process(f, args.per_queue)
+
+    order = ['%s->%s' % (a, b) for i, a in enumerate(STAGES)
+             for b in STAGES[i + 1:]] + ['total']
+    for key in sorted(hists):
+        sys.stdout.write('=== %s ===\n' % key)
+        for name in order:
+            if name in hists[key]:
+                hists[key][name].dump(name, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
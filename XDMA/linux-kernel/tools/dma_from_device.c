@@ -41,6 +41,7 @@ static struct option const long_opts[] = {
 	{"count", required_argument, NULL, 'c'},
 	{"file", required_argument, NULL, 'f'},
 	{"eop_flush", no_argument, NULL, 'e'},
+	{"cpu", no_argument, NULL, 'u'},
 	{"help", no_argument, NULL, 'h'},
 	{"verbose", no_argument, NULL, 'v'},
 	{0, 0, 0, 0}
@@ -50,6 +51,7 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 		uint64_t size, uint64_t offset, uint64_t count,
 		char *ofname);
 static int eop_flush = 0;
+static int cpu_acct = 0;
 
 static void usage(const char *name)
 {
@@ -89,6 +91,10 @@ static void usage(const char *name)
 	fprintf(stdout,
 		 "\t\t* acutal # of bytes dma'ed could be smaller than specified\n");
 	i++;
+	fprintf(stdout,
+		"  -%c (--%s) report the cpu cost of the transfers\n",
+		long_opts[i].val, long_opts[i].name);
+	i++;
 	fprintf(stdout, "  -%c (--%s) print usage help and exit\n",
 		long_opts[i].val, long_opts[i].name);
 	i++;
@@ -113,7 +119,7 @@ int main(int argc, char *argv[])
 	uint64_t count = COUNT_DEFAULT;
 	char *ofname = NULL;
 
-	while ((cmd_opt = getopt_long(argc, argv, "vhec:f:d:a:k:s:o:", long_opts,
+	while ((cmd_opt = getopt_long(argc, argv, "vhec:f:d:a:k:s:o:u", long_opts,
 			    NULL)) != -1) {
 		switch (cmd_opt) {
 		case 0:
@@ -150,6 +156,9 @@ int main(int argc, char *argv[])
 		case 'v':
 			verbose = 1;
 			break;
+		case 'u':
+			cpu_acct = 1;
+			break;
 		case 'e':
 			eop_flush = 1;
 			break;
@@ -187,6 +196,8 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 	float result;
 	float avg_time = 0;
 	int underflow = 0;
+	uint64_t total_bytes = 0;
+	struct cpu_snap cpu_start, cpu_end;
 
 	/*
 	 * use O_TRUNC to indicate to the driver to flush the data up based on
@@ -228,6 +239,9 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 	if (verbose)
 	fprintf(stdout, "host buffer 0x%lx, %p.\n", size + 4096, buffer);
 
+	if (cpu_acct)
+		cpu_snapshot(&cpu_start);
+
 	for (i = 0; i < count; i++) {
 		rc = clock_gettime(CLOCK_MONOTONIC, &ts_start);
 		if (apt_loop) {
@@ -257,6 +271,7 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 				underflow = 1;
 		}
 		clock_gettime(CLOCK_MONOTONIC, &ts_end);
+		total_bytes += bytes_done;
 
 
 		/* subtract the start time from the end time */
@@ -291,6 +306,10 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 		rc = 0;
 	} else 
 		rc = -EIO;
+	if (cpu_acct) {
+		cpu_snapshot(&cpu_end);
+		cpu_report(&cpu_start, &cpu_end, total_bytes, count);
+	}
 
 out:
 	close(fpga_fd);
@@ -38,6 +38,7 @@ static struct option const long_opts[] = {
 	{"count", required_argument, NULL, 'c'},
 	{"data infile", required_argument, NULL, 'f'},
 	{"data outfile", required_argument, NULL, 'w'},
+	{"cpu", no_argument, NULL, 'u'},
 	{"help", no_argument, NULL, 'h'},
 	{"verbose", no_argument, NULL, 'v'},
 	{0, 0, 0, 0}
@@ -46,6 +47,7 @@ static struct option const long_opts[] = {
 #define DEVICE_NAME_DEFAULT "/dev/xdma0_h2c_0"
 #define SIZE_DEFAULT (32)
 #define COUNT_DEFAULT (1)
+static int cpu_acct = 0;
 
 
 static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
@@ -87,6 +89,10 @@ static void usage(const char *name)
 		"  -%c (--%s) filename to write the data of the transfers\n",
 		long_opts[i].val, long_opts[i].name);
 	i++;
+	fprintf(stdout,
+		"  -%c (--%s) report the cpu cost of the transfers\n",
+		long_opts[i].val, long_opts[i].name);
+	i++;
 	fprintf(stdout, "  -%c (--%s) print usage help and exit\n",
 		long_opts[i].val, long_opts[i].name);
 	i++;
@@ -112,7 +118,7 @@ int main(int argc, char *argv[])
 	char *ofname = NULL;
 
 	while ((cmd_opt =
-		getopt_long(argc, argv, "vhc:f:d:a:k:s:o:w:", long_opts,
+		getopt_long(argc, argv, "vhc:f:d:a:k:s:o:w:u", long_opts,
 			    NULL)) != -1) {
 		switch (cmd_opt) {
 		case 0:
@@ -153,6 +159,9 @@ int main(int argc, char *argv[])
 		case 'v':
 			verbose = 1;
 			break;
+		case 'u':
+			cpu_acct = 1;
+			break;
 		case 'h':
 		default:
 			usage(argv[0]);
@@ -190,6 +199,8 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 	float result;
 	float avg_time = 0;
 	int underflow = 0;
+	uint64_t total_bytes = 0;
+	struct cpu_snap cpu_start, cpu_end;
 
 	if (fpga_fd < 0) {
 		fprintf(stderr, "unable to open device %s, %d.\n",
@@ -239,6 +250,9 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 			goto out;
 	}
 
+	if (cpu_acct)
+		cpu_snapshot(&cpu_start);
+
 	for (i = 0; i < count; i++) {
 		/* write buffer to AXI MM address using SGDMA */
 		rc = clock_gettime(CLOCK_MONOTONIC, &ts_start);
@@ -273,6 +287,7 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 		}
 
 		rc = clock_gettime(CLOCK_MONOTONIC, &ts_end);
+		total_bytes += bytes_done;
 		/* subtract the start time from the end time */
 		timespec_sub(&ts_end, &ts_start);
 		total_time += ts_end.tv_nsec;
@@ -299,6 +314,10 @@ static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 			devname, total_time, avg_time, size, result);
 		printf("%s ** Average BW = %lu, %f\n", devname, size, result);
 	}
+	if (cpu_acct) {
+		cpu_snapshot(&cpu_end);
+		cpu_report(&cpu_start, &cpu_end, total_bytes, count);
+	}
 
 out:
 	close(fpga_fd);
@@ -10,10 +10,16 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 
 /*
  * man 2 write:
@@ -181,3 +187,208 @@ void timespec_sub(struct timespec *t1, struct timespec *t2)
 		t1->tv_nsec += 1000000000;
 	}
 }
+
+/*
+ * cpu cost accounting: the cpu time spent on the host between two samples,
+ * system wide (in clock ticks summed over all cpus), by this process, by
+ * the ksoftirqd, kworker and xdma completion kernel threads, and the
+ * interrupts taken on the xdma vectors.
+ */
+struct cpu_snap {
+	uint64_t wall_ns;
+	uint64_t proc_us;
+	uint64_t user;
+	uint64_t system;
+	uint64_t irq;
+	uint64_t softirq;
+	uint64_t ksoftirqd;
+	uint64_t kworker;
+	uint64_t dma_thrd;
+	uint64_t intr;
+};
+
+#define KTHREADD_PID	2
+
+static uint64_t tv_us(struct timeval *tv)
+{
+	return (uint64_t)tv->tv_sec * 1000000ULL + tv->tv_usec;
+}
+
+/* kernel thread totals go down when a thread exits during the run */
+static uint64_t delta(uint64_t start, uint64_t end)
+{
+	return end > start ? end - start : 0;
+}
+
+static void cpu_kthread_read(struct cpu_snap *snap)
+{
+	DIR *dir;
+	struct dirent *de;
+	char path[300];
+	char buf[512];
+
+	dir = opendir("/proc");
+	if (!dir)
+		return;
+
+	while ((de = readdir(dir)) != NULL) {
+		unsigned long long utime, stime;
+		char *comm, *p;
+		int ppid;
+		FILE *fp;
+
+		if (!isdigit(de->d_name[0]))
+			continue;
+		snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
+		fp = fopen(path, "r");
+		if (!fp)
+			continue;
+		p = fgets(buf, sizeof(buf), fp);
+		fclose(fp);
+		if (!p)
+			continue;
+
+		/* pid (comm) state ppid ..., comm may contain blanks */
+		comm = strchr(buf, '(');
+		p = strrchr(buf, ')');
+		if (!comm || !p)
+			continue;
+		comm++;
+		*p = '\0';
+		if (sscanf(p + 1, " %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+			   "%llu %llu", &ppid, &utime, &stime) != 3)
+			continue;
+		if (ppid != KTHREADD_PID)
+			continue;
+
+		if (!strncmp(comm, "ksoftirqd/", 10))
+			snap->ksoftirqd += utime + stime;
+		else if (!strncmp(comm, "kworker/", 8))
+			snap->kworker += utime + stime;
+		else if (!strncmp(comm, "cmpl_status_th", 14))
+			snap->dma_thrd += utime + stime;
+	}
+	closedir(dir);
+}
+
+static void cpu_intr_read(struct cpu_snap *snap)
+{
+	FILE *fp;
+	char *line = NULL;
+	size_t len = 0;
+
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return;
+
+	while (getline(&line, &len, fp) != -1) {
+		char *p, *end;
+		unsigned long long cnt;
+
+		if (!strstr(line, "xdma"))
+			continue;
+		p = strchr(line, ':');
+		if (!p)
+			continue;
+		/* one count per cpu, up to the chip and action names */
+		for (p++; ; p = end) {
+			cnt = strtoull(p, &end, 10);
+			if (end == p)
+				break;
+			snap->intr += cnt;
+		}
+	}
+	free(line);
+	fclose(fp);
+}
+
+static unsigned int cpu_mhz_read(void)
+{
+	FILE *fp;
+	char buf[256];
+	double mhz, sum = 0;
+	unsigned int n = 0;
+
+	fp = fopen("/proc/cpuinfo", "r");
+	if (!fp)
+		return 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (sscanf(buf, "cpu MHz : %lf", &mhz) == 1) {
+			sum += mhz;
+			n++;
+		}
+	}
+	fclose(fp);
+
+	return n ? (unsigned int)(sum / n + 0.5) : 0;
+}
+
+int cpu_snapshot(struct cpu_snap *snap)
+{
+	unsigned long long user, nice, system, idle, iowait, irq, softirq;
+	struct timespec ts;
+	struct rusage ru;
+	FILE *fp;
+	int rc;
+
+	memset(snap, 0, sizeof(*snap));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	snap->wall_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		snap->proc_us = tv_us(&ru.ru_utime) + tv_us(&ru.ru_stime);
+
+	fp = fopen("/proc/stat", "r");
+	if (!fp)
+		return -errno;
+	rc = fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu", &user,
+		    &nice, &system, &idle, &iowait, &irq, &softirq);
+	fclose(fp);
+	if (rc != 7)
+		return -EINVAL;
+	snap->user = user + nice;
+	snap->system = system;
+	snap->irq = irq;
+	snap->softirq = softirq;
+
+	cpu_kthread_read(snap);
+	cpu_intr_read(snap);
+	return 0;
+}
+
+/*
+ * cycles are counted at the average clock from /proc/cpuinfo, the cost is
+ * the system wide busy time so the kernel threads and interrupts are
+ * charged to the transfers.
+ */
+void cpu_report(struct cpu_snap *start, struct cpu_snap *end,
+		uint64_t bytes, uint64_t reqs)
+{
+	double hz = (double)sysconf(_SC_CLK_TCK);
+	double wall = (end->wall_ns - start->wall_ns) / 1e9;
+	double user = (end->user - start->user) / hz;
+	double system = (end->system - start->system) / hz;
+	double irq = (end->irq - start->irq) / hz;
+	double softirq = (end->softirq - start->softirq) / hz;
+	double busy = user + system + irq + softirq;
+	double cores = wall > 0 ? busy / wall : 0;
+	double gbps = wall > 0 ? bytes * 8 / wall / 1e9 : 0;
+	unsigned int mhz = cpu_mhz_read();
+	double cycles = busy * mhz * 1e6;
+
+	printf("CPU busy = %.3f s, cores = %.3f, user = %.3f s, sys = %.3f s, "
+	       "irq = %.3f s, softirq = %.3f s\n",
+	       busy, cores, user, system, irq, softirq);
+	printf("CPU process = %.3f s, ksoftirqd = %.3f s, kworker = %.3f s, "
+	       "xdma_thrd = %.3f s\n",
+	       (end->proc_us - start->proc_us) / 1e6,
+	       delta(start->ksoftirqd, end->ksoftirqd) / hz,
+	       delta(start->kworker, end->kworker) / hz,
+	       delta(start->dma_thrd, end->dma_thrd) / hz);
+	printf("CPU intr = %lu, intr/s = %.0f\n", end->intr - start->intr,
+	       wall > 0 ? (end->intr - start->intr) / wall : 0);
+	printf("CPU MHz = %u, cycles/byte = %.3f, cycles/req = %.1f, "
+	       "cores/Gbps = %.4f\n", mhz,
+	       bytes ? cycles / bytes : 0, reqs ? cycles / reqs : 0,
+	       gbps > 0 ? cores / gbps : 0);
+}
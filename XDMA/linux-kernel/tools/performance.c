@@ -24,6 +24,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "dma_utils.c"
+
 /* @TODO During kernel upstreaming, the IOCTL must move into the public user API of the kernel */
 #include "../xdma/cdev_sgdma.h"
 
@@ -38,6 +40,7 @@ static struct option const long_opts[] =
   {"non-incremental", no_argument, NULL, 'n'},
   {"verbose", no_argument, NULL, 'v'},
   {"help", no_argument, NULL, 'h'},
+  {"cpu", no_argument, NULL, 'u'},
   {0, 0, 0, 0}
 };
 
@@ -49,26 +52,19 @@ static void usage(const char* name)
   printf("Performance test for XDMA SGDMA engine.\n\n");
 
   printf("  -%c (--%s) device\n", long_opts[i].val, long_opts[i].name); i++;
+  printf("  -%c (--%s) number of transfers\n", long_opts[i].val, long_opts[i].name); i++;
+  printf("  -%c (--%s) size of a single transfer in bytes\n", long_opts[i].val, long_opts[i].name); i++;
   printf("  -%c (--%s) incremental\n", long_opts[i].val, long_opts[i].name); i++;
   printf("  -%c (--%s) non-incremental\n", long_opts[i].val, long_opts[i].name); i++;
   printf("  -%c (--%s) be more verbose during test\n", long_opts[i].val, long_opts[i].name); i++;
   printf("  -%c (--%s) print usage help and exit\n", long_opts[i].val, long_opts[i].name); i++;
-}
-
-static uint32_t getopt_integer(char *optarg)
-{
-  int rc;
-  uint32_t value;
-  rc = sscanf(optarg, "0x%x", &value);
-  if (rc <= 0)
-    rc = sscanf(optarg, "%ul", &value);
-  //printf("sscanf() = %d, value = 0x%08x\n", rc, (unsigned int)value);
-  return value;
+  printf("  -%c (--%s) report the cpu cost of the test\n", long_opts[i].val, long_opts[i].name); i++;
 }
 
 int test_dma(char *device_name, int size, int count);
 
 static int verbosity = 0;
+static int cpu_acct = 0;
 
 int main(int argc, char *argv[])
 {
@@ -78,7 +74,7 @@ int main(int argc, char *argv[])
   uint32_t count = 1;
   char *filename = NULL;
 
-  while ((cmd_opt = getopt_long(argc, argv, "vhic:d:s:", long_opts, NULL)) != -1)
+  while ((cmd_opt = getopt_long(argc, argv, "vhuic:d:s:", long_opts, NULL)) != -1)
   {
     switch (cmd_opt)
     {
@@ -88,6 +84,9 @@ int main(int argc, char *argv[])
       case 'v':
         verbosity++;
         break;
+      case 'u':
+        cpu_acct = 1;
+        break;
       /* device node name */
       case 'd':
         printf("'%s'\n", optarg);
@@ -125,6 +124,10 @@ int test_dma(char *device_name, int size, int count)
   }
 
   unsigned char status = 1;
+  struct cpu_snap cpu_start, cpu_end;
+
+  if (cpu_acct)
+    cpu_snapshot(&cpu_start);
 
   perf.version = IOCTL_XDMA_PERF_V1;
   perf.transfer_size = size;
@@ -170,6 +173,11 @@ int test_dma(char *device_name, int size, int count)
     printf (" data rate ***** bytes length = %d, rate = %f \n", perf.transfer_size, (double)(long long)perf.data_cycle_count/(long long)perf.clock_cycle_count);
   }
   printf("perf.pending_count = %lld\n", (long long)perf.pending_count);
+  if (cpu_acct) {
+    cpu_snapshot(&cpu_end);
+    cpu_report(&cpu_start, &cpu_end,
+               (uint64_t)perf.transfer_size * perf.iterations, perf.iterations);
+  }
 
   close(fd);
 }